@@ -0,0 +1,228 @@
+// Compares the binary lookup protocol (BINARY_PORT) with /ip-location over HTTP on a running
+// service, with the same connections and addresses. Each HTTP connection is kept alive and
+// sends its next request when the previous response arrives. Each binary connection sends
+// `pipeline depth` requests at a time with BinaryClient and waits for all their answers, so
+// a depth of 1 isolates the protocol cost and larger depths show what pipelining adds.
+// Latencies are per round trip, that is per batch for the binary protocol.
+//
+//   bench_binary_lookup [host] [http port] [binary port] [connections] [seconds] [pipeline depth] [distinct addresses]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "client/binary_client.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    size_t requests = 0;
+    size_t errors = 0;
+    size_t found = 0;
+    std::vector<double> latencies_ms;
+};
+
+// public unicast addresses, so requests are not answered from the reserved range table
+std::vector<IpAddress> make_addresses(size_t count) {
+    std::mt19937 rng(7);
+    std::vector<IpAddress> addresses;
+    while (addresses.size() < count) {
+        uint32_t value = static_cast<uint32_t>(rng());
+        uint32_t first = value >> 24;
+        uint32_t second = (value >> 16) & 0xFF;
+        if (first == 0 || first == 10 || first == 127 || first >= 224 || (first == 100 && second >= 64 && second < 128)
+            || (first == 169 && second == 254) || (first == 172 && second >= 16 && second < 32) || (first == 192 && second == 168)) {
+            continue;
+        }
+        addresses.push_back(IpAddress::from_v4(value));
+    }
+    return addresses;
+}
+
+int connect_http(const char* host, const char* port) {
+    addrinfo hints{};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* resolved = nullptr;
+    if (getaddrinfo(host, port, &hints, &resolved) != 0 || !resolved) {
+        return -1;
+    }
+    int fd = socket(resolved->ai_family, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, resolved->ai_addr, resolved->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(resolved);
+    if (fd >= 0) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+// length of the first complete response in `in` and its status, or 0 if it is incomplete
+size_t complete_response(const std::string& in, int& status) {
+    size_t header_end = in.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return 0;
+    }
+    status = std::atoi(in.c_str() + in.find(' ') + 1);
+
+    size_t content_length = 0;
+    std::string headers = in.substr(0, header_end);
+    std::transform(headers.begin(), headers.end(), headers.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t length_header = headers.find("\r\ncontent-length:");
+    if (length_header != std::string::npos) {
+        content_length = std::strtoull(headers.c_str() + length_header + 17, nullptr, 10);
+    }
+
+    size_t total = header_end + 4 + content_length;
+    return in.size() >= total ? total : 0;
+}
+
+void run_http(const char* host, const char* port, const std::vector<IpAddress>& addresses, unsigned seed,
+              Clock::time_point deadline, Result& result) {
+    int fd = connect_http(host, port);
+    if (fd < 0) {
+        ++result.errors;
+        return;
+    }
+    std::mt19937 rng(seed);
+    std::string in;
+    char buffer[16384];
+    while (Clock::now() < deadline) {
+        std::string request = "GET /ip-location?ip=" + addresses[rng() % addresses.size()].to_string()
+            + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: keep-alive\r\n\r\n";
+        auto sent = Clock::now();
+        if (write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+            ++result.errors;
+            break;
+        }
+
+        int status = 0;
+        size_t length;
+        while ((length = complete_response(in, status)) == 0) {
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                ++result.errors;
+                close(fd);
+                return;
+            }
+            in.append(buffer, static_cast<size_t>(n));
+        }
+        in.erase(0, length);
+        result.latencies_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+        ++result.requests;
+        result.found += status == 200;
+    }
+    close(fd);
+}
+
+void run_binary(const char* host, int port, size_t depth, const std::vector<IpAddress>& addresses, unsigned seed,
+                Clock::time_point deadline, Result& result) {
+    try {
+        auto client = BinaryClient::connect_tcp(host, port);
+        std::mt19937 rng(seed);
+        while (Clock::now() < deadline) {
+            auto sent = Clock::now();
+            for (size_t i = 0; i < depth; ++i) {
+                client.send(addresses[rng() % addresses.size()]);
+            }
+            client.flush();
+            for (size_t i = 0; i < depth; ++i) {
+                result.found += client.receive().status == BinaryProtocol::Status::FOUND;
+            }
+            result.latencies_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+            result.requests += depth;
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "binary connection: %s\n", e.what());
+        ++result.errors;
+    }
+}
+
+template <typename Run>
+Result run_connections(size_t connections, int seconds, Run run) {
+    std::vector<Result> results(connections);
+    std::vector<std::thread> threads;
+    auto deadline = Clock::now() + std::chrono::seconds(seconds);
+    for (size_t i = 0; i < connections; ++i) {
+        threads.emplace_back([&, i]() { run(static_cast<unsigned>(i + 1), deadline, results[i]); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    Result total;
+    for (auto& result : results) {
+        total.requests += result.requests;
+        total.errors += result.errors;
+        total.found += result.found;
+        total.latencies_ms.insert(total.latencies_ms.end(), result.latencies_ms.begin(), result.latencies_ms.end());
+    }
+    std::sort(total.latencies_ms.begin(), total.latencies_ms.end());
+    return total;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+    return sorted[index];
+}
+
+double report(const char* name, const Result& result, int seconds) {
+    double rate = static_cast<double>(result.requests) / seconds;
+    std::printf("%-8s %10zu lookups (%.0f/s), %zu found, %zu errors; round trip ms p50 %.3f  p99 %.3f\n", name,
+                result.requests, rate, result.found, result.errors, percentile(result.latencies_ms, 0.50),
+                percentile(result.latencies_ms, 0.99));
+    return rate;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+    const char* http_port = argc > 2 ? argv[2] : "8080";
+    int binary_port = argc > 3 ? std::atoi(argv[3]) : 8081;
+    size_t connections = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 16;
+    int seconds = argc > 5 ? std::atoi(argv[5]) : 10;
+    size_t depth = std::max<size_t>(1, argc > 6 ? std::strtoull(argv[6], nullptr, 10) : 32);
+    size_t address_count = argc > 7 ? std::strtoull(argv[7], nullptr, 10) : 100000;
+
+    auto addresses = make_addresses(address_count);
+    std::printf("%zu connections, %d s each, %zu distinct addresses, pipeline depth %zu\n", connections, seconds,
+                address_count, depth);
+
+    auto http = run_connections(connections, seconds, [&](unsigned seed, Clock::time_point deadline, Result& result) {
+        run_http(host, http_port, addresses, seed, deadline, result);
+    });
+    double http_rate = report("http", http, seconds);
+
+    auto single = run_connections(connections, seconds, [&](unsigned seed, Clock::time_point deadline, Result& result) {
+        run_binary(host, binary_port, 1, addresses, seed, deadline, result);
+    });
+    double single_rate = report("binary/1", single, seconds);
+
+    auto pipelined = run_connections(connections, seconds, [&](unsigned seed, Clock::time_point deadline, Result& result) {
+        run_binary(host, binary_port, depth, addresses, seed, deadline, result);
+    });
+    double pipelined_rate = report("binary/N", pipelined, seconds);
+
+    if (http_rate > 0) {
+        std::printf("binary over http: %.2fx unpipelined, %.2fx pipelined\n", single_rate / http_rate,
+                    pipelined_rate / http_rate);
+    }
+    return 0;
+}
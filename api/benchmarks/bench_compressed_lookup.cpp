@@ -0,0 +1,154 @@
+// Reports bytes per range and lookup latency for the compressed IPv6 range table against the
+// plain sorted arrays, and bytes per record for the dictionary-coded record store against
+// expanded LocationRecords.
+//
+//   bench_compressed_lookup [ipv6 ranges] [distinct locations] [lookups]
+//
+// The synthetic feed mimics allocation structure: prefix-aligned /32 to /64 ranges under
+// 2000::/3, mostly adjacent, with occasional unassigned gaps.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "lookup/compressed_range_table.h"
+#include "lookup/record_store.h"
+#include "utils/ip_address.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<RangeTable<uint128_t>::Range> synthetic_ranges(size_t count, size_t locations, std::mt19937_64& rng) {
+    std::vector<RangeTable<uint128_t>::Range> ranges;
+    ranges.reserve(count);
+
+    uint128_t address = static_cast<uint128_t>(0x2001) << 112;
+    while (ranges.size() < count) {
+        // prefix lengths cluster around /48
+        int prefix = 32 + static_cast<int>(rng() % 33);
+        uint128_t size = static_cast<uint128_t>(1) << (128 - prefix);
+        address = (address + size - 1) & ~(size - 1);
+        if (rng() % 10 == 0) {
+            address += size * (1 + rng() % 16); // unassigned space
+        }
+        ranges.push_back({address, address + size - 1, static_cast<RecordId>(rng() % locations)});
+        address += size;
+    }
+    return ranges;
+}
+
+std::string random_word(std::mt19937_64& rng, size_t min_length, size_t max_length) {
+    size_t length = min_length + rng() % (max_length - min_length + 1);
+    std::string word;
+    for (size_t i = 0; i < length; ++i) word += static_cast<char>('a' + rng() % 26);
+    return word;
+}
+
+std::vector<LocationRecord> synthetic_records(size_t count, std::mt19937_64& rng) {
+    std::vector<std::string> countries;
+    std::vector<std::string> regions;
+    std::vector<std::string> timezones;
+    for (int i = 0; i < 240; ++i) countries.push_back(random_word(rng, 2, 2));
+    for (int i = 0; i < 4000; ++i) regions.push_back(random_word(rng, 5, 20));
+    for (int i = 0; i < 400; ++i) timezones.push_back("Region/" + random_word(rng, 4, 14));
+
+    std::vector<LocationRecord> records(count);
+    for (auto& record : records) {
+        record.country = countries[rng() % countries.size()];
+        record.city = random_word(rng, 4, 18);
+        record.region = regions[rng() % regions.size()];
+        record.latitude = static_cast<float>(static_cast<double>(rng() % 180000000) / 1e6 - 90);
+        record.longitude = static_cast<float>(static_cast<double>(rng() % 360000000) / 1e6 - 180);
+        record.postal_code = std::to_string(rng() % 100000);
+        record.timezone = timezones[rng() % timezones.size()];
+    }
+    return records;
+}
+
+size_t expanded_record_bytes(const std::vector<LocationRecord>& records) {
+    size_t bytes = records.capacity() * sizeof(LocationRecord);
+    for (const auto& record : records) {
+        // strings past the small-string buffer live in their own allocation
+        for (const auto* field : {&record.country, &record.city, &record.region, &record.postal_code, &record.timezone}) {
+            if (*field && (*field)->capacity() > 15) bytes += (*field)->capacity() + 1;
+        }
+    }
+    return bytes;
+}
+
+template <typename Lookup>
+double time_lookups(const std::vector<uint128_t>& probes, size_t& hits, Lookup lookup) {
+    hits = 0;
+    auto start = Clock::now();
+    for (uint128_t probe : probes) hits += lookup(probe) != NO_RECORD;
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(probes.size());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t range_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5'000'000;
+    size_t location_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200'000;
+    size_t lookups = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 5'000'000;
+
+    std::mt19937_64 rng(42);
+    auto ranges = synthetic_ranges(range_count, location_count, rng);
+    uint128_t span_first = ranges.front().first;
+    uint128_t span_size = ranges.back().last - span_first + 1;
+
+    RangeTable<uint128_t> table;
+    table.build(ranges);
+
+    auto start = Clock::now();
+    CompressedRangeTable<uint128_t> compressed;
+    compressed.build(table);
+    double build_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    // probes inside the populated span, so they exercise hits and gaps alike
+    std::vector<uint128_t> probes(lookups);
+    for (auto& probe : probes) {
+        uint128_t offset = ((static_cast<uint128_t>(rng()) << 64) | rng()) % span_size;
+        probe = span_first + offset;
+    }
+    for (size_t i = 0; i < probes.size(); i += 97) {
+        if (compressed.find(probes[i]) != table.find(probes[i])) {
+            std::fprintf(stderr, "mismatch at probe %zu\n", i);
+            return 1;
+        }
+    }
+
+    std::printf("%zu IPv6 ranges, %zu blocks of %zu bytes (%.1f ranges per block), built in %.1f ms\n",
+                compressed.size(), compressed.block_count(), CompressedRangeTable<uint128_t>::BLOCK_BYTES,
+                static_cast<double>(compressed.size()) / static_cast<double>(compressed.block_count()), build_ms);
+    std::printf("%-20s %12s %14s %12s %10s\n", "ranges", "total MB", "bytes/range", "ns/lookup", "hits");
+
+    size_t hits = 0;
+    double ns = time_lookups(probes, hits, [&](uint128_t key) { return table.find(key); });
+    std::printf("%-20s %12.1f %14.2f %12.2f %10zu\n", "sorted arrays", static_cast<double>(table.memory_bytes()) / (1 << 20),
+                static_cast<double>(table.memory_bytes()) / static_cast<double>(table.size()), ns, hits);
+    ns = time_lookups(probes, hits, [&](uint128_t key) { return compressed.find(key); });
+    std::printf("%-20s %12.1f %14.2f %12.2f %10zu\n", "compressed blocks", static_cast<double>(compressed.memory_bytes()) / (1 << 20),
+                static_cast<double>(compressed.memory_bytes()) / static_cast<double>(compressed.size()), ns, hits);
+
+    auto records = synthetic_records(location_count, rng);
+    RecordStore store;
+    store.build(records);
+
+    std::vector<RecordId> record_probes(lookups);
+    for (auto& id : record_probes) id = static_cast<RecordId>(rng() % records.size());
+    size_t checksum = 0;
+    start = Clock::now();
+    for (RecordId id : record_probes) checksum += store.get(id).city->size();
+    double get_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(record_probes.size());
+
+    size_t expanded = expanded_record_bytes(records);
+    std::printf("\n%zu distinct locations, %zu dictionary strings\n", store.size(), store.string_count());
+    std::printf("%-20s %12s %14s %12s\n", "records", "total MB", "bytes/record", "ns/get");
+    std::printf("%-20s %12.1f %14.2f %12s\n", "LocationRecord", static_cast<double>(expanded) / (1 << 20),
+                static_cast<double>(expanded) / static_cast<double>(records.size()), "-");
+    std::printf("%-20s %12.1f %14.2f %12.2f\n", "RecordStore", static_cast<double>(store.memory_bytes()) / (1 << 20),
+                static_cast<double>(store.memory_bytes()) / static_cast<double>(store.size()), get_ns);
+    return checksum == 0 ? 1 : 0;
+}
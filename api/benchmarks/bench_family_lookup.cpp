@@ -0,0 +1,147 @@
+// Compares per-family range tables (uint32_t keys for IPv4, uint128_t for IPv6) against a
+// single generic table that stores every bound as a 17-byte family+address key compared with
+// memcmp, the way one inet-style path would.
+//
+//   bench_family_lookup [ranges per family] [lookups]
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <vector>
+#include "lookup/range_table.h"
+#include "utils/ip_address.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// family byte followed by the address in network order, so memcmp orders like inet
+using GenericKey = std::array<uint8_t, 17>;
+
+GenericKey generic_key(const IpAddress& address) {
+    GenericKey key{};
+    if (address.is_v4()) {
+        key[0] = 4;
+        uint32_t value = address.v4();
+        for (int i = 0; i < 4; ++i) key[1 + i] = static_cast<uint8_t>(value >> (24 - 8 * i));
+    } else {
+        key[0] = 6;
+        uint128_t value = address.v6();
+        for (int i = 0; i < 16; ++i) key[1 + i] = static_cast<uint8_t>(value >> (120 - 8 * i));
+    }
+    return key;
+}
+
+struct GenericTable {
+    std::vector<GenericKey> firsts;
+    std::vector<GenericKey> lasts;
+    std::vector<RecordId> ids;
+
+    RecordId find(const GenericKey& key) const {
+        auto it = std::upper_bound(firsts.begin(), firsts.end(), key,
+                                   [](const GenericKey& k, const GenericKey& first) { return std::memcmp(k.data(), first.data(), k.size()) < 0; });
+        if (it == firsts.begin()) return NO_RECORD;
+        size_t i = static_cast<size_t>(it - firsts.begin()) - 1;
+        return std::memcmp(key.data(), lasts[i].data(), key.size()) <= 0 ? ids[i] : NO_RECORD;
+    }
+};
+
+template <typename Key>
+std::vector<typename RangeTable<Key>::Range> random_ranges(size_t count, std::mt19937_64& rng, Key (*draw)(std::mt19937_64&)) {
+    std::set<Key> boundaries;
+    while (boundaries.size() < count) boundaries.insert(draw(rng));
+
+    std::vector<typename RangeTable<Key>::Range> ranges;
+    Key previous = 0;
+    RecordId id = 0;
+    for (Key boundary : boundaries) {
+        if (boundary > previous) ranges.push_back({previous, static_cast<Key>(boundary - 1), id++ % 50000});
+        previous = boundary;
+    }
+    return ranges;
+}
+
+uint32_t draw_v4(std::mt19937_64& rng) { return static_cast<uint32_t>(rng()); }
+
+// allocated IPv6 space is concentrated under 2000::/3, so draw from there
+uint128_t draw_v6(std::mt19937_64& rng) {
+    uint128_t value = (static_cast<uint128_t>(rng()) << 64) | rng();
+    return (value >> 3) | (static_cast<uint128_t>(1) << 125);
+}
+
+template <typename Lookup>
+double time_lookups(const std::vector<IpAddress>& probes, size_t& hits, Lookup lookup) {
+    hits = 0;
+    auto start = Clock::now();
+    for (const auto& probe : probes) hits += lookup(probe) != NO_RECORD;
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(probes.size());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t range_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    size_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10'000'000;
+
+    std::mt19937_64 rng(42);
+    auto v4_ranges = random_ranges<uint32_t>(range_count, rng, draw_v4);
+    auto v6_ranges = random_ranges<uint128_t>(range_count, rng, draw_v6);
+
+    GenericTable generic;
+    for (const auto& range : v4_ranges) {
+        generic.firsts.push_back(generic_key(IpAddress::from_v4(range.first)));
+        generic.lasts.push_back(generic_key(IpAddress::from_v4(range.last)));
+        generic.ids.push_back(range.id);
+    }
+    for (const auto& range : v6_ranges) {
+        generic.firsts.push_back(generic_key(IpAddress::from_v6(range.first)));
+        generic.lasts.push_back(generic_key(IpAddress::from_v6(range.last)));
+        generic.ids.push_back(range.id);
+    }
+
+    RangeTable<uint32_t> v4_table;
+    v4_table.build(v4_ranges);
+    RangeTable<uint128_t> v6_table;
+    v6_table.build(v6_ranges);
+
+    std::vector<IpAddress> v4_probes;
+    std::vector<IpAddress> v6_probes;
+    v4_probes.reserve(lookups);
+    v6_probes.reserve(lookups);
+    for (size_t i = 0; i < lookups; ++i) {
+        v4_probes.push_back(IpAddress::from_v4(draw_v4(rng)));
+        v6_probes.push_back(IpAddress::from_v6(draw_v6(rng)));
+    }
+
+    // cross-check before timing
+    for (size_t i = 0; i < lookups; i += 101) {
+        if (v4_table.find(v4_probes[i].v4()) != generic.find(generic_key(v4_probes[i]))
+            || v6_table.find(v6_probes[i].v6()) != generic.find(generic_key(v6_probes[i]))) {
+            std::fprintf(stderr, "mismatch at probe %zu\n", i);
+            return 1;
+        }
+    }
+
+    std::printf("%zu IPv4 + %zu IPv6 ranges, %zu lookups per row\n", v4_table.size(), v6_table.size(), lookups);
+    std::printf("%-24s %12s %12s %10s\n", "table", "index MB", "ns/lookup", "hits");
+
+    auto report = [](const char* name, size_t bytes, double ns, size_t hits) {
+        std::printf("%-24s %12.1f %12.2f %10zu\n", name, static_cast<double>(bytes) / (1 << 20), ns, hits);
+    };
+    size_t generic_bytes = (generic.firsts.size() + generic.lasts.size()) * sizeof(GenericKey) + generic.ids.size() * sizeof(RecordId);
+
+    size_t hits = 0;
+    double ns = time_lookups(v4_probes, hits, [&](const IpAddress& a) { return v4_table.find(a.v4()); });
+    report("ipv4 uint32_t", v4_table.memory_bytes(), ns, hits);
+    ns = time_lookups(v4_probes, hits, [&](const IpAddress& a) { return generic.find(generic_key(a)); });
+    report("ipv4 generic", generic_bytes, ns, hits);
+    ns = time_lookups(v6_probes, hits, [&](const IpAddress& a) { return v6_table.find(a.v6()); });
+    report("ipv6 uint128_t", v6_table.memory_bytes(), ns, hits);
+    ns = time_lookups(v6_probes, hits, [&](const IpAddress& a) { return generic.find(generic_key(a)); });
+    report("ipv6 generic", generic_bytes, ns, hits);
+    return 0;
+}
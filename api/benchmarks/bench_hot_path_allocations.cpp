@@ -0,0 +1,137 @@
+// Counts heap allocations on the handler's part of a cache hit: working out the client's key
+// from the peer address and X-Forwarded-For, the rate limit check, parsing the address, building the Redis key, decoding the
+// cached value and rendering the body into the std::string the response hands to Crow. Global
+// operator new is replaced by a counting one. The body is the one allocation a request is left
+// with; the Redis client's reply and the rest of the response object are outside the handler
+// and not included.
+//
+// The same steps are also run as the handler did them before: copied client address,
+// concatenated key, owning decode and a body rendered with no reservation.
+//
+//   bench_hot_path_allocations [requests]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "cache/cache_codec.h"
+#include "cache/cache_key.h"
+#include "handlers/location_json.h"
+#include "utils/client_address.h"
+#include "utils/ip_address.h"
+#include "utils/rate_limiter.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    uint64_t allocations;
+    double ns_per_request;
+};
+
+template <typename Request>
+Result measure(size_t requests, Request request) {
+    // the first requests create the rate limiter's entry
+    for (size_t i = 0; i < 1000; ++i) {
+        request();
+    }
+    uint64_t before = g_allocations.load();
+    auto start = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        request();
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return {g_allocations.load() - before, elapsed / static_cast<double>(requests)};
+}
+
+volatile size_t g_sink = 0;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    LocationRecord record;
+    record.country = "US";
+    record.city = "San Francisco";
+    record.region = "California";
+    record.latitude = 37.77493f;
+    record.longitude = -122.41942f;
+    record.postal_code = "94103";
+    record.timezone = "America/Los_Angeles";
+    const std::string cached = CacheCodec::encode_record(record);
+
+    // as Crow holds them: the peer (a trusted load balancer), the forwarded-for header and the
+    // ip query parameter
+    const std::string peer = "10.0.3.17";
+    const std::string forwarded_for = "2001:db8:85a3::8a2e:370:7334, 10.0.1.2";
+    const char* ip_param = "2001:db8:ffff:1234:5678:9abc:def0:1234";
+    constexpr uint64_t generation = 42;
+
+    // the service's limit; the client's window is full after the warm-up, which leaves the
+    // check itself unchanged
+    RateLimiter limiter(100, 60);
+    ClientAddressResolver resolver(ClientAddressResolver::parse_prefixes("10.0.0.0/8"), 32, 64);
+    Result views = measure(requests, [&]() {
+        ClientKey client(resolver.resolve(peer, forwarded_for, ""));
+        bool allowed = limiter.is_allowed(client.view());
+        std::string_view ip = ip_param;
+        auto address = IpAddress::parse(ip);
+        CacheKey key(generation, ip);
+        auto value = CacheCodec::decode_view(cached);
+
+        std::string body;
+        body.reserve(256);
+        LocationJson::append_location(body, ip, value.record);
+        g_sink = g_sink + allowed + address.has_value() + key.size() + body.size();
+    });
+
+    RateLimiter owning_limiter(100, 60);
+    Result owning = measure(requests, [&]() {
+        std::string client_ip = forwarded_for;
+        bool allowed = owning_limiter.is_allowed(client_ip);
+        std::string ip = ip_param;
+        auto address = IpAddress::parse(ip);
+        std::string key = "ip_location:" + std::to_string(generation) + ":" + ip;
+        auto value = CacheCodec::decode(cached);
+
+        std::string body;
+        LocationJson::append_location(body, ip, LocationRecordView(value.record));
+        g_sink = g_sink + allowed + address.has_value() + key.size() + body.size();
+    });
+
+    std::printf("%zu cache hits, IPv6 client and lookup address\n", requests);
+    auto report = [&](const char* name, const Result& result) {
+        std::printf("%-28s %10llu allocations (%.2f/request)  %7.1f ns/request\n", name,
+                    static_cast<unsigned long long>(result.allocations),
+                    static_cast<double>(result.allocations) / static_cast<double>(requests), result.ns_per_request);
+    };
+    report("views and body:", views);
+    report("owning strings and decode:", owning);
+    // the response body, and nothing else
+    return views.allocations == requests ? 0 : 1;
+}
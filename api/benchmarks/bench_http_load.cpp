@@ -0,0 +1,219 @@
+// Closed-loop HTTP load generator for /ip-location, used to compare the blocking and async
+// request pipelines (REQUEST_PIPELINE) of a running service. Each connection is kept alive and
+// sends its next request as soon as the previous response arrives, so the throughput reached
+// at a given number of connections shows how many lookups the server keeps in flight.
+// The number of distinct addresses sets the cache hit ratio: few addresses are served from
+// Redis after the first pass, many keep going to Postgres.
+//
+//   bench_http_load [host] [port] [connections] [seconds] [distinct addresses]
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Connection {
+    int fd = -1;
+    std::string out;
+    size_t written = 0;
+    std::string in;
+    Clock::time_point sent;
+};
+
+// public unicast addresses, so requests are not answered from the reserved range table
+std::vector<std::string> make_addresses(size_t count) {
+    std::mt19937 rng(7);
+    std::vector<std::string> addresses;
+    while (addresses.size() < count) {
+        uint32_t value = static_cast<uint32_t>(rng());
+        uint32_t first = value >> 24;
+        uint32_t second = (value >> 16) & 0xFF;
+        if (first == 0 || first == 10 || first == 127 || first >= 224 || (first == 100 && second >= 64 && second < 128)
+            || (first == 169 && second == 254) || (first == 172 && second >= 16 && second < 32) || (first == 192 && second == 168)) {
+            continue;
+        }
+        char text[INET_ADDRSTRLEN];
+        uint32_t network = htonl(value);
+        inet_ntop(AF_INET, &network, text, sizeof(text));
+        addresses.emplace_back(text);
+    }
+    return addresses;
+}
+
+int connect_to(const addrinfo& address) {
+    int fd = socket(address.ai_family, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, address.ai_addr, address.ai_addrlen) != 0) {
+        std::perror("connect");
+        std::exit(1);
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// length of the first complete response in `in` and its status, or 0 if it is incomplete
+size_t complete_response(const std::string& in, int& status) {
+    size_t header_end = in.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return 0;
+    }
+    status = std::atoi(in.c_str() + in.find(' ') + 1);
+
+    size_t content_length = 0;
+    std::string headers = in.substr(0, header_end);
+    std::transform(headers.begin(), headers.end(), headers.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t length_header = headers.find("\r\ncontent-length:");
+    if (length_header != std::string::npos) {
+        content_length = std::strtoull(headers.c_str() + length_header + 17, nullptr, 10);
+    }
+
+    size_t total = header_end + 4 + content_length;
+    return in.size() >= total ? total : 0;
+}
+
+// writes what the socket takes and watches for writability only while a request is partly sent
+void flush(int epoll_fd, Connection& connection, size_t index) {
+    while (connection.written < connection.out.size()) {
+        ssize_t n = write(connection.fd, connection.out.data() + connection.written, connection.out.size() - connection.written);
+        if (n < 0) {
+            break;
+        }
+        connection.written += static_cast<size_t>(n);
+    }
+    epoll_event event{};
+    event.events = connection.written < connection.out.size() ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.u64 = index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+    const char* port = argc > 2 ? argv[2] : "8080";
+    size_t connection_count = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 256;
+    int seconds = argc > 4 ? std::atoi(argv[4]) : 30;
+    size_t address_count = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 100000;
+
+    addrinfo hints{};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* resolved = nullptr;
+    if (getaddrinfo(host, port, &hints, &resolved) != 0 || !resolved) {
+        std::fprintf(stderr, "cannot resolve %s:%s\n", host, port);
+        return 1;
+    }
+
+    auto addresses = make_addresses(address_count);
+    std::mt19937 rng(11);
+    auto next_request = [&]() {
+        const std::string& ip = addresses[rng() % addresses.size()];
+        return "GET /ip-location?ip=" + ip + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: keep-alive\r\n\r\n";
+    };
+
+    int epoll_fd = epoll_create1(0);
+    std::vector<Connection> connections(connection_count);
+    for (size_t i = 0; i < connections.size(); ++i) {
+        connections[i].fd = connect_to(*resolved);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connections[i].fd, &event);
+    }
+    freeaddrinfo(resolved);
+
+    std::vector<double> latencies_ms;
+    std::map<int, size_t> statuses;
+    size_t errors = 0;
+
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::seconds(seconds);
+    for (size_t i = 0; i < connections.size(); ++i) {
+        connections[i].out = next_request();
+        connections[i].sent = Clock::now();
+        flush(epoll_fd, connections[i], i);
+    }
+
+    std::vector<epoll_event> events(1024);
+    char buffer[16384];
+    while (Clock::now() < deadline) {
+        int count = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), 100);
+        for (int e = 0; e < count; ++e) {
+            size_t index = events[e].data.u64;
+            Connection& connection = connections[index];
+            if (events[e].events & EPOLLOUT) {
+                flush(epoll_fd, connection, index);
+            }
+            if (!(events[e].events & EPOLLIN)) {
+                continue;
+            }
+
+            ssize_t n;
+            while ((n = read(connection.fd, buffer, sizeof(buffer))) > 0) {
+                connection.in.append(buffer, static_cast<size_t>(n));
+            }
+            if (n == 0 || (n < 0 && errno != EAGAIN)) {
+                ++errors;
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection.fd, nullptr);
+                close(connection.fd);
+                connection.fd = -1;
+                continue;
+            }
+
+            int status = 0;
+            size_t length;
+            while ((length = complete_response(connection.in, status)) > 0) {
+                latencies_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - connection.sent).count());
+                ++statuses[status];
+                connection.in.erase(0, length);
+
+                connection.out = next_request();
+                connection.written = 0;
+                connection.sent = Clock::now();
+                flush(epoll_fd, connection, index);
+            }
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+
+    std::printf("%zu connections, %zu distinct addresses, %.1f s\n", connection_count, address_count, elapsed);
+    std::printf("requests: %zu (%.0f/s), connection errors: %zu\n", latencies_ms.size(),
+                static_cast<double>(latencies_ms.size()) / elapsed, errors);
+    std::printf("latency ms: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", percentile(latencies_ms, 0.50),
+                percentile(latencies_ms, 0.90), percentile(latencies_ms, 0.99),
+                latencies_ms.empty() ? 0.0 : latencies_ms.back());
+    for (const auto& [status, count] : statuses) {
+        std::printf("status %d: %zu\n", status, count);
+    }
+
+    for (auto& connection : connections) {
+        if (connection.fd >= 0) close(connection.fd);
+    }
+    close(epoll_fd);
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Compares the in-memory IPv4 indexes (binary search, DIR-24-8, DIR-16-8-8) on build time,
+// memory and lookup latency over synthetic datasets.
+//
+//   bench_ipv4_lookup [ranges] [lookups]
+//
+// The "fine" dataset spreads `ranges` ranges over the whole address space, like a city
+// level geolocation feed. The "coarse" dataset splits on /20 boundaries, which is closer to
+// a country level feed.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "lookup/location_dataset.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Range {
+    uint32_t first;
+    uint32_t last;
+};
+
+std::vector<Range> fine_ranges(size_t count, std::mt19937& rng) {
+    // sorted random boundaries, with roughly one range in eight left as a gap
+    std::set<uint32_t> boundaries;
+    while (boundaries.size() < count) {
+        boundaries.insert(static_cast<uint32_t>(rng()));
+    }
+    std::vector<Range> ranges;
+    ranges.reserve(count);
+    uint32_t previous = 0;
+    for (uint32_t boundary : boundaries) {
+        if (boundary > previous && rng() % 8 != 0) {
+            ranges.push_back({previous, boundary - 1});
+        }
+        previous = boundary;
+    }
+    return ranges;
+}
+
+std::vector<Range> coarse_ranges(std::mt19937& rng) {
+    std::vector<Range> ranges;
+    for (uint64_t first = 0; first <= 0xFFFFFFFF;) {
+        uint64_t length = (1 + rng() % 64) << 12;
+        uint64_t last = std::min<uint64_t>(first + length - 1, 0xFFFFFFFF);
+        if (rng() % 8 != 0) {
+            ranges.push_back({static_cast<uint32_t>(first), static_cast<uint32_t>(last)});
+        }
+        first = last + 1;
+    }
+    return ranges;
+}
+
+std::shared_ptr<const LocationDataset> build(const std::vector<Range>& ranges, Ipv4IndexType index_type, double& build_ms) {
+    auto start = Clock::now();
+    LocationDataset::Builder builder;
+    LocationRecord record;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        // a few thousand distinct locations, as in real feeds
+        record.country = "C" + std::to_string(i % 240);
+        record.city = "city" + std::to_string(i % 50000);
+        builder.add_ipv4(ranges[i].first, ranges[i].last, record);
+    }
+    auto dataset = builder.build(index_type);
+    build_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return dataset;
+}
+
+void run(const char* name, const std::vector<Range>& ranges, size_t lookups) {
+    std::mt19937 rng(1234);
+    std::vector<uint32_t> probes(lookups);
+    for (auto& probe : probes) probe = static_cast<uint32_t>(rng());
+
+    std::printf("\n%s dataset: %zu ranges\n", name, ranges.size());
+    std::printf("%-8s %10s %12s %12s %10s\n", "index", "build ms", "index MB", "ns/lookup", "hits");
+
+    double reference_build_ms = 0;
+    auto reference = build(ranges, Ipv4IndexType::BINARY_SEARCH, reference_build_ms);
+
+    for (Ipv4IndexType index_type : {Ipv4IndexType::BINARY_SEARCH, Ipv4IndexType::DIR_24_8, Ipv4IndexType::DIR_16_8_8}) {
+        double build_ms = 0;
+        auto dataset = build(ranges, index_type, build_ms);
+
+        // cross-check against binary search before timing
+        for (size_t i = 0; i < probes.size(); i += 97) {
+            if (dataset->find_ipv4(probes[i]) != reference->find_ipv4(probes[i])) {
+                std::fprintf(stderr, "%s mismatch at %u\n", LocationDataset::ipv4_index_to_string(index_type), probes[i]);
+                std::exit(1);
+            }
+        }
+
+        size_t hits = 0;
+        auto start = Clock::now();
+        for (uint32_t probe : probes) {
+            hits += dataset->find_ipv4_id(probe) != NO_RECORD;
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(probes.size());
+
+        std::printf("%-8s %10.1f %12.1f %12.2f %10zu\n", LocationDataset::ipv4_index_to_string(index_type), build_ms,
+                    static_cast<double>(dataset->ipv4_index_memory_bytes()) / (1 << 20), ns, hits);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t range_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 3'000'000;
+    size_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10'000'000;
+
+    std::mt19937 rng(42);
+    run("fine", fine_ranges(range_count, rng), lookups);
+    run("coarse", coarse_ranges(rng), lookups);
+    return 0;
+}
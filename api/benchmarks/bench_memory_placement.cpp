@@ -0,0 +1,165 @@
+// Measures random IPv4 lookups over a DIR-24-8 dataset copied under each memory placement:
+// regular pages, transparent huge pages and MAP_HUGETLB, plus local versus remote NUMA node
+// when the host has more than one. Reports ns per lookup and dTLB load misses per lookup
+// (from perf_event_open; shown as n/a when perf events are not permitted).
+//
+//   bench_memory_placement [ranges] [lookups]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "lookup/location_dataset.h"
+#include "utils/numa_topology.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class DtlbMissCounter {
+public:
+    DtlbMissCounter() {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~DtlbMissCounter() {
+        if (m_fd >= 0) close(m_fd);
+    }
+
+    bool available() const { return m_fd >= 0; }
+    void start() {
+        if (m_fd < 0) return;
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint64_t stop() {
+        uint64_t count = 0;
+        if (m_fd < 0) return count;
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(m_fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+        return count;
+    }
+
+private:
+    int m_fd = -1;
+};
+
+std::string first_line(const char* path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return file ? line : "unavailable";
+}
+
+// kB of anonymous memory backed by transparent huge pages in this process
+std::string anon_huge_pages() {
+    std::ifstream file("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.rfind("AnonHugePages:", 0) == 0) return line.substr(14);
+    }
+    return " unavailable";
+}
+
+std::shared_ptr<const LocationDataset> build_dataset(size_t count) {
+    std::mt19937 rng(42);
+    std::set<uint32_t> boundaries;
+    while (boundaries.size() < count) boundaries.insert(static_cast<uint32_t>(rng()));
+
+    LocationDataset::Builder builder;
+    LocationRecord record;
+    uint32_t previous = 0;
+    size_t i = 0;
+    for (uint32_t boundary : boundaries) {
+        if (boundary > previous) {
+            record.city = "city" + std::to_string(i++ % 50000);
+            builder.add_ipv4(previous, boundary - 1, record);
+        }
+        previous = boundary;
+    }
+    return builder.build(Ipv4IndexType::DIR_24_8);
+}
+
+void run(const char* name, const LocationDataset& dataset, const std::vector<uint32_t>& probes, DtlbMissCounter& counter) {
+    size_t hits = 0;
+    // one untimed pass so every page has been touched
+    for (uint32_t probe : probes) hits += dataset.find_ipv4_id(probe) != NO_RECORD;
+
+    hits = 0;
+    counter.start();
+    auto start = Clock::now();
+    for (uint32_t probe : probes) hits += dataset.find_ipv4_id(probe) != NO_RECORD;
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(probes.size());
+    uint64_t misses = counter.stop();
+
+    if (counter.available()) {
+        std::printf("%-28s %12.2f %16.3f %10zu\n", name, ns, static_cast<double>(misses) / static_cast<double>(probes.size()), hits);
+    } else {
+        std::printf("%-28s %12.2f %16s %10zu\n", name, ns, "n/a", hits);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t range_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    size_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20'000'000;
+
+    auto nodes = NumaTopology::detect();
+    if (!nodes.empty()) {
+        NumaTopology::pin_current_thread(nodes.front());
+    }
+
+    auto primary = build_dataset(range_count);
+    std::mt19937 rng(1234);
+    std::vector<uint32_t> probes(lookups);
+    for (auto& probe : probes) probe = static_cast<uint32_t>(rng());
+
+    std::printf("%zu ranges, %.1f MB DIR-24-8 index, %zu NUMA node(s)\n", primary->ipv4_range_count(),
+                static_cast<double>(primary->ipv4_index_memory_bytes()) / (1 << 20), nodes.size());
+    std::printf("transparent_hugepage: %s\n", first_line("/sys/kernel/mm/transparent_hugepage/enabled").c_str());
+    std::printf("nr_hugepages: %s\n\n", first_line("/proc/sys/vm/nr_hugepages").c_str());
+
+    DtlbMissCounter counter;
+    std::printf("%-28s %12s %16s %10s\n", "placement", "ns/lookup", "dTLB miss/lookup", "hits");
+
+    int local_node = nodes.empty() ? -1 : nodes.front().id;
+    for (HugePageMode mode : {HugePageMode::OFF, HugePageMode::TRANSPARENT, HugePageMode::EXPLICIT}) {
+        auto before = MemoryPlacementPolicy::stats();
+        // OFF still goes through mmap when bound to a node, so every row pays the same first-touch costs
+        auto replica = primary->replicate(MemoryPlacement{mode, local_node});
+        auto after = MemoryPlacementPolicy::stats();
+
+        std::string name = std::string(MemoryPlacementPolicy::huge_page_mode_to_string(mode));
+        if (mode == HugePageMode::EXPLICIT && after.hugetlb_fallbacks > before.hugetlb_fallbacks) {
+            name += " (fell back)";
+        }
+        run(name.c_str(), *replica, probes, counter);
+        std::printf("%-28s AnonHugePages:%s\n", "", anon_huge_pages().c_str());
+    }
+
+    if (nodes.size() > 1) {
+        std::printf("\nthread pinned to node %d\n", nodes.front().id);
+        for (const auto& node : {nodes.front(), nodes.back()}) {
+            auto replica = primary->replicate(MemoryPlacement{HugePageMode::TRANSPARENT, node.id});
+            std::string name = "transparent, node " + std::to_string(node.id);
+            run(name.c_str(), *replica, probes, counter);
+        }
+    }
+    return 0;
+}
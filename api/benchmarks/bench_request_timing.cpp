@@ -0,0 +1,104 @@
+// Measures what per-request timing adds to an /ip-location request: the seven stage spans of a
+// lookup with timing disabled (the default for requests that neither send X-Server-Timing nor
+// are sampled), enabled with the Server-Timing header formatted, and enabled with the record
+// pushed to the trace ring, also with several threads pushing at once.
+//
+//   bench_request_timing [requests] [threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/request_timing.h"
+#include "utils/trace_ring.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// stands in for the work of a stage so the loop is not optimised away
+volatile uint64_t g_sink = 0;
+
+void stage_work(uint64_t i) {
+    g_sink = g_sink + i;
+}
+
+// one request's worth of spans, as in ApiHandlers::lookup_blocking on a cache miss
+void instrumented_request(RequestTiming& timing, uint64_t i) {
+    constexpr RequestTiming::Stage STAGES[] = {
+        RequestTiming::Stage::RATE_LIMIT, RequestTiming::Stage::VALIDATE, RequestTiming::Stage::MEMORY,
+        RequestTiming::Stage::CACHE, RequestTiming::Stage::POOL_WAIT, RequestTiming::Stage::QUERY,
+        RequestTiming::Stage::SERIALIZE,
+    };
+    for (auto stage : STAGES) {
+        auto span = timing.span(stage);
+        stage_work(i);
+    }
+}
+
+template <typename Request>
+double ns_per_request(size_t requests, Request request) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        request(i);
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(requests);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+
+    double baseline = ns_per_request(requests, [](uint64_t i) {
+        for (int s = 0; s < 7; ++s) stage_work(i);
+    });
+    double disabled = ns_per_request(requests, [](uint64_t i) {
+        RequestTiming timing;
+        instrumented_request(timing, i);
+    });
+    double header = ns_per_request(requests, [](uint64_t i) {
+        auto timing = RequestTiming::start(true, false);
+        instrumented_request(timing, i);
+        std::string value = timing.server_timing_header();
+        g_sink = g_sink + value.size();
+    });
+
+    TraceRing ring(1024);
+    double traced = ns_per_request(requests, [&](uint64_t i) {
+        auto timing = RequestTiming::start(false, true);
+        timing.set_ip("203.0.113.9");
+        instrumented_request(timing, i);
+        ring.push(TraceRecord::from(timing, 200));
+    });
+
+    TraceRing shared_ring(1024);
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i = 0; i < requests / threads; ++i) {
+                auto timing = RequestTiming::start(false, true);
+                instrumented_request(timing, i);
+                shared_ring.push(TraceRecord::from(timing, 200));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double contended = std::chrono::duration<double, std::nano>(Clock::now() - start).count()
+        / static_cast<double>(requests / threads);
+
+    std::printf("%zu requests, 7 spans each\n", requests);
+    std::printf("no instrumentation:        %7.1f ns/request\n", baseline);
+    std::printf("timing disabled:           %7.1f ns/request (+%.1f)\n", disabled, disabled - baseline);
+    std::printf("Server-Timing header:      %7.1f ns/request (+%.1f)\n", header, header - baseline);
+    std::printf("sampled into trace ring:   %7.1f ns/request (+%.1f)\n", traced, traced - baseline);
+    std::printf("sampled, %zu threads:       %7.1f ns/request per thread, %llu of %llu records dropped\n", threads,
+                contended, static_cast<unsigned long long>(shared_ring.dropped_count()),
+                static_cast<unsigned long long>(shared_ring.recorded_count()));
+    return 0;
+}
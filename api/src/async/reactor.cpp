@@ -0,0 +1,113 @@
+#include "reactor.h"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+Reactor::Reactor(size_t thread_count) {
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epoll_fd < 0 || m_wake_fd < 0) {
+        throw std::runtime_error("Failed to create reactor: errno " + std::to_string(errno));
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr; // the wakeup descriptor
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &event);
+
+    for (size_t i = 0; i < std::max<size_t>(thread_count, 1); ++i) {
+        m_threads.emplace_back(&Reactor::run, this);
+    }
+}
+
+Reactor::~Reactor() {
+    m_stop.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = write(m_wake_fd, &one, sizeof(one));
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+    close(m_wake_fd);
+    close(m_epoll_fd);
+}
+
+void Reactor::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(m_ready_mutex);
+        m_ready.push_back(handle);
+    }
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = write(m_wake_fd, &one, sizeof(one));
+}
+
+void Reactor::watch(int fd, bool write, std::coroutine_handle<> handle) {
+    // one-shot, so exactly one thread resumes the waiter and the registration stays disarmed
+    // until the next wait on the socket
+    epoll_event event{};
+    event.events = (write ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+    event.data.ptr = handle.address();
+
+    std::lock_guard<std::mutex> lock(m_watched_mutex);
+    bool known = std::find(m_watched.begin(), m_watched.end(), fd) != m_watched.end();
+    if (epoll_ctl(m_epoll_fd, known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) != 0) {
+        // not a pollable descriptor (or already closed): let the waiter find out from the socket
+        post(handle);
+        return;
+    }
+    if (!known) {
+        m_watched.push_back(fd);
+    }
+}
+
+void Reactor::forget(int fd) {
+    std::lock_guard<std::mutex> lock(m_watched_mutex);
+    auto it = std::find(m_watched.begin(), m_watched.end(), fd);
+    if (it != m_watched.end()) {
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        m_watched.erase(it);
+    }
+}
+
+void Reactor::drain_ready() {
+    while (true) {
+        std::coroutine_handle<> handle;
+        {
+            std::lock_guard<std::mutex> lock(m_ready_mutex);
+            if (m_ready.empty()) {
+                return;
+            }
+            handle = m_ready.front();
+            m_ready.pop_front();
+        }
+        handle.resume();
+    }
+}
+
+void Reactor::run() {
+    constexpr int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+
+    while (!m_stop.load(std::memory_order_acquire)) {
+        int count = epoll_wait(m_epoll_fd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            continue; // EINTR
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                // once stopping, leave the wakeup descriptor readable so every thread sees it
+                if (!m_stop.load(std::memory_order_acquire)) {
+                    uint64_t value;
+                    [[maybe_unused]] auto read_bytes = read(m_wake_fd, &value, sizeof(value));
+                }
+                continue;
+            }
+            std::coroutine_handle<>::from_address(events[i].data.ptr).resume();
+        }
+        drain_ready();
+    }
+}
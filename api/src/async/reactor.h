@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small epoll event loop that resumes coroutines, run by a fixed set of threads. Coroutines
+// suspend on a socket becoming readable or writable and are resumed on one of the reactor's
+// threads, so a few threads can keep thousands of requests waiting on I/O.
+class Reactor {
+public:
+    explicit Reactor(size_t thread_count);
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // resumes the coroutine on a reactor thread; safe from any thread
+    void post(std::coroutine_handle<> handle);
+
+    // co_await reactor.schedule() continues on a reactor thread
+    auto schedule() {
+        struct Awaiter {
+            Reactor& m_reactor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { m_reactor.post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // co_await reactor.readable(fd) / writable(fd) resume once the socket is ready. Only one
+    // coroutine may wait on a given socket at a time.
+    auto readable(int fd) { return FdAwaiter{*this, fd, false}; }
+    auto writable(int fd) { return FdAwaiter{*this, fd, true}; }
+
+    // stops watching a socket before it is closed or replaced
+    void forget(int fd);
+
+    size_t thread_count() const { return m_threads.size(); }
+
+private:
+    struct FdAwaiter {
+        Reactor& m_reactor;
+        int m_fd;
+        bool m_write;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { m_reactor.watch(m_fd, m_write, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    void watch(int fd, bool write, std::coroutine_handle<> handle);
+    void run();
+    void drain_ready();
+
+    int m_epoll_fd = -1;
+    int m_wake_fd = -1;
+    std::atomic<bool> m_stop{false};
+
+    std::mutex m_ready_mutex;
+    std::deque<std::coroutine_handle<>> m_ready;
+
+    std::mutex m_watched_mutex;
+    std::vector<int> m_watched; // fds already added to the epoll set
+
+    std::vector<std::thread> m_threads;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sw/redis++/async_redis++.h>
+#include "reactor.h"
+
+// co_await AsyncRedisGet(redis, reactor, key) issues a GET through redis++'s AsyncRedis
+// without blocking the calling thread. The reply callback runs on AsyncRedis's event loop
+// thread; it only stores the reply and hands the coroutine back to the Reactor.
+class AsyncRedisGet {
+public:
+    // `key` is only read while the command is queued
+    AsyncRedisGet(sw::redis::AsyncRedis& redis, Reactor& reactor, std::string_view key)
+        : m_redis(redis), m_reactor(reactor), m_key(key) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        try {
+            m_redis.get(sw::redis::StringView(m_key.data(), m_key.size()), [this, handle](sw::redis::Future<sw::redis::OptionalString>&& reply) {
+                try {
+                    m_value = reply.get();
+                } catch (...) {
+                    m_error = std::current_exception();
+                }
+                m_reactor.post(handle);
+            });
+        } catch (...) {
+            // the command could not be queued; resume immediately with the error
+            m_error = std::current_exception();
+            return false;
+        }
+        return true;
+    }
+
+    // nullopt on a miss; rethrows Redis errors
+    std::optional<std::string> await_resume() {
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+        return std::move(m_value);
+    }
+
+private:
+    sw::redis::AsyncRedis& m_redis;
+    Reactor& m_reactor;
+    std::string_view m_key;
+    sw::redis::OptionalString m_value;
+    std::exception_ptr m_error;
+};
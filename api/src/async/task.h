@@ -0,0 +1,125 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+// Lazily started coroutine returning T. Awaiting a Task starts it and resumes the awaiter
+// when it completes (by symmetric transfer, so long await chains do not grow the stack).
+// Exceptions thrown inside the coroutine are rethrown from co_await.
+template <typename T = void>
+class Task;
+
+namespace task_detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> m_continuation = std::noop_coroutine();
+    std::exception_ptr m_error;
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept {
+            return handle.promise().m_continuation;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { m_error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> m_value;
+
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& value) { m_value.emplace(std::forward<U>(value)); }
+
+    T result() {
+        if (m_error) std::rethrow_exception(m_error);
+        return std::move(*m_value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+
+    void result() {
+        if (m_error) std::rethrow_exception(m_error);
+    }
+};
+
+} // namespace task_detail
+
+template <typename T>
+class Task {
+public:
+    using promise_type = task_detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+    Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (m_handle) m_handle.destroy();
+    }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> m_handle;
+
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                m_handle.promise().m_continuation = awaiting;
+                return m_handle;
+            }
+            T await_resume() { return m_handle.promise().result(); }
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace task_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// owns itself: runs eagerly and frees its frame when done
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+} // namespace task_detail
+
+// Starts a task on the calling thread without waiting for it; it runs until its first
+// suspension before spawn returns. The task must handle its own exceptions.
+inline task_detail::Detached spawn(Task<void> task) {
+    co_await std::move(task);
+}
@@ -0,0 +1,186 @@
+#include "cache_codec.h"
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+enum FieldFlag : uint8_t {
+    FOUND = 1 << 0,
+    HAS_COUNTRY = 1 << 1,
+    HAS_CITY = 1 << 2,
+    HAS_REGION = 1 << 3,
+    HAS_LATITUDE = 1 << 4,
+    HAS_LONGITUDE = 1 << 5,
+    HAS_POSTAL_CODE = 1 << 6,
+    HAS_TIMEZONE = 1 << 7,
+};
+
+void put_float(std::string& out, float value) {
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+    }
+}
+
+void put_string(std::string& out, const std::string& value) {
+    size_t len = value.size();
+    while (len >= 0x80) {
+        out.push_back(static_cast<char>((len & 0x7F) | 0x80));
+        len >>= 7;
+    }
+    out.push_back(static_cast<char>(len));
+    out.append(value);
+}
+
+class Reader {
+public:
+    explicit Reader(std::string_view data) : m_data(data) {}
+
+    bool get_float(float& value) {
+        if (m_data.size() - m_pos < 4) return false;
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; ++i) {
+            bits |= static_cast<uint32_t>(static_cast<unsigned char>(m_data[m_pos + i])) << (8 * i);
+        }
+        m_pos += 4;
+        value = std::bit_cast<float>(bits);
+        return true;
+    }
+
+    bool get_string(std::optional<std::string_view>& value) {
+        size_t len = 0;
+        int shift = 0;
+        while (true) {
+            if (m_pos >= m_data.size() || shift > 28) return false;
+            auto byte = static_cast<unsigned char>(m_data[m_pos++]);
+            len |= static_cast<size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+            shift += 7;
+        }
+        if (m_data.size() - m_pos < len) return false;
+        value.emplace(m_data.substr(m_pos, len));
+        m_pos += len;
+        return true;
+    }
+
+    bool at_end() const { return m_pos == m_data.size(); }
+
+private:
+    std::string_view m_data;
+    size_t m_pos = 3; // past the header
+};
+
+} // namespace
+
+CacheValueFormat CacheCodec::parse_format(const std::string& format_str) {
+    std::string lower = format_str;
+    for (char& c : lower) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    if (lower == "json") {
+        return CacheValueFormat::JSON;
+    } else if (lower == "binary") {
+        return CacheValueFormat::BINARY;
+    }
+    throw std::invalid_argument("Invalid cache value format: " + format_str);
+}
+
+std::string CacheCodec::encode_record(const LocationRecord& record) {
+    uint8_t flags = FOUND;
+    if (record.country) flags |= HAS_COUNTRY;
+    if (record.city) flags |= HAS_CITY;
+    if (record.region) flags |= HAS_REGION;
+    if (record.latitude) flags |= HAS_LATITUDE;
+    if (record.longitude) flags |= HAS_LONGITUDE;
+    if (record.postal_code) flags |= HAS_POSTAL_CODE;
+    if (record.timezone) flags |= HAS_TIMEZONE;
+
+    std::string out;
+    out.reserve(64);
+    out.push_back(static_cast<char>(MAGIC));
+    out.push_back(static_cast<char>(VERSION));
+    out.push_back(static_cast<char>(flags));
+
+    if (record.latitude) put_float(out, *record.latitude);
+    if (record.longitude) put_float(out, *record.longitude);
+    if (record.country) put_string(out, *record.country);
+    if (record.city) put_string(out, *record.city);
+    if (record.region) put_string(out, *record.region);
+    if (record.postal_code) put_string(out, *record.postal_code);
+    if (record.timezone) put_string(out, *record.timezone);
+
+    return out;
+}
+
+std::string CacheCodec::encode_not_found() {
+    return std::string{static_cast<char>(MAGIC), static_cast<char>(VERSION), 0};
+}
+
+CachedValue CacheCodec::decode(std::string_view value) {
+    CachedValueView view = decode_view(value);
+    CachedValue result;
+    result.kind = view.kind;
+    if (view.kind == CachedValue::Kind::FOUND) {
+        result.record = view.record.to_record();
+    }
+    return result;
+}
+
+CachedValueView CacheCodec::decode_view(std::string_view value) {
+    CachedValueView result;
+
+    if (value.empty()) {
+        return result;
+    }
+    if (static_cast<unsigned char>(value[0]) != MAGIC) {
+        // entries written before the binary format was enabled; not-found bodies were cached too
+        result.kind = value.find("\"IP_NOT_FOUND\"") != std::string_view::npos
+            ? CachedValue::Kind::NOT_FOUND
+            : CachedValue::Kind::LEGACY_JSON;
+        return result;
+    }
+    if (value.size() < 3 || static_cast<unsigned char>(value[1]) != VERSION) {
+        return result;
+    }
+
+    auto flags = static_cast<uint8_t>(value[2]);
+    if (!(flags & FOUND)) {
+        result.kind = CachedValue::Kind::NOT_FOUND;
+        return result;
+    }
+
+    Reader reader(value);
+    auto& record = result.record;
+    bool ok = true;
+    if (flags & HAS_LATITUDE) ok = ok && reader.get_float(record.latitude.emplace());
+    if (flags & HAS_LONGITUDE) ok = ok && reader.get_float(record.longitude.emplace());
+    if (flags & HAS_COUNTRY) ok = ok && reader.get_string(record.country);
+    if (flags & HAS_CITY) ok = ok && reader.get_string(record.city);
+    if (flags & HAS_REGION) ok = ok && reader.get_string(record.region);
+    if (flags & HAS_POSTAL_CODE) ok = ok && reader.get_string(record.postal_code);
+    if (flags & HAS_TIMEZONE) ok = ok && reader.get_string(record.timezone);
+
+    if (!ok || !reader.at_end()) {
+        result.record = LocationRecordView{};
+        return result;
+    }
+
+    result.kind = CachedValue::Kind::FOUND;
+    return result;
+}
+
+double CacheCodec::widen_coordinate(float value) {
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    if (ec != std::errc()) {
+        return static_cast<double>(value);
+    }
+    *end = '\0';
+    return std::strtod(buf, nullptr);
+}
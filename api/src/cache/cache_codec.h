@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "../models/location_record.h"
+
+enum class CacheValueFormat { JSON, BINARY };
+
+struct CachedValue {
+    enum class Kind { FOUND, NOT_FOUND, LEGACY_JSON, INVALID };
+
+    Kind kind = Kind::INVALID;
+    LocationRecord record; // set for FOUND
+};
+
+// CachedValue whose strings point into the decoded value, which must outlive it.
+struct CachedValueView {
+    CachedValue::Kind kind = CachedValue::Kind::INVALID;
+    LocationRecordView record; // set for FOUND
+};
+
+// Encoding of Redis cache values.
+//
+// JSON is the original format: the full response body. BINARY (version 1) is
+//   [0xA7 magic][version][flags][lat f32 LE][lon f32 LE][varint len + bytes per string field]
+// where flags bit 0 marks a found record and bits 1..7 mark which fields are present.
+// A not-found entry is just the three header bytes. The client's IP is not stored; it is
+// added back when the response is rendered. Values that don't start with the magic byte
+// are treated as legacy JSON entries so a deployment can switch formats without a flush.
+class CacheCodec {
+public:
+    static constexpr unsigned char MAGIC = 0xA7;
+    static constexpr unsigned char VERSION = 1;
+
+    static CacheValueFormat parse_format(const std::string& format_str);
+
+    static std::string encode_record(const LocationRecord& record);
+    static std::string encode_not_found();
+    static CachedValue decode(std::string_view value);
+    // decodes without copying any string; the request hot path
+    static CachedValueView decode_view(std::string_view value);
+
+    // widens a float coordinate to the double with the same shortest decimal representation,
+    // so 43.36679f renders as 43.36679 rather than 43.366790771484375
+    static double widen_coordinate(float value);
+};
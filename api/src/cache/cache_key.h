@@ -0,0 +1,35 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Redis key of a cached lookup, "ip_location:<generation>:<ip>", built in a fixed buffer so
+// that reading the cache does not allocate. Entries from older dataset generations are never
+// read again and age out on their own.
+class CacheKey {
+public:
+    static constexpr std::string_view PREFIX = "ip_location:";
+    // prefix, a 64-bit generation, the separator and the longest IPv6 text (45 characters)
+    static constexpr size_t CAPACITY = 12 + 20 + 1 + 45;
+
+    CacheKey(uint64_t generation, std::string_view ip) {
+        char* out = std::copy(PREFIX.begin(), PREFIX.end(), m_data);
+        out = std::to_chars(out, m_data + CAPACITY, generation).ptr;
+        *out++ = ':';
+        // validated addresses always fit; anything longer is cut rather than overrun
+        size_t ip_length = std::min(ip.size(), static_cast<size_t>(m_data + CAPACITY - out));
+        out = std::copy_n(ip.data(), ip_length, out);
+        m_size = static_cast<size_t>(out - m_data);
+    }
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+    std::string str() const { return std::string(m_data, m_size); }
+
+private:
+    char m_data[CAPACITY];
+    size_t m_size;
+};
@@ -0,0 +1,69 @@
+#include "cache_ttl_policy.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+constexpr int SECONDS_PER_DAY = 24 * 60 * 60;
+}
+
+CacheTtlPolicy::CacheTtlPolicy(int update_hour_utc, int update_minute_utc, int jitter_seconds,
+                               int update_grace_seconds)
+    : m_update_second_of_day(update_hour_utc * 3600 + update_minute_utc * 60),
+      m_jitter_seconds(std::max(0, jitter_seconds)),
+      m_update_grace_seconds(std::max(0, update_grace_seconds)) {}
+
+CacheTtlPolicy CacheTtlPolicy::from_schedule(const std::string& update_time_utc, int jitter_seconds,
+                                             int update_grace_seconds) {
+    auto colon = update_time_utc.find(':');
+    if (colon == std::string::npos) {
+        throw std::invalid_argument("Invalid update time (expected HH:MM): " + update_time_utc);
+    }
+
+    int hour = 0;
+    int minute = 0;
+    try {
+        hour = std::stoi(update_time_utc.substr(0, colon));
+        minute = std::stoi(update_time_utc.substr(colon + 1));
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid update time (expected HH:MM): " + update_time_utc);
+    }
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+        throw std::invalid_argument("Invalid update time (expected HH:MM): " + update_time_utc);
+    }
+
+    return CacheTtlPolicy(hour, minute, jitter_seconds, update_grace_seconds);
+}
+
+int CacheTtlPolicy::ttl_seconds(int base_ttl_seconds) const {
+    thread_local std::minstd_rand rng{std::random_device{}()};
+    int jitter = 0;
+    if (m_jitter_seconds > 0) {
+        jitter = std::uniform_int_distribution<int>(0, m_jitter_seconds)(rng);
+    }
+    return ttl_seconds(base_ttl_seconds, std::chrono::system_clock::now(), jitter);
+}
+
+int CacheTtlPolicy::ttl_seconds(int base_ttl_seconds, std::chrono::system_clock::time_point now, int jitter) const {
+    // keys carry the dataset generation, so outliving the update only wastes memory.
+    // Jitter is added past the update and, scaled to at most a tenth of the base TTL,
+    // subtracted from the base so that neither boundary becomes a synchronized expiry point.
+    int base_jitter = m_jitter_seconds > 0
+        ? static_cast<int>(static_cast<long long>(jitter) * (base_ttl_seconds / 10) / m_jitter_seconds)
+        : 0;
+    int until_update = seconds_until_next_update(now) + m_update_grace_seconds;
+    int ttl = std::min(base_ttl_seconds - base_jitter, until_update + jitter);
+    return std::max(1, ttl);
+}
+
+int CacheTtlPolicy::seconds_until_next_update(std::chrono::system_clock::time_point now) const {
+    auto since_epoch = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    int second_of_day = static_cast<int>(since_epoch % SECONDS_PER_DAY);
+
+    int remaining = m_update_second_of_day - second_of_day;
+    if (remaining <= 0) {
+        remaining += SECONDS_PER_DAY;
+    }
+    return remaining;
+}
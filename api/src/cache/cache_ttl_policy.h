@@ -0,0 +1,26 @@
+#pragma once
+#include <chrono>
+#include <string>
+
+// Computes cache TTLs relative to the daily dataset update. An entry never outlives the
+// next scheduled update (plus a grace period for the import itself), and a random jitter
+// spreads expirations so entries written in the same burst don't all expire together.
+class CacheTtlPolicy {
+public:
+    CacheTtlPolicy(int update_hour_utc = 2, int update_minute_utc = 0, int jitter_seconds = 300,
+                   int update_grace_seconds = 900);
+
+    // parses "HH:MM"; throws std::invalid_argument on malformed input
+    static CacheTtlPolicy from_schedule(const std::string& update_time_utc, int jitter_seconds,
+                                        int update_grace_seconds = 900);
+
+    int ttl_seconds(int base_ttl_seconds) const;
+    int ttl_seconds(int base_ttl_seconds, std::chrono::system_clock::time_point now, int jitter) const;
+
+    int seconds_until_next_update(std::chrono::system_clock::time_point now) const;
+
+private:
+    int m_update_second_of_day;
+    int m_jitter_seconds;
+    int m_update_grace_seconds;
+};
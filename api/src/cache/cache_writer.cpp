@@ -0,0 +1,123 @@
+#include "cache_writer.h"
+#include "../utils/logger.h"
+#include <algorithm>
+#include <iterator>
+
+CacheWriter::CacheWriter(FlushFn flush_fn, size_t max_queue_size, size_t max_batch_size,
+                         std::chrono::milliseconds flush_interval)
+    : m_flush_fn(std::move(flush_fn)),
+      m_max_queue_size(max_queue_size),
+      m_max_batch_size(max_batch_size > 0 ? max_batch_size : 1),
+      m_flush_interval(flush_interval) {
+    m_pending.reserve(m_max_queue_size);
+    m_worker = std::thread(&CacheWriter::run, this);
+}
+
+CacheWriter::~CacheWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+bool CacheWriter::enqueue(std::string key, std::string value, int ttl_seconds) {
+    bool wake_worker = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_pending_index.find(key);
+        if (it != m_pending_index.end()) {
+            // a newer value for a key that hasn't been flushed yet replaces the old one
+            auto& write = m_pending[it->second];
+            write.value = std::move(value);
+            write.ttl_seconds = ttl_seconds;
+            m_coalesced.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        if (m_pending.size() >= m_max_queue_size) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_pending_index.emplace(key, m_pending.size());
+        m_pending.push_back(CacheWrite{std::move(key), std::move(value), ttl_seconds});
+        m_queued.fetch_add(1, std::memory_order_relaxed);
+        wake_worker = m_pending.size() >= m_max_batch_size;
+    }
+
+    if (wake_worker) {
+        m_cv.notify_one();
+    }
+    return true;
+}
+
+void CacheWriter::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_flush_requested = true;
+    m_cv.notify_one();
+    m_drained_cv.wait(lock, [this] { return m_pending.empty() && !m_in_flight; });
+}
+
+size_t CacheWriter::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size();
+}
+
+void CacheWriter::run() {
+    std::vector<CacheWrite> batch;
+    batch.reserve(m_max_queue_size);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait_for(lock, m_flush_interval, [this] {
+            return m_stop || m_flush_requested || m_pending.size() >= m_max_batch_size;
+        });
+        m_flush_requested = false;
+
+        if (m_pending.empty()) {
+            m_drained_cv.notify_all();
+            if (m_stop) {
+                break;
+            }
+            continue;
+        }
+
+        batch.swap(m_pending);
+        m_pending_index.clear();
+        m_in_flight = true;
+
+        lock.unlock();
+        flush_batch(batch);
+        batch.clear();
+        lock.lock();
+
+        m_in_flight = false;
+        if (m_pending.empty()) {
+            m_drained_cv.notify_all();
+        }
+    }
+}
+
+void CacheWriter::flush_batch(std::vector<CacheWrite>& batch) {
+    std::vector<CacheWrite> chunk;
+    chunk.reserve(std::min(batch.size(), m_max_batch_size));
+
+    for (size_t offset = 0; offset < batch.size(); offset += m_max_batch_size) {
+        size_t end = std::min(batch.size(), offset + m_max_batch_size);
+        chunk.assign(std::make_move_iterator(batch.begin() + offset), std::make_move_iterator(batch.begin() + end));
+
+        try {
+            m_flush_fn(chunk);
+            m_flushed.fetch_add(chunk.size(), std::memory_order_relaxed);
+        } catch (const std::exception& e) {
+            m_failed.fetch_add(chunk.size(), std::memory_order_relaxed);
+            auto logger = Logger::Logger::get_logger();
+            logger->warning("Cache write batch of {} entries failed: {}", chunk.size(), e.what());
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct CacheWrite {
+    std::string key;
+    std::string value;
+    int ttl_seconds;
+};
+
+// Write-behind queue for cache fills. Request threads enqueue and return immediately;
+// a background worker hands batches to the flush function (a pipelined SETEX in production).
+// Pending writes to the same key are coalesced, and writes are dropped instead of blocking
+// once the queue is full.
+class CacheWriter {
+public:
+    using FlushFn = std::function<void(const std::vector<CacheWrite>&)>;
+
+    CacheWriter(FlushFn flush_fn, size_t max_queue_size = 10000, size_t max_batch_size = 128,
+                std::chrono::milliseconds flush_interval = std::chrono::milliseconds(5));
+    ~CacheWriter();
+
+    CacheWriter(const CacheWriter&) = delete;
+    CacheWriter& operator=(const CacheWriter&) = delete;
+
+    // returns false if the write was dropped because the queue is full
+    bool enqueue(std::string key, std::string value, int ttl_seconds);
+
+    // blocks until everything queued before the call has been handed to the flush function
+    void flush();
+
+    uint64_t queued_count() const { return m_queued.load(std::memory_order_relaxed); }
+    uint64_t coalesced_count() const { return m_coalesced.load(std::memory_order_relaxed); }
+    uint64_t flushed_count() const { return m_flushed.load(std::memory_order_relaxed); }
+    uint64_t dropped_count() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t failed_count() const { return m_failed.load(std::memory_order_relaxed); }
+    size_t pending() const;
+
+private:
+    void run();
+    void flush_batch(std::vector<CacheWrite>& batch);
+
+    FlushFn m_flush_fn;
+    const size_t m_max_queue_size;
+    const size_t m_max_batch_size;
+    const std::chrono::milliseconds m_flush_interval;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_drained_cv;
+    std::vector<CacheWrite> m_pending;
+    std::unordered_map<std::string, size_t> m_pending_index; // key -> position in m_pending
+    bool m_in_flight = false;
+    bool m_flush_requested = false;
+    bool m_stop = false;
+
+    std::atomic<uint64_t> m_queued{0};
+    std::atomic<uint64_t> m_coalesced{0};
+    std::atomic<uint64_t> m_flushed{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_failed{0};
+
+    std::thread m_worker;
+};
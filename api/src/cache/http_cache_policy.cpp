@@ -0,0 +1,62 @@
+#include "http_cache_policy.h"
+#include <algorithm>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string max_age(int seconds) {
+    return "public, max-age=" + std::to_string(std::max(0, seconds));
+}
+
+} // namespace
+
+HttpCachePolicy::HttpCachePolicy(int max_age_seconds, int not_found_max_age_seconds)
+    : m_max_age_seconds(std::max(0, max_age_seconds)),
+      m_not_found_max_age_seconds(std::max(0, not_found_max_age_seconds)) {}
+
+std::string HttpCachePolicy::etag(uint64_t generation) {
+    if (generation == 0) {
+        return "";
+    }
+    return "W/\"" + std::to_string(generation) + "\"";
+}
+
+bool HttpCachePolicy::matches(std::string_view if_none_match, uint64_t generation) {
+    if (generation == 0) {
+        return false;
+    }
+    std::string opaque = "\"" + std::to_string(generation) + "\"";
+    while (!if_none_match.empty()) {
+        size_t comma = if_none_match.find(',');
+        std::string_view tag = trim(if_none_match.substr(0, comma));
+        if_none_match = comma == std::string_view::npos ? std::string_view() : if_none_match.substr(comma + 1);
+
+        if (tag == "*") {
+            return true;
+        }
+        if (tag.starts_with("W/")) {
+            tag.remove_prefix(2);
+        }
+        if (tag == opaque) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string HttpCachePolicy::cache_control(bool found, int seconds_until_update) const {
+    int base = found ? m_max_age_seconds : m_not_found_max_age_seconds;
+    return max_age(std::min(base, seconds_until_update));
+}
+
+std::string HttpCachePolicy::reserved_cache_control() {
+    return max_age(RESERVED_MAX_AGE_SECONDS);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Cache headers for /ip-location answers, for browsers and CDNs in front of the service.
+//
+// An answer only changes when a new dataset generation is loaded, so the generation is the
+// validator: ETag W/"<generation>" (weak, since a cached JSON body and a freshly rendered one
+// may differ in formatting). max-age never runs past the next scheduled update; a client
+// revalidating after it gets a 304 until the updater has actually swapped the data in.
+class HttpCachePolicy {
+public:
+    // reserved ranges change with the code, not the dataset
+    static constexpr int RESERVED_MAX_AGE_SECONDS = 24 * 60 * 60;
+
+    // a max_age_seconds of 0 disables cache headers and conditional requests
+    HttpCachePolicy(int max_age_seconds = 0, int not_found_max_age_seconds = 0);
+
+    bool enabled() const { return m_max_age_seconds > 0; }
+
+    // W/"42"; a generation of 0 (none recorded yet) has no tag
+    static std::string etag(uint64_t generation);
+    // true when an If-None-Match value ("*" or a list of tags) names the generation's tag;
+    // weak comparison, so "42" and W/"42" both match
+    static bool matches(std::string_view if_none_match, uint64_t generation);
+
+    // "public, max-age=N" for a found (200) or not found (404) answer, capped at the update
+    std::string cache_control(bool found, int seconds_until_update) const;
+    static std::string reserved_cache_control();
+
+private:
+    int m_max_age_seconds;
+    int m_not_found_max_age_seconds;
+};
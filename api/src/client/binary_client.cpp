@@ -0,0 +1,158 @@
+#include "binary_client.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+std::runtime_error io_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+BinaryClient BinaryClient::connect_tcp(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* resolved = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &resolved) != 0 || !resolved) {
+        throw std::runtime_error("Cannot resolve " + host);
+    }
+
+    int fd = -1;
+    for (addrinfo* address = resolved; address && fd < 0; address = address->ai_next) {
+        fd = socket(address->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(resolved);
+    if (fd < 0) {
+        throw io_error("Cannot connect to " + host + ":" + service);
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return BinaryClient(fd);
+}
+
+BinaryClient BinaryClient::connect_unix(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        auto error = io_error("Cannot connect to " + path);
+        if (fd >= 0) close(fd);
+        throw error;
+    }
+    return BinaryClient(fd);
+}
+
+BinaryClient::~BinaryClient() {
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+BinaryClient::BinaryClient(BinaryClient&& other) noexcept
+    : m_fd(std::exchange(other.m_fd, -1)),
+      m_next_id(other.m_next_id),
+      m_outstanding(std::exchange(other.m_outstanding, 0)),
+      m_out(std::move(other.m_out)),
+      m_in(std::move(other.m_in)),
+      m_in_offset(std::exchange(other.m_in_offset, 0)) {}
+
+BinaryClient& BinaryClient::operator=(BinaryClient&& other) noexcept {
+    if (this != &other) {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+        m_fd = std::exchange(other.m_fd, -1);
+        m_next_id = other.m_next_id;
+        m_outstanding = std::exchange(other.m_outstanding, 0);
+        m_out = std::move(other.m_out);
+        m_in = std::move(other.m_in);
+        m_in_offset = std::exchange(other.m_in_offset, 0);
+    }
+    return *this;
+}
+
+BinaryProtocol::Response BinaryClient::lookup(const IpAddress& address, FieldMask fields) {
+    if (m_outstanding > 0) {
+        throw std::logic_error("lookup() with pipelined requests unanswered");
+    }
+    send(address, fields);
+    flush();
+    return receive();
+}
+
+uint32_t BinaryClient::send(const IpAddress& address, FieldMask fields) {
+    uint32_t id = m_next_id++;
+    BinaryProtocol::append_request(m_out, BinaryProtocol::Request{id, fields, address});
+    ++m_outstanding;
+    return id;
+}
+
+void BinaryClient::flush() {
+    size_t written = 0;
+    while (written < m_out.size()) {
+        ssize_t n = ::send(m_fd, m_out.data() + written, m_out.size() - written, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw io_error("Cannot send lookup requests");
+        }
+        written += static_cast<size_t>(n);
+    }
+    m_out.clear();
+}
+
+BinaryProtocol::Response BinaryClient::receive() {
+    if (!m_out.empty()) {
+        flush();
+    }
+    while (true) {
+        std::string_view in = std::string_view(m_in).substr(m_in_offset);
+        auto length = BinaryProtocol::frame_length(in);
+        if (length && *length > BinaryProtocol::MAX_FRAME_SIZE) {
+            throw std::runtime_error("Lookup response frame too long");
+        }
+        if (length && in.size() >= BinaryProtocol::LENGTH_SIZE + *length) {
+            auto response = BinaryProtocol::parse_response(in.substr(BinaryProtocol::LENGTH_SIZE, *length));
+            m_in_offset += BinaryProtocol::LENGTH_SIZE + *length;
+            if (!response) {
+                throw std::runtime_error("Malformed lookup response");
+            }
+            if (m_outstanding > 0) {
+                --m_outstanding;
+            }
+            return *response;
+        }
+
+        // keep the buffer from growing with answers already returned
+        m_in.erase(0, m_in_offset);
+        m_in_offset = 0;
+        char buffer[16384];
+        ssize_t n = read(m_fd, buffer, sizeof(buffer));
+        if (n == 0) {
+            throw std::runtime_error("Lookup connection closed by the server");
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw io_error("Cannot read lookup responses");
+        }
+        m_in.append(buffer, static_cast<size_t>(n));
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "../protocol/binary_protocol.h"
+
+// Client for the binary lookup protocol (BINARY_PORT / BINARY_SOCKET), on one persistent
+// connection, used from one thread at a time. Blocking; I/O errors and a closed connection
+// throw std::runtime_error.
+//
+// lookup() sends one request and waits for its answer. For throughput, send() queues
+// requests, flush() writes them in one go and receive() returns answers as they arrive, in
+// whatever order the server finishes them; each carries the id send() returned.
+class BinaryClient {
+public:
+    using FieldMask = BinaryProtocol::FieldMask;
+
+    static BinaryClient connect_tcp(const std::string& host, int port);
+    static BinaryClient connect_unix(const std::string& path);
+
+    ~BinaryClient();
+    BinaryClient(BinaryClient&& other) noexcept;
+    BinaryClient& operator=(BinaryClient&& other) noexcept;
+    BinaryClient(const BinaryClient&) = delete;
+    BinaryClient& operator=(const BinaryClient&) = delete;
+
+    // throws std::logic_error while send()s are unanswered
+    BinaryProtocol::Response lookup(const IpAddress& address, FieldMask fields = LocationJson::ALL_FIELDS);
+
+    uint32_t send(const IpAddress& address, FieldMask fields = LocationJson::ALL_FIELDS);
+    void flush();
+    BinaryProtocol::Response receive();
+
+    // requests sent and not yet answered
+    size_t outstanding() const { return m_outstanding; }
+
+private:
+    explicit BinaryClient(int fd) : m_fd(fd) {}
+
+    int m_fd = -1;
+    uint32_t m_next_id = 1;
+    size_t m_outstanding = 0;
+    std::string m_out;
+    std::string m_in;
+    size_t m_in_offset = 0;
+};
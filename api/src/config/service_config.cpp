@@ -19,11 +19,68 @@ ServiceConfig ServiceConfig::load_from_env() {
     //rate limiting
     config.m_rate_limit_requests = get_env_int("RATE_LIMIT_REQUESTS", 100);
     config.m_rate_limit_window_seconds = get_env_int("RATE_LIMIT_WINDOW", 60);
+    config.m_trusted_proxies = get_env_var("TRUSTED_PROXIES", config.m_trusted_proxies);
+    config.m_rate_limit_ipv4_prefix = get_env_int("RATE_LIMIT_IPV4_PREFIX", 32);
+    config.m_rate_limit_ipv6_prefix = get_env_int("RATE_LIMIT_IPV6_PREFIX", 64);
+    config.m_rate_limit_max_clients = get_env_int("RATE_LIMIT_MAX_CLIENTS", 100000);
     
     //other
     config.m_log_level = get_env_var("LOG_LEVEL", "INFO");
     config.m_enable_metrics = get_env_bool("ENABLE_METRICS", true);
     config.m_redis_url = get_env_var("REDIS_URL", "");
+    config.m_redis_pool_size = get_env_int("REDIS_POOL_SIZE", 8);
+    config.m_redis_op_budget_ms = get_env_int("REDIS_OP_BUDGET_MS", 20);
+    config.m_redis_connect_timeout_ms = get_env_int("REDIS_CONNECT_TIMEOUT_MS", 100);
+    config.m_redis_breaker_failures = get_env_int("REDIS_BREAKER_FAILURES", 5);
+    config.m_redis_breaker_open_ms = get_env_int("REDIS_BREAKER_OPEN_MS", 5000);
+    
+    //cache writes
+    config.m_cache_write_queue_size = get_env_int("CACHE_WRITE_QUEUE_SIZE", 10000);
+    config.m_cache_write_batch_size = get_env_int("CACHE_WRITE_BATCH_SIZE", 128);
+    config.m_cache_write_flush_ms = get_env_int("CACHE_WRITE_FLUSH_MS", 5);
+    config.m_cache_value_format = get_env_var("CACHE_VALUE_FORMAT", "json");
+    config.m_cache_ttl_seconds = get_env_int("CACHE_TTL_SECONDS", 3600);
+    config.m_cache_not_found_ttl_seconds = get_env_int("CACHE_NOT_FOUND_TTL_SECONDS", 300);
+    config.m_cache_ttl_jitter_seconds = get_env_int("CACHE_TTL_JITTER_SECONDS", 300);
+    config.m_data_update_time_utc = get_env_var("DATA_UPDATE_TIME_UTC", "02:00");
+    config.m_generation_poll_seconds = get_env_int("DATASET_GENERATION_POLL_SECONDS", 30);
+    config.m_http_max_age_seconds = get_env_int("HTTP_MAX_AGE_SECONDS", 3600);
+    config.m_http_not_found_max_age_seconds = get_env_int("HTTP_NOT_FOUND_MAX_AGE_SECONDS", 300);
+    config.m_ipv4_index = get_env_var("IPV4_INDEX", "off");
+    config.m_huge_pages = get_env_var("HUGE_PAGES", "off");
+    config.m_numa_replicas = get_env_bool("NUMA_REPLICAS", false);
+    config.m_dataset_generations = get_env_int("DATASET_GENERATIONS", 1);
+    config.m_ranges_max_limit = get_env_int("RANGES_MAX_LIMIT", 1000);
+    config.m_request_pipeline = get_env_var("REQUEST_PIPELINE", "blocking");
+    config.m_async_threads = get_env_int("ASYNC_THREADS", 2);
+    config.m_async_db_connections = get_env_int("ASYNC_DB_CONNECTIONS", 16);
+    config.m_db_statement_timeout_ms = get_env_int("DB_STATEMENT_TIMEOUT_MS", 1000);
+    config.m_admission_control = get_env_bool("ADMISSION_CONTROL", true);
+    config.m_cache_concurrency_limit = get_env_int("CACHE_CONCURRENCY_LIMIT", 256);
+    config.m_cache_concurrency_max = get_env_int("CACHE_CONCURRENCY_MAX", 4096);
+    config.m_db_concurrency_limit = get_env_int("DB_CONCURRENCY_LIMIT", 32);
+    config.m_db_concurrency_max = get_env_int("DB_CONCURRENCY_MAX", 512);
+    config.m_retry_after_seconds = get_env_int("RETRY_AFTER_SECONDS", 1);
+    config.m_server_timing = get_env_var("SERVER_TIMING", "request");
+    config.m_trace_sample_every = get_env_int("TRACE_SAMPLE_EVERY", 0);
+    config.m_trace_ring_size = get_env_int("TRACE_RING_SIZE", 1024);
+    config.m_capture_file = get_env_var("CAPTURE_FILE", "");
+    config.m_capture_sample_every = get_env_int("CAPTURE_SAMPLE_EVERY", 1);
+    config.m_capture_buffer_size = get_env_int("CAPTURE_BUFFER_SIZE", 65536);
+    config.m_heavy_hitters_top_k = get_env_int("HEAVY_HITTERS_TOP_K", 32);
+    config.m_heavy_hitters_width = get_env_int("HEAVY_HITTERS_WIDTH", 2048);
+    config.m_binary_port = get_env_int("BINARY_PORT", 0);
+    config.m_binary_bind_address = get_env_var("BINARY_BIND_ADDRESS", "127.0.0.1");
+    config.m_binary_socket = get_env_var("BINARY_SOCKET", "");
+    config.m_binary_io_threads = get_env_int("BINARY_IO_THREADS", 2);
+    config.m_binary_workers = get_env_int("BINARY_WORKERS", 8);
+    config.m_binary_rate_limit = get_env_bool("BINARY_RATE_LIMIT", false);
+    config.m_admin_port = get_env_int("ADMIN_PORT", 0);
+    config.m_admin_bind_address = get_env_var("ADMIN_BIND_ADDRESS", "127.0.0.1");
+    config.m_worker_processes = get_env_int("WORKER_PROCESSES", 1);
+    config.m_pin_workers = get_env_bool("PIN_WORKERS", false);
+    config.m_db_pool_min_ready = get_env_int("DB_POOL_MIN_READY", 2);
+    config.m_redis_startup_wait_ms = get_env_int("REDIS_STARTUP_WAIT_MS", 5000);
     
     return config;
 }
@@ -5,14 +5,113 @@
 class ServiceConfig {
 public:
     std::string m_database_url;
-    int m_server_port;
-    int m_db_pool_size;
-    int m_rate_limit_requests;
-    int m_rate_limit_window_seconds;
-    std::string m_log_level;
-    bool m_enable_metrics;
+    int m_server_port = 8080;
+    int m_db_pool_size = 10;
+    int m_rate_limit_requests = 100;
+    int m_rate_limit_window_seconds = 60;
+    std::string m_log_level = "INFO";
+    bool m_enable_metrics = true;
     std::string m_redis_url;
 
+    //rate limit keys: proxies whose X-Forwarded-For is believed, the prefix lengths clients are
+    //grouped by, and how many clients the limiter tracks at most
+    std::string m_trusted_proxies = "127.0.0.0/8,10.0.0.0/8,172.16.0.0/12,192.168.0.0/16,::1/128,fc00::/7";
+    int m_rate_limit_ipv4_prefix = 32;
+    int m_rate_limit_ipv6_prefix = 64;
+    int m_rate_limit_max_clients = 100000;
+
+    //redis latency budget and circuit breaker
+    int m_redis_pool_size = 8;
+    int m_redis_op_budget_ms = 20;
+    int m_redis_connect_timeout_ms = 100;
+    int m_redis_breaker_failures = 5;
+    int m_redis_breaker_open_ms = 5000;
+
+    //write-behind cache fills
+    int m_cache_write_queue_size = 10000;
+    int m_cache_write_batch_size = 128;
+    int m_cache_write_flush_ms = 5;
+    std::string m_cache_value_format = "json";
+
+    //cache expiry, aligned with the daily dataset update
+    int m_cache_ttl_seconds = 3600;
+    int m_cache_not_found_ttl_seconds = 300;
+    int m_cache_ttl_jitter_seconds = 300;
+    std::string m_data_update_time_utc = "02:00";
+    int m_generation_poll_seconds = 30;
+
+    //HTTP caching of /ip-location by browsers and CDNs: max-age of found and not found answers,
+    //capped at the next dataset update (0 sends no cache headers and ignores If-None-Match)
+    int m_http_max_age_seconds = 3600;
+    int m_http_not_found_max_age_seconds = 300;
+
+    //in-memory lookups: off, binary, dir24 or dir16
+    std::string m_ipv4_index = "off";
+    //in-memory data placement: huge pages off, transparent or explicit; one replica per NUMA node
+    std::string m_huge_pages = "off";
+    bool m_numa_replicas = false;
+    //dataset generations kept in memory, the newest included, for ?generation= lookups and rollback
+    int m_dataset_generations = 1;
+    //most ranges one /ip-ranges page may list; pages past it need the next_cursor
+    int m_ranges_max_limit = 1000;
+
+    //request pipeline: blocking (a Crow thread per lookup) or async (coroutines over
+    //non-blocking Redis and Postgres, opt-in until it has been load tested end to end)
+    std::string m_request_pipeline = "blocking";
+    int m_async_threads = 2;
+    int m_async_db_connections = 16;
+    int m_db_statement_timeout_ms = 1000;
+
+    //admission control: adaptive concurrency limits (initial and maximum) for the Redis and
+    //Postgres stages of a lookup; requests over a limit get 503 with Retry-After
+    bool m_admission_control = true;
+    int m_cache_concurrency_limit = 256;
+    int m_cache_concurrency_max = 4096;
+    int m_db_concurrency_limit = 32;
+    int m_db_concurrency_max = 512;
+    int m_retry_after_seconds = 1;
+
+    //per-request timing: Server-Timing header (off, request when the request sends
+    //X-Server-Timing, or always) and 1 in N lookups kept for /debug/traces (0 disables tracing)
+    std::string m_server_timing = "request";
+    int m_trace_sample_every = 0;
+    int m_trace_ring_size = 1024;
+
+    //traffic capture: the address, fields and arrival time of 1 in N lookups, written to a
+    //file for replay_traffic through a lock-free ring of the given size (no file disables it)
+    std::string m_capture_file;
+    int m_capture_sample_every = 1;
+    int m_capture_buffer_size = 65536;
+
+    //heavy hitters: the top K looked-up addresses and clients, counted in Count-Min sketches
+    //of the given width, shown on /debug/heavy-hitters (a K of 0 disables them)
+    int m_heavy_hitters_top_k = 32;
+    int m_heavy_hitters_width = 2048;
+
+    //binary lookup protocol: a second listener on a TCP port (0 disables it) and/or a Unix
+    //socket, with its own I/O threads and workers for lookups that go to Redis or Postgres;
+    //meant for internal callers, so not rate limited unless asked
+    int m_binary_port = 0;
+    std::string m_binary_bind_address = "127.0.0.1";
+    std::string m_binary_socket;
+    int m_binary_io_threads = 2;
+    int m_binary_workers = 8;
+    bool m_binary_rate_limit = false;
+
+    //admin listener: actions that change what is served (rollback, resetting counters) on a
+    //separate port without CORS, bound to loopback by default (0 disables them)
+    int m_admin_port = 0;
+    std::string m_admin_bind_address = "127.0.0.1";
+
+    //prefork mode: worker processes sharing the port with SO_REUSEPORT, optionally one per CPU
+    int m_worker_processes = 1;
+    bool m_pin_workers = false;
+
+    //startup: connections the database pool needs before the worker reports ready, and how
+    //long Redis may take to answer before the worker becomes ready with the cache bypassed
+    int m_db_pool_min_ready = 2;
+    int m_redis_startup_wait_ms = 5000;
+
     static ServiceConfig load_from_env();
 
 private:
@@ -0,0 +1,312 @@
+#include "async_database_pool.h"
+#include "../utils/logger.h"
+
+class AsyncDatabasePool::AcquireAwaiter {
+public:
+    explicit AcquireAwaiter(AsyncDatabasePool& pool) : m_pool(pool) {}
+
+    bool await_ready() {
+        std::lock_guard<std::mutex> lock(m_pool.m_mutex);
+        if (m_pool.m_idle.empty()) {
+            // no connection will come back soon; resumes with none
+            return m_pool.m_reconnecting == m_pool.m_connection_count;
+        }
+        m_conn = m_pool.m_idle.back();
+        m_pool.m_idle.pop_back();
+        return true;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> lock(m_pool.m_mutex);
+        // a connection may have come back since await_ready
+        if (!m_pool.m_idle.empty()) {
+            m_conn = m_pool.m_idle.back();
+            m_pool.m_idle.pop_back();
+            return false;
+        }
+        if (m_pool.m_reconnecting == m_pool.m_connection_count) {
+            return false;
+        }
+        m_handle = handle;
+        m_pool.m_waiters.push_back(this);
+        return true;
+    }
+
+    // null when every connection is reconnecting
+    PGconn* await_resume() const { return m_conn; }
+
+private:
+    friend class AsyncDatabasePool;
+
+    AsyncDatabasePool& m_pool;
+    std::coroutine_handle<> m_handle;
+    PGconn* m_conn = nullptr;
+};
+
+// returns the connection when the query's coroutine frame unwinds, including on exceptions
+class AsyncDatabasePool::Lease {
+public:
+    Lease(AsyncDatabasePool& pool, PGconn* conn) : m_pool(pool), m_conn(conn) {}
+    ~Lease() { m_pool.release(m_conn); }
+
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+private:
+    AsyncDatabasePool& m_pool;
+    PGconn* m_conn;
+};
+
+AsyncDatabasePool::AsyncDatabasePool(Reactor& reactor, const std::string& connection_string, int pool_size,
+                                     std::vector<std::pair<std::string, std::string>> prepared_statements,
+                                     std::chrono::milliseconds statement_timeout)
+    : m_reactor(reactor),
+      m_conn_str(connection_string),
+      m_prepared_statements(std::move(prepared_statements)),
+      m_statement_timeout(statement_timeout) {
+    auto logger = Logger::Logger::get_logger();
+    // connection setup is a few round trips each; open them all at once
+    std::vector<std::thread> connectors;
+    for (int i = 0; i < pool_size; ++i) {
+        connectors.emplace_back([this]() {
+            if (PGconn* conn = connect()) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_idle.push_back(conn);
+            }
+        });
+    }
+    for (auto& connector : connectors) {
+        connector.join();
+    }
+    m_connection_count = m_idle.size();
+    if (m_idle.empty()) {
+        throw AsyncDatabaseError("Failed to open any non-blocking database connections", true);
+    }
+    logger->info("Async database pool initialized with {} connections", m_connection_count);
+    m_reconnector = std::thread([this]() { run_reconnects(); });
+}
+
+AsyncDatabasePool::~AsyncDatabasePool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_reconnect_cv.notify_all();
+    m_reconnector.join();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (PGconn* conn : m_idle) {
+        m_reactor.forget(PQsocket(conn));
+        PQfinish(conn);
+    }
+    for (PGconn* conn : m_broken) {
+        PQfinish(conn);
+    }
+}
+
+PGconn* AsyncDatabasePool::connect() {
+    auto logger = Logger::Logger::get_logger();
+    PGconn* conn = PQconnectdb(m_conn_str.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        logger->error("Async database connection failed: {}", PQerrorMessage(conn));
+        PQfinish(conn);
+        return nullptr;
+    }
+
+    // connection setup is blocking; only the queries themselves go through the reactor
+    if (!prepare_session(conn)) {
+        PQfinish(conn);
+        return nullptr;
+    }
+    if (PQsetnonblocking(conn, 1) != 0) {
+        logger->error("Failed to make database connection non-blocking: {}", PQerrorMessage(conn));
+        PQfinish(conn);
+        return nullptr;
+    }
+    return conn;
+}
+
+bool AsyncDatabasePool::prepare_session(PGconn* conn) {
+    auto logger = Logger::Logger::get_logger();
+    std::string set_timeout = "SET statement_timeout = " + std::to_string(m_statement_timeout.count());
+    PgResult timeout(PQexec(conn, set_timeout.c_str()));
+    if (PQresultStatus(timeout.raw()) != PGRES_COMMAND_OK) {
+        logger->error("Failed to set statement_timeout: {}", PQerrorMessage(conn));
+        return false;
+    }
+    for (const auto& [name, query] : m_prepared_statements) {
+        PgResult prepared(PQprepare(conn, name.c_str(), query.c_str(), 0, nullptr));
+        if (PQresultStatus(prepared.raw()) != PGRES_COMMAND_OK) {
+            logger->error("Failed to prepare {}: {}", name, PQerrorMessage(conn));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AsyncDatabasePool::reconnect(PGconn* conn) {
+    PQsetnonblocking(conn, 0);
+    PQreset(conn);
+    if (PQstatus(conn) != CONNECTION_OK || !prepare_session(conn)) {
+        return false;
+    }
+    return PQsetnonblocking(conn, 1) == 0;
+}
+
+void AsyncDatabasePool::run_reconnects() {
+    auto logger = Logger::Logger::get_logger();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        if (m_broken.empty()) {
+            m_reconnect_cv.wait(lock, [this]() { return m_stopping || !m_broken.empty(); });
+            continue;
+        }
+        std::vector<PGconn*> broken;
+        broken.swap(m_broken);
+        lock.unlock();
+
+        std::vector<PGconn*> failed;
+        for (PGconn* conn : broken) {
+            if (reconnect(conn)) {
+                logger->info("Async database connection re-established");
+                {
+                    std::lock_guard<std::mutex> relock(m_mutex);
+                    --m_reconnecting;
+                }
+                hand_back(conn);
+            } else {
+                failed.push_back(conn);
+            }
+        }
+
+        lock.lock();
+        m_broken.insert(m_broken.end(), failed.begin(), failed.end());
+        if (!failed.empty()) {
+            m_reconnect_cv.wait_for(lock, RECONNECT_INTERVAL, [this]() { return m_stopping; });
+        }
+    }
+}
+
+AsyncDatabasePool::AcquireAwaiter AsyncDatabasePool::acquire() {
+    return AcquireAwaiter(*this);
+}
+
+void AsyncDatabasePool::release(PGconn* conn) {
+    // a query abandoned half way leaves the connection unusable for the next one
+    if (PQstatus(conn) != CONNECTION_BAD && PQtransactionStatus(conn) != PQTRANS_ACTIVE) {
+        hand_back(conn);
+        return;
+    }
+
+    // the socket is replaced by the reset
+    m_reactor.forget(PQsocket(conn));
+    std::deque<AcquireAwaiter*> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_broken.push_back(conn);
+        ++m_reconnecting;
+        if (m_reconnecting == m_connection_count) {
+            abandoned.swap(m_waiters);
+        }
+    }
+    m_reconnect_cv.notify_one();
+    Logger::Logger::get_logger()->warning("Async database connection lost, reconnecting in the background");
+    for (AcquireAwaiter* waiter : abandoned) {
+        waiter->m_conn = nullptr;
+        m_reactor.post(waiter->m_handle);
+    }
+}
+
+void AsyncDatabasePool::hand_back(PGconn* conn) {
+    AcquireAwaiter* waiter = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_waiters.empty()) {
+            m_idle.push_back(conn);
+            return;
+        }
+        waiter = m_waiters.front();
+        m_waiters.pop_front();
+    }
+    // hand the connection straight to the oldest waiting query
+    waiter->m_conn = conn;
+    m_reactor.post(waiter->m_handle);
+}
+
+size_t AsyncDatabasePool::idle_connections() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_idle.size();
+}
+
+size_t AsyncDatabasePool::waiting_queries() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_waiters.size();
+}
+
+size_t AsyncDatabasePool::reconnecting_connections() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_reconnecting;
+}
+
+Task<void> AsyncDatabasePool::wait_for_flush(PGconn* conn) {
+    int pending;
+    while ((pending = PQflush(conn)) == 1) {
+        co_await m_reactor.writable(PQsocket(conn));
+    }
+    if (pending < 0) {
+        throw AsyncDatabaseError(PQerrorMessage(conn), PQstatus(conn) == CONNECTION_BAD);
+    }
+}
+
+Task<PgResult> AsyncDatabasePool::execute_prepared(std::string name, std::vector<std::string> params,
+                                                   std::chrono::nanoseconds* connection_wait) {
+    auto start = std::chrono::steady_clock::now();
+    PGconn* conn = co_await acquire();
+    if (!conn) {
+        throw AsyncDatabaseError("Every database connection is reconnecting", true);
+    }
+    Lease lease(*this, conn);
+    if (connection_wait) {
+        *connection_wait = std::chrono::steady_clock::now() - start;
+    }
+
+    std::vector<const char*> values;
+    values.reserve(params.size());
+    for (const auto& param : params) {
+        values.push_back(param.c_str());
+    }
+
+    if (!PQsendQueryPrepared(conn, name.c_str(), static_cast<int>(values.size()), values.data(), nullptr, nullptr, 0)) {
+        throw AsyncDatabaseError(PQerrorMessage(conn), PQstatus(conn) == CONNECTION_BAD);
+    }
+    co_await wait_for_flush(conn);
+
+    // read until libpq has every result of the query; the first one is the query's
+    PgResult result;
+    while (true) {
+        while (PQisBusy(conn)) {
+            co_await m_reactor.readable(PQsocket(conn));
+            if (!PQconsumeInput(conn)) {
+                throw AsyncDatabaseError(PQerrorMessage(conn), PQstatus(conn) == CONNECTION_BAD);
+            }
+        }
+        PGresult* next = PQgetResult(conn);
+        if (!next) {
+            break;
+        }
+        if (!result) {
+            result = PgResult(next);
+        } else {
+            PQclear(next);
+        }
+    }
+
+    if (!result) {
+        throw AsyncDatabaseError("Query returned no result", PQstatus(conn) == CONNECTION_BAD);
+    }
+    ExecStatusType status = PQresultStatus(result.raw());
+    if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK) {
+        throw AsyncDatabaseError(PQresultErrorMessage(result.raw()), PQstatus(conn) == CONNECTION_BAD);
+    }
+    co_return result;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <libpq-fe.h>
+#include "../async/reactor.h"
+#include "../async/task.h"
+
+class AsyncDatabaseError : public std::runtime_error {
+public:
+    AsyncDatabaseError(const std::string& message, bool connection_lost)
+        : std::runtime_error(message), m_connection_lost(connection_lost) {}
+
+    bool connection_lost() const { return m_connection_lost; }
+
+private:
+    bool m_connection_lost;
+};
+
+// Owns a libpq result.
+class PgResult {
+public:
+    PgResult() = default;
+    explicit PgResult(PGresult* result) : m_result(result, &PQclear) {}
+
+    explicit operator bool() const { return m_result != nullptr; }
+    PGresult* raw() const { return m_result.get(); }
+    int rows() const { return m_result ? PQntuples(m_result.get()) : 0; }
+    int column(const char* name) const { return PQfnumber(m_result.get(), name); }
+    bool is_null(int row, int column) const { return column < 0 || PQgetisnull(m_result.get(), row, column); }
+    std::string value(int row, int column) const { return PQgetvalue(m_result.get(), row, column); }
+
+private:
+    std::unique_ptr<PGresult, void (*)(PGresult*)> m_result{nullptr, &PQclear};
+};
+
+// Postgres connections driven through libpq's non-blocking API on a Reactor. A query suspends
+// the calling coroutine while it waits for the socket instead of holding a thread, and
+// callers suspend while every connection is busy. pqxx has no non-blocking interface, so
+// these connections are separate from DatabasePool's.
+//
+// A connection that breaks is reconnected on a background thread, since libpq's reset blocks
+// for up to the connect timeout, and rejoins the pool once its session is prepared again.
+// While every connection is reconnecting, queries fail at once instead of queueing.
+class AsyncDatabasePool {
+public:
+    // Connects up to `pool_size` connections up front, preparing every statement on each.
+    // Queries running longer than statement_timeout are cancelled by the server.
+    AsyncDatabasePool(Reactor& reactor, const std::string& connection_string, int pool_size,
+                      std::vector<std::pair<std::string, std::string>> prepared_statements,
+                      std::chrono::milliseconds statement_timeout);
+    ~AsyncDatabasePool();
+
+    AsyncDatabasePool(const AsyncDatabasePool&) = delete;
+    AsyncDatabasePool& operator=(const AsyncDatabasePool&) = delete;
+
+    // throws AsyncDatabaseError; `connection_wait`, when given, is set to the time spent
+    // waiting for a free connection
+    Task<PgResult> execute_prepared(std::string name, std::vector<std::string> params,
+                                    std::chrono::nanoseconds* connection_wait = nullptr);
+
+    size_t connection_count() const { return m_connection_count; }
+    size_t idle_connections();
+    size_t waiting_queries();
+    size_t reconnecting_connections();
+
+private:
+    class AcquireAwaiter;
+    class Lease;
+
+    PGconn* connect();
+    bool prepare_session(PGconn* conn);
+    // blocking; true once the connection is usable again
+    bool reconnect(PGconn* conn);
+    void run_reconnects();
+    AcquireAwaiter acquire();
+    // back to the pool, or to the reconnect thread when the connection is broken
+    void release(PGconn* conn);
+    // to the oldest waiting query, or idle
+    void hand_back(PGconn* conn);
+    Task<void> wait_for_flush(PGconn* conn);
+
+    Reactor& m_reactor;
+    const std::string m_conn_str;
+    const std::vector<std::pair<std::string, std::string>> m_prepared_statements;
+    const std::chrono::milliseconds m_statement_timeout;
+    size_t m_connection_count = 0;
+
+    std::mutex m_mutex;
+    std::vector<PGconn*> m_idle;
+    std::deque<AcquireAwaiter*> m_waiters;
+
+    static constexpr std::chrono::seconds RECONNECT_INTERVAL{1};
+    std::vector<PGconn*> m_broken; // waiting for the reconnect thread
+    size_t m_reconnecting = 0;     // out of the pool until reconnected, m_broken included
+    bool m_stopping = false;
+    std::condition_variable m_reconnect_cv;
+    std::thread m_reconnector;
+};
@@ -4,28 +4,34 @@
 #include <chrono>
 #include <iostream>
 
-DatabasePool::DatabasePool(const std::string& connection_string, int pool_size) 
+DatabasePool::DatabasePool(const std::string& connection_string, int pool_size, bool deferred) 
     : m_conn_str(connection_string), m_pool_size(pool_size) {
-    initialize_pool();
+    if (deferred) {
+        m_is_healthy = false;
+    } else {
+        initialize_pool();
+    }
 }
 
 DatabasePool::~DatabasePool() {
+    stop_connecting();
+    join_connectors();
     std::lock_guard<std::mutex> lock(m_pool_mutex);
     m_pool.clear();
 }
 
 void DatabasePool::initialize_pool() {
     auto logger = Logger::Logger::get_logger();
-    std::lock_guard<std::mutex> lock(m_pool_mutex);
-    m_pool.clear();
-    
-    for (int i = 0; i < m_pool_size; ++i) {
-        auto conn = create_connection();
-        if (conn) {
-            m_pool.push_back(std::move(conn));
-        }
+    {
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+        m_pool.clear();
     }
-    
+
+    start_connecting();
+    wait_for_connections(static_cast<size_t>(m_pool_size));
+    join_connectors();
+
+    std::lock_guard<std::mutex> lock(m_pool_mutex);
     if (m_pool.empty()) {
         logger->error("Failed to create any database connections!");
         m_is_healthy = false;
@@ -35,6 +41,62 @@ void DatabasePool::initialize_pool() {
     }
 }
 
+void DatabasePool::start_connecting() {
+    // a previous round has finished by the time the pool is short of connections again
+    join_connectors();
+
+    size_t missing;
+    {
+        std::lock_guard<std::mutex> lock(m_pool_mutex);
+        missing = m_pool.size() < static_cast<size_t>(m_pool_size) ? m_pool_size - m_pool.size() : 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_connect_mutex);
+    m_connecting += missing;
+    for (size_t i = 0; i < missing; ++i) {
+        m_connectors.emplace_back([this]() {
+            auto conn = create_connection();
+            bool opened = conn != nullptr;
+            if (opened) {
+                std::lock_guard<std::mutex> pool_lock(m_pool_mutex);
+                m_pool.push_back(std::move(conn));
+                m_is_healthy = true;
+            }
+            {
+                std::lock_guard<std::mutex> connect_lock(m_connect_mutex);
+                --m_connecting;
+                m_connected += opened ? 1 : 0;
+            }
+            m_connect_cv.notify_all();
+        });
+    }
+}
+
+size_t DatabasePool::wait_for_connections(size_t count) {
+    std::unique_lock<std::mutex> lock(m_connect_mutex);
+    m_connect_cv.wait(lock, [&]() { return m_connected >= count || m_connecting == 0; });
+    return m_connected;
+}
+
+void DatabasePool::stop_connecting() {
+    {
+        std::lock_guard<std::mutex> lock(m_connect_mutex);
+        m_stop_connecting = true;
+    }
+    m_connect_cv.notify_all();
+}
+
+void DatabasePool::join_connectors() {
+    std::vector<std::thread> connectors;
+    {
+        std::lock_guard<std::mutex> lock(m_connect_mutex);
+        connectors.swap(m_connectors);
+    }
+    for (auto& connector : connectors) {
+        connector.join();
+    }
+}
+
 std::unique_ptr<pqxx::connection> DatabasePool::get_connection() {
     std::lock_guard<std::mutex> lock(m_pool_mutex);
     
@@ -95,20 +157,17 @@ std::unique_ptr<pqxx::connection> DatabasePool::create_connection() {
             auto conn = std::make_unique<pqxx::connection>(m_conn_str);
             if (conn->is_open()) {
                 // Prepare the statement immediately after connecting
-                conn->prepare(
-                    PREPARED_IP_LOOKUP_NAME,
-                    "SELECT country, city, region, latitude, longitude, postal_code, timezone "
-                    "FROM ip_locations "
-                    "WHERE $1::inet >= start_ip AND $1::inet <= end_ip "
-                    "ORDER BY start_ip "
-                    "LIMIT 1"
-                );
+                conn->prepare(PREPARED_IP_LOOKUP_NAME, PREPARED_IP_LOOKUP_QUERY);
                 return conn;
             }
         } catch (const std::exception& e) {
             logger->error("Database connection attempt {} failed: {}", i + 1, e.what());
             if (i < MAX_RETRIES - 1) {
-                std::this_thread::sleep_for(std::chrono::seconds(RETRY_DELAY_SECONDS));
+                std::unique_lock<std::mutex> lock(m_connect_mutex);
+                if (m_connect_cv.wait_for(lock, std::chrono::seconds(RETRY_DELAY_SECONDS),
+                                          [&]() { return m_stop_connecting; })) {
+                    break;
+                }
             }
         }
     }
@@ -4,13 +4,22 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
 #include <string>
+#include <thread>
 
 class DatabasePool {
 public:
     static inline const std::string PREPARED_IP_LOOKUP_NAME = "ip_lookup_query";
+    static inline const std::string PREPARED_IP_LOOKUP_QUERY =
+        "SELECT country, city, region, latitude, longitude, postal_code, timezone "
+        "FROM ip_locations "
+        "WHERE $1::inet >= start_ip AND $1::inet <= end_ip "
+        "ORDER BY start_ip "
+        "LIMIT 1";
     
-    DatabasePool(const std::string& connection_string, int pool_size = 10);
+    // connects in the constructor unless `deferred`, in which case start_connecting() does
+    DatabasePool(const std::string& connection_string, int pool_size = 10, bool deferred = false);
     ~DatabasePool();
     
     std::unique_ptr<pqxx::connection> get_connection();
@@ -19,15 +28,32 @@ public:
     bool is_pool_healthy() const;
     void initialize_pool();
 
+    // opens the connections the pool is missing, all at once, in the background
+    void start_connecting();
+    // blocks until `count` connections have been opened or every attempt has finished;
+    // returns the number opened so far
+    size_t wait_for_connections(size_t count);
+    // cuts connection retries short; connection attempts after this are tried once
+    void stop_connecting();
+
 private:
     std::vector<std::unique_ptr<pqxx::connection>> m_pool;
     std::mutex m_pool_mutex;
     std::string m_conn_str;
     std::atomic<bool> m_is_healthy{true};
     int m_pool_size;
+
+    // background connection attempts started by start_connecting()
+    std::mutex m_connect_mutex;
+    std::condition_variable m_connect_cv;
+    std::vector<std::thread> m_connectors;
+    size_t m_connecting = 0;
+    size_t m_connected = 0;
+    bool m_stop_connecting = false;
     
     static inline const int MAX_RETRIES = 10;
     static inline const int RETRY_DELAY_SECONDS = 3;
     
     std::unique_ptr<pqxx::connection> create_connection();
+    void join_connectors();
 };
\ No newline at end of file
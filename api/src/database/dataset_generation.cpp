@@ -0,0 +1,74 @@
+#include "dataset_generation.h"
+#include "../utils/logger.h"
+
+DatasetGeneration::DatasetGeneration(DatabasePool& db_pool, std::chrono::seconds poll_interval)
+    : m_db_pool(db_pool), m_poll_interval(poll_interval) {
+    refresh();
+    if (m_poll_interval.count() > 0) {
+        m_poller = std::thread(&DatasetGeneration::run, this);
+    }
+}
+
+DatasetGeneration::~DatasetGeneration() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_poller.joinable()) {
+        m_poller.join();
+    }
+}
+
+bool DatasetGeneration::refresh() {
+    auto logger = Logger::Logger::get_logger();
+    auto conn = m_db_pool.get_connection();
+    if (!conn) {
+        return false;
+    }
+
+    uint64_t generation = 0;
+    try {
+        pqxx::work W(*conn);
+        // checked first, so polling before the updater's first run costs no failed query
+        if (W.exec(TABLE_EXISTS_QUERY)[0][0].as<bool>()) {
+            pqxx::result R = W.exec(GENERATION_QUERY);
+            if (!R.empty() && !R[0][0].is_null()) {
+                generation = R[0][0].as<uint64_t>();
+            }
+        }
+        W.commit();
+        m_db_pool.return_connection(std::move(conn));
+    } catch (const std::exception& e) {
+        logger->debug("Dataset generation lookup failed: {}", e.what());
+        // the transaction is rolled back by now; a connection that is still open goes back
+        // to the pool rather than being reopened under the pool's lock
+        m_db_pool.return_connection(std::move(conn));
+        return false;
+    }
+
+    uint64_t previous = m_generation.exchange(generation, std::memory_order_acq_rel);
+    if (previous != generation) {
+        logger->info("Dataset generation changed from {} to {}", previous, generation);
+        std::lock_guard<std::mutex> lock(m_listener_mutex);
+        if (m_listener) {
+            m_listener(generation);
+        }
+        return true;
+    }
+    return false;
+}
+
+void DatasetGeneration::set_listener(std::function<void(uint64_t)> listener) {
+    std::lock_guard<std::mutex> lock(m_listener_mutex);
+    m_listener = std::move(listener);
+}
+
+void DatasetGeneration::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_cv.wait_for(lock, m_poll_interval, [this] { return m_stop; })) {
+        lock.unlock();
+        refresh();
+        lock.lock();
+    }
+}
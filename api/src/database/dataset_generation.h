@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "database_pool.h"
+
+// Tracks the id of the dataset currently loaded in ip_locations. The data updater records
+// a new row in dataset_generations in the same transaction as the table swap; this class
+// polls for it in the background so request threads only read an atomic.
+class DatasetGeneration {
+public:
+    static inline const std::string GENERATION_QUERY =
+        "SELECT COALESCE(MAX(generation), 0) FROM dataset_generations";
+    // the table only exists once the updater has completed a run
+    static inline const std::string TABLE_EXISTS_QUERY =
+        "SELECT to_regclass('dataset_generations') IS NOT NULL";
+
+    DatasetGeneration(DatabasePool& db_pool, std::chrono::seconds poll_interval);
+    ~DatasetGeneration();
+
+    DatasetGeneration(const DatasetGeneration&) = delete;
+    DatasetGeneration& operator=(const DatasetGeneration&) = delete;
+
+    uint64_t current() const { return m_generation.load(std::memory_order_acquire); }
+
+    // queries the database once; returns true if the generation changed
+    bool refresh();
+
+    // called from the polling thread after the generation changes
+    void set_listener(std::function<void(uint64_t)> listener);
+
+private:
+    void run();
+
+    DatabasePool& m_db_pool;
+    const std::chrono::seconds m_poll_interval;
+    std::atomic<uint64_t> m_generation{0};
+
+    std::mutex m_listener_mutex;
+    std::function<void(uint64_t)> m_listener;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    std::thread m_poller;
+};
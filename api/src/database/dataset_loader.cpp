@@ -0,0 +1,87 @@
+#include "dataset_loader.h"
+#include "dataset_generation.h"
+#include "../utils/ip_address.h"
+#include "../utils/logger.h"
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+std::optional<std::string> to_optional_string(const std::optional<std::string_view>& value) {
+    return value ? std::optional<std::string>(std::string(*value)) : std::nullopt;
+}
+
+} // namespace
+
+DatasetLoader::Result DatasetLoader::load(DatabasePool& db_pool, Ipv4IndexType ipv4_index) {
+    auto logger = Logger::Logger::get_logger();
+    auto start = std::chrono::steady_clock::now();
+
+    auto conn = db_pool.get_connection();
+    if (!conn) {
+        throw std::runtime_error("Database connection unavailable");
+    }
+
+    LocationDataset::Builder builder;
+    size_t skipped = 0;
+    uint64_t generation = 0;
+    {
+        // streamed row by row so the full result set is never materialized; the generation is
+        // read afterwards from the same snapshot, so it names exactly these rows
+        pqxx::work W(*conn);
+        W.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+        for (auto [start_ip, end_ip, country, city, region, latitude, longitude, postal_code, timezone] :
+             W.stream<std::string_view, std::string_view,
+                      std::optional<std::string_view>, std::optional<std::string_view>, std::optional<std::string_view>,
+                      std::optional<float>, std::optional<float>,
+                      std::optional<std::string_view>, std::optional<std::string_view>>(LOCATIONS_QUERY)) {
+            auto first = IpAddress::parse(start_ip);
+            auto last = IpAddress::parse(end_ip);
+            if (!first || !last || first->family() != last->family()) {
+                ++skipped;
+                continue;
+            }
+
+            LocationRecord record;
+            record.country = to_optional_string(country);
+            record.city = to_optional_string(city);
+            record.region = to_optional_string(region);
+            record.latitude = latitude;
+            record.longitude = longitude;
+            record.postal_code = to_optional_string(postal_code);
+            record.timezone = to_optional_string(timezone);
+
+            if (first->is_v4()) {
+                builder.add_ipv4(first->v4(), last->v4(), record);
+            } else {
+                builder.add_ipv6(first->v6(), last->v6(), record);
+            }
+        }
+        try {
+            pqxx::result R = W.exec(DatasetGeneration::GENERATION_QUERY);
+            if (!R.empty() && !R[0][0].is_null()) {
+                generation = R[0][0].as<uint64_t>();
+            }
+            W.commit();
+        } catch (const pqxx::sql_error& e) {
+            // the table only exists once the updater has completed a run
+            logger->debug("Dataset generation lookup failed: {}", e.what());
+        }
+    }
+    db_pool.return_connection(std::move(conn));
+
+    auto dataset = builder.build(ipv4_index);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    logger->info("Loaded in-memory dataset generation {}: {} IPv4 ranges ({} index, {} bytes), {} IPv6 ranges ({} bytes), "
+                 "{} distinct locations ({} bytes) in {} ms",
+                 generation, dataset->ipv4_range_count(), LocationDataset::ipv4_index_to_string(ipv4_index),
+                 dataset->ipv4_index_memory_bytes(), dataset->ipv6_range_count(), dataset->ipv6_index_memory_bytes(),
+                 dataset->record_count(), dataset->record_memory_bytes(), elapsed.count());
+    if (skipped > 0) {
+        logger->warning("Skipped {} ip_locations rows with unparseable bounds", skipped);
+    }
+    return {dataset, generation};
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "database_pool.h"
+#include "../lookup/location_dataset.h"
+
+// Builds the in-memory LocationDataset from ip_locations.
+class DatasetLoader {
+public:
+    static inline const std::string LOCATIONS_QUERY =
+        "SELECT host(start_ip), host(end_ip), country, city, region, latitude, longitude, postal_code, timezone "
+        "FROM ip_locations "
+        "ORDER BY start_ip";
+
+    struct Result {
+        std::shared_ptr<const LocationDataset> dataset;
+        // the dataset_generations entry the rows belong to, read in the same snapshot; 0 when
+        // none is recorded yet
+        uint64_t generation = 0;
+    };
+
+    // throws on connection or query errors
+    static Result load(DatabasePool& db_pool, Ipv4IndexType ipv4_index);
+};
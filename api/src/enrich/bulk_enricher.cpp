@@ -0,0 +1,414 @@
+#include "bulk_enricher.h"
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include "work_stealing_pool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct FieldColumn {
+    LocationJson::FieldMask mask;
+    std::string_view name;
+};
+
+constexpr std::array<FieldColumn, 7> FIELD_COLUMNS{{
+    {LocationJson::COUNTRY, "country"},
+    {LocationJson::CITY, "city"},
+    {LocationJson::REGION, "region"},
+    {LocationJson::LATITUDE, "latitude"},
+    {LocationJson::LONGITUDE, "longitude"},
+    {LocationJson::POSTAL_CODE, "postal_code"},
+    {LocationJson::TIMEZONE, "timezone"},
+}};
+
+// what LocationJson::append_location writes before the location fields for an empty address
+constexpr std::string_view EMPTY_IP_PREFIX = "{\"ip\":\"\"";
+
+// the `index`th field of a CSV line, unquoted into `scratch` when quoted
+std::optional<std::string_view> csv_field(std::string_view line, size_t index, std::string& scratch) {
+    size_t position = 0;
+    for (size_t field = 0;; ++field) {
+        if (position < line.size() && line[position] == '"') {
+            scratch.clear();
+            size_t i = position + 1;
+            for (; i < line.size(); ++i) {
+                if (line[i] != '"') {
+                    scratch.push_back(line[i]);
+                } else if (i + 1 < line.size() && line[i + 1] == '"') {
+                    scratch.push_back('"');
+                    ++i;
+                } else {
+                    break;
+                }
+            }
+            position = i + 1;
+            if (field == index) {
+                return std::string_view(scratch);
+            }
+        } else {
+            size_t comma = line.find(',', position);
+            if (field == index) {
+                return line.substr(position, comma == std::string_view::npos ? std::string_view::npos : comma - position);
+            }
+            position = comma;
+        }
+        position = line.find(',', position);
+        if (position == std::string_view::npos) {
+            return std::nullopt;
+        }
+        ++position;
+    }
+}
+
+void append_csv_value(std::pmr::string& out, std::string_view value) {
+    if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out += value;
+        return;
+    }
+    out += '"';
+    for (char c : value) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+size_t skip_space(std::string_view text, size_t i) {
+    while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) {
+        ++i;
+    }
+    return i;
+}
+
+// past the string starting at the quote at `i`, or npos when it does not end
+size_t skip_string(std::string_view text, size_t i) {
+    for (++i; i < text.size(); ++i) {
+        if (text[i] == '\\') {
+            ++i;
+        } else if (text[i] == '"') {
+            return i + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// past the value starting at `i`: a string, a nested object or array, or a bare literal
+size_t skip_value(std::string_view text, size_t i) {
+    if (i < text.size() && text[i] == '"') {
+        return skip_string(text, i);
+    }
+    int depth = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (c == '"') {
+            i = skip_string(text, i);
+            if (i == std::string_view::npos) {
+                return i;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            ++depth;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) {
+                return i;
+            }
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            return i;
+        }
+        ++i;
+    }
+    return i;
+}
+
+// the text of a top-level string member of a one-line JSON object; a member with escapes in
+// it is not an address, so it is not unescaped
+std::optional<std::string_view> json_member(std::string_view object, std::string_view name) {
+    size_t i = skip_space(object, 0);
+    if (i >= object.size() || object[i] != '{') {
+        return std::nullopt;
+    }
+    i = skip_space(object, i + 1);
+    while (i < object.size() && object[i] == '"') {
+        size_t key_end = skip_string(object, i);
+        if (key_end == std::string_view::npos) {
+            return std::nullopt;
+        }
+        std::string_view key = object.substr(i + 1, key_end - i - 2);
+        i = skip_space(object, key_end);
+        if (i >= object.size() || object[i] != ':') {
+            return std::nullopt;
+        }
+        i = skip_space(object, i + 1);
+        size_t value_end = skip_value(object, i);
+        if (value_end == std::string_view::npos) {
+            return std::nullopt;
+        }
+        if (key == name) {
+            if (object[i] != '"') {
+                return std::nullopt;
+            }
+            std::string_view value = object.substr(i + 1, value_end - i - 2);
+            return value.find('\\') == std::string_view::npos ? std::optional<std::string_view>(value) : std::nullopt;
+        }
+        i = skip_space(object, value_end);
+        if (i >= object.size() || object[i] != ',') {
+            return std::nullopt;
+        }
+        i = skip_space(object, i + 1);
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+struct BulkEnricher::Batch {
+    std::string input; // whole lines, each ending in '\n'
+    std::pmr::string output;
+    Stats counts;
+    bool done = false;
+};
+
+BulkEnricher::BulkEnricher(std::shared_ptr<const LocationDataset> dataset, Options options)
+    : m_dataset(std::move(dataset)), m_options(std::move(options)) {}
+
+std::optional<BulkEnricher::Format> BulkEnricher::parse_format(std::string_view name) {
+    if (name == "csv") {
+        return Format::CSV;
+    } else if (name == "ndjson") {
+        return Format::NDJSON;
+    }
+    return std::nullopt;
+}
+
+void BulkEnricher::render(std::pmr::string& out, RecordId id) const {
+    if (m_options.format == Format::NDJSON) {
+        if (id == NO_RECORD) {
+            out += "null";
+            return;
+        }
+        std::pmr::string body;
+        LocationJson::append_location(body, "", LocationRecordView(m_dataset->record(id)), m_options.fields);
+        out += std::string_view(body).substr(EMPTY_IP_PREFIX.size());
+        return;
+    }
+
+    std::optional<LocationRecord> record;
+    if (id != NO_RECORD) {
+        record = m_dataset->record(id);
+    }
+    for (const auto& column : FIELD_COLUMNS) {
+        if ((m_options.fields & column.mask) == 0) {
+            continue;
+        }
+        out += ',';
+        if (!record) {
+            continue;
+        }
+        auto text = [&](const std::optional<std::string>& value) {
+            if (value) append_csv_value(out, *value);
+        };
+        auto coordinate = [&](const std::optional<float>& value) {
+            if (value) LocationJson::append_coordinate(out, *value);
+        };
+        switch (column.mask) {
+            case LocationJson::COUNTRY: text(record->country); break;
+            case LocationJson::CITY: text(record->city); break;
+            case LocationJson::REGION: text(record->region); break;
+            case LocationJson::LATITUDE: coordinate(record->latitude); break;
+            case LocationJson::LONGITUDE: coordinate(record->longitude); break;
+            case LocationJson::POSTAL_CODE: text(record->postal_code); break;
+            case LocationJson::TIMEZONE: text(record->timezone); break;
+        }
+    }
+}
+
+void BulkEnricher::enrich(Batch& batch, size_t column) const {
+    std::optional<LocationDataset::Ipv4Cursor> cursor;
+    if (m_options.sorted) {
+        cursor.emplace(*m_dataset);
+    }
+    std::string scratch;
+    // consecutive lines in one range, the common case for sorted input, are rendered once
+    RecordId rendered_id = NO_RECORD;
+    std::pmr::string rendered;
+    render(rendered, NO_RECORD);
+    const std::pmr::string not_found = rendered;
+
+    batch.output.reserve(batch.input.size() * 2);
+    std::string_view input = batch.input;
+    while (!input.empty()) {
+        size_t newline = input.find('\n');
+        std::string_view line = input.substr(0, newline);
+        input.remove_prefix(newline + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        ++batch.counts.lines;
+
+        std::optional<std::string_view> text = m_options.format == Format::CSV
+            ? csv_field(line, column, scratch)
+            : json_member(line, m_options.column);
+        std::optional<IpAddress> address = text ? IpAddress::parse(*text) : std::nullopt;
+
+        RecordId id = NO_RECORD;
+        if (!address) {
+            ++batch.counts.invalid;
+        } else {
+            IpAddress key = address->unmapped();
+            id = cursor && key.is_v4() ? cursor->find(key.v4()) : m_dataset->find_id(key);
+            ++(id == NO_RECORD ? batch.counts.not_found : batch.counts.found);
+        }
+        if (id != NO_RECORD && id != rendered_id) {
+            rendered.clear();
+            render(rendered, id);
+            rendered_id = id;
+        }
+        const std::pmr::string& suffix = id == NO_RECORD ? not_found : rendered;
+
+        if (m_options.format == Format::CSV) {
+            batch.output += line;
+            batch.output += suffix;
+        } else {
+            // only an object can gain a member; anything else is passed through
+            size_t close = line.find_last_not_of(" \t");
+            if (close == std::string_view::npos || line[close] != '}') {
+                batch.output += line;
+            } else {
+                size_t last = line.find_last_not_of(" \t", close - 1);
+                bool empty = last == std::string_view::npos || line[last] == '{';
+                batch.output += line.substr(0, close);
+                batch.output += empty ? "\"location\":" : ",\"location\":";
+                if (id == NO_RECORD) {
+                    batch.output += suffix;
+                } else {
+                    batch.output += "{\"ip\":\"";
+                    batch.output += *text;
+                    batch.output += '"';
+                    batch.output += suffix;
+                }
+                batch.output += '}';
+            }
+        }
+        batch.output += '\n';
+    }
+}
+
+void BulkEnricher::write_csv_header(std::ostream& out, std::string_view header) const {
+    out << header;
+    for (const auto& column : FIELD_COLUMNS) {
+        if ((m_options.fields & column.mask) != 0) {
+            out << ',' << column.name;
+        }
+    }
+    out << '\n';
+}
+
+BulkEnricher::Stats BulkEnricher::run(std::istream& in, std::ostream& out) {
+    auto start = Clock::now();
+    Stats totals;
+    std::string line;
+
+    size_t column = 0;
+    if (m_options.format == Format::CSV) {
+        if (!std::getline(in, line)) {
+            return totals;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::string scratch;
+        for (column = 0;; ++column) {
+            auto name = csv_field(line, column, scratch);
+            if (!name) {
+                throw std::invalid_argument("No column named " + m_options.column + " in the CSV header");
+            }
+            if (*name == m_options.column) {
+                break;
+            }
+        }
+        write_csv_header(out, line);
+    }
+
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    std::deque<std::shared_ptr<Batch>> pending;
+    auto last_progress = start;
+
+    auto write_front = [&](bool wait) {
+        std::shared_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (wait) {
+                done_cv.wait(lock, [&] { return pending.front()->done; });
+            } else if (!pending.front()->done) {
+                return false;
+            }
+            batch = std::move(pending.front());
+            pending.pop_front();
+        }
+        out.write(batch->output.data(), static_cast<std::streamsize>(batch->output.size()));
+        if (!out) {
+            throw std::runtime_error("Cannot write the enriched output");
+        }
+        totals.lines += batch->counts.lines;
+        totals.found += batch->counts.found;
+        totals.not_found += batch->counts.not_found;
+        totals.invalid += batch->counts.invalid;
+        return true;
+    };
+
+    // declared last, so its destructor finishes the tasks before what they use goes away
+    WorkStealingPool pool(m_options.threads);
+    size_t batch_lines = std::max<size_t>(m_options.batch_lines, 1);
+    size_t max_batches = std::max<size_t>(m_options.max_batches, 1);
+    bool more = true;
+    while (more) {
+        auto batch = std::make_shared<Batch>();
+        for (size_t i = 0; i < batch_lines && (more = static_cast<bool>(std::getline(in, line))); ++i) {
+            batch->input += line;
+            batch->input += '\n';
+        }
+        if (batch->input.empty()) {
+            break;
+        }
+
+        while (pending.size() >= max_batches) {
+            write_front(true);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(batch);
+        }
+        pool.submit([this, batch, column, &mutex, &done_cv]() {
+            enrich(*batch, column);
+            std::lock_guard<std::mutex> lock(mutex);
+            batch->done = true;
+            done_cv.notify_all();
+        });
+        while (!pending.empty() && write_front(false)) {
+        }
+
+        auto now = Clock::now();
+        if (m_options.on_progress && m_options.progress_interval.count() > 0
+            && now - last_progress >= m_options.progress_interval) {
+            last_progress = now;
+            totals.seconds = std::chrono::duration<double>(now - start).count();
+            m_options.on_progress(totals);
+        }
+    }
+    while (!pending.empty()) {
+        write_front(true);
+    }
+    out.flush();
+
+    totals.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return totals;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "../handlers/location_json.h"
+#include "../lookup/location_dataset.h"
+
+// Adds the location of an address in each line of a CSV or NDJSON stream, for offline jobs
+// that would otherwise go through /ip-location one request at a time.
+//
+// The calling thread reads the input in batches of `batch_lines` lines and hands them to a
+// WorkStealingPool. Each batch is enriched into its own buffer, and the calling thread writes
+// the buffers out in input order. At most `max_batches` batches are read ahead of the one being
+// written, so memory stays bounded however large the input is.
+//
+// CSV: the first line is a header naming the address column, and each record is one line
+// (quoted fields may hold commas but not line breaks). The requested location fields are
+// appended as columns, empty when the address is not found. NDJSON: each line is an object
+// with the address in a top-level string member. The object gains a "location" member holding
+// the /ip-location body, or null.
+//
+// With `sorted`, the addresses are expected in ascending order and each batch is merged with
+// the IPv4 ranges (LocationDataset::Ipv4Cursor) instead of searched line by line; out-of-order
+// stretches still get right answers, only slower. In both modes a line in the same range as
+// the line before reuses its rendering.
+class BulkEnricher {
+public:
+    enum class Format { CSV, NDJSON };
+
+    struct Stats {
+        uint64_t lines = 0;
+        uint64_t found = 0;
+        uint64_t not_found = 0;
+        // no address in the line, or not one that parses
+        uint64_t invalid = 0;
+        double seconds = 0;
+
+        double lines_per_second() const { return seconds > 0 ? static_cast<double>(lines) / seconds : 0; }
+    };
+
+    struct Options {
+        Format format = Format::CSV;
+        // the CSV header's name for the address column, or the NDJSON member
+        std::string column = "ip";
+        LocationJson::FieldMask fields = LocationJson::ALL_FIELDS;
+        bool sorted = false;
+        size_t threads = 4;
+        size_t batch_lines = 4096;
+        size_t max_batches = 64;
+        // called on the calling thread, at most once per interval, with the totals so far
+        std::chrono::milliseconds progress_interval{0};
+        std::function<void(const Stats&)> on_progress;
+    };
+
+    BulkEnricher(std::shared_ptr<const LocationDataset> dataset, Options options);
+
+    // throws std::invalid_argument when the CSV header has no such column and
+    // std::runtime_error when the output cannot be written
+    Stats run(std::istream& in, std::ostream& out);
+
+    // "csv" or "ndjson"
+    static std::optional<Format> parse_format(std::string_view name);
+
+private:
+    struct Batch;
+
+    void enrich(Batch& batch, size_t column) const;
+    // the rendering appended for a record, or for none when `id` is NO_RECORD
+    void render(std::pmr::string& out, RecordId id) const;
+    void write_csv_header(std::ostream& out, std::string_view header) const;
+
+    const std::shared_ptr<const LocationDataset> m_dataset;
+    const Options m_options;
+};
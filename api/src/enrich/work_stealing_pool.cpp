@@ -0,0 +1,76 @@
+#include "work_stealing_pool.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&WorkStealingPool::run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    // counted before it is pushed, so a thread that takes it never sees the count at zero
+    m_queued.fetch_add(1);
+    Worker& worker = *m_workers[m_next.fetch_add(1, std::memory_order_relaxed) % m_workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    // pairs with run(): a thread going to sleep registers before it checks m_queued, and both
+    // sides use sequentially consistent operations, so either it sees this task or it is seen
+    // here and woken
+    if (m_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cv.notify_one();
+    }
+}
+
+bool WorkStealingPool::take(size_t index, std::function<void()>& task) {
+    for (size_t offset = 0; offset < m_workers.size(); ++offset) {
+        Worker& worker = *m_workers[(index + offset) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            if (offset > 0) {
+                m_steals.fetch_add(1, std::memory_order_relaxed);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(size_t index) {
+    std::function<void()> task;
+    while (true) {
+        if (take(index, task)) {
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping.fetch_add(1);
+        // a task counted in m_queued but not yet pushed is picked up on the next pass
+        m_cv.wait(lock, [this] { return m_queued.load() > 0 || m_stop; });
+        m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+        if (m_queued.load() == 0 && m_stop) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads, each with its own deque of tasks. Submitted tasks are dealt out
+// round-robin; a thread whose deque runs dry steals from the others, so uneven tasks (a batch
+// of long lines, a batch that misses every cache) even out without one queue that every
+// thread contends on. Each deque is taken oldest first, by its owner and by thieves alike,
+// because callers like BulkEnricher write results in submission order.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threads);
+    // runs the tasks still queued, then joins the threads
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    size_t thread_count() const { return m_threads.size(); }
+    // tasks run by a thread other than the one they were dealt to
+    uint64_t steal_count() const { return m_steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t index);
+    // from the thread's own deque, else from the next non-empty one after it
+    bool take(size_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_next{0};
+    std::atomic<uint64_t> m_steals{0};
+
+    // tasks queued across all deques and threads asleep waiting for one; submitting and
+    // taking only touch the counters, and m_mutex is locked just to sleep or to wake a sleeper
+    std::atomic<size_t> m_queued{0};
+    std::atomic<size_t> m_sleeping{0};
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+};
@@ -1,25 +1,380 @@
 #include "api_handlers.h"
-#include "../utils/ip_validator.h"
+#include "../async/redis_awaitable.h"
+#include "../database/dataset_loader.h"
+#include "location_json.h"
+#include "../utils/ip_address.h"
 #include "../utils/logger.h"
+#include "../utils/reserved_ranges.h"
+#include <algorithm>
+#include <charconv>
 #include <chrono>
+#include <stdexcept>
 #include <sw/redis++/redis++.h>
+#include <unistd.h>
 
-ApiHandlers::ApiHandlers(std::unique_ptr<DatabasePool> db_pool) 
-    : m_db_pool(std::move(db_pool)) {
-    m_rate_limiter = std::make_unique<RateLimiter>(100, 60); // 100 requests per minute
+namespace {
+
+std::chrono::microseconds elapsed_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+// index into m_numa_nodes of the node this worker thread was pinned to, -1 until its first lookup
+thread_local int t_worker_node = -1;
+
+// a dataset generation as a request names it; generations start at 1
+std::optional<uint64_t> parse_generation(std::string_view text) {
+    uint64_t generation = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), generation);
+    if (error != std::errc() || end != text.data() + text.size() || generation == 0) {
+        return std::nullopt;
+    }
+    return generation;
+}
+
+// Copies a finished response into the one Crow handed to the route and sends it. Crow's
+// response assignment does not carry over the completion handler, so fields are moved one by one.
+void complete_response(crow::response& res, crow::response&& response) {
+    res.code = response.code;
+    res.body = std::move(response.body);
+    res.headers = std::move(response.headers);
+    res.end();
+}
+
+// the response takes the body over, so a body rendered into a std::string is not copied
+crow::response json_response(int code, std::string body) {
+    crow::response response(code, std::move(body));
+    response.set_header("Content-Type", "application/json");
+    return response;
+}
+
+// no pooled database connection could be had for a query
+class ConnectionUnavailable : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// a JSON cache entry holds every field; read back when a projection is asked for
+std::optional<LocationRecord> record_from_json(const std::string& body) {
+    auto json = crow::json::load(body);
+    if (!json || json.t() != crow::json::type::Object) {
+        return std::nullopt;
+    }
+
+    LocationRecord record;
+    auto text = [&](const char* name) -> std::optional<std::string> {
+        if (!json.has(name) || json[name].t() != crow::json::type::String) {
+            return std::nullopt;
+        }
+        return std::string(json[name].s());
+    };
+    auto number = [&](const char* name) -> std::optional<float> {
+        if (!json.has(name) || json[name].t() != crow::json::type::Number) {
+            return std::nullopt;
+        }
+        return static_cast<float>(json[name].d());
+    };
+    record.country = text("country");
+    record.city = text("city");
+    record.region = text("region");
+    record.latitude = number("latitude");
+    record.longitude = number("longitude");
+    record.postal_code = text("postal_code");
+    record.timezone = text("timezone");
+    return record;
+}
+
+std::optional<LocationRecord> record_from_result(const PgResult& result) {
+    if (result.rows() == 0) {
+        return std::nullopt;
+    }
+
+    LocationRecord record;
+    auto text = [&](const char* name) -> std::optional<std::string> {
+        int column = result.column(name);
+        if (result.is_null(0, column)) {
+            return std::nullopt;
+        }
+        return result.value(0, column);
+    };
+    record.country = text("country");
+    record.city = text("city");
+    record.region = text("region");
+    if (auto latitude = text("latitude")) {
+        record.latitude = std::stof(*latitude);
+    }
+    if (auto longitude = text("longitude")) {
+        record.longitude = std::stof(*longitude);
+    }
+    record.postal_code = text("postal_code");
+    record.timezone = text("timezone");
+    return record;
+}
+
+} // namespace
+
+ApiHandlers::ApiHandlers(std::unique_ptr<DatabasePool> db_pool, const ServiceConfig& config,
+                         std::shared_ptr<const LocationDataset> shared_dataset,
+                         std::shared_ptr<const DatasetHistory> shared_history)
+    : m_db_pool(std::move(db_pool)),
+      m_cache_ttl_seconds(config.m_cache_ttl_seconds),
+      m_not_found_ttl_seconds(config.m_cache_not_found_ttl_seconds),
+      m_binary_rate_limit(config.m_binary_rate_limit),
+      m_retry_after_seconds(std::max(1, config.m_retry_after_seconds)) {
+    m_rate_limiter = std::make_unique<RateLimiter>(config.m_rate_limit_requests, config.m_rate_limit_window_seconds,
+                                                   static_cast<size_t>(std::max(1, config.m_rate_limit_max_clients)));
+    std::vector<IpPrefix> trusted_proxies;
+    try {
+        trusted_proxies = ClientAddressResolver::parse_prefixes(config.m_trusted_proxies);
+    } catch (const std::invalid_argument& e) {
+        Logger::Logger::get_logger()->warning("{}, no proxy is trusted", e.what());
+    }
+    m_client_resolver = std::make_unique<ClientAddressResolver>(
+        std::move(trusted_proxies), config.m_rate_limit_ipv4_prefix, config.m_rate_limit_ipv6_prefix);
     
+    m_redis_breaker = std::make_unique<CircuitBreaker>(
+        config.m_redis_breaker_failures,
+        std::chrono::milliseconds(config.m_redis_breaker_open_ms),
+        std::chrono::milliseconds(config.m_redis_op_budget_ms));
+
     try {
-        std::string redis_url = std::getenv("REDIS_URL") ? std::getenv("REDIS_URL") : "redis://redis:6379";
-        m_redis_client = std::make_unique<sw::redis::Redis>(redis_url);
-        
-        m_redis_client->ping();
-        auto logger = Logger::Logger::get_logger();
-        logger->info("Redis connection established successfully");
+        m_server_timing = RequestTiming::parse_header_mode(config.m_server_timing);
+    } catch (const std::invalid_argument& e) {
+        Logger::Logger::get_logger()->warning("{}, Server-Timing sent on request", e.what());
+    }
+    if (config.m_trace_sample_every > 0) {
+        m_trace_sample_every = static_cast<uint32_t>(config.m_trace_sample_every);
+        m_trace_ring = std::make_unique<TraceRing>(static_cast<size_t>(std::max(1, config.m_trace_ring_size)));
+    }
+
+    if (!config.m_capture_file.empty()) {
+        // one file per worker in prefork mode; replay_traffic merges them
+        std::string path = config.m_capture_file;
+        if (config.m_worker_processes > 1) {
+            path += "." + std::to_string(getpid());
+        }
+        try {
+            m_traffic_capture = std::make_unique<TrafficCapture>(
+                path, static_cast<size_t>(std::max(1, config.m_capture_buffer_size)));
+            m_capture_sample_every = static_cast<uint32_t>(std::max(1, config.m_capture_sample_every));
+            Logger::Logger::get_logger()->info("Capturing 1 in {} lookups to {}", m_capture_sample_every, path);
+        } catch (const std::runtime_error& e) {
+            Logger::Logger::get_logger()->warning("{}, traffic capture disabled", e.what());
+        }
+    }
+
+    if (config.m_heavy_hitters_top_k > 0) {
+        size_t top_k = static_cast<size_t>(config.m_heavy_hitters_top_k);
+        size_t width = static_cast<size_t>(std::max(1, config.m_heavy_hitters_width));
+        m_hot_addresses = std::make_unique<HeavyHitters>(top_k, width);
+        m_hot_clients = std::make_unique<HeavyHitters>(top_k, width);
+    }
+
+    if (config.m_admission_control) {
+        AdmissionController::Options cache_options;
+        cache_options.initial_limit = config.m_cache_concurrency_limit;
+        cache_options.max_limit = config.m_cache_concurrency_max;
+        m_cache_admission = std::make_unique<AdmissionController>(cache_options);
+
+        AdmissionController::Options db_options;
+        db_options.initial_limit = config.m_db_concurrency_limit;
+        db_options.max_limit = config.m_db_concurrency_max;
+        // index lookups vary more than Redis reads; small plan or I/O hiccups are not queueing
+        db_options.latency_slack = std::chrono::milliseconds(5);
+        m_db_admission = std::make_unique<AdmissionController>(db_options);
+    }
+
+    auto logger = Logger::Logger::get_logger();
+    try {
+        std::string redis_url = !config.m_redis_url.empty() ? config.m_redis_url
+            : std::getenv("REDIS_URL") ? std::getenv("REDIS_URL") : "redis://redis:6379";
+
+        // the socket timeout enforces the latency budget; connections are opened lazily and
+        // re-established by the client, so an unreachable Redis at boot is not fatal
+        sw::redis::ConnectionOptions connection_options(redis_url);
+        connection_options.connect_timeout = std::chrono::milliseconds(config.m_redis_connect_timeout_ms);
+        connection_options.socket_timeout = std::chrono::milliseconds(config.m_redis_op_budget_ms);
+
+        sw::redis::ConnectionPoolOptions pool_options;
+        pool_options.size = static_cast<std::size_t>(config.m_redis_pool_size);
+        pool_options.wait_timeout = std::chrono::milliseconds(config.m_redis_op_budget_ms);
+
+        m_redis_client = std::make_unique<sw::redis::Redis>(connection_options, pool_options);
+        if (config.m_request_pipeline == "async") {
+            m_async_redis = std::make_unique<sw::redis::AsyncRedis>(connection_options, pool_options);
+        }
     } catch (const std::exception& e) {
-        auto logger = Logger::Logger::get_logger();
-        logger->error("Failed to connect to Redis: {}", e.what());
+        logger->error("Invalid Redis configuration: {}", e.what());
         m_redis_client = nullptr;
+        m_async_redis = nullptr;
+    }
+
+    if (!m_redis_client) {
+        m_readiness.settle(Readiness::Component::CACHE, Readiness::State::OFF);
+    }
+
+    if (config.m_ipv4_index != "off") {
+        try {
+            m_ipv4_index = LocationDataset::parse_ipv4_index(config.m_ipv4_index);
+            m_in_memory_enabled = true;
+        } catch (const std::invalid_argument& e) {
+            logger->warning("{}, in-memory lookups disabled", e.what());
+        }
+    }
+    if (m_in_memory_enabled) {
+        try {
+            m_huge_pages = MemoryPlacementPolicy::parse_huge_page_mode(config.m_huge_pages);
+        } catch (const std::invalid_argument& e) {
+            logger->warning("{}, huge pages disabled", e.what());
+        }
+        m_generations_kept = static_cast<size_t>(std::max(1, config.m_dataset_generations));
+        m_ranges_max_limit = static_cast<size_t>(std::max(1, config.m_ranges_max_limit));
+        if (shared_dataset) {
+            m_shared_dataset = true;
+            auto datasets = std::make_shared<LoadedDatasets>();
+            datasets->replicas.push_back(std::move(shared_dataset));
+            datasets->history = shared_history ? std::move(shared_history) : std::make_shared<const DatasetHistory>(0);
+            datasets->serving = datasets->newest();
+            m_datasets.store(std::move(datasets), std::memory_order_release);
+            m_readiness.settle(Readiness::Component::DATASET, Readiness::State::READY);
+        } else if (config.m_numa_replicas) {
+            m_numa_nodes = NumaTopology::detect();
+            if (m_numa_nodes.size() < 2) {
+                logger->info("NUMA replicas requested but {} node(s) found, keeping a single copy", m_numa_nodes.size());
+                m_numa_nodes.clear();
+            }
+        }
+    } else {
+        m_readiness.settle(Readiness::Component::DATASET, Readiness::State::OFF);
+    }
+
+    if (config.m_request_pipeline != "async" && config.m_request_pipeline != "blocking") {
+        logger->warning("Invalid request pipeline: {}, using the blocking request pipeline", config.m_request_pipeline);
+    }
+
+    try {
+        m_ttl_policy = CacheTtlPolicy::from_schedule(config.m_data_update_time_utc, config.m_cache_ttl_jitter_seconds);
+    } catch (const std::invalid_argument& e) {
+        auto logger = Logger::Logger::get_logger();
+        logger->warning("{}, using the default update schedule", e.what());
+    }
+
+    m_http_cache = HttpCachePolicy(config.m_http_max_age_seconds, config.m_http_not_found_max_age_seconds);
+
+    try {
+        m_cache_format = CacheCodec::parse_format(config.m_cache_value_format);
+    } catch (const std::invalid_argument& e) {
+        auto logger = Logger::Logger::get_logger();
+        logger->warning("{}, falling back to json", e.what());
+    }
+
+    if (m_redis_client) {
+        m_cache_writer = std::make_unique<CacheWriter>(
+            [this](const std::vector<CacheWrite>& batch) { flush_cache_writes(batch); },
+            static_cast<size_t>(config.m_cache_write_queue_size),
+            static_cast<size_t>(config.m_cache_write_batch_size),
+            std::chrono::milliseconds(config.m_cache_write_flush_ms));
+    }
+
+    // connections, the Redis check and the dataset load happen in the background so the
+    // listener can start at once; lookups get 503 until everything has settled
+    m_startup = std::thread(&ApiHandlers::start_up, this, config);
+}
+
+void ApiHandlers::start_up(ServiceConfig config) {
+    auto logger = Logger::Logger::get_logger();
+
+    // the pool's connections are opened concurrently while Redis is checked
+    m_db_pool->start_connecting();
+
+    if (m_redis_client) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.m_redis_startup_wait_ms);
+        bool cache_ready = redis_ping();
+        while (!cache_ready && std::chrono::steady_clock::now() < deadline && wait_during_startup(STARTUP_RETRY_INTERVAL)) {
+            cache_ready = redis_ping();
+        }
+        if (cache_ready) {
+            logger->info("Redis connection established successfully");
+            settle(Readiness::Component::CACHE, Readiness::State::READY);
+        } else {
+            logger->error("Failed to connect to Redis, caching is bypassed until it recovers");
+            m_redis_breaker->trip();
+            settle(Readiness::Component::CACHE, Readiness::State::BYPASSED);
+        }
+    }
+
+    size_t min_connections = static_cast<size_t>(std::clamp(config.m_db_pool_min_ready, 1, std::max(1, config.m_db_pool_size)));
+    while (m_db_pool->wait_for_connections(min_connections) < min_connections) {
+        if (m_stopping.load()) {
+            return;
+        }
+        logger->error("Database pool has fewer than {} connections, retrying", min_connections);
+        m_db_pool->start_connecting();
+    }
+    if (m_stopping.load()) {
+        return;
+    }
+
+    m_dataset_generation = std::make_unique<DatasetGeneration>(
+        *m_db_pool, std::chrono::seconds(config.m_generation_poll_seconds));
+
+    if (config.m_request_pipeline == "async") {
+        try {
+            m_reactor = std::make_unique<Reactor>(static_cast<size_t>(config.m_async_threads));
+            m_async_db_pool = std::make_unique<AsyncDatabasePool>(
+                *m_reactor, config.m_database_url, config.m_async_db_connections,
+                std::vector<std::pair<std::string, std::string>>{
+                    {DatabasePool::PREPARED_IP_LOOKUP_NAME, DatabasePool::PREPARED_IP_LOOKUP_QUERY}},
+                std::chrono::milliseconds(config.m_db_statement_timeout_ms));
+        } catch (const std::exception& e) {
+            logger->warning("{}, using the blocking request pipeline", e.what());
+            m_async_redis.reset();
+            m_async_db_pool.reset();
+            m_reactor.reset();
+        }
+    }
+    settle(Readiness::Component::DATABASE, Readiness::State::READY);
+
+    if (m_in_memory_enabled && !m_shared_dataset) {
+        reload_dataset();
+        m_dataset_generation->set_listener([this](uint64_t) { reload_dataset(); });
+        // without the dataset lookups still go to Redis and Postgres
+        settle(Readiness::Component::DATASET, m_datasets.load(std::memory_order_acquire)
+            ? Readiness::State::READY : Readiness::State::BYPASSED);
+    }
+}
+
+void ApiHandlers::settle(Readiness::Component component, Readiness::State state) {
+    if (m_readiness.settle(component, state)) {
+        Logger::Logger::get_logger()->info("Ready in {} ms (database {} ms, cache {} ms, dataset {} ms)",
+            m_readiness.time_to_ready()->count(),
+            m_readiness.settled_after(Readiness::Component::DATABASE)->count(),
+            m_readiness.settled_after(Readiness::Component::CACHE)->count(),
+            m_readiness.settled_after(Readiness::Component::DATASET)->count());
+    }
+}
+
+bool ApiHandlers::wait_during_startup(std::chrono::milliseconds interval) {
+    std::unique_lock<std::mutex> lock(m_startup_mutex);
+    return !m_startup_cv.wait_for(lock, interval, [this]() { return m_stopping.load(); });
+}
+
+ApiHandlers::~ApiHandlers() {
+    // the startup thread fills in what follows; stop its retries and let it finish first
+    {
+        std::lock_guard<std::mutex> lock(m_startup_mutex);
+        m_stopping = true;
     }
+    m_startup_cv.notify_all();
+    m_db_pool->stop_connecting();
+    if (m_startup.joinable()) {
+        m_startup.join();
+    }
+    // the generation poller calls back into reload_dataset, so stop it before anything else goes away
+    m_dataset_generation.reset();
+    // Redis replies are posted to the reactor; stop both before the pool their lookups use
+    m_async_redis.reset();
+    m_reactor.reset();
+    m_async_db_pool.reset();
 }
 
 crow::response ApiHandlers::handle_health_check() {
@@ -27,22 +382,14 @@ crow::response ApiHandlers::handle_health_check() {
     health["status"] = "healthy";
     health["timestamp"] = std::time(nullptr);
     
-    //database
-    bool db_healthy = m_db_pool && m_db_pool->health_check();
+    //database; until the pool has connected, a check would wait out the connection retries
+    bool db_healthy = m_db_pool && (m_readiness.ready() ? m_db_pool->health_check() : m_db_pool->is_pool_healthy());
     health["database"]["status"] = db_healthy ? "healthy" : "unhealthy";
     
     //redis
-    bool redis_healthy = false;
-    if (m_redis_client) {
-        try {
-            m_redis_client->ping();
-            redis_healthy = true;
-        } catch (const std::exception& e) {
-            auto logger = Logger::Logger::get_logger();
-            logger->warning("Redis health check failed: {}", e.what());
-        }
-    }
+    bool redis_healthy = redis_ping();
     health["cache"]["status"] = redis_healthy ? "healthy" : "unhealthy";
+    health["cache"]["circuit"] = CircuitBreaker::state_to_string(m_redis_breaker->state());
     
     if (db_healthy && redis_healthy) {
         return crow::response(200, health);
@@ -56,116 +403,666 @@ crow::response ApiHandlers::handle_health_check() {
     }
 }
 
+crow::response ApiHandlers::handle_liveness() {
+    return crow::response(200, "{\"status\":\"alive\"}");
+}
+
+crow::response ApiHandlers::handle_readiness() {
+    crow::json::wvalue readiness;
+    bool ready = m_readiness.ready();
+    readiness["status"] = ready ? "ready" : "starting";
+    for (size_t i = 0; i < Readiness::COMPONENT_COUNT; ++i) {
+        auto component = static_cast<Readiness::Component>(i);
+        readiness["components"][Readiness::component_to_string(component)] =
+            Readiness::state_to_string(m_readiness.state(component));
+    }
+    if (auto time_to_ready = m_readiness.time_to_ready()) {
+        readiness["time_to_ready_ms"] = time_to_ready->count();
+    }
+    return crow::response(ready ? 200 : 503, readiness);
+}
+
 crow::response ApiHandlers::handle_root() {
     return crow::response(200, "{\"message\":\"IP Location Service API\",\"version\":\"1.0\"}");
 }
 
-crow::response ApiHandlers::handle_ip_location(const crow::request& req) {
-    auto logger = Logger::Logger::get_logger();
-    
-    std::string client_ip = get_client_ip(req);
-    if (!m_rate_limiter->is_allowed(client_ip)) {
+std::variant<crow::response, ApiHandlers::LocationLookup> ApiHandlers::prepare_lookup(const crow::request& req,
+                                                                                     RequestTiming& timing) {
+    bool allowed;
+    {
+        auto span = timing.span(RequestTiming::Stage::RATE_LIMIT);
+        ClientKey client = client_key(req);
+        // counted before the limit so clients that keep hitting it show up
+        if (m_hot_clients) {
+            m_hot_clients->add(client.view());
+        }
+        allowed = m_rate_limiter->is_allowed(client.view());
+    }
+    if (!allowed) {
         return crow::response(429, create_error_response("Rate limit exceeded", "RATE_LIMIT_EXCEEDED"));
     }
 
+    auto validate_span = std::make_optional<RequestTiming::Span>(timing, RequestTiming::Stage::VALIDATE);
     const char* ip_raw = req.url_params.get("ip");
-    std::string ip_str = ip_raw ? ip_raw : "";
+    std::string_view ip_str = ip_raw ? ip_raw : "";
     if (ip_str.empty()) {
         return crow::response(400, create_error_response("IP address parameter 'ip' is missing", "MISSING_PARAMETER"));
     }
 
-    if (!IpValidator::is_valid_ip(ip_str)) {
+    auto address = IpAddress::parse(ip_str);
+    if (!address) {
         return crow::response(400, create_error_response("Invalid IP address format", "INVALID_IP_FORMAT"));
     }
+    LocationJson::FieldMask fields = LocationJson::ALL_FIELDS;
+    if (const char* fields_raw = req.url_params.get("fields")) {
+        auto parsed = LocationJson::parse_fields(fields_raw);
+        if (!parsed) {
+            return crow::response(400, create_error_response(
+                "Unknown field in 'fields', expected a list of ip, country, city, region, latitude, longitude, "
+                "postal_code and timezone", "INVALID_FIELDS"));
+        }
+        fields = *parsed;
+    }
+    // 0: the generation being served
+    uint64_t requested_generation = 0;
+    if (const char* generation_raw = req.url_params.get("generation")) {
+        auto parsed = parse_generation(generation_raw);
+        if (!parsed) {
+            return crow::response(400, create_error_response("Invalid dataset generation", "INVALID_GENERATION"));
+        }
+        requested_generation = *parsed;
+    }
+    timing.set_ip(ip_str);
+    if (m_hot_addresses) {
+        m_hot_addresses->add(ip_str);
+    }
+    if (m_traffic_capture) {
+        thread_local uint32_t t_capture_countdown = 0;
+        if (t_capture_countdown == 0) {
+            m_traffic_capture->record(*address, fields);
+            t_capture_countdown = m_capture_sample_every;
+        }
+        --t_capture_countdown;
+    }
 
-    try {
-        // try to get from cache first
-        std::string cached_result = get_from_cache(ip_str);
-        if (!cached_result.empty()) {
-            logger->debug("Cache hit for IP: {}", ip_str);
-            return crow::response(200, cached_result);
+    // private, loopback, documentation etc. never have a location; answer without touching Redis or Postgres
+    if (const char* reserved_range = ReservedRanges::find(*address)) {
+        m_reserved_ip_requests.fetch_add(1, std::memory_order_relaxed);
+        auto response_json = create_error_response("IP address is in a reserved range", "IP_RESERVED");
+        response_json["ip"] = std::string(ip_str);
+        response_json["range"] = reserved_range;
+        crow::response response(404, response_json);
+        if (m_http_cache.enabled()) {
+            response.set_header("Cache-Control", HttpCachePolicy::reserved_cache_control());
         }
+        return response;
+    }
+    validate_span.reset();
 
-        logger->debug("Cache miss for IP: {}", ip_str);
+    if (!m_readiness.ready()) {
+        return not_ready_response();
+    }
 
-        auto conn = m_db_pool->get_connection();
-        if (!conn) {
-            logger->error("Database connection unavailable for IP: {}", ip_str);
-            return crow::response(500, create_error_response("Database connection unavailable", "DB_CONNECTION_ERROR"));
+    // read once, so the tag a response carries is never newer than its body
+    uint64_t generation = m_dataset_generation->current();
+    // the in-memory datasets answer when they hold the generation asked for, or the one being
+    // served; otherwise Redis and Postgres answer for the current one
+    auto datasets = m_datasets.load(std::memory_order_acquire);
+    if (datasets) {
+        uint64_t wanted = requested_generation ? requested_generation : datasets->serving;
+        if (datasets->history->contains(wanted)) {
+            generation = wanted;
+        } else {
+            datasets.reset();
         }
+    }
+    if (requested_generation && !datasets && requested_generation != generation) {
+        auto response_json = create_error_response("Dataset generation is not kept in memory", "GENERATION_NOT_AVAILABLE");
+        response_json["generation"] = requested_generation;
+        return crow::response(404, response_json);
+    }
 
-        pqxx::work W(*conn);
-        pqxx::result R = W.exec_prepared(DatabasePool::PREPARED_IP_LOOKUP_NAME, ip_str);
-        W.commit();
+    if (m_http_cache.enabled()) {
+        std::string if_none_match = req.get_header_value("If-None-Match");
+        if (!if_none_match.empty() && HttpCachePolicy::matches(if_none_match, generation)) {
+            m_not_modified_responses.fetch_add(1, std::memory_order_relaxed);
+            return not_modified_response(generation);
+        }
+    }
 
-        m_db_pool->return_connection(std::move(conn));
+    if (datasets) {
+        auto span = timing.span(RequestTiming::Stage::MEMORY);
+        m_in_memory_lookups.fetch_add(1, std::memory_order_relaxed);
+        auto record = find_in_memory(*datasets, generation, *address);
+        crow::response response = record ? location_response(ip_str, LocationRecordView(*record), fields)
+                                         : not_found_response();
+        set_cache_headers(response, generation);
+        return response;
+    }
 
-        if (!R.empty()) {
-            crow::json::wvalue response_json;
-            response_json["ip"] = ip_str;
+    return LocationLookup{ip_str, *address, generation, fields};
+}
 
-            if (!R[0]["country"].is_null()) {
-                response_json["country"] = R[0]["country"].as<std::string>();
-            }
-            if (!R[0]["city"].is_null()) {
-                response_json["city"] = R[0]["city"].as<std::string>();
-            }
-            if (!R[0]["region"].is_null()) {
-                response_json["region"] = R[0]["region"].as<std::string>();
-            }
-            if (!R[0]["latitude"].is_null()) {
-                response_json["latitude"] = R[0]["latitude"].as<double>();
-            }
-            if (!R[0]["longitude"].is_null()) {
-                response_json["longitude"] = R[0]["longitude"].as<double>();
-            }
-            if (!R[0]["postal_code"].is_null()) {
-                response_json["postal_code"] = R[0]["postal_code"].as<std::string>();
-            }
-            if (!R[0]["timezone"].is_null()) {
-                response_json["timezone"] = R[0]["timezone"].as<std::string>();
+std::optional<crow::response> ApiHandlers::cached_response(std::string_view ip, std::string cached,
+                                                          LocationJson::FieldMask fields) {
+    auto logger = Logger::Logger::get_logger();
+    auto value = CacheCodec::decode_view(cached);
+    switch (value.kind) {
+        case CachedValue::Kind::FOUND:
+            logger->debug("Cache hit for IP: {}", ip);
+            return location_response(ip, value.record, fields);
+        case CachedValue::Kind::LEGACY_JSON: {
+            logger->debug("Cache hit for IP: {}", ip);
+            if (fields != LocationJson::ALL_FIELDS) {
+                auto record = record_from_json(cached);
+                if (!record) {
+                    logger->warning("Ignoring undecodable cache entry for IP: {}", ip);
+                    break;
+                }
+                return location_response(ip, LocationRecordView(*record), fields);
             }
+            crow::response response(200, std::move(cached));
+            response.set_header("Content-Type", "application/json");
+            return response;
+        }
+        case CachedValue::Kind::NOT_FOUND:
+            logger->debug("Cache hit (not found) for IP: {}", ip);
+            return not_found_response();
+        case CachedValue::Kind::INVALID:
+            logger->warning("Ignoring undecodable cache entry for IP: {}", ip);
+            break;
+    }
+    return std::nullopt;
+}
 
-            std::string response_str = response_json.dump();
-            cache_result(ip_str, response_str);
+crow::response ApiHandlers::database_response(std::string_view ip, const std::optional<LocationRecord>& record,
+                                             LocationJson::FieldMask fields) {
+    crow::response response = record ? location_response(ip, LocationRecordView(*record), fields) : not_found_response();
 
-            return crow::response(200, response_json);
+    // a JSON entry is the full body, so the one just rendered does unless it is projected
+    if (m_cache_format == CacheValueFormat::JSON && (!record || fields == LocationJson::ALL_FIELDS)) {
+        cache_result(ip, response.body, record ? m_cache_ttl_seconds : m_not_found_ttl_seconds);
+    } else {
+        fill_cache(ip, record);
+    }
+    return response;
+}
+
+void ApiHandlers::fill_cache(std::string_view ip, const std::optional<LocationRecord>& record) {
+    if (m_cache_format == CacheValueFormat::BINARY) {
+        if (record) {
+            cache_result(ip, CacheCodec::encode_record(*record), m_cache_ttl_seconds);
         } else {
-            std::string not_found_response = create_error_response("IP address location not found", "IP_NOT_FOUND").dump();
-            cache_result(ip_str, not_found_response, 300); // 5 minutes cache timeout for not found
-            
-            return crow::response(404, create_error_response("IP address location not found", "IP_NOT_FOUND"));
+            cache_result(ip, CacheCodec::encode_not_found(), m_not_found_ttl_seconds);
+        }
+    } else if (record) {
+        cache_result(ip, location_response(ip, LocationRecordView(*record), LocationJson::ALL_FIELDS).body,
+                     m_cache_ttl_seconds);
+    } else {
+        cache_result(ip, not_found_response().body, m_not_found_ttl_seconds);
+    }
+}
+
+crow::response ApiHandlers::handle_ip_location(const crow::request& req) {
+    RequestTiming timing = start_timing(req);
+    crow::response response = lookup_blocking(req, timing);
+    finish_cache_headers(response);
+    finish_timing(timing, response);
+    return response;
+}
+
+crow::response ApiHandlers::lookup_blocking(const crow::request& req, RequestTiming& timing) {
+    auto prepared = prepare_lookup(req, timing);
+    if (auto* response = std::get_if<crow::response>(&prepared)) {
+        return std::move(*response);
+    }
+    const auto& lookup = std::get<LocationLookup>(prepared);
+    crow::response response = query_blocking(lookup, timing);
+    set_cache_headers(response, lookup.generation);
+    return response;
+}
+
+crow::response ApiHandlers::query_blocking(const LocationLookup& lookup, RequestTiming& timing) {
+    auto logger = Logger::Logger::get_logger();
+    std::string_view ip_str = lookup.ip;
+
+    std::optional<AdmissionController::Permit> permit;
+    try {
+        // try to get from cache first
+        if (!admit(m_cache_admission.get(), permit)) {
+            return overloaded_response();
+        }
+        std::string cached_result;
+        {
+            auto span = timing.span(RequestTiming::Stage::CACHE);
+            cached_result = get_from_cache(ip_str);
+        }
+        permit.reset();
+        if (!cached_result.empty()) {
+            auto span = timing.span(RequestTiming::Stage::SERIALIZE);
+            if (auto response = cached_response(ip_str, std::move(cached_result), lookup.fields)) {
+                return std::move(*response);
+            }
+        }
+
+        logger->debug("Cache miss for IP: {}", ip_str);
+
+        if (!admit(m_db_admission.get(), permit)) {
+            return overloaded_response();
         }
+        std::optional<LocationRecord> record = query_record(lookup.address, timing);
+        permit.reset();
 
+        auto span = timing.span(RequestTiming::Stage::SERIALIZE);
+        return database_response(ip_str, record, lookup.fields);
+
+    } catch (const ConnectionUnavailable&) {
+        if (permit) permit->drop();
+        logger->error("Database connection unavailable for IP: {}", ip_str);
+        return crow::response(500, create_error_response("Database connection unavailable", "DB_CONNECTION_ERROR"));
     } catch (const pqxx::broken_connection& e) {
+        if (permit) permit->drop();
         logger->error("DB query failed due to broken connection: {}", e.what());
         return crow::response(500, create_error_response("Database connection lost", "DB_CONNECTION_LOST"));
     } catch (const std::exception& e) {
+        if (permit) permit->drop();
         logger->error("DB query error: {}", e.what());
         return crow::response(500, create_error_response("Database query error", "DB_QUERY_ERROR"));
     }
 }
 
+std::optional<LocationRecord> ApiHandlers::query_record(const IpAddress& address, RequestTiming& timing) {
+    std::unique_ptr<pqxx::connection> conn;
+    {
+        auto span = timing.span(RequestTiming::Stage::POOL_WAIT);
+        conn = m_db_pool->get_connection();
+    }
+    if (!conn) {
+        throw ConnectionUnavailable("Database connection unavailable");
+    }
+
+    pqxx::result R;
+    {
+        auto span = timing.span(RequestTiming::Stage::QUERY);
+        pqxx::work W(*conn);
+        // IPv4-mapped IPv6 addresses are looked up as IPv4: inet sorts every IPv4 value before any
+        // IPv6 one, so a mapped address would never fall inside an IPv4 range
+        R = W.exec_prepared(DatabasePool::PREPARED_IP_LOOKUP_NAME, address.unmapped().to_string());
+        W.commit();
+    }
+    m_db_pool->return_connection(std::move(conn));
+
+    std::optional<LocationRecord> record;
+    if (!R.empty()) {
+        record.emplace();
+        if (!R[0]["country"].is_null()) {
+            record->country = R[0]["country"].as<std::string>();
+        }
+        if (!R[0]["city"].is_null()) {
+            record->city = R[0]["city"].as<std::string>();
+        }
+        if (!R[0]["region"].is_null()) {
+            record->region = R[0]["region"].as<std::string>();
+        }
+        if (!R[0]["latitude"].is_null()) {
+            record->latitude = R[0]["latitude"].as<float>();
+        }
+        if (!R[0]["longitude"].is_null()) {
+            record->longitude = R[0]["longitude"].as<float>();
+        }
+        if (!R[0]["postal_code"].is_null()) {
+            record->postal_code = R[0]["postal_code"].as<std::string>();
+        }
+        if (!R[0]["timezone"].is_null()) {
+            record->timezone = R[0]["timezone"].as<std::string>();
+        }
+    }
+    return record;
+}
+
+BinaryServer::Handler ApiHandlers::binary_handler() {
+    return BinaryServer::Handler{
+        [this](const BinaryProtocol::Request& request, std::string_view client, std::string& out) {
+            return prepare_binary(request, client, out);
+        },
+        [this](const BinaryProtocol::Request& request, std::string& out) { lookup_binary(request, out); },
+    };
+}
+
+bool ApiHandlers::prepare_binary(const BinaryProtocol::Request& request, std::string_view client, std::string& out) {
+    using Status = BinaryProtocol::Status;
+    if (m_binary_rate_limit) {
+        ClientKey key(m_client_resolver->resolve(client, "", ""));
+        if (m_hot_clients) {
+            m_hot_clients->add(key.view());
+        }
+        if (!m_rate_limiter->is_allowed(key.view())) {
+            BinaryProtocol::append_response(out, request.id, Status::RATE_LIMITED);
+            return true;
+        }
+    }
+
+    if (m_hot_addresses) {
+        char ip[IpAddress::MAX_TEXT_LENGTH];
+        m_hot_addresses->add(std::string_view(ip, request.address.to_chars(ip)));
+    }
+    if (ReservedRanges::find(request.address)) {
+        m_reserved_ip_requests.fetch_add(1, std::memory_order_relaxed);
+        BinaryProtocol::append_response(out, request.id, Status::RESERVED);
+        return true;
+    }
+    if (!m_readiness.ready()) {
+        BinaryProtocol::append_response(out, request.id, Status::UNAVAILABLE);
+        return true;
+    }
+
+    if (auto datasets = m_datasets.load(std::memory_order_acquire)) {
+        m_in_memory_lookups.fetch_add(1, std::memory_order_relaxed);
+        if (auto record = find_in_memory(*datasets, datasets->serving, request.address)) {
+            BinaryProtocol::append_response(out, request.id, LocationRecordView(*record), request.fields);
+        } else {
+            BinaryProtocol::append_response(out, request.id, Status::NOT_FOUND);
+        }
+        return true;
+    }
+    return false;
+}
+
+void ApiHandlers::lookup_binary(const BinaryProtocol::Request& request, std::string& out) {
+    using Status = BinaryProtocol::Status;
+    char ip[IpAddress::MAX_TEXT_LENGTH];
+    std::string_view ip_str(ip, request.address.to_chars(ip));
+
+    std::optional<AdmissionController::Permit> permit;
+    if (!admit(m_cache_admission.get(), permit)) {
+        BinaryProtocol::append_response(out, request.id, Status::UNAVAILABLE);
+        return;
+    }
+    std::string cached = get_from_cache(ip_str);
+    permit.reset();
+    if (!cached.empty()) {
+        auto value = CacheCodec::decode_view(cached);
+        switch (value.kind) {
+            case CachedValue::Kind::FOUND:
+                BinaryProtocol::append_response(out, request.id, value.record, request.fields);
+                return;
+            case CachedValue::Kind::NOT_FOUND:
+                BinaryProtocol::append_response(out, request.id, Status::NOT_FOUND);
+                return;
+            case CachedValue::Kind::LEGACY_JSON:
+                if (auto record = record_from_json(cached)) {
+                    BinaryProtocol::append_response(out, request.id, LocationRecordView(*record), request.fields);
+                    return;
+                }
+                break;
+            case CachedValue::Kind::INVALID:
+                break;
+        }
+    }
+
+    if (!admit(m_db_admission.get(), permit)) {
+        BinaryProtocol::append_response(out, request.id, Status::UNAVAILABLE);
+        return;
+    }
+    try {
+        RequestTiming untimed;
+        auto record = query_record(request.address, untimed);
+        permit.reset();
+        if (record) {
+            BinaryProtocol::append_response(out, request.id, LocationRecordView(*record), request.fields);
+        } else {
+            BinaryProtocol::append_response(out, request.id, Status::NOT_FOUND);
+        }
+        fill_cache(ip_str, record);
+    } catch (const std::exception& e) {
+        if (permit) permit->drop();
+        Logger::Logger::get_logger()->error("DB query error: {}", e.what());
+        BinaryProtocol::append_response(out, request.id, Status::ERROR);
+    }
+}
+
+void ApiHandlers::handle_ip_location_async(const crow::request& req, crow::response& res) {
+    // the async pool is only known to exist, or not, once startup is done
+    if (!m_readiness.ready() || !m_async_db_pool) {
+        complete_response(res, handle_ip_location(req));
+        return;
+    }
+
+    RequestTiming timing = start_timing(req);
+    auto prepared = prepare_lookup(req, timing);
+    if (auto* response = std::get_if<crow::response>(&prepared)) {
+        finish_cache_headers(*response);
+        finish_timing(timing, *response);
+        complete_response(res, std::move(*response));
+        return;
+    }
+    // runs on this thread up to the Redis GET; the rest continues on the reactor
+    spawn(lookup_async(std::get<LocationLookup>(std::move(prepared)), timing, *req.io_context, res));
+}
+
+Task<void> ApiHandlers::lookup_async(LocationLookup lookup, RequestTiming timing, asio::io_context& connection_context,
+                                     crow::response& res) {
+    // copied before the first suspension, after which the request may be gone
+    std::string ip(lookup.ip);
+    lookup.ip = ip;
+    auto logger = Logger::Logger::get_logger();
+    m_async_in_flight.fetch_add(1, std::memory_order_relaxed);
+
+    std::optional<crow::response> response;
+    std::optional<AdmissionController::Permit> permit;
+    if (!admit(m_cache_admission.get(), permit)) {
+        response = overloaded_response();
+    } else {
+        std::string cached_result;
+        {
+            auto span = timing.span(RequestTiming::Stage::CACHE);
+            cached_result = co_await get_from_cache_async(ip);
+        }
+        permit.reset();
+        if (!cached_result.empty()) {
+            auto span = timing.span(RequestTiming::Stage::SERIALIZE);
+            response = cached_response(lookup.ip, std::move(cached_result), lookup.fields);
+        }
+    }
+
+    if (!response && !admit(m_db_admission.get(), permit)) {
+        response = overloaded_response();
+    }
+    if (!response) {
+        logger->debug("Cache miss for IP: {}", lookup.ip);
+        try {
+            // IPv4-mapped addresses are looked up as IPv4, as in handle_ip_location
+            std::vector<std::string> params{lookup.address.unmapped().to_string()};
+            std::chrono::nanoseconds connection_wait{0};
+            auto query_start = std::chrono::steady_clock::now();
+            PgResult result = co_await m_async_db_pool->execute_prepared(
+                DatabasePool::PREPARED_IP_LOOKUP_NAME, std::move(params), &connection_wait);
+            if (timing.enabled()) {
+                timing.add(RequestTiming::Stage::POOL_WAIT, connection_wait);
+                timing.add(RequestTiming::Stage::QUERY, std::chrono::steady_clock::now() - query_start - connection_wait);
+            }
+            permit.reset();
+            auto span = timing.span(RequestTiming::Stage::SERIALIZE);
+            response = database_response(lookup.ip, record_from_result(result), lookup.fields);
+        } catch (const AsyncDatabaseError& e) {
+            // statement timeouts and lost connections both mean the database is not keeping up
+            if (permit) permit->drop();
+            if (e.connection_lost()) {
+                logger->error("DB query failed due to broken connection: {}", e.what());
+                response = crow::response(500, create_error_response("Database connection lost", "DB_CONNECTION_LOST"));
+            } else {
+                logger->error("DB query error: {}", e.what());
+                response = crow::response(500, create_error_response("Database query error", "DB_QUERY_ERROR"));
+            }
+        } catch (const std::exception& e) {
+            if (permit) permit->drop();
+            logger->error("DB query error: {}", e.what());
+            response = crow::response(500, create_error_response("Database query error", "DB_QUERY_ERROR"));
+        }
+        permit.reset();
+    }
+
+    m_async_in_flight.fetch_sub(1, std::memory_order_relaxed);
+    set_cache_headers(*response, lookup.generation);
+    finish_timing(timing, *response);
+    // ending the response writes to the connection, which only its own io_context thread may
+    // touch; this coroutine is on a reactor thread by now
+    asio::post(connection_context, [&res, response = std::move(*response)]() mutable {
+        complete_response(res, std::move(response));
+    });
+}
+
+RequestTiming ApiHandlers::start_timing(const crow::request& req) {
+    bool header_requested = m_server_timing == RequestTiming::HeaderMode::ALWAYS
+        || (m_server_timing == RequestTiming::HeaderMode::ON_REQUEST && !req.get_header_value("X-Server-Timing").empty());
+
+    // every Nth lookup handled by this thread; a per-thread countdown keeps threads from
+    // contending on a shared counter
+    bool sampled = false;
+    if (m_trace_ring) {
+        thread_local uint32_t t_trace_countdown = 0;
+        if (t_trace_countdown == 0) {
+            sampled = true;
+            t_trace_countdown = m_trace_sample_every;
+        }
+        --t_trace_countdown;
+    }
+
+    if (!header_requested && !sampled) {
+        return RequestTiming();
+    }
+    return RequestTiming::start(header_requested, sampled);
+}
+
+void ApiHandlers::finish_timing(const RequestTiming& timing, crow::response& response) {
+    if (timing.header_requested()) {
+        response.set_header("Server-Timing", timing.server_timing_header());
+    }
+    if (timing.sampled()) {
+        m_trace_ring->push(TraceRecord::from(timing, response.code));
+    }
+}
+
+void ApiHandlers::set_cache_headers(crow::response& response, uint64_t generation) const {
+    if (!m_http_cache.enabled()) {
+        return;
+    }
+    if (response.code != 200 && response.code != 404) {
+        response.set_header("Cache-Control", "no-store");
+        return;
+    }
+    int until_update = m_ttl_policy.seconds_until_next_update(std::chrono::system_clock::now());
+    response.set_header("Cache-Control", m_http_cache.cache_control(response.code == 200, until_update));
+    if (generation != 0) {
+        response.set_header("ETag", HttpCachePolicy::etag(generation));
+    }
+}
+
+void ApiHandlers::finish_cache_headers(crow::response& response) const {
+    if (m_http_cache.enabled() && response.get_header_value("Cache-Control").empty()) {
+        response.set_header("Cache-Control", "no-store");
+    }
+}
+
 crow::response ApiHandlers::handle_metrics() {
     crow::json::wvalue metrics;
     metrics["database_healthy"] = m_db_pool->is_pool_healthy();
-    
-    if (m_redis_client) {
-        try {
-            m_redis_client->ping();
-            metrics["redis_healthy"] = true;
-            
-            // Get Redis info
-            auto info = m_redis_client->info("memory");
-            // Parse memory usage if needed
-            metrics["redis_connected"] = true;
-        } catch (const std::exception& e) {
-            metrics["redis_healthy"] = false;
-            metrics["redis_connected"] = false;
+    metrics["reserved_ip_requests"] = m_reserved_ip_requests.load(std::memory_order_relaxed);
+    metrics["not_modified_responses"] = m_not_modified_responses.load(std::memory_order_relaxed);
+    metrics["rate_limiter"]["clients"] = m_rate_limiter->client_count();
+    metrics["rate_limiter"]["max_clients"] = m_rate_limiter->max_clients();
+    metrics["rate_limiter"]["evicted"] = m_rate_limiter->evicted_count();
+
+    bool ready = m_readiness.ready();
+    metrics["startup"]["ready"] = ready;
+    for (size_t i = 0; i < Readiness::COMPONENT_COUNT; ++i) {
+        auto component = static_cast<Readiness::Component>(i);
+        if (auto settled_after = m_readiness.settled_after(component)) {
+            metrics["startup"][std::string(Readiness::component_to_string(component)) + "_ms"] = settled_after->count();
         }
-    } else {
-        metrics["redis_healthy"] = false;
-        metrics["redis_connected"] = false;
+    }
+    if (auto time_to_ready = m_readiness.time_to_ready()) {
+        metrics["startup"]["time_to_ready_ms"] = time_to_ready->count();
+    }
+
+    // set by the startup thread
+    if (ready) {
+        metrics["dataset_generation"] = m_dataset_generation->current();
+        metrics["request_pipeline"] = m_async_db_pool ? "async" : "blocking";
+    }
+
+    if (ready && m_async_db_pool) {
+        metrics["async_pipeline"]["threads"] = m_reactor->thread_count();
+        metrics["async_pipeline"]["in_flight"] = m_async_in_flight.load(std::memory_order_relaxed);
+        metrics["async_pipeline"]["db_connections"] = m_async_db_pool->connection_count();
+        metrics["async_pipeline"]["db_idle"] = m_async_db_pool->idle_connections();
+        metrics["async_pipeline"]["db_waiting"] = m_async_db_pool->waiting_queries();
+        metrics["async_pipeline"]["db_reconnecting"] = m_async_db_pool->reconnecting_connections();
+    }
+
+    if (m_traffic_capture) {
+        metrics["traffic_capture"]["file"] = m_traffic_capture->path();
+        metrics["traffic_capture"]["sample_every"] = m_capture_sample_every;
+        metrics["traffic_capture"]["captured"] = m_traffic_capture->captured_count();
+        metrics["traffic_capture"]["dropped"] = m_traffic_capture->dropped_count();
+        metrics["traffic_capture"]["written"] = m_traffic_capture->written_count();
+        metrics["traffic_capture"]["failed"] = m_traffic_capture->failed_count();
+    }
+
+    auto admission_metrics = [&](const char* stage, const AdmissionController& controller) {
+        metrics["admission"][stage]["limit"] = controller.limit();
+        metrics["admission"][stage]["in_flight"] = controller.in_flight();
+        metrics["admission"][stage]["min_latency_us"] = controller.min_latency().count();
+        metrics["admission"][stage]["admitted"] = controller.admitted_count();
+        metrics["admission"][stage]["rejected"] = controller.rejected_count();
+        metrics["admission"][stage]["decreases"] = controller.decrease_count();
+    };
+    if (m_cache_admission) {
+        admission_metrics("cache", *m_cache_admission);
+        admission_metrics("db", *m_db_admission);
+    }
+
+    if (auto datasets = m_datasets.load(std::memory_order_acquire)) {
+        const auto& dataset = datasets->replicas.front();
+        auto placement = MemoryPlacementPolicy::stats();
+        metrics["in_memory"]["generation"] = datasets->newest();
+        metrics["in_memory"]["serving_generation"] = datasets->serving;
+        metrics["in_memory"]["generations_kept"] = datasets->history->generations().size();
+        metrics["in_memory"]["history_bytes"] = datasets->history->memory_bytes();
+        metrics["in_memory"]["replicas"] = datasets->replicas.size();
+        metrics["in_memory"]["shared"] = m_shared_dataset;
+        metrics["in_memory"]["huge_pages"] = MemoryPlacementPolicy::huge_page_mode_to_string(m_huge_pages);
+        metrics["in_memory"]["mapped_bytes"] = placement.mapped_bytes;
+        metrics["in_memory"]["hugetlb_bytes"] = placement.hugetlb_bytes;
+        metrics["in_memory"]["ipv4_index"] = LocationDataset::ipv4_index_to_string(dataset->ipv4_index_type());
+        metrics["in_memory"]["ipv4_ranges"] = dataset->ipv4_range_count();
+        metrics["in_memory"]["records"] = dataset->record_count();
+        metrics["in_memory"]["record_bytes"] = dataset->record_memory_bytes();
+        metrics["in_memory"]["ipv4_index_bytes"] = dataset->ipv4_index_memory_bytes();
+        metrics["in_memory"]["ipv6_ranges"] = dataset->ipv6_range_count();
+        metrics["in_memory"]["ipv6_index_bytes"] = dataset->ipv6_index_memory_bytes();
+        metrics["in_memory"]["country_index_bytes"] = dataset->country_index_memory_bytes();
+        metrics["in_memory"]["lookups"] = m_in_memory_lookups.load(std::memory_order_relaxed);
+        metrics["in_memory"]["range_pages"] = m_range_pages.load(std::memory_order_relaxed);
+    }
+    
+    bool redis_healthy = redis_ping();
+    metrics["redis_healthy"] = redis_healthy;
+    metrics["redis_connected"] = redis_healthy;
+
+    metrics["redis_circuit"]["state"] = CircuitBreaker::state_to_string(m_redis_breaker->state());
+    metrics["redis_circuit"]["short_circuited"] = m_redis_breaker->short_circuited_count();
+    metrics["redis_circuit"]["failures"] = m_redis_breaker->failure_count();
+    metrics["redis_circuit"]["slow_calls"] = m_redis_breaker->slow_call_count();
+    metrics["redis_circuit"]["opened"] = m_redis_breaker->opened_count();
+
+    if (m_cache_writer) {
+        metrics["cache_writes"]["queued"] = m_cache_writer->queued_count();
+        metrics["cache_writes"]["coalesced"] = m_cache_writer->coalesced_count();
+        metrics["cache_writes"]["flushed"] = m_cache_writer->flushed_count();
+        metrics["cache_writes"]["dropped"] = m_cache_writer->dropped_count();
+        metrics["cache_writes"]["failed"] = m_cache_writer->failed_count();
+        metrics["cache_writes"]["pending"] = m_cache_writer->pending();
     }
     
     metrics["uptime"] = std::chrono::duration_cast<std::chrono::seconds>(
@@ -174,15 +1071,297 @@ crow::response ApiHandlers::handle_metrics() {
     return crow::response(200, metrics);
 }
 
-std::string ApiHandlers::get_client_ip(const crow::request& req) {
-    std::string client_ip = req.get_header_value("X-Forwarded-For");
-    if (client_ip.empty()) {
-        client_ip = req.get_header_value("X-Real-IP");
+crow::response ApiHandlers::handle_debug_traces(const crow::request& req) {
+    if (!m_trace_ring) {
+        return crow::response(404, create_error_response("Request tracing is disabled", "TRACING_DISABLED"));
+    }
+
+    size_t limit = m_trace_ring->capacity();
+    if (const char* limit_param = req.url_params.get("limit")) {
+        try {
+            limit = std::min(limit, static_cast<size_t>(std::stoul(limit_param)));
+        } catch (const std::exception&) {
+            return crow::response(400, create_error_response("Invalid limit", "INVALID_PARAMETER"));
+        }
+    }
+
+    crow::json::wvalue body;
+    body["sample_every"] = m_trace_sample_every;
+    body["recorded"] = m_trace_ring->recorded_count();
+    body["dropped"] = m_trace_ring->dropped_count();
+
+    auto records = m_trace_ring->snapshot(limit);
+    std::vector<crow::json::wvalue> traces;
+    traces.reserve(records.size());
+    for (const auto& record : records) {
+        crow::json::wvalue trace;
+        trace["timestamp_ms"] = record.unix_ms;
+        trace["ip"] = std::string(record.ip);
+        trace["status"] = record.status;
+        trace["total_us"] = record.total_ns / 1000.0;
+        for (size_t i = 0; i < RequestTiming::STAGE_COUNT; ++i) {
+            if (record.ran_stages & (1u << i)) {
+                trace["stages_us"][RequestTiming::stage_to_string(static_cast<RequestTiming::Stage>(i))] = record.stage_ns[i] / 1000.0;
+            }
+        }
+        traces.push_back(std::move(trace));
+    }
+    body["traces"] = std::move(traces);
+    return crow::response(200, body);
+}
+
+crow::response ApiHandlers::handle_debug_heavy_hitters(const crow::request& req) {
+    if (!m_hot_addresses) {
+        return crow::response(404, create_error_response("Heavy hitter tracking is disabled", "HEAVY_HITTERS_DISABLED"));
+    }
+
+    size_t limit = m_hot_addresses->capacity();
+    if (const char* limit_param = req.url_params.get("limit")) {
+        try {
+            limit = std::min(limit, static_cast<size_t>(std::stoul(limit_param)));
+        } catch (const std::exception&) {
+            return crow::response(400, create_error_response("Invalid limit", "INVALID_PARAMETER"));
+        }
+    }
+
+    crow::json::wvalue body;
+    body["width"] = m_hot_addresses->width();
+    body["depth"] = HeavyHitters::DEPTH;
+    auto report = [&](const char* name, const HeavyHitters& sketch) {
+        body[name]["total"] = sketch.total();
+        body[name]["error_bound"] = sketch.error_bound();
+        std::vector<crow::json::wvalue> entries;
+        for (const auto& entry : sketch.top(limit)) {
+            crow::json::wvalue item;
+            item["key"] = entry.key;
+            item["count"] = entry.count;
+            entries.push_back(std::move(item));
+        }
+        body[name]["top"] = std::move(entries);
+    };
+    report("addresses", *m_hot_addresses);
+    report("clients", *m_hot_clients);
+    return crow::response(200, body);
+}
+
+crow::response ApiHandlers::handle_reset_heavy_hitters(const crow::request& req) {
+    if (auto rejected = reject_non_admin(req)) {
+        return std::move(*rejected);
+    }
+    if (!m_hot_addresses) {
+        return crow::response(404, create_error_response("Heavy hitter tracking is disabled", "HEAVY_HITTERS_DISABLED"));
+    }
+    m_hot_addresses->reset();
+    m_hot_clients->reset();
+    Logger::Logger::get_logger()->info("Heavy hitter counts reset");
+    return crow::response(204);
+}
+
+crow::response ApiHandlers::handle_serve_generation(const crow::request& req) {
+    if (auto rejected = reject_non_admin(req)) {
+        return std::move(*rejected);
+    }
+    if (!m_in_memory_enabled) {
+        return crow::response(404, create_error_response("In-memory lookups are disabled", "IN_MEMORY_DISABLED"));
+    }
+
+    if (m_shared_dataset) {
+        // the supervisor owns the datasets, and a rollback in one worker would not reach the others
+        return crow::response(409, create_error_response("Rollback is not supported in prefork mode",
+                                                         "ROLLBACK_UNSUPPORTED"));
+    }
+    const char* serve = req.url_params.get("serve");
+    if (!serve) {
+        return crow::response(400, create_error_response("Parameter 'serve' is missing", "MISSING_PARAMETER"));
+    }
+    // nullopt: the newest
+    std::optional<uint64_t> requested;
+    if (std::string_view(serve) != "latest") {
+        requested = parse_generation(serve);
+        if (!requested) {
+            return crow::response(400, create_error_response(
+                "Parameter 'serve' must be a dataset generation or latest", "INVALID_GENERATION"));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_datasets_mutex);
+    auto current = m_datasets.load(std::memory_order_acquire);
+    if (!current) {
+        return not_ready_response();
+    }
+    uint64_t generation = requested.value_or(current->newest());
+    if (!current->history->contains(generation)) {
+        auto response_json = create_error_response("Dataset generation is not kept in memory", "GENERATION_NOT_AVAILABLE");
+        response_json["generation"] = generation;
+        return crow::response(404, response_json);
+    }
+    if (generation != current->serving) {
+        auto next = std::make_shared<LoadedDatasets>(*current);
+        next->serving = generation;
+        m_datasets.store(std::move(next), std::memory_order_release);
+        if (generation == current->newest()) {
+            Logger::Logger::get_logger()->info("Lookups answered from the newest dataset generation {} again", generation);
+        } else {
+            Logger::Logger::get_logger()->warning("Lookups rolled back to dataset generation {}, the newest is {}",
+                                                  generation, current->newest());
+        }
+    }
+    return handle_debug_generations();
+}
+
+crow::response ApiHandlers::handle_debug_generations() {
+    if (!m_in_memory_enabled) {
+        return crow::response(404, create_error_response("In-memory lookups are disabled", "IN_MEMORY_DISABLED"));
+    }
+
+    auto datasets = m_datasets.load(std::memory_order_acquire);
+    if (!datasets) {
+        return not_ready_response();
+    }
+    crow::json::wvalue body;
+    body["newest"] = datasets->newest();
+    body["serving"] = datasets->serving;
+    body["keep"] = m_generations_kept;
+    std::vector<crow::json::wvalue> generations;
+    for (const auto& generation : datasets->history->generations()) {
+        crow::json::wvalue item;
+        item["generation"] = generation.generation;
+        if (generations.empty()) {
+            const auto& dataset = *datasets->replicas.front();
+            item["stored"] = "full";
+            item["ipv4_ranges"] = dataset.ipv4_range_count();
+            item["ipv6_ranges"] = dataset.ipv6_range_count();
+            item["records"] = dataset.record_count();
+            item["bytes"] = dataset.ipv4_index_memory_bytes() + dataset.ipv6_index_memory_bytes() +
+                            dataset.record_memory_bytes() + dataset.country_index_memory_bytes();
+        } else {
+            item["stored"] = "delta";
+            item["ipv4_ranges"] = generation.ipv4_ranges;
+            item["ipv6_ranges"] = generation.ipv6_ranges;
+            item["records"] = generation.records;
+            item["bytes"] = generation.memory_bytes;
+        }
+        generations.push_back(std::move(item));
+    }
+    body["generations"] = std::move(generations);
+    return crow::response(200, body);
+}
+
+crow::response ApiHandlers::handle_ip_ranges(const crow::request& req) {
+    if (!m_in_memory_enabled) {
+        return crow::response(404, create_error_response("In-memory lookups are disabled", "IN_MEMORY_DISABLED"));
+    }
+    ClientKey client = client_key(req);
+    if (!m_rate_limiter->is_allowed(client.view())) {
+        return crow::response(429, create_error_response("Rate limit exceeded", "RATE_LIMIT_EXCEEDED"));
+    }
+
+    LocationDataset::RangeQuery query;
+    if (const char* cidr = req.url_params.get("cidr")) {
+        query.prefix = IpPrefix::parse(cidr);
+        if (!query.prefix) {
+            return crow::response(400, create_error_response("Invalid CIDR block", "INVALID_CIDR"));
+        }
+    }
+    if (const char* country = req.url_params.get("country")) {
+        query.country = country;
+    }
+    if (!query.prefix && !query.country) {
+        return crow::response(400, create_error_response("Parameter 'cidr' or 'country' is missing", "MISSING_PARAMETER"));
+    }
+    if (const char* cursor = req.url_params.get("cursor")) {
+        query.from = IpAddress::parse(cursor);
+        if (!query.from) {
+            return crow::response(400, create_error_response("Invalid cursor", "INVALID_CURSOR"));
+        }
+    }
+    size_t limit = std::min(DEFAULT_RANGES_LIMIT, m_ranges_max_limit);
+    if (const char* limit_raw = req.url_params.get("limit")) {
+        std::string_view text(limit_raw);
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), limit);
+        if (error != std::errc() || end != text.data() + text.size() || limit == 0) {
+            return crow::response(400, create_error_response("Invalid limit", "INVALID_PARAMETER"));
+        }
+        limit = std::min(limit, m_ranges_max_limit);
+    }
+    LocationJson::FieldMask fields = LocationJson::ALL_FIELDS;
+    if (const char* fields_raw = req.url_params.get("fields")) {
+        auto parsed = LocationJson::parse_fields(fields_raw);
+        if (!parsed) {
+            return crow::response(400, create_error_response(
+                "Unknown field in 'fields', expected a list of country, city, region, latitude, longitude, "
+                "postal_code and timezone", "INVALID_FIELDS"));
+        }
+        fields = *parsed;
+    }
+
+    auto datasets = m_datasets.load(std::memory_order_acquire);
+    if (!m_readiness.ready() || !datasets) {
+        return not_ready_response();
+    }
+    m_range_pages.fetch_add(1, std::memory_order_relaxed);
+    // the newest generation: older ones are kept as deltas, which have no order of their own
+    // to scan
+    const LocationDataset& dataset = local_dataset(*datasets);
+    std::vector<LocationDataset::Range> ranges;
+    ranges.reserve(limit);
+    auto next = dataset.scan_ranges(query, limit, ranges);
+
+    // one reservation for the whole page
+    std::string body;
+    body.reserve(64 + ranges.size() * 160);
+    char digits[24];
+    body += "{\"generation\":";
+    body.append(digits, std::to_chars(digits, digits + sizeof(digits), datasets->newest()).ptr);
+    body += ",\"ranges\":[";
+    char first[IpAddress::MAX_TEXT_LENGTH];
+    char last[IpAddress::MAX_TEXT_LENGTH];
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (i > 0) {
+            body += ',';
+        }
+        LocationRecord record = dataset.record(ranges[i].id);
+        LocationJson::append_range(body, std::string_view(first, ranges[i].first.to_chars(first)),
+                                   std::string_view(last, ranges[i].last.to_chars(last)), LocationRecordView(record),
+                                   fields);
+    }
+    body += "],\"next_cursor\":";
+    if (next) {
+        LocationJson::append_string(body, std::string_view(first, next->to_chars(first)));
+    } else {
+        body += "null";
     }
-    if (client_ip.empty()) {
-        client_ip = "unknown";
+    body += '}';
+    return json_response(200, std::move(body));
+}
+
+ClientKey ApiHandlers::client_key(const crow::request& req) const {
+    return ClientKey(m_client_resolver->resolve(req.remote_ip_address, req.get_header_value("X-Forwarded-For"),
+                                                req.get_header_value("X-Real-IP")));
+}
+
+crow::response ApiHandlers::location_response(std::string_view ip, const LocationRecordView& record,
+                                             LocationJson::FieldMask fields) {
+    // rendered into the body Crow sends, the one allocation of a cache hit
+    std::string body;
+    body.reserve(256);
+    LocationJson::append_location(body, ip, record, fields);
+    return json_response(200, std::move(body));
+}
+
+crow::response ApiHandlers::not_found_response() {
+    std::string body;
+    body.reserve(128);
+    LocationJson::append_error(body, "IP address location not found", "IP_NOT_FOUND", std::time(nullptr));
+    return json_response(404, std::move(body));
+}
+
+std::optional<crow::response> ApiHandlers::reject_non_admin(const crow::request& req) {
+    if (req.get_header_value(ADMIN_HEADER).empty()) {
+        return crow::response(403, create_error_response(std::string("Admin requests need the ") + ADMIN_HEADER + " header",
+                                                         "ADMIN_HEADER_MISSING"));
     }
-    return client_ip;
+    return std::nullopt;
 }
 
 crow::json::wvalue ApiHandlers::create_error_response(const std::string& error, const std::string& code) {
@@ -193,19 +1372,78 @@ crow::json::wvalue ApiHandlers::create_error_response(const std::string& error,
     return response;
 }
 
-std::string ApiHandlers::get_from_cache(const std::string& ip) {
-    if (!m_redis_client) {
+bool ApiHandlers::admit(AdmissionController* controller, std::optional<AdmissionController::Permit>& permit) {
+    if (!controller) {
+        return true;
+    }
+    permit = controller->try_acquire();
+    return permit.has_value();
+}
+
+crow::response ApiHandlers::overloaded_response() {
+    crow::response response(503, create_error_response("Service overloaded, retry later", "OVERLOADED"));
+    response.set_header("Retry-After", std::to_string(m_retry_after_seconds));
+    return response;
+}
+
+crow::response ApiHandlers::not_modified_response(uint64_t generation) const {
+    // whether the stored answer was found or not is unknown here, so the shorter max-age
+    crow::response response(304);
+    int until_update = m_ttl_policy.seconds_until_next_update(std::chrono::system_clock::now());
+    response.set_header("Cache-Control", m_http_cache.cache_control(false, until_update));
+    response.set_header("ETag", HttpCachePolicy::etag(generation));
+    return response;
+}
+
+crow::response ApiHandlers::not_ready_response() {
+    crow::response response(503, create_error_response("Service is starting, retry later", "NOT_READY"));
+    response.set_header("Retry-After", std::to_string(m_retry_after_seconds));
+    return response;
+}
+
+CacheKey ApiHandlers::cache_key(std::string_view ip) const {
+    return CacheKey(m_dataset_generation->current(), ip);
+}
+
+Task<std::string> ApiHandlers::get_from_cache_async(std::string ip) {
+    if (!m_async_redis || !m_redis_breaker->allow_request()) {
+        co_return "";
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        CacheKey key = cache_key(ip);
+        auto cached_value = co_await AsyncRedisGet(*m_async_redis, *m_reactor, key.view());
+        m_redis_breaker->record_success(elapsed_since(start));
+
+        if (cached_value) {
+            co_return *cached_value;
+        }
+    } catch (const std::exception& e) {
+        m_redis_breaker->record_failure();
+        auto logger = Logger::Logger::get_logger();
+        logger->warning("Redis cache read error for IP {}: {}", ip, e.what());
+    }
+
+    co_return "";
+}
+
+std::string ApiHandlers::get_from_cache(std::string_view ip) {
+    if (!m_redis_client || !m_redis_breaker->allow_request()) {
         return "";
     }
     
+    auto start = std::chrono::steady_clock::now();
     try {
-        std::string cache_key = "ip_location:" + ip;
-        auto cached_value = m_redis_client->get(cache_key);
+        CacheKey key = cache_key(ip);
+        auto cached_value = m_redis_client->get(sw::redis::StringView(key.data(), key.size()));
+        m_redis_breaker->record_success(elapsed_since(start));
         
         if (cached_value) {
             return *cached_value;
         }
     } catch (const std::exception& e) {
+        m_redis_breaker->record_failure();
         auto logger = Logger::Logger::get_logger();
         logger->warning("Redis cache read error for IP {}: {}", ip, e.what());
     }
@@ -213,16 +1451,127 @@ std::string ApiHandlers::get_from_cache(const std::string& ip) {
     return "";
 }
 
-void ApiHandlers::cache_result(const std::string& ip, const std::string& result, int ttl_seconds) {
-    if (!m_redis_client) {
+void ApiHandlers::cache_result(std::string_view ip, std::string result, int base_ttl_seconds) {
+    if (!m_cache_writer) {
         return;
     }
     
+    // the write is flushed by the background worker; under backpressure it is dropped rather than blocking
+    if (!m_cache_writer->enqueue(cache_key(ip).str(), std::move(result), m_ttl_policy.ttl_seconds(base_ttl_seconds))) {
+        auto logger = Logger::Logger::get_logger();
+        logger->debug("Cache write queue full, dropping write for IP: {}", ip);
+    }
+}
+
+void ApiHandlers::flush_cache_writes(const std::vector<CacheWrite>& batch) {
+    if (!m_redis_breaker->allow_request()) {
+        throw std::runtime_error("Redis circuit is open");
+    }
+
+    // one round trip for the whole batch; the connection is borrowed from the client's pool.
+    // A batch is allowed more time than a single operation, so only errors trip the breaker.
+    auto start = std::chrono::steady_clock::now();
+    try {
+        auto pipe = m_redis_client->pipeline(false);
+        for (const auto& write : batch) {
+            pipe.setex(write.key, write.ttl_seconds, write.value);
+        }
+        pipe.exec();
+    } catch (const std::exception&) {
+        m_redis_breaker->record_failure();
+        throw;
+    }
+    m_redis_breaker->record_success(std::min(elapsed_since(start), m_redis_breaker->latency_budget()));
+}
+
+void ApiHandlers::reload_dataset() {
+    auto logger = Logger::Logger::get_logger();
+    try {
+        // the primary copy is built on the first node, replicas are copied onto the others
+        MemoryPlacement placement{m_huge_pages, m_numa_nodes.empty() ? -1 : m_numa_nodes.front().id};
+        auto datasets = std::make_shared<LoadedDatasets>();
+        auto before = MemoryPlacementPolicy::stats();
+        DatasetLoader::Result loaded;
+        {
+            PlacementScope scope(placement);
+            loaded = DatasetLoader::load(*m_db_pool, m_ipv4_index);
+        }
+        datasets->replicas.push_back(std::move(loaded.dataset));
+        for (size_t i = 1; i < m_numa_nodes.size(); ++i) {
+            datasets->replicas.push_back(datasets->replicas.front()->replicate(MemoryPlacement{m_huge_pages, m_numa_nodes[i].id}));
+        }
+
+        auto after = MemoryPlacementPolicy::stats();
+        if (after.hugetlb_fallbacks > before.hugetlb_fallbacks) {
+            logger->warning("{} dataset allocations fell back from MAP_HUGETLB to transparent huge pages; "
+                            "reserve more with vm.nr_hugepages", after.hugetlb_fallbacks - before.hugetlb_fallbacks);
+        }
+        if (after.numa_bind_failures > before.numa_bind_failures) {
+            logger->warning("{} dataset allocations could not be bound to their NUMA node",
+                            after.numa_bind_failures - before.numa_bind_failures);
+        }
+
+        // the previous dataset keeps serving until the new one is fully built, and becomes a
+        // delta against it if older generations are kept
+        std::lock_guard<std::mutex> lock(m_datasets_mutex);
+        auto previous = m_datasets.load(std::memory_order_acquire);
+        if (previous) {
+            // a rollback holds until it is lifted, and its generation is kept until then
+            uint64_t pinned = previous->serving != previous->newest() ? previous->serving : 0;
+            datasets->history = previous->history->advance(*previous->replicas.front(), loaded.generation,
+                                                           *datasets->replicas.front(), m_generations_kept, pinned);
+            datasets->serving = pinned && datasets->history->contains(pinned) ? pinned : datasets->newest();
+            if (m_generations_kept > 1 || pinned) {
+                logger->info("Keeping {} dataset generations in memory, {} bytes in deltas",
+                             datasets->history->generations().size(), datasets->history->memory_bytes());
+            }
+        } else {
+            datasets->history = std::make_shared<const DatasetHistory>(loaded.generation);
+            datasets->serving = loaded.generation;
+        }
+        m_datasets.store(std::move(datasets), std::memory_order_release);
+    } catch (const std::exception& e) {
+        logger->error("Failed to load in-memory dataset: {}", e.what());
+    }
+}
+
+const LocationDataset& ApiHandlers::local_dataset(const LoadedDatasets& datasets) {
+    const auto& replicas = datasets.replicas;
+    if (replicas.size() == 1) {
+        return *replicas.front();
+    }
+
+    if (t_worker_node < 0) {
+        // first lookup on this worker thread: spread workers over the nodes and keep each one
+        // on its node so it only reads local memory
+        t_worker_node = static_cast<int>(m_next_worker_node.fetch_add(1, std::memory_order_relaxed) % m_numa_nodes.size());
+        if (!NumaTopology::pin_current_thread(m_numa_nodes[static_cast<size_t>(t_worker_node)])) {
+            Logger::Logger::get_logger()->warning("Failed to pin worker thread to NUMA node {}",
+                                                  m_numa_nodes[static_cast<size_t>(t_worker_node)].id);
+        }
+    }
+    return *replicas[static_cast<size_t>(t_worker_node) % replicas.size()];
+}
+
+std::optional<LocationRecord> ApiHandlers::find_in_memory(const LoadedDatasets& datasets, uint64_t generation,
+                                                          const IpAddress& address) {
+    return datasets.history->find(generation, address, local_dataset(datasets));
+}
+
+bool ApiHandlers::redis_ping() {
+    if (!m_redis_client || !m_redis_breaker->allow_request()) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
     try {
-        std::string cache_key = "ip_location:" + ip;
-        m_redis_client->setex(cache_key, ttl_seconds, result);
+        m_redis_client->ping();
+        m_redis_breaker->record_success(elapsed_since(start));
+        return true;
     } catch (const std::exception& e) {
+        m_redis_breaker->record_failure();
         auto logger = Logger::Logger::get_logger();
-        logger->warning("Redis cache write error for IP {}: {}", ip, e.what());
+        logger->warning("Redis ping failed: {}", e.what());
+        return false;
     }
 }
\ No newline at end of file
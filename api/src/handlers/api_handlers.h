@@ -1,13 +1,52 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
 #include <crow.h>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <variant>
+#include <sw/redis++/async_redis++.h>
 #include <sw/redis++/redis++.h>
+#include "../async/reactor.h"
+#include "../async/task.h"
+#include "../cache/cache_codec.h"
+#include "../cache/cache_key.h"
+#include "../cache/cache_ttl_policy.h"
+#include "../cache/cache_writer.h"
+#include "../cache/http_cache_policy.h"
+#include "../config/service_config.h"
+#include "../database/async_database_pool.h"
 #include "../database/database_pool.h"
+#include "../database/dataset_generation.h"
+#include "../lookup/dataset_history.h"
+#include "../lookup/location_dataset.h"
+#include "../protocol/binary_protocol.h"
+#include "../server/binary_server.h"
+#include "../server/readiness.h"
+#include "location_json.h"
+#include "../utils/admission_controller.h"
+#include "../utils/circuit_breaker.h"
+#include "../utils/client_address.h"
+#include "../utils/heavy_hitters.h"
+#include "../utils/ip_address.h"
+#include "../utils/numa_topology.h"
 #include "../utils/rate_limiter.h"
+#include "../utils/request_timing.h"
+#include "../utils/trace_ring.h"
+#include "../utils/traffic_capture.h"
 
 class ApiHandlers {
 public:
-    explicit ApiHandlers(std::unique_ptr<DatabasePool> db_pool);
+    // A shared dataset, loaded by the prefork supervisor with the history of older generations
+    // it keeps, is served as is: reloads are then the supervisor's job. Without one the
+    // handlers load and reload the dataset themselves.
+    // Returns without waiting for connections or the dataset; see /readyz.
+    explicit ApiHandlers(std::unique_ptr<DatabasePool> db_pool, const ServiceConfig& config = ServiceConfig(),
+                         std::shared_ptr<const LocationDataset> shared_dataset = nullptr,
+                         std::shared_ptr<const DatasetHistory> shared_history = nullptr);
+    ~ApiHandlers();
     
     template <typename App>
     void register_routes(App& app) {
@@ -16,33 +55,242 @@ public:
             return handle_health_check();
         });
 
+        CROW_ROUTE(app, "/livez")([this]() {
+            return handle_liveness();
+        });
+
+        CROW_ROUTE(app, "/readyz")([this]() {
+            return handle_readiness();
+        });
+
         CROW_ROUTE(app, "/")([this]() {
             return handle_root();
         });
 
-        CROW_ROUTE(app, "/ip-location")([this](const crow::request& req) {
-            return handle_ip_location(req);
+        CROW_ROUTE(app, "/ip-location")([this](const crow::request& req, crow::response& res) {
+            handle_ip_location_async(req, res);
+        });
+
+        CROW_ROUTE(app, "/ip-ranges")([this](const crow::request& req) {
+            return handle_ip_ranges(req);
         });
 
         CROW_ROUTE(app, "/metrics")([this]() {
             return handle_metrics();
         });
+
+        CROW_ROUTE(app, "/debug/traces")([this](const crow::request& req) {
+            return handle_debug_traces(req);
+        });
+
+        CROW_ROUTE(app, "/debug/heavy-hitters")([this](const crow::request& req) {
+            return handle_debug_heavy_hitters(req);
+        });
+
+        CROW_ROUTE(app, "/debug/generations")([this]() {
+            return handle_debug_generations();
+        });
     }
 
+    // Actions that change the service's state, for the admin listener only: it has no
+    // CORS, and each request must also carry ADMIN_HEADER, which a browser cannot add to a
+    // cross-origin request without a preflight the listener never allows.
+    template <typename App>
+    void register_admin_routes(App& app) {
+        CROW_ROUTE(app, "/debug/generations").methods("POST"_method)([this](const crow::request& req) {
+            return handle_serve_generation(req);
+        });
+
+        CROW_ROUTE(app, "/debug/heavy-hitters/reset").methods("POST"_method)([this](const crow::request& req) {
+            return handle_reset_heavy_hitters(req);
+        });
+    }
+
+    static constexpr const char* ADMIN_HEADER = "X-Admin-Request";
+
     // public for testing (an alternative could be making them friends)
     crow::response handle_health_check();
+    // the process is up and serving requests; no dependency is checked
+    crow::response handle_liveness();
+    // 200 once the pool's minimum connections, the cache and the in-memory dataset have
+    // settled, 503 with each component's state until then
+    crow::response handle_readiness();
+    // what handle_readiness answers 200 for
+    bool ready() const { return m_readiness.ready(); }
     crow::response handle_root();
     crow::response handle_ip_location(const crow::request& req);
+    // completes `res` once the lookup is done, on the thread of the request's io_context
+    void handle_ip_location_async(const crow::request& req, crow::response& res);
+    // the ranges overlapping `cidr` and/or located in `country`, in address order from the
+    // in-memory dataset, `limit` at a time; a page that is not the last names the `cursor`
+    // the next one starts from
+    crow::response handle_ip_ranges(const crow::request& req);
     crow::response handle_metrics();
+    // the most recent sampled request breakdowns, newest first; `limit` caps the count
+    crow::response handle_debug_traces(const crow::request& req);
+    // the most frequent looked-up addresses and clients; `limit` caps each list
+    crow::response handle_debug_heavy_hitters(const crow::request& req);
+    // admin: starts counting heavy hitters afresh
+    crow::response handle_reset_heavy_hitters(const crow::request& req);
+    // the dataset generations kept in memory
+    crow::response handle_debug_generations();
+    // admin: `serve=<generation>` rolls lookups back to a kept generation and `serve=latest`
+    // returns them to the newest; answers as handle_debug_generations
+    crow::response handle_serve_generation(const crow::request& req);
+
+    // lookups for BinaryServer, sharing the rate limiter, dataset, cache and pool with HTTP
+    BinaryServer::Handler binary_handler();
 
 private:
     std::unique_ptr<DatabasePool> m_db_pool;
+    std::unique_ptr<DatasetGeneration> m_dataset_generation;
     std::unique_ptr<RateLimiter> m_rate_limiter;
+    std::unique_ptr<ClientAddressResolver> m_client_resolver;
     std::unique_ptr<sw::redis::Redis> m_redis_client;
+    std::unique_ptr<CircuitBreaker> m_redis_breaker;
+    std::unique_ptr<CacheWriter> m_cache_writer; // declared after m_redis_client so it is stopped first
+    CacheValueFormat m_cache_format = CacheValueFormat::JSON;
+    CacheTtlPolicy m_ttl_policy;
+    int m_cache_ttl_seconds;
+    int m_not_found_ttl_seconds;
+    HttpCachePolicy m_http_cache;
+
+    std::atomic<uint64_t> m_reserved_ip_requests{0};
+    bool m_binary_rate_limit = false;
+    std::atomic<uint64_t> m_not_modified_responses{0};
+
+    // separate concurrency budgets for the Redis and Postgres stages, so cache hits keep
+    // flowing while the database is saturated. Null when ADMISSION_CONTROL is off.
+    std::unique_ptr<AdmissionController> m_cache_admission;
+    std::unique_ptr<AdmissionController> m_db_admission;
+    int m_retry_after_seconds;
+
+    // per-stage timing of /ip-location: a Server-Timing header and a sampled trace ring (null
+    // when TRACE_SAMPLE_EVERY is 0)
+    RequestTiming::HeaderMode m_server_timing = RequestTiming::HeaderMode::ON_REQUEST;
+    std::unique_ptr<TraceRing> m_trace_ring;
+    uint32_t m_trace_sample_every = 0;
+
+    // 1 in N lookup keys written out for replay_traffic; null when CAPTURE_FILE is unset
+    std::unique_ptr<TrafficCapture> m_traffic_capture;
+    uint32_t m_capture_sample_every = 1;
+
+    // most frequent looked-up addresses and clients, in fixed memory; null when
+    // HEAVY_HITTERS_TOP_K is 0
+    std::unique_ptr<HeavyHitters> m_hot_addresses;
+    std::unique_ptr<HeavyHitters> m_hot_clients;
+
+    // In-memory copy of ip_locations, swapped as a whole when a new generation is loaded or
+    // lookups are rolled back: the newest generation, one replica per NUMA node (or a single
+    // one), the older generations kept as deltas against it, and the generation that answers
+    // lookups naming none.
+    struct LoadedDatasets {
+        std::vector<std::shared_ptr<const LocationDataset>> replicas;
+        std::shared_ptr<const DatasetHistory> history;
+        uint64_t serving = 0;
+
+        uint64_t newest() const { return history->newest(); }
+    };
+    bool m_in_memory_enabled = false;
+    bool m_shared_dataset = false;
+    Ipv4IndexType m_ipv4_index = Ipv4IndexType::DIR_24_8;
+    HugePageMode m_huge_pages = HugePageMode::OFF;
+    std::vector<NumaNode> m_numa_nodes; // empty unless replicas are enabled on a multi-node host
+    std::atomic<size_t> m_next_worker_node{0};
+    std::atomic<std::shared_ptr<const LoadedDatasets>> m_datasets;
+    // serializes the reloads and rollbacks that replace m_datasets; lookups never take it
+    std::mutex m_datasets_mutex;
+    size_t m_generations_kept = 1;
+    std::atomic<uint64_t> m_in_memory_lookups{0};
+    // /ip-ranges page sizes: the default and the most a request may ask for
+    static constexpr size_t DEFAULT_RANGES_LIMIT = 100;
+    size_t m_ranges_max_limit = 1000;
+    std::atomic<uint64_t> m_range_pages{0};
+
+    // coroutine request pipeline: cache and database round trips suspend on the reactor
+    // instead of holding a Crow worker thread. Null when REQUEST_PIPELINE=blocking.
+    std::unique_ptr<Reactor> m_reactor;
+    std::unique_ptr<AsyncDatabasePool> m_async_db_pool;
+    std::unique_ptr<sw::redis::AsyncRedis> m_async_redis;
+    std::atomic<uint64_t> m_async_in_flight{0};
+
+    // startup work done in the background after the constructor returns; members it sets
+    // are read by lookups only once m_readiness is ready
+    static constexpr std::chrono::milliseconds STARTUP_RETRY_INTERVAL{250};
+    Readiness m_readiness;
+    std::mutex m_startup_mutex;
+    std::condition_variable m_startup_cv;
+    std::atomic<bool> m_stopping{false};
+    std::thread m_startup;
+
+    // a lookup that has to go to Redis or Postgres; `ip` points into the request,
+    // `generation` is the dataset generation its cache headers name and `fields` the
+    // projection asked for
+    struct LocationLookup {
+        std::string_view ip;
+        IpAddress address;
+        uint64_t generation;
+        LocationJson::FieldMask fields;
+    };
     
-    std::string get_client_ip(const crow::request& req);
+    // the client's address prefix, from the peer address and trusted proxies' headers
+    ClientKey client_key(const crow::request& req) const;
+    // bodies rendered into the response's string, without building crow::json::wvalue trees
+    static crow::response location_response(std::string_view ip, const LocationRecordView& record,
+                                            LocationJson::FieldMask fields);
+    static crow::response not_found_response();
     crow::json::wvalue create_error_response(const std::string& error, const std::string& code = "INTERNAL_ERROR");
+    // false when the stage is at its limit; `permit` stays empty when admission control is off
+    static bool admit(AdmissionController* controller, std::optional<AdmissionController::Permit>& permit);
+    crow::response overloaded_response();
+    crow::response not_ready_response();
+    // 403 unless the request carries ADMIN_HEADER
+    std::optional<crow::response> reject_non_admin(const crow::request& req);
     
-    std::string get_from_cache(const std::string& ip);
-    void cache_result(const std::string& ip, const std::string& result, int ttl_seconds = 3600); // 1 hour default TTL
+    // answers what needs no I/O (validation, rate limiting, reserved ranges, the in-memory
+    // dataset); otherwise returns the lookup left for Redis and Postgres
+    std::variant<crow::response, LocationLookup> prepare_lookup(const crow::request& req, RequestTiming& timing);
+    // nullopt when the cached value cannot be used
+    std::optional<crow::response> cached_response(std::string_view ip, std::string cached, LocationJson::FieldMask fields);
+    // responds with a database answer and queues the cache fill, which always holds every field
+    crow::response database_response(std::string_view ip, const std::optional<LocationRecord>& record,
+                                     LocationJson::FieldMask fields);
+    crow::response lookup_blocking(const crow::request& req, RequestTiming& timing);
+    crow::response query_blocking(const LocationLookup& lookup, RequestTiming& timing);
+    // the address's record from Postgres; throws on connection and query errors
+    std::optional<LocationRecord> query_record(const IpAddress& address, RequestTiming& timing);
+    // the binary protocol's halves of a lookup, as prepare_lookup and query_blocking
+    bool prepare_binary(const BinaryProtocol::Request& request, std::string_view client, std::string& out);
+    void lookup_binary(const BinaryProtocol::Request& request, std::string& out);
+    // completes `res` on `connection_context`, the io_context of the request's connection
+    Task<void> lookup_async(LocationLookup lookup, RequestTiming timing, asio::io_context& connection_context,
+                            crow::response& res);
+    // enabled when the request asked for Server-Timing or is sampled for the trace ring
+    RequestTiming start_timing(const crow::request& req);
+    void finish_timing(const RequestTiming& timing, crow::response& response);
+    // Cache-Control and ETag for an answer of the given generation; errors are not stored
+    void set_cache_headers(crow::response& response, uint64_t generation) const;
+    // no-store on responses that set no cache headers of their own
+    void finish_cache_headers(crow::response& response) const;
+    crow::response not_modified_response(uint64_t generation) const;
+    Task<std::string> get_from_cache_async(std::string ip);
+
+    CacheKey cache_key(std::string_view ip) const;
+    std::string get_from_cache(std::string_view ip);
+    void cache_result(std::string_view ip, std::string result, int base_ttl_seconds);
+    // queues the cache entry for a database answer, in the configured format
+    void fill_cache(std::string_view ip, const std::optional<LocationRecord>& record);
+    void flush_cache_writes(const std::vector<CacheWrite>& batch);
+    bool redis_ping();
+    void start_up(ServiceConfig config);
+    // logs the time to ready when this makes the worker ready
+    void settle(Readiness::Component component, Readiness::State state);
+    // false when the handlers are being destroyed
+    bool wait_during_startup(std::chrono::milliseconds interval);
+    void reload_dataset();
+    // the replica of the newest generation this thread reads
+    const LocationDataset& local_dataset(const LoadedDatasets& datasets);
+    // `address` in a generation `datasets` holds
+    std::optional<LocationRecord> find_in_memory(const LoadedDatasets& datasets, uint64_t generation,
+                                                 const IpAddress& address);
 };
\ No newline at end of file
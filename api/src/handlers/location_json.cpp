@@ -0,0 +1,218 @@
+#include "location_json.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <utility>
+#include "../cache/cache_codec.h"
+
+namespace {
+
+template <typename String>
+void append_string(String& out, std::string_view value) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += HEX[(c >> 4) & 0xF];
+                    out += HEX[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+// every field follows "ip", or a range's bounds
+template <typename String>
+void append_key(String& out, std::string_view key) {
+    out += ",\"";
+    out += key;
+    out += "\":";
+}
+
+template <typename String>
+void append_optional_string(String& out, std::string_view key, const std::optional<std::string_view>& value) {
+    if (value) {
+        append_key(out, key);
+        append_string(out, *value);
+    }
+}
+
+template <typename String, LocationJson::FieldMask FIELDS>
+void write_fields(String& out, const LocationRecordView& record) {
+    if constexpr ((FIELDS & LocationJson::COUNTRY) != 0) {
+        append_optional_string(out, "country", record.country);
+    }
+    if constexpr ((FIELDS & LocationJson::CITY) != 0) {
+        append_optional_string(out, "city", record.city);
+    }
+    if constexpr ((FIELDS & LocationJson::REGION) != 0) {
+        append_optional_string(out, "region", record.region);
+    }
+    if constexpr ((FIELDS & LocationJson::LATITUDE) != 0) {
+        if (record.latitude) {
+            append_key(out, "latitude");
+            LocationJson::append_coordinate(out, *record.latitude);
+        }
+    }
+    if constexpr ((FIELDS & LocationJson::LONGITUDE) != 0) {
+        if (record.longitude) {
+            append_key(out, "longitude");
+            LocationJson::append_coordinate(out, *record.longitude);
+        }
+    }
+    if constexpr ((FIELDS & LocationJson::POSTAL_CODE) != 0) {
+        append_optional_string(out, "postal_code", record.postal_code);
+    }
+    if constexpr ((FIELDS & LocationJson::TIMEZONE) != 0) {
+        append_optional_string(out, "timezone", record.timezone);
+    }
+}
+
+template <typename String, LocationJson::FieldMask FIELDS>
+void write_location(String& out, std::string_view ip, const LocationRecordView& record) {
+    out += "{\"ip\":";
+    append_string(out, ip);
+    write_fields<String, FIELDS>(out, record);
+    out += '}';
+}
+
+template <typename String>
+using LocationWriter = void (*)(String&, std::string_view, const LocationRecordView&);
+template <typename String>
+using FieldsWriter = void (*)(String&, const LocationRecordView&);
+
+template <typename String, size_t... MASKS>
+constexpr std::array<LocationWriter<String>, sizeof...(MASKS)> make_writers(std::index_sequence<MASKS...>) {
+    return {&write_location<String, static_cast<LocationJson::FieldMask>(MASKS)>...};
+}
+
+template <typename String, size_t... MASKS>
+constexpr std::array<FieldsWriter<String>, sizeof...(MASKS)> make_fields_writers(std::index_sequence<MASKS...>) {
+    return {&write_fields<String, static_cast<LocationJson::FieldMask>(MASKS)>...};
+}
+
+// one writer per field mask and string type, instantiated at compile time
+template <typename String>
+constexpr auto LOCATION_WRITERS = make_writers<String>(std::make_index_sequence<LocationJson::ALL_FIELDS + 1>());
+template <typename String>
+constexpr auto FIELDS_WRITERS = make_fields_writers<String>(std::make_index_sequence<LocationJson::ALL_FIELDS + 1>());
+
+struct FieldName {
+    std::string_view name;
+    LocationJson::FieldMask mask;
+};
+
+constexpr std::array<FieldName, 8> FIELD_NAMES{{
+    {"ip", 0},
+    {"country", LocationJson::COUNTRY},
+    {"city", LocationJson::CITY},
+    {"region", LocationJson::REGION},
+    {"latitude", LocationJson::LATITUDE},
+    {"longitude", LocationJson::LONGITUDE},
+    {"postal_code", LocationJson::POSTAL_CODE},
+    {"timezone", LocationJson::TIMEZONE},
+}};
+
+} // namespace
+
+// Crow prints doubles with "%f" and drops trailing zeros, keeping one digit after the point
+template <typename String>
+void LocationJson::append_coordinate(String& out, float value) {
+    char digits[64];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), CacheCodec::widen_coordinate(value),
+                                   std::chars_format::fixed, 6);
+    if (ec != std::errc()) {
+        out += '0';
+        return;
+    }
+    std::string_view text(digits, static_cast<size_t>(end - digits));
+    size_t point = text.find('.');
+    if (point != std::string_view::npos) {
+        size_t last = text.find_last_not_of('0');
+        text = text.substr(0, std::max(last, point + 1) + 1);
+    }
+    out += text;
+}
+
+std::optional<LocationJson::FieldMask> LocationJson::parse_fields(std::string_view list) {
+    FieldMask fields = 0;
+    bool named = false;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view name = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        if (name.empty()) {
+            continue;
+        }
+        auto field = std::find_if(FIELD_NAMES.begin(), FIELD_NAMES.end(),
+                                  [&](const FieldName& entry) { return entry.name == name; });
+        if (field == FIELD_NAMES.end()) {
+            return std::nullopt;
+        }
+        fields |= field->mask;
+        named = true;
+    }
+    // "fields=" alone is every field; "fields=ip" is just the address
+    return named ? fields : ALL_FIELDS;
+}
+
+template <typename String>
+void LocationJson::append_location(String& out, std::string_view ip, const LocationRecordView& record,
+                                   FieldMask fields) {
+    LOCATION_WRITERS<String>[fields & ALL_FIELDS](out, ip, record);
+}
+
+template <typename String>
+void LocationJson::append_range(String& out, std::string_view start_ip, std::string_view end_ip,
+                                const LocationRecordView& record, FieldMask fields) {
+    out += "{\"start_ip\":";
+    append_string(out, start_ip);
+    out += ",\"end_ip\":";
+    append_string(out, end_ip);
+    FIELDS_WRITERS<String>[fields & ALL_FIELDS](out, record);
+    out += '}';
+}
+
+template <typename String>
+void LocationJson::append_string(String& out, std::string_view value) {
+    ::append_string(out, value);
+}
+
+template <typename String>
+void LocationJson::append_error(String& out, std::string_view error, std::string_view code, std::time_t timestamp) {
+    out += "{\"error\":";
+    append_string(out, error);
+    out += ",\"code\":";
+    append_string(out, code);
+    out += ",\"timestamp\":";
+    char digits[24];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), static_cast<long long>(timestamp)).ptr);
+    out += '}';
+}
+
+// a response body Crow takes over, and the bulk enricher's pmr strings
+template void LocationJson::append_location(std::string&, std::string_view, const LocationRecordView&, FieldMask);
+template void LocationJson::append_range(std::string&, std::string_view, std::string_view, const LocationRecordView&,
+                                         FieldMask);
+template void LocationJson::append_string(std::string&, std::string_view);
+template void LocationJson::append_coordinate(std::string&, float);
+template void LocationJson::append_error(std::string&, std::string_view, std::string_view, std::time_t);
+
+template void LocationJson::append_location(std::pmr::string&, std::string_view, const LocationRecordView&, FieldMask);
+template void LocationJson::append_range(std::pmr::string&, std::string_view, std::string_view, const LocationRecordView&,
+                                         FieldMask);
+template void LocationJson::append_string(std::pmr::string&, std::string_view);
+template void LocationJson::append_coordinate(std::pmr::string&, float);
+template void LocationJson::append_error(std::pmr::string&, std::string_view, std::string_view, std::time_t);
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "../models/location_record.h"
+
+// Renders /ip-location and /ip-ranges bodies straight into a string, with the escaping and
+// number format of crow::json::wvalue but without building a tree of nodes. The string is a
+// std::string, such as the body a crow::response takes over, or a std::pmr::string; those
+// two are instantiated.
+class LocationJson {
+public:
+    // the location fields a body carries (the `fields=` parameter); "ip" is always there
+    using FieldMask = uint8_t;
+    static constexpr FieldMask COUNTRY = 1 << 0;
+    static constexpr FieldMask CITY = 1 << 1;
+    static constexpr FieldMask REGION = 1 << 2;
+    static constexpr FieldMask LATITUDE = 1 << 3;
+    static constexpr FieldMask LONGITUDE = 1 << 4;
+    static constexpr FieldMask POSTAL_CODE = 1 << 5;
+    static constexpr FieldMask TIMEZONE = 1 << 6;
+    static constexpr FieldMask ALL_FIELDS = (1 << 7) - 1;
+
+    // "country,city"; an empty list means every field, nullopt an unknown field name
+    static std::optional<FieldMask> parse_fields(std::string_view list);
+
+    // {"ip":...,"country":...,...}; absent fields are left out. Each mask has its own writer,
+    // picked from a table, so a narrow body costs no per-field test of the mask.
+    template <typename String>
+    static void append_location(String& out, std::string_view ip, const LocationRecordView& record,
+                                FieldMask fields = ALL_FIELDS);
+    // {"start_ip":...,"end_ip":...,"country":...,...}, an /ip-ranges entry
+    template <typename String>
+    static void append_range(String& out, std::string_view start_ip, std::string_view end_ip,
+                             const LocationRecordView& record, FieldMask fields = ALL_FIELDS);
+    // a quoted, escaped JSON string
+    template <typename String>
+    static void append_string(String& out, std::string_view value);
+    // a latitude or longitude as a body shows it, for other formats that should match
+    template <typename String>
+    static void append_coordinate(String& out, float value);
+    // {"error":...,"code":...,"timestamp":...}, as ApiHandlers::create_error_response
+    template <typename String>
+    static void append_error(String& out, std::string_view error, std::string_view code, std::time_t timestamp);
+};
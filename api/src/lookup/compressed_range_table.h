@@ -0,0 +1,257 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "range_table.h"
+
+// Read-only, delta-encoded form of a RangeTable for large datasets. Ranges are packed into
+// 64-byte blocks, one cache line each, and a sampled top-level index keeps the first address
+// of every block. A lookup binary searches the samples and then decodes a single block.
+// Each block's first ordinal is kept as well, so a range can be found by its position.
+//
+// Within a block each range is stored as the gap since the previous range, its size and its
+// record id. Gaps and sizes are written as a trailing-zero count followed by the remaining
+// bits as a varint, so the gap between adjacent ranges costs one byte and a prefix-aligned
+// size (a /48 is 2^80 addresses) costs two. Record ids are plain varints.
+template <typename Key>
+class CompressedRangeTable {
+public:
+    static constexpr size_t BLOCK_BYTES = 64;
+
+    void build(const RangeTable<Key>& table) {
+        m_block_firsts.clear();
+        m_block_ordinals.clear();
+        m_blocks.clear();
+        m_size = table.size();
+
+        const auto& firsts = table.firsts();
+        const auto& lasts = table.lasts();
+        const auto& ids = table.ids();
+
+        Block* block = nullptr;
+        size_t used = 0;
+        uint8_t buffer[BLOCK_BYTES];
+
+        for (size_t i = 0; i < firsts.size(); ++i) {
+            // first try to append to the current block, gap included
+            size_t length = 0;
+            if (block) {
+                length = encode_key(buffer, firsts[i] - (lasts[i - 1] + 1));
+                length += encode_range(buffer + length, firsts[i], lasts[i], ids[i]);
+            }
+            if (!block || used + length > BLOCK_BYTES) {
+                // the first range of a block starts at the block's sample, so it has no gap
+                m_blocks.emplace_back();
+                m_block_firsts.push_back(firsts[i]);
+                m_block_ordinals.push_back(static_cast<uint32_t>(i));
+                block = &m_blocks.back();
+                used = 1;
+                length = encode_range(buffer, firsts[i], lasts[i], ids[i]);
+            }
+            std::copy(buffer, buffer + length, block->bytes + used);
+            used += length;
+            ++block->bytes[0];
+        }
+        m_blocks.shrink_to_fit();
+        m_block_firsts.shrink_to_fit();
+        m_block_ordinals.shrink_to_fit();
+    }
+
+    RecordId find(Key key) const {
+        auto it = std::upper_bound(m_block_firsts.begin(), m_block_firsts.end(), key);
+        if (it == m_block_firsts.begin()) {
+            return NO_RECORD;
+        }
+        size_t block_index = static_cast<size_t>(it - m_block_firsts.begin()) - 1;
+        const uint8_t* p = m_blocks[block_index].bytes;
+        const uint8_t count = *p++;
+
+        Key first = m_block_firsts[block_index];
+        for (uint8_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                first += decode_key(p);
+                if (key < first) {
+                    return NO_RECORD; // in the gap before this range
+                }
+            }
+            // a size of zero encodes the full address space
+            Key last = first + decode_key(p) - 1;
+            RecordId id = static_cast<RecordId>(decode_varint(p));
+            if (key <= last) {
+                return id;
+            }
+            first = last + 1;
+        }
+        return NO_RECORD;
+    }
+
+    // Decodes the ranges in address order, for walking a whole table (e.g. to diff two) or
+    // part of it from a seek.
+    class Reader {
+    public:
+        explicit Reader(const CompressedRangeTable& table) : m_table(&table) {}
+
+        // false once every range has been read
+        bool next(typename RangeTable<Key>::Range& range) {
+            while (m_left == 0) {
+                if (m_block == m_table->m_blocks.size()) {
+                    return false;
+                }
+                load_block(m_block);
+            }
+            if (!m_first_in_block) {
+                m_next_first += decode_key(m_p);
+            }
+            m_first_in_block = false;
+            range.first = m_next_first;
+            range.last = m_next_first + decode_key(m_p) - 1;
+            range.id = static_cast<RecordId>(decode_varint(m_p));
+            m_next_first = range.last + 1;
+            --m_left;
+            ++m_ordinal;
+            return true;
+        }
+
+        // positions next() at the first range ending at or after `key`
+        void seek(Key key) {
+            const auto& firsts = m_table->m_block_firsts;
+            if (firsts.empty()) {
+                return;
+            }
+            auto it = std::upper_bound(firsts.begin(), firsts.end(), key);
+            load_block(it == firsts.begin() ? 0 : static_cast<size_t>(it - firsts.begin()) - 1);
+            // at most the rest of this block is read past: a key in the gap after its last
+            // range belongs to the next block's first range
+            while (true) {
+                Reader before = *this;
+                typename RangeTable<Key>::Range range{};
+                if (!next(range)) {
+                    return;
+                }
+                if (range.last >= key) {
+                    *this = before;
+                    return;
+                }
+            }
+        }
+
+        // positions next() at the range with the given ordinal, its position in the table
+        void seek_ordinal(size_t ordinal) {
+            if (ordinal < m_ordinal || ordinal - m_ordinal >= m_left) {
+                if (ordinal >= m_table->m_size) {
+                    m_block = m_table->m_blocks.size();
+                    m_left = 0;
+                    m_ordinal = m_table->m_size;
+                    return;
+                }
+                auto it = std::upper_bound(m_table->m_block_ordinals.begin(), m_table->m_block_ordinals.end(), ordinal);
+                load_block(static_cast<size_t>(it - m_table->m_block_ordinals.begin()) - 1);
+            }
+            typename RangeTable<Key>::Range range{};
+            while (m_ordinal < ordinal) {
+                if (!next(range)) {
+                    break;
+                }
+            }
+        }
+
+        // the ordinal of the range next() reads
+        size_t ordinal() const { return m_ordinal; }
+
+    private:
+        void load_block(size_t block) {
+            m_p = m_table->m_blocks[block].bytes;
+            m_left = *m_p++;
+            m_next_first = m_table->m_block_firsts[block];
+            m_first_in_block = true;
+            m_ordinal = m_table->m_block_ordinals[block];
+            m_block = block + 1;
+        }
+
+        const CompressedRangeTable* m_table;
+        size_t m_block = 0; // the next block to load
+        const uint8_t* m_p = nullptr;
+        uint8_t m_left = 0;
+        bool m_first_in_block = false;
+        Key m_next_first = 0;
+        size_t m_ordinal = 0;
+    };
+
+    size_t size() const { return m_size; }
+    size_t block_count() const { return m_blocks.size(); }
+    size_t memory_bytes() const {
+        return m_blocks.capacity() * sizeof(Block) + m_block_firsts.capacity() * sizeof(Key) +
+               m_block_ordinals.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    struct alignas(BLOCK_BYTES) Block {
+        // bytes[0] is the number of ranges in the block
+        uint8_t bytes[BLOCK_BYTES] = {};
+    };
+
+    static constexpr uint8_t ZERO_KEY = 0xFF;
+
+    static int trailing_zeros(Key value) {
+        if constexpr (sizeof(Key) > sizeof(uint64_t)) {
+            auto low = static_cast<uint64_t>(value);
+            return low != 0 ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<uint64_t>(value >> 64));
+        } else {
+            return __builtin_ctzll(static_cast<uint64_t>(value));
+        }
+    }
+
+    static size_t encode_varint(uint8_t* out, Key value) {
+        size_t length = 0;
+        while (value >= 0x80) {
+            out[length++] = static_cast<uint8_t>(value) | 0x80;
+            value >>= 7;
+        }
+        out[length++] = static_cast<uint8_t>(value);
+        return length;
+    }
+
+    static Key decode_varint(const uint8_t*& p) {
+        Key value = 0;
+        int shift = 0;
+        while (*p & 0x80) {
+            value |= static_cast<Key>(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        value |= static_cast<Key>(*p++) << shift;
+        return value;
+    }
+
+    // trailing zero count, then the bits above the lowest set bit (which is implied)
+    static size_t encode_key(uint8_t* out, Key value) {
+        if (value == 0) {
+            out[0] = ZERO_KEY;
+            return 1;
+        }
+        int zeros = trailing_zeros(value);
+        out[0] = static_cast<uint8_t>(zeros);
+        Key rest = value >> zeros >> 1;
+        return 1 + encode_varint(out + 1, rest);
+    }
+
+    static Key decode_key(const uint8_t*& p) {
+        uint8_t zeros = *p++;
+        if (zeros == ZERO_KEY) {
+            return 0;
+        }
+        Key rest = decode_varint(p);
+        return ((rest << 1) | 1) << zeros;
+    }
+
+    static size_t encode_range(uint8_t* out, Key first, Key last, RecordId id) {
+        size_t length = encode_key(out, last - first + 1);
+        return length + encode_varint(out + length, id);
+    }
+
+    PlacedVector<Key> m_block_firsts;
+    // the ordinal of each block's first range, for seeking by ordinal
+    PlacedVector<uint32_t> m_block_ordinals;
+    PlacedVector<Block> m_blocks;
+    size_t m_size = 0;
+};
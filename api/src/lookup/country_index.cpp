@@ -0,0 +1,96 @@
+#include "country_index.h"
+#include <algorithm>
+
+namespace {
+
+// counting sort of the table's ordinals by the country of their record
+template <typename Key>
+void index_ranges(const RangeTable<Key>& table, const std::vector<uint32_t>& record_countries, size_t country_count,
+                  uint32_t no_country, PlacedVector<uint32_t>& offsets, PlacedVector<uint32_t>& ordinals) {
+    const auto& ids = table.ids();
+    offsets.assign(country_count + 1, 0);
+    for (RecordId id : ids) {
+        if (record_countries[id] != no_country) {
+            ++offsets[record_countries[id] + 1];
+        }
+    }
+    for (size_t i = 0; i < country_count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    ordinals.assign(offsets.back(), 0);
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t ordinal = 0; ordinal < ids.size(); ++ordinal) {
+        uint32_t country = record_countries[ids[ordinal]];
+        if (country != no_country) {
+            ordinals[next[country]++] = static_cast<uint32_t>(ordinal);
+        }
+    }
+}
+
+} // namespace
+
+void CountryIndex::build(const std::vector<LocationRecord>& records, const RangeTable<uint32_t>& ipv4,
+                         const RangeTable<uint128_t>& ipv6) {
+    std::vector<std::string_view> names;
+    for (const auto& record : records) {
+        if (record.country) {
+            names.push_back(*record.country);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    m_names.clear();
+    m_name_offsets.assign(1, 0);
+    for (std::string_view name : names) {
+        m_names.insert(m_names.end(), name.begin(), name.end());
+        m_name_offsets.push_back(static_cast<uint32_t>(m_names.size()));
+    }
+
+    std::vector<uint32_t> record_countries(records.size(), NO_COUNTRY);
+    for (size_t id = 0; id < records.size(); ++id) {
+        if (records[id].country) {
+            auto it = std::lower_bound(names.begin(), names.end(), std::string_view(*records[id].country));
+            record_countries[id] = static_cast<uint32_t>(it - names.begin());
+        }
+    }
+
+    index_ranges(ipv4, record_countries, names.size(), NO_COUNTRY, m_ipv4_offsets, m_ipv4_ordinals);
+    index_ranges(ipv6, record_countries, names.size(), NO_COUNTRY, m_ipv6_offsets, m_ipv6_ordinals);
+}
+
+std::span<const uint32_t> CountryIndex::ipv4_ranges(std::string_view country) const {
+    return ranges(m_ipv4_offsets, m_ipv4_ordinals, find(country));
+}
+
+std::span<const uint32_t> CountryIndex::ipv6_ranges(std::string_view country) const {
+    return ranges(m_ipv6_offsets, m_ipv6_ordinals, find(country));
+}
+
+size_t CountryIndex::memory_bytes() const {
+    return m_names.capacity() + (m_name_offsets.capacity() + m_ipv4_offsets.capacity() + m_ipv4_ordinals.capacity() +
+                                 m_ipv6_offsets.capacity() + m_ipv6_ordinals.capacity()) * sizeof(uint32_t);
+}
+
+uint32_t CountryIndex::find(std::string_view country) const {
+    uint32_t low = 0;
+    uint32_t high = static_cast<uint32_t>(country_count());
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (name(middle) < country) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < country_count() && name(low) == country ? low : NO_COUNTRY;
+}
+
+std::span<const uint32_t> CountryIndex::ranges(const PlacedVector<uint32_t>& offsets, const PlacedVector<uint32_t>& ordinals,
+                                               uint32_t country) {
+    if (country == NO_COUNTRY) {
+        return {};
+    }
+    return std::span<const uint32_t>(ordinals.data() + offsets[country], offsets[country + 1] - offsets[country]);
+}
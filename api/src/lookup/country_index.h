@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "../models/location_record.h"
+#include "../utils/ip_address.h"
+#include "memory_placement.h"
+#include "range_table.h"
+
+// Secondary index of a dataset's ranges by country, for listing the ranges of one country
+// without walking the whole table. Ranges are referred to by ordinal, their position in the
+// family's range table, and each country's ordinals are kept ascending so they come out in
+// address order. The countries' lists are stored back to back in one array per family, with
+// an offsets array marking where each starts, so the index costs 4 bytes per range.
+//
+// Ranges whose location has no country are not indexed.
+class CountryIndex {
+public:
+    // `records` are the dataset's records by id; the tables are the ones the ordinals refer to
+    void build(const std::vector<LocationRecord>& records, const RangeTable<uint32_t>& ipv4,
+               const RangeTable<uint128_t>& ipv6);
+
+    // the ordinals of the country's ranges, ascending; empty for an unknown country
+    std::span<const uint32_t> ipv4_ranges(std::string_view country) const;
+    std::span<const uint32_t> ipv6_ranges(std::string_view country) const;
+
+    size_t country_count() const { return m_name_offsets.empty() ? 0 : m_name_offsets.size() - 1; }
+    size_t memory_bytes() const;
+
+private:
+    static constexpr uint32_t NO_COUNTRY = UINT32_MAX;
+
+    // the country's position in the sorted names, or NO_COUNTRY
+    uint32_t find(std::string_view country) const;
+    std::string_view name(uint32_t country) const {
+        return std::string_view(m_names.data() + m_name_offsets[country], m_name_offsets[country + 1] - m_name_offsets[country]);
+    }
+    static std::span<const uint32_t> ranges(const PlacedVector<uint32_t>& offsets, const PlacedVector<uint32_t>& ordinals,
+                                            uint32_t country);
+
+    // country i is m_names[m_name_offsets[i], m_name_offsets[i + 1]), sorted
+    PlacedVector<char> m_names;
+    PlacedVector<uint32_t> m_name_offsets;
+    // country i's ranges are m_ipv4_ordinals[m_ipv4_offsets[i], m_ipv4_offsets[i + 1])
+    PlacedVector<uint32_t> m_ipv4_offsets;
+    PlacedVector<uint32_t> m_ipv4_ordinals;
+    PlacedVector<uint32_t> m_ipv6_offsets;
+    PlacedVector<uint32_t> m_ipv6_ordinals;
+};
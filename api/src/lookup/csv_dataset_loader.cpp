@@ -0,0 +1,130 @@
+#include "csv_dataset_loader.h"
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+enum Column { START_IP, END_IP, NETWORK_IP, CITY, REGION, COUNTRY, LATITUDE, LONGITUDE, POSTAL_CODE, TIMEZONE, COLUMNS };
+
+struct Field {
+    std::string text;
+    bool quoted = false;
+};
+
+// reads one record, which may span lines inside quotes; false at the end of the input
+bool read_record(std::istream& in, std::vector<Field>& fields) {
+    fields.clear();
+    int c = in.get();
+    if (c == std::char_traits<char>::eof()) {
+        return false;
+    }
+
+    fields.emplace_back();
+    bool in_quotes = false;
+    for (; c != std::char_traits<char>::eof(); c = in.get()) {
+        Field& field = fields.back();
+        if (in_quotes) {
+            if (c != '"') {
+                field.text.push_back(static_cast<char>(c));
+            } else if (in.peek() == '"') {
+                field.text.push_back('"');
+                in.get();
+            } else {
+                in_quotes = false;
+            }
+        } else if (c == '"') {
+            in_quotes = true;
+            field.quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else if (c == '\n') {
+            break;
+        } else if (c != '\r') {
+            field.text.push_back(static_cast<char>(c));
+        }
+    }
+    return true;
+}
+
+std::optional<std::string> text_column(Field& field) {
+    if (field.text.empty() && !field.quoted) {
+        return std::nullopt;
+    }
+    return std::move(field.text);
+}
+
+// false for text that is not a number; NULL is fine
+bool float_column(const Field& field, std::optional<float>& value) {
+    if (field.text.empty() && !field.quoted) {
+        value = std::nullopt;
+        return true;
+    }
+    char* end = nullptr;
+    errno = 0;
+    float parsed = std::strtof(field.text.c_str(), &end);
+    if (end == field.text.c_str() || *end != '\0' || errno == ERANGE) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+} // namespace
+
+CsvDatasetLoader::Result CsvDatasetLoader::load(const std::string& path, Ipv4IndexType ipv4_index) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open dataset file " + path);
+    }
+    Result result = load(in, ipv4_index);
+    if (in.bad()) {
+        throw std::runtime_error("Cannot read dataset file " + path);
+    }
+    return result;
+}
+
+CsvDatasetLoader::Result CsvDatasetLoader::load(std::istream& in, Ipv4IndexType ipv4_index) {
+    Result result;
+    LocationDataset::Builder builder;
+    std::vector<Field> fields;
+
+    // the header line, which the updater skips the same way
+    read_record(in, fields);
+    while (read_record(in, fields)) {
+        if (fields.size() == 1 && fields[0].text.empty() && !fields[0].quoted) {
+            continue; // blank line
+        }
+        ++result.rows;
+        if (fields.size() != COLUMNS) {
+            ++result.skipped;
+            continue;
+        }
+
+        auto first = IpAddress::parse(fields[START_IP].text);
+        auto last = IpAddress::parse(fields[END_IP].text);
+        LocationRecord record;
+        if (!first || !last || first->family() != last->family()
+            || !float_column(fields[LATITUDE], record.latitude) || !float_column(fields[LONGITUDE], record.longitude)) {
+            ++result.skipped;
+            continue;
+        }
+        record.country = text_column(fields[COUNTRY]);
+        record.city = text_column(fields[CITY]);
+        record.region = text_column(fields[REGION]);
+        record.postal_code = text_column(fields[POSTAL_CODE]);
+        record.timezone = text_column(fields[TIMEZONE]);
+
+        if (first->is_v4()) {
+            builder.add_ipv4(first->v4(), last->v4(), record);
+        } else {
+            builder.add_ipv6(first->v6(), last->v6(), record);
+        }
+    }
+
+    result.dataset = builder.build(ipv4_index);
+    return result;
+}
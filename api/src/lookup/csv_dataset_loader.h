@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include "location_dataset.h"
+
+// Builds a LocationDataset from a CSV file in the format the data updater imports: a header
+// line, then start_ip, end_ip, network_ip, city, region, country, latitude, longitude,
+// postal_code, timezone. As with Postgres' COPY ... CSV, an unquoted empty field is NULL and a
+// quoted one ("") is an empty string. Rows whose bounds or coordinates do not parse are
+// skipped and counted.
+class CsvDatasetLoader {
+public:
+    struct Result {
+        std::shared_ptr<const LocationDataset> dataset;
+        size_t rows = 0;
+        size_t skipped = 0;
+    };
+
+    // throws std::runtime_error if the file cannot be opened or read
+    static Result load(const std::string& path, Ipv4IndexType ipv4_index);
+    static Result load(std::istream& in, Ipv4IndexType ipv4_index);
+};
@@ -0,0 +1,222 @@
+#include "dataset_history.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+// reads a RangeTable the way CompressedRangeTable::Reader reads a compressed one
+class RangeTableReader {
+public:
+    explicit RangeTableReader(const RangeTable<uint32_t>& table) : m_table(table) {}
+
+    bool next(RangeTable<uint32_t>::Range& range) {
+        if (m_next == m_table.size()) {
+            return false;
+        }
+        range = {m_table.firsts()[m_next], m_table.lasts()[m_next], m_table.ids()[m_next]};
+        ++m_next;
+        return true;
+    }
+
+private:
+    const RangeTable<uint32_t>& m_table;
+    size_t m_next = 0;
+};
+
+// Walks two sorted, disjoint range lists side by side and calls emit(first, last, older_id)
+// for the maximal runs where the older list's record differs from the newer one's, as told by
+// same(older_id, newer_id). older_id is NO_RECORD where the older list has no range.
+template <typename Key, typename OlderReader, typename NewerReader, typename Same, typename Emit>
+void diff_ranges(OlderReader older, NewerReader newer, Same same, Emit emit) {
+    constexpr Key MAX_KEY = ~Key{0};
+    typename RangeTable<Key>::Range older_range{};
+    typename RangeTable<Key>::Range newer_range{};
+    bool has_older = older.next(older_range);
+    bool has_newer = newer.next(newer_range);
+
+    bool pending = false;
+    typename RangeTable<Key>::Range run{};
+    Key position = 0;
+    while (true) {
+        while (has_older && older_range.last < position) {
+            has_older = older.next(older_range);
+        }
+        while (has_newer && newer_range.last < position) {
+            has_newer = newer.next(newer_range);
+        }
+
+        // both sides answer the same from `position` through `end`
+        Key end = MAX_KEY;
+        RecordId older_id = NO_RECORD;
+        RecordId newer_id = NO_RECORD;
+        if (has_older) {
+            if (older_range.first <= position) {
+                older_id = older_range.id;
+                end = std::min(end, older_range.last);
+            } else {
+                end = std::min(end, static_cast<Key>(older_range.first - 1));
+            }
+        }
+        if (has_newer) {
+            if (newer_range.first <= position) {
+                newer_id = newer_range.id;
+                end = std::min(end, newer_range.last);
+            } else {
+                end = std::min(end, static_cast<Key>(newer_range.first - 1));
+            }
+        }
+
+        if (!same(older_id, newer_id)) {
+            if (pending && run.id == older_id && run.last + 1 == position) {
+                run.last = end;
+            } else {
+                if (pending) {
+                    emit(run.first, run.last, run.id);
+                }
+                run = {position, end, older_id};
+                pending = true;
+            }
+        }
+        if (end == MAX_KEY) {
+            break;
+        }
+        position = end + 1;
+    }
+    if (pending) {
+        emit(run.first, run.last, run.id);
+    }
+}
+
+} // namespace
+
+std::shared_ptr<const DatasetHistory> DatasetHistory::advance(const LocationDataset& previous, uint64_t generation,
+                                                              const LocationDataset& next, size_t keep,
+                                                              uint64_t pinned) const {
+    if (generation != 0 && generation == m_newest) {
+        return std::make_shared<const DatasetHistory>(*this);
+    }
+    auto history = std::make_shared<DatasetHistory>(generation);
+    if (generation == 0 || m_newest == 0) {
+        return history;
+    }
+
+    size_t deltas = keep > 1 ? keep - 1 : 0;
+    if (pinned == m_newest) {
+        deltas = std::max<size_t>(deltas, 1);
+    }
+    for (size_t i = 0; i < m_deltas.size(); ++i) {
+        if (m_deltas[i]->generation == pinned) {
+            deltas = std::max(deltas, i + 2);
+        }
+    }
+    if (deltas == 0) {
+        return history;
+    }
+
+    history->m_deltas.push_back(diff(m_newest, previous, next));
+    for (size_t i = 0; i + 1 < deltas && i < m_deltas.size(); ++i) {
+        history->m_deltas.push_back(m_deltas[i]);
+    }
+    return history;
+}
+
+bool DatasetHistory::contains(uint64_t generation) const {
+    return generation == m_newest ||
+           std::any_of(m_deltas.begin(), m_deltas.end(), [&](const auto& delta) { return delta->generation == generation; });
+}
+
+std::optional<LocationRecord> DatasetHistory::find(uint64_t generation, const IpAddress& address,
+                                                   const LocationDataset& newest) const {
+    IpAddress key = address.unmapped();
+    if (generation != m_newest) {
+        size_t depth = 0;
+        while (depth + 1 < m_deltas.size() && m_deltas[depth]->generation != generation) {
+            ++depth;
+        }
+        // from the generation asked for towards the newest
+        for (size_t i = depth + 1; i-- > 0;) {
+            const Delta& delta = *m_deltas[i];
+            RecordId id = key.is_v4() ? delta.ipv4.find(key.v4()) : delta.ipv6.find(key.v6());
+            if (id == ABSENT) {
+                return std::nullopt;
+            }
+            if (id != NO_RECORD) {
+                return delta.records.get(id);
+            }
+        }
+    }
+    return newest.find(key);
+}
+
+std::vector<DatasetHistory::Generation> DatasetHistory::generations() const {
+    std::vector<Generation> generations;
+    generations.push_back({m_newest});
+    for (const auto& delta : m_deltas) {
+        generations.push_back({delta->generation, delta->ipv4.size(), delta->ipv6.size(), delta->records.size(),
+                               delta->memory_bytes()});
+    }
+    return generations;
+}
+
+size_t DatasetHistory::memory_bytes() const {
+    size_t bytes = 0;
+    for (const auto& delta : m_deltas) {
+        bytes += delta->memory_bytes();
+    }
+    return bytes;
+}
+
+std::shared_ptr<const DatasetHistory::Delta> DatasetHistory::diff(uint64_t generation, const LocationDataset& older,
+                                                                  const LocationDataset& newer) {
+    // record ids are per dataset, so the two are matched by value
+    std::unordered_map<LocationRecord, RecordId, LocationRecordHash> newer_ids;
+    newer_ids.reserve(newer.record_count());
+    for (size_t id = 0; id < newer.record_count(); ++id) {
+        newer_ids.emplace(newer.record(static_cast<RecordId>(id)), static_cast<RecordId>(id));
+    }
+    std::vector<RecordId> older_to_newer(older.record_count(), NO_RECORD);
+    for (size_t id = 0; id < older.record_count(); ++id) {
+        auto it = newer_ids.find(older.record(static_cast<RecordId>(id)));
+        if (it != newer_ids.end()) {
+            older_to_newer[id] = it->second;
+        }
+    }
+    newer_ids.clear();
+    auto same = [&](RecordId older_id, RecordId newer_id) {
+        if (older_id == NO_RECORD || newer_id == NO_RECORD) {
+            return older_id == newer_id;
+        }
+        return older_to_newer[older_id] == newer_id;
+    };
+
+    // only the older records the diff maps to are kept
+    std::vector<LocationRecord> records;
+    std::unordered_map<RecordId, RecordId> delta_ids;
+    auto delta_id = [&](RecordId older_id) -> RecordId {
+        if (older_id == NO_RECORD) {
+            return ABSENT;
+        }
+        auto [it, inserted] = delta_ids.try_emplace(older_id, static_cast<RecordId>(records.size()));
+        if (inserted) {
+            records.push_back(older.record(older_id));
+        }
+        return it->second;
+    };
+
+    auto delta = std::make_shared<Delta>();
+    delta->generation = generation;
+
+    std::vector<RangeTable<uint32_t>::Range> ipv4;
+    diff_ranges<uint32_t>(RangeTableReader(older.ipv4_table()), RangeTableReader(newer.ipv4_table()), same,
+                          [&](uint32_t first, uint32_t last, RecordId id) { ipv4.push_back({first, last, delta_id(id)}); });
+    delta->ipv4.build(ipv4);
+
+    std::vector<RangeTable<uint128_t>::Range> ipv6;
+    diff_ranges<uint128_t>(CompressedRangeTable<uint128_t>::Reader(older.ipv6_table()),
+                           CompressedRangeTable<uint128_t>::Reader(newer.ipv6_table()), same,
+                           [&](uint128_t first, uint128_t last, RecordId id) { ipv6.push_back({first, last, delta_id(id)}); });
+    delta->ipv6.build(ipv6);
+
+    delta->records.build(records);
+    return delta;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "../models/location_record.h"
+#include "../utils/ip_address.h"
+#include "location_dataset.h"
+#include "range_table.h"
+#include "record_store.h"
+
+// The generation ids of the newest dataset and of the older ones kept with it, for lookups
+// pinned to a generation and for rolling back a bad feed.
+//
+// Only the newest generation is a full LocationDataset, and it is not held here: callers pass
+// it in, so it can be a NUMA replica. Each older generation is a reverse delta, the address
+// ranges where its answer differs from the next newer generation's and the records they map
+// to. A lookup in an older generation walks the deltas from it towards the newest and the
+// first one covering the address answers; an address none covers is answered by the newest
+// dataset. Every generation therefore shares the newest one's range tables, index and string
+// dictionary, and memory grows with the size of the feeds' diffs rather than with their
+// number.
+//
+// A history is immutable; advance() returns a new one that shares the deltas it keeps.
+class DatasetHistory {
+public:
+    // a history of just the newest generation; 0 means the database records none
+    explicit DatasetHistory(uint64_t newest) : m_newest(newest) {}
+
+    uint64_t newest() const { return m_newest; }
+
+    // The history once `next`, of generation `generation`, replaces `previous`, the dataset of
+    // this history's newest generation. `previous` is kept as a delta against `next`, and
+    // older deltas are dropped beyond `keep` generations in all, except that `pinned` and
+    // every generation newer than it are kept. Reloading the newest generation keeps the
+    // history as it is; an unrecorded generation (0) on either side drops it, since its
+    // generations could not be told apart.
+    std::shared_ptr<const DatasetHistory> advance(const LocationDataset& previous, uint64_t generation,
+                                                  const LocationDataset& next, size_t keep,
+                                                  uint64_t pinned = 0) const;
+
+    // the newest generation or a kept older one
+    bool contains(uint64_t generation) const;
+
+    // the answer of `generation`, which must be contained; `newest` is the dataset of the
+    // newest generation
+    std::optional<LocationRecord> find(uint64_t generation, const IpAddress& address,
+                                       const LocationDataset& newest) const;
+
+    struct Generation {
+        uint64_t generation;
+        // what the delta holds; all 0 for the newest generation
+        size_t ipv4_ranges = 0;
+        size_t ipv6_ranges = 0;
+        size_t records = 0;
+        size_t memory_bytes = 0;
+    };
+    // newest first
+    std::vector<Generation> generations() const;
+    // bytes held by the deltas of the older generations
+    size_t memory_bytes() const;
+
+private:
+    // marks a delta range where the older generation had no location
+    static constexpr RecordId ABSENT = NO_RECORD - 1;
+
+    struct Delta {
+        uint64_t generation;
+        RangeTable<uint32_t> ipv4;
+        RangeTable<uint128_t> ipv6;
+        RecordStore records;
+
+        size_t memory_bytes() const { return ipv4.memory_bytes() + ipv6.memory_bytes() + records.memory_bytes(); }
+    };
+
+    // where `older` answers differently from `newer`
+    static std::shared_ptr<const Delta> diff(uint64_t generation, const LocationDataset& older,
+                                             const LocationDataset& newer);
+
+    uint64_t m_newest;
+    std::vector<std::shared_ptr<const Delta>> m_deltas; // newest first
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "memory_placement.h"
+
+using RecordId = uint32_t;
+inline constexpr RecordId NO_RECORD = 0x7FFFFFFF;
+
+// Direct-indexed IPv4 table in the style of DIR-24-8. The first level is indexed by the top
+// FirstLevelBits of the address and holds either a record id or, with the high bit set, the
+// number of a chunk of 2^ChunkBits entries indexed by the next bits of the address, which in
+// turn may point to a deeper chunk. A lookup is a fixed number of array reads with no
+// comparisons against range bounds.
+//
+// DirIndex<24, 8> costs a fixed 64 MB first level plus 1 KB per /24 that is split between
+// ranges, and answers in at most two reads. DirIndex<16, 8> has a 256 KB first level that
+// stays cache resident and adds 1 KB per split /16 and per split /24, at the cost of a third
+// read for addresses in split /24s.
+template <int FirstLevelBits, int ChunkBits>
+class DirIndex {
+    static_assert(FirstLevelBits >= 8 && FirstLevelBits <= 24, "unsupported first level width");
+    static_assert(ChunkBits > 0 && (32 - FirstLevelBits) % ChunkBits == 0, "chunks must tile the remaining bits");
+
+public:
+    static constexpr int LEVELS = 1 + (32 - FirstLevelBits) / ChunkBits;
+    static constexpr uint32_t CHUNK_SIZE = 1u << ChunkBits;
+    static constexpr uint32_t CHUNK_MASK = CHUNK_SIZE - 1;
+    static constexpr uint32_t CHUNK_FLAG = 0x80000000u;
+
+    // ranges must be sorted by first address and disjoint
+    void build(const PlacedVector<uint32_t>& firsts, const PlacedVector<uint32_t>& lasts, const PlacedVector<RecordId>& ids) {
+        m_first_level.assign(size_t{1} << FirstLevelBits, NO_RECORD);
+        m_chunks.clear();
+
+        for (size_t i = 0; i < firsts.size(); ++i) {
+            fill(0, 0, firsts[i], lasts[i], ids[i]);
+        }
+        m_chunks.shrink_to_fit();
+    }
+
+    RecordId find(uint32_t address) const {
+        uint32_t entry = m_first_level[address >> (32 - FirstLevelBits)];
+        int shift = 32 - FirstLevelBits;
+        for (int level = 1; level < LEVELS && (entry & CHUNK_FLAG); ++level) {
+            shift -= ChunkBits;
+            entry = m_chunks[(static_cast<size_t>(entry & ~CHUNK_FLAG) << ChunkBits) | ((address >> shift) & CHUNK_MASK)];
+        }
+        return entry;
+    }
+
+    size_t chunk_count() const { return m_chunks.size() >> ChunkBits; }
+    size_t memory_bytes() const {
+        return (m_first_level.capacity() + m_chunks.capacity()) * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr int shift_for(int level) { return 32 - FirstLevelBits - level * ChunkBits; }
+
+    uint32_t& entry_at(int level, size_t table, size_t index) {
+        return level == 0 ? m_first_level[index] : m_chunks[(table << ChunkBits) | index];
+    }
+
+    // map [first, last], which lies inside `table` at `level`, to id
+    void fill(int level, size_t table, uint64_t first, uint64_t last, RecordId id) {
+        const int shift = shift_for(level);
+        const uint64_t slot_span = uint64_t{1} << shift;
+        const uint64_t index_mask = level == 0 ? (uint64_t{1} << FirstLevelBits) - 1 : CHUNK_MASK;
+
+        uint64_t address = first;
+        while (address <= last) {
+            size_t index = static_cast<size_t>((address >> shift) & index_mask);
+            uint64_t slot_start = address & ~(slot_span - 1);
+            uint64_t slot_end = slot_start + slot_span - 1;
+            uint64_t covered_end = last < slot_end ? last : slot_end;
+
+            if (address == slot_start && covered_end == slot_end && !(entry_at(level, table, index) & CHUNK_FLAG)) {
+                entry_at(level, table, index) = id;
+            } else {
+                fill(level + 1, chunk_for(level, table, index), address, covered_end, id);
+            }
+            address = covered_end + 1;
+        }
+    }
+
+    size_t chunk_for(int level, size_t table, size_t index) {
+        uint32_t entry = entry_at(level, table, index);
+        if (entry & CHUNK_FLAG) {
+            return entry & ~CHUNK_FLAG;
+        }
+
+        // split the slot: the new chunk starts out with whatever the slot mapped to
+        size_t chunk = chunk_count();
+        m_chunks.resize(m_chunks.size() + CHUNK_SIZE, entry);
+        entry_at(level, table, index) = CHUNK_FLAG | static_cast<uint32_t>(chunk);
+        return chunk;
+    }
+
+    PlacedVector<uint32_t> m_first_level;
+    PlacedVector<uint32_t> m_chunks;
+};
+
+using Dir24_8Index = DirIndex<24, 8>;
+using Dir16_8_8Index = DirIndex<16, 8>;
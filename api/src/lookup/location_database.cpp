@@ -0,0 +1,107 @@
+#include "location_database.h"
+#include <stdexcept>
+#include <sys/stat.h>
+#include "csv_dataset_loader.h"
+
+LocationDatabase::LocationDatabase(Options options) : m_options(std::move(options)) {}
+
+std::unique_ptr<LocationDatabase> LocationDatabase::open(Options options) {
+    std::unique_ptr<LocationDatabase> database(new LocationDatabase(std::move(options)));
+    {
+        std::lock_guard<std::mutex> lock(database->m_reload_mutex);
+        database->load();
+    }
+    if (database->m_options.reload_interval.count() > 0) {
+        database->m_poller = std::thread(&LocationDatabase::run, database.get());
+    }
+    return database;
+}
+
+std::unique_ptr<LocationDatabase> LocationDatabase::open(const std::string& path) {
+    Options options;
+    options.path = path;
+    return open(std::move(options));
+}
+
+LocationDatabase::~LocationDatabase() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_poller.joinable()) {
+        m_poller.join();
+    }
+}
+
+std::optional<LocationRecord> LocationDatabase::lookup(std::string_view address) const {
+    auto parsed = IpAddress::parse(address);
+    return parsed ? lookup(*parsed) : std::nullopt;
+}
+
+std::vector<std::optional<LocationRecord>> LocationDatabase::lookup_many(std::span<const IpAddress> addresses) const {
+    auto current = dataset();
+    std::vector<std::optional<LocationRecord>> records;
+    records.reserve(addresses.size());
+    for (const auto& address : addresses) {
+        records.push_back(current->find(address));
+    }
+    return records;
+}
+
+bool LocationDatabase::reload() {
+    std::lock_guard<std::mutex> lock(m_reload_mutex);
+    try {
+        load();
+    } catch (const std::exception& e) {
+        if (m_options.on_reload) {
+            m_options.on_reload(generation(), e.what());
+        }
+        return false;
+    }
+    if (m_options.on_reload) {
+        m_options.on_reload(generation(), "");
+    }
+    return true;
+}
+
+std::optional<LocationDatabase::FileStamp> LocationDatabase::stamp(const std::string& path) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        return std::nullopt;
+    }
+    return FileStamp{static_cast<uint64_t>(info.st_size),
+                     static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec,
+                     static_cast<uint64_t>(info.st_ino)};
+}
+
+void LocationDatabase::load() {
+    // stamped before reading, so a write that lands during the load is picked up next time, and
+    // a file that fails to load is not tried again until it changes
+    m_stamp = stamp(m_options.path);
+    auto loaded = CsvDatasetLoader::load(m_options.path, m_options.ipv4_index);
+    // an empty or truncated file is more likely a copy in progress than an empty dataset
+    if (loaded.skipped == loaded.rows) {
+        throw std::runtime_error("No usable rows in dataset file " + m_options.path);
+    }
+    m_dataset.store(std::move(loaded.dataset), std::memory_order_release);
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void LocationDatabase::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_cv.wait_for(lock, m_options.reload_interval, [this] { return m_stop; })) {
+        lock.unlock();
+        bool changed;
+        {
+            std::lock_guard<std::mutex> reload_lock(m_reload_mutex);
+            auto current = stamp(m_options.path);
+            // a file being replaced may be missing for a moment; keep what is loaded
+            changed = current && current != m_stamp;
+        }
+        if (changed) {
+            reload();
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../models/location_record.h"
+#include "../utils/ip_address.h"
+#include "location_dataset.h"
+
+// The lookup core for in-process use: a LocationDataset loaded from a local CSV file (see
+// CsvDatasetLoader), with no dependency on Crow, Redis or Postgres.
+//
+// Every member is safe to call from any thread. Lookups read the current dataset through an
+// atomic shared_ptr and never wait. When `reload_interval` is set, a background thread checks
+// the file's size, modification time and inode, builds a new dataset when one of them changes
+// and swaps it in; lookups still running on the old dataset finish on it. A reload that fails
+// keeps the previous dataset and is not retried until the file changes again.
+class LocationDatabase {
+public:
+    struct Options {
+        std::string path;
+        Ipv4IndexType ipv4_index = Ipv4IndexType::BINARY_SEARCH;
+        // how often the file is checked for changes; 0 reloads only on reload()
+        std::chrono::milliseconds reload_interval{0};
+        // called after each reload, on the thread that ran it; `error` is empty on success
+        std::function<void(uint64_t generation, const std::string& error)> on_reload;
+    };
+
+    // loads the file; throws std::runtime_error if it cannot be read
+    static std::unique_ptr<LocationDatabase> open(Options options);
+    // the file alone, never reloaded on its own
+    static std::unique_ptr<LocationDatabase> open(const std::string& path);
+    ~LocationDatabase();
+
+    LocationDatabase(const LocationDatabase&) = delete;
+    LocationDatabase& operator=(const LocationDatabase&) = delete;
+
+    std::optional<LocationRecord> lookup(const IpAddress& address) const { return dataset()->find(address); }
+    // nullopt also for text that is not an IP address
+    std::optional<LocationRecord> lookup(std::string_view address) const;
+    // all of them against one dataset, even if a reload lands midway
+    std::vector<std::optional<LocationRecord>> lookup_many(std::span<const IpAddress> addresses) const;
+
+    // the current dataset, for callers that want several lookups to see the same data
+    std::shared_ptr<const LocationDataset> dataset() const { return m_dataset.load(std::memory_order_acquire); }
+    // 1 once opened, then one more for each reload swapped in
+    uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
+    // reads the file now, changed or not; returns false, keeping the current dataset, on failure
+    bool reload();
+
+private:
+    // what tells one version of the file from another
+    struct FileStamp {
+        uint64_t size = 0;
+        int64_t modified_ns = 0;
+        uint64_t inode = 0;
+
+        bool operator==(const FileStamp&) const = default;
+    };
+
+    explicit LocationDatabase(Options options);
+
+    static std::optional<FileStamp> stamp(const std::string& path);
+    void load();
+    void run();
+
+    const Options m_options;
+    std::atomic<std::shared_ptr<const LocationDataset>> m_dataset;
+    std::atomic<uint64_t> m_generation{0};
+
+    // one reload at a time; guards m_stamp, the file as last read
+    std::mutex m_reload_mutex;
+    std::optional<FileStamp> m_stamp;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    std::thread m_poller;
+};
@@ -0,0 +1,226 @@
+#include "location_dataset.h"
+#include <algorithm>
+#include <stdexcept>
+
+void LocationDataset::Builder::add_ipv4(uint32_t first, uint32_t last, const LocationRecord& record) {
+    if (first > last) {
+        return;
+    }
+    m_ipv4_ranges.push_back({first, last, intern(record)});
+}
+
+void LocationDataset::Builder::add_ipv6(uint128_t first, uint128_t last, const LocationRecord& record) {
+    if (first > last) {
+        return;
+    }
+    IpAddress first_address = IpAddress::from_v6(first);
+    IpAddress last_address = IpAddress::from_v6(last);
+    if (first_address.is_v4_mapped() && last_address.is_v4_mapped()) {
+        add_ipv4(first_address.unmapped().v4(), last_address.unmapped().v4(), record);
+        return;
+    }
+    m_ipv6_ranges.push_back({first, last, intern(record)});
+}
+
+RecordId LocationDataset::Builder::intern(const LocationRecord& record) {
+    auto it = m_record_ids.find(record);
+    if (it != m_record_ids.end()) {
+        return it->second;
+    }
+    if (m_records.size() >= NO_RECORD) {
+        throw std::length_error("Too many distinct location records");
+    }
+
+    auto id = static_cast<RecordId>(m_records.size());
+    m_records.push_back(record);
+    m_record_ids.emplace(record, id);
+    return id;
+}
+
+std::shared_ptr<const LocationDataset> LocationDataset::Builder::build(Ipv4IndexType index_type) {
+    std::shared_ptr<LocationDataset> dataset(new LocationDataset());
+
+    dataset->m_ipv4.build(m_ipv4_ranges);
+    {
+        RangeTable<uint128_t> ipv6;
+        ipv6.build(m_ipv6_ranges);
+        dataset->m_ipv6.build(ipv6);
+        dataset->m_countries.build(m_records, dataset->m_ipv4, ipv6);
+    }
+
+    dataset->m_ipv4_index_type = index_type;
+    if (index_type == Ipv4IndexType::DIR_24_8) {
+        dataset->m_dir24.build(dataset->m_ipv4.firsts(), dataset->m_ipv4.lasts(), dataset->m_ipv4.ids());
+    } else if (index_type == Ipv4IndexType::DIR_16_8_8) {
+        dataset->m_dir16.build(dataset->m_ipv4.firsts(), dataset->m_ipv4.lasts(), dataset->m_ipv4.ids());
+    }
+
+    dataset->m_records.build(m_records);
+    m_records.clear();
+    m_record_ids.clear();
+    m_ipv4_ranges.clear();
+    m_ipv6_ranges.clear();
+
+    return dataset;
+}
+
+std::shared_ptr<const LocationDataset> LocationDataset::replicate(const MemoryPlacement& placement) const {
+    PlacementScope scope(placement);
+    return std::shared_ptr<const LocationDataset>(new LocationDataset(*this));
+}
+
+RecordId LocationDataset::Ipv4Cursor::find(uint32_t address) {
+    const auto& firsts = m_dataset.m_ipv4.firsts();
+    size_t size = firsts.size();
+    if (address < m_previous) {
+        m_next = static_cast<size_t>(std::upper_bound(firsts.begin(), firsts.end(), address) - firsts.begin());
+    } else if (m_next < size && firsts[m_next] <= address) {
+        // double the step until a start lies above the address, then search the last step
+        size_t low = m_next + 1;
+        size_t step = 1;
+        while (low + step <= size && firsts[low + step - 1] <= address) {
+            low += step;
+            step *= 2;
+        }
+        size_t high = std::min(low + step, size);
+        m_next = static_cast<size_t>(std::upper_bound(firsts.begin() + low, firsts.begin() + high, address) - firsts.begin());
+    }
+    m_previous = address;
+
+    if (m_next == 0 || address > m_dataset.m_ipv4.lasts()[m_next - 1]) {
+        return NO_RECORD;
+    }
+    return m_dataset.m_ipv4.ids()[m_next - 1];
+}
+
+std::optional<IpAddress> LocationDataset::scan_ranges(const RangeQuery& query, size_t limit,
+                                                     std::vector<Range>& out) const {
+    // the part of each family's address space left to scan
+    bool scan_ipv4 = true;
+    bool scan_ipv6 = true;
+    uint32_t ipv4_first = 0;
+    uint32_t ipv4_last = UINT32_MAX;
+    uint128_t ipv6_first = 0;
+    uint128_t ipv6_last = ~uint128_t{0};
+    if (query.prefix) {
+        IpAddress network = query.prefix->network();
+        int length = query.prefix->length();
+        if (network.is_v4_mapped() && length >= 96) {
+            network = network.unmapped();
+            length -= 96;
+        }
+        if (network.is_v4()) {
+            scan_ipv6 = false;
+            ipv4_first = network.v4();
+            ipv4_last = ipv4_first | (length == 0 ? UINT32_MAX : (uint32_t{1} << (32 - length)) - 1);
+        } else {
+            // IPv4 is stored apart from IPv6, as ::ffff:0:0/96 would be; a block covering
+            // that one (::/0 up to ::/96) covers all of IPv4 as well
+            scan_ipv4 = length <= 96 && query.prefix->contains(IpAddress::from_v6(uint128_t{0xFFFF} << 32));
+            ipv6_first = network.v6();
+            ipv6_last = ipv6_first | (length == 0 ? ~uint128_t{0} : (uint128_t{1} << (128 - length)) - 1);
+        }
+    }
+    if (query.from) {
+        IpAddress from = query.from->unmapped();
+        if (from.is_v4()) {
+            ipv4_first = std::max(ipv4_first, from.v4());
+        } else {
+            scan_ipv4 = false;
+            ipv6_first = std::max(ipv6_first, from.v6());
+        }
+    }
+
+    // one match past the page is looked for, to tell where the next page starts
+    size_t listed = 0;
+    std::optional<IpAddress> next;
+    auto list = [&](const IpAddress& first, const IpAddress& last, RecordId id) {
+        if (listed == limit) {
+            next = first;
+            return false;
+        }
+        out.push_back({first, last, id});
+        ++listed;
+        return true;
+    };
+
+    if (scan_ipv4 && ipv4_first <= ipv4_last) {
+        const auto& firsts = m_ipv4.firsts();
+        const auto& lasts = m_ipv4.lasts();
+        const auto& ids = m_ipv4.ids();
+        auto visit = [&](size_t i) {
+            return list(IpAddress::from_v4(firsts[i]), IpAddress::from_v4(lasts[i]), ids[i]);
+        };
+        // lasts are ascending too, since the ranges are disjoint
+        size_t start = static_cast<size_t>(std::lower_bound(lasts.begin(), lasts.end(), ipv4_first) - lasts.begin());
+        if (query.country) {
+            auto ordinals = m_countries.ipv4_ranges(*query.country);
+            for (auto it = std::lower_bound(ordinals.begin(), ordinals.end(), start);
+                 it != ordinals.end() && firsts[*it] <= ipv4_last; ++it) {
+                if (!visit(*it)) {
+                    return next;
+                }
+            }
+        } else {
+            for (size_t i = start; i < firsts.size() && firsts[i] <= ipv4_last; ++i) {
+                if (!visit(i)) {
+                    return next;
+                }
+            }
+        }
+    }
+
+    if (scan_ipv6 && ipv6_first <= ipv6_last) {
+        CompressedRangeTable<uint128_t>::Reader reader(m_ipv6);
+        reader.seek(ipv6_first);
+        RangeTable<uint128_t>::Range range{};
+        auto visit = [&]() { return list(IpAddress::from_v6(range.first), IpAddress::from_v6(range.last), range.id); };
+        if (query.country) {
+            auto ordinals = m_countries.ipv6_ranges(*query.country);
+            for (auto it = std::lower_bound(ordinals.begin(), ordinals.end(), reader.ordinal()); it != ordinals.end(); ++it) {
+                // ordinals close together are read on from the same block
+                reader.seek_ordinal(*it);
+                if (!reader.next(range) || range.first > ipv6_last || !visit()) {
+                    break;
+                }
+            }
+        } else {
+            while (reader.next(range) && range.first <= ipv6_last) {
+                if (!visit()) {
+                    break;
+                }
+            }
+        }
+    }
+    return next;
+}
+
+size_t LocationDataset::ipv4_index_memory_bytes() const {
+    size_t bytes = m_ipv4.memory_bytes();
+    if (m_ipv4_index_type == Ipv4IndexType::DIR_24_8) {
+        bytes += m_dir24.memory_bytes();
+    } else if (m_ipv4_index_type == Ipv4IndexType::DIR_16_8_8) {
+        bytes += m_dir16.memory_bytes();
+    }
+    return bytes;
+}
+
+Ipv4IndexType LocationDataset::parse_ipv4_index(const std::string& index_str) {
+    if (index_str == "binary") {
+        return Ipv4IndexType::BINARY_SEARCH;
+    } else if (index_str == "dir24") {
+        return Ipv4IndexType::DIR_24_8;
+    } else if (index_str == "dir16") {
+        return Ipv4IndexType::DIR_16_8_8;
+    }
+    throw std::invalid_argument("Invalid IPv4 index type: " + index_str);
+}
+
+const char* LocationDataset::ipv4_index_to_string(Ipv4IndexType index_type) {
+    switch (index_type) {
+        case Ipv4IndexType::BINARY_SEARCH: return "binary";
+        case Ipv4IndexType::DIR_24_8: return "dir24";
+        case Ipv4IndexType::DIR_16_8_8: return "dir16";
+        default: return "unknown";
+    }
+}
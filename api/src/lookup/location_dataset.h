@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../models/location_record.h"
+#include "../utils/ip_address.h"
+#include "compressed_range_table.h"
+#include "country_index.h"
+#include "dir_index.h"
+#include "memory_placement.h"
+#include "range_table.h"
+#include "record_store.h"
+
+enum class Ipv4IndexType { BINARY_SEARCH, DIR_24_8, DIR_16_8_8 };
+
+// Immutable in-memory copy of ip_locations. Locations are deduplicated into a dictionary-coded
+// record store and ranges refer to them by id. Each address family has its own range table
+// keyed by its native integer width, so IPv4 searches stay on 32-bit compares over a quarter
+// of the memory; the much larger IPv6 table is kept delta-encoded in cache-line blocks.
+// IPv4-mapped IPv6 addresses and ranges are routed to the IPv4 table. Lookups follow
+// the database query's semantics: among ranges containing the address, the one with the
+// lowest start wins, which the builder guarantees by trimming overlapping ranges. A country
+// index lists each country's ranges, for scans by country.
+class LocationDataset {
+public:
+    class Builder {
+    public:
+        void add_ipv4(uint32_t first, uint32_t last, const LocationRecord& record);
+        // ranges inside ::ffff:0:0/96 are stored as IPv4
+        void add_ipv6(uint128_t first, uint128_t last, const LocationRecord& record);
+        // the dataset's arrays are allocated under the calling thread's MemoryPlacement
+        std::shared_ptr<const LocationDataset> build(Ipv4IndexType index_type);
+
+    private:
+        RecordId intern(const LocationRecord& record);
+
+        std::vector<LocationRecord> m_records;
+        std::unordered_map<LocationRecord, RecordId, LocationRecordHash> m_record_ids;
+        std::vector<RangeTable<uint32_t>::Range> m_ipv4_ranges;
+        std::vector<RangeTable<uint128_t>::Range> m_ipv6_ranges;
+    };
+
+    // throws std::invalid_argument for unknown names ("binary", "dir24", "dir16")
+    static Ipv4IndexType parse_ipv4_index(const std::string& index_str);
+    static const char* ipv4_index_to_string(Ipv4IndexType index_type);
+
+    // deep copy with every array allocated under `placement`, e.g. one replica per NUMA node
+    std::shared_ptr<const LocationDataset> replicate(const MemoryPlacement& placement) const;
+
+    std::optional<LocationRecord> find(const IpAddress& address) const {
+        IpAddress key = address.unmapped();
+        return key.is_v4() ? find_ipv4(key.v4()) : find_ipv6(key.v6());
+    }
+
+    std::optional<LocationRecord> find_ipv4(uint32_t address) const { return record_for(find_ipv4_id(address)); }
+    std::optional<LocationRecord> find_ipv6(uint128_t address) const { return record_for(m_ipv6.find(address)); }
+
+    // Looks up ascending IPv4 addresses by merging them with the sorted ranges: each lookup
+    // gallops forward from where the previous one ended, so a sorted stream walks the range
+    // arrays once, in order, instead of binary searching them from the top for every address.
+    // An address below the previous one starts over with a binary search.
+    class Ipv4Cursor {
+    public:
+        explicit Ipv4Cursor(const LocationDataset& dataset) : m_dataset(dataset) {}
+        RecordId find(uint32_t address);
+
+    private:
+        const LocationDataset& m_dataset;
+        uint32_t m_previous = 0;
+        size_t m_next = 0; // the first range starting above m_previous
+    };
+
+    // index lookup only, without materializing the record
+    RecordId find_id(const IpAddress& address) const {
+        IpAddress key = address.unmapped();
+        return key.is_v4() ? find_ipv4_id(key.v4()) : m_ipv6.find(key.v6());
+    }
+    LocationRecord record(RecordId id) const { return m_records.get(id); }
+
+    RecordId find_ipv4_id(uint32_t address) const {
+        switch (m_ipv4_index_type) {
+            case Ipv4IndexType::DIR_24_8: return m_dir24.find(address);
+            case Ipv4IndexType::DIR_16_8_8: return m_dir16.find(address);
+            case Ipv4IndexType::BINARY_SEARCH: return m_ipv4.find(address);
+        }
+        return NO_RECORD;
+    }
+
+    Ipv4IndexType ipv4_index_type() const { return m_ipv4_index_type; }
+    size_t record_count() const { return m_records.size(); }
+    size_t ipv4_range_count() const { return m_ipv4.size(); }
+    size_t ipv6_range_count() const { return m_ipv6.size(); }
+    // bytes used by the range arrays and the direct index, excluding the record table
+    size_t ipv4_index_memory_bytes() const;
+    size_t ipv6_index_memory_bytes() const { return m_ipv6.memory_bytes(); }
+    size_t record_memory_bytes() const { return m_records.memory_bytes(); }
+    size_t country_index_memory_bytes() const { return m_countries.memory_bytes(); }
+
+    // A range as scan_ranges() lists it
+    struct Range {
+        IpAddress first;
+        IpAddress last;
+        RecordId id;
+    };
+    // The ranges scan_ranges() lists: those overlapping `prefix` whose location is in
+    // `country` and that end at or after `from`. IPv4 ranges come first, then IPv6 ranges,
+    // each in address order. An IPv6 prefix inside ::ffff:0:0/96 stands for an IPv4 one,
+    // and one containing it, such as ::/0, covers every IPv4 range too.
+    struct RangeQuery {
+        std::optional<IpPrefix> prefix;          // nullopt: every address
+        std::optional<std::string_view> country; // nullopt: any location, with a country or not
+        std::optional<IpAddress> from;           // nullopt: from the first range
+    };
+    // Appends up to `limit` ranges matching `query` to `out` and returns the first address
+    // of the next match, to pass as `from` for the rest, or nullopt when there is none. The
+    // work is a binary search plus a step per range listed, however many ranges match.
+    std::optional<IpAddress> scan_ranges(const RangeQuery& query, size_t limit, std::vector<Range>& out) const;
+
+    // the range tables, for walking a dataset in address order
+    const RangeTable<uint32_t>& ipv4_table() const { return m_ipv4; }
+    const CompressedRangeTable<uint128_t>& ipv6_table() const { return m_ipv6; }
+
+private:
+    LocationDataset() = default;
+    LocationDataset(const LocationDataset&) = default;
+
+    std::optional<LocationRecord> record_for(RecordId id) const {
+        return id == NO_RECORD ? std::nullopt : std::optional<LocationRecord>(m_records.get(id));
+    }
+
+    RecordStore m_records;
+
+    RangeTable<uint32_t> m_ipv4;
+    CompressedRangeTable<uint128_t> m_ipv6;
+    CountryIndex m_countries;
+
+    Ipv4IndexType m_ipv4_index_type = Ipv4IndexType::BINARY_SEARCH;
+    Dir24_8Index m_dir24;
+    Dir16_8_8Index m_dir16;
+};
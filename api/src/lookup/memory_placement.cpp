@@ -0,0 +1,168 @@
+#include "memory_placement.h"
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+thread_local MemoryPlacement MemoryPlacementPolicy::t_current;
+
+namespace {
+
+// from <numaif.h>, which would pull in libnuma for a single syscall
+constexpr int MPOL_BIND_MODE = 2;
+constexpr unsigned MPOL_MF_MOVE_FLAG = 1 << 1;
+
+struct Mapping {
+    void* base;   // start of the mmap, which may precede the aligned pointer handed out
+    size_t length;
+    bool hugetlb;
+};
+
+std::mutex g_mappings_mutex;
+std::unordered_map<void*, Mapping> g_mappings;
+
+std::atomic<uint64_t> g_mapped_bytes{0};
+std::atomic<uint64_t> g_hugetlb_bytes{0};
+std::atomic<uint64_t> g_hugetlb_fallbacks{0};
+std::atomic<uint64_t> g_numa_bind_failures{0};
+
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+bool bind_to_node(void* address, size_t length, int node) {
+    constexpr size_t BITS = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask(static_cast<size_t>(node) / BITS + 1, 0);
+    mask[static_cast<size_t>(node) / BITS] |= 1ul << (static_cast<size_t>(node) % BITS);
+    return syscall(SYS_mbind, address, length, MPOL_BIND_MODE, mask.data(), mask.size() * BITS + 1, MPOL_MF_MOVE_FLAG) == 0;
+}
+
+// private mappings are copy-on-write after fork(); khugepaged collapsing them in a child would
+// also copy, so placements meant to be shared across processes use MAP_SHARED
+int sharing_flag(const MemoryPlacement& placement) {
+    return placement.shared ? MAP_SHARED : MAP_PRIVATE;
+}
+
+// maps `length` bytes at a HUGE_PAGE_BYTES boundary so the kernel can back it with huge pages
+Mapping map_aligned(size_t length, int sharing) {
+    size_t padded = length + MemoryPlacementPolicy::HUGE_PAGE_BYTES;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, sharing | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    auto start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = round_up(start, MemoryPlacementPolicy::HUGE_PAGE_BYTES);
+    size_t head = aligned - start;
+    size_t tail = padded - head - length;
+    if (head > 0) munmap(raw, head);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + length), tail);
+    return Mapping{reinterpret_cast<void*>(aligned), length, false};
+}
+
+} // namespace
+
+HugePageMode MemoryPlacementPolicy::parse_huge_page_mode(const std::string& mode_str) {
+    if (mode_str == "off") {
+        return HugePageMode::OFF;
+    } else if (mode_str == "transparent") {
+        return HugePageMode::TRANSPARENT;
+    } else if (mode_str == "explicit") {
+        return HugePageMode::EXPLICIT;
+    }
+    throw std::invalid_argument("Invalid huge page mode: " + mode_str);
+}
+
+const char* MemoryPlacementPolicy::huge_page_mode_to_string(HugePageMode mode) {
+    switch (mode) {
+        case HugePageMode::OFF: return "off";
+        case HugePageMode::TRANSPARENT: return "transparent";
+        case HugePageMode::EXPLICIT: return "explicit";
+        default: return "unknown";
+    }
+}
+
+const MemoryPlacement& MemoryPlacementPolicy::current() {
+    return t_current;
+}
+
+void* MemoryPlacementPolicy::allocate(size_t bytes, size_t alignment) {
+    const MemoryPlacement& placement = t_current;
+    if (placement.is_default() || bytes < HUGE_PAGE_BYTES || alignment > HUGE_PAGE_BYTES) {
+        return ::operator new(bytes, std::align_val_t(alignment));
+    }
+
+    size_t length = round_up(bytes, HUGE_PAGE_BYTES);
+    Mapping mapping{nullptr, length, false};
+
+    if (placement.huge_pages == HugePageMode::EXPLICIT) {
+        void* address = mmap(nullptr, length, PROT_READ | PROT_WRITE, sharing_flag(placement) | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (address != MAP_FAILED) {
+            mapping = Mapping{address, length, true};
+        } else {
+            // the reserved pool (vm.nr_hugepages) is empty or too small
+            g_hugetlb_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!mapping.base) {
+        mapping = map_aligned(length, sharing_flag(placement));
+        if (placement.huge_pages != HugePageMode::OFF) {
+            madvise(mapping.base, length, MADV_HUGEPAGE);
+        }
+    }
+
+    // bind before first touch so the pages are allocated on the node
+    if (placement.numa_node >= 0 && !bind_to_node(mapping.base, length, placement.numa_node)) {
+        g_numa_bind_failures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    g_mapped_bytes.fetch_add(length, std::memory_order_relaxed);
+    if (mapping.hugetlb) {
+        g_hugetlb_bytes.fetch_add(length, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(g_mappings_mutex);
+    g_mappings.emplace(mapping.base, mapping);
+    return mapping.base;
+}
+
+void MemoryPlacementPolicy::deallocate(void* pointer, size_t bytes, size_t alignment) {
+    if (bytes >= HUGE_PAGE_BYTES) {
+        std::unique_lock<std::mutex> lock(g_mappings_mutex);
+        auto it = g_mappings.find(pointer);
+        if (it != g_mappings.end()) {
+            Mapping mapping = it->second;
+            g_mappings.erase(it);
+            lock.unlock();
+
+            munmap(mapping.base, mapping.length);
+            g_mapped_bytes.fetch_sub(mapping.length, std::memory_order_relaxed);
+            if (mapping.hugetlb) {
+                g_hugetlb_bytes.fetch_sub(mapping.length, std::memory_order_relaxed);
+            }
+            return;
+        }
+    }
+    ::operator delete(pointer, std::align_val_t(alignment));
+}
+
+MemoryPlacementStats MemoryPlacementPolicy::stats() {
+    MemoryPlacementStats stats;
+    stats.mapped_bytes = g_mapped_bytes.load(std::memory_order_relaxed);
+    stats.hugetlb_bytes = g_hugetlb_bytes.load(std::memory_order_relaxed);
+    stats.hugetlb_fallbacks = g_hugetlb_fallbacks.load(std::memory_order_relaxed);
+    stats.numa_bind_failures = g_numa_bind_failures.load(std::memory_order_relaxed);
+    return stats;
+}
+
+PlacementScope::PlacementScope(const MemoryPlacement& placement)
+    : m_previous(MemoryPlacementPolicy::t_current) {
+    MemoryPlacementPolicy::t_current = placement;
+}
+
+PlacementScope::~PlacementScope() {
+    MemoryPlacementPolicy::t_current = m_previous;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+// Where the large arrays of the in-memory dataset are allocated. Huge pages cut TLB misses
+// for random lookups over hundreds of MB; binding to a NUMA node keeps a replica in memory
+// local to the threads that read it. Shared placements survive fork() as one copy, so
+// prefork workers read the same physical pages.
+enum class HugePageMode {
+    OFF,         // regular heap allocations
+    TRANSPARENT, // 2 MB aligned mappings with madvise(MADV_HUGEPAGE)
+    EXPLICIT     // MAP_HUGETLB from the reserved pool, falling back to TRANSPARENT
+};
+
+struct MemoryPlacement {
+    HugePageMode huge_pages = HugePageMode::OFF;
+    int numa_node = -1; // -1: no binding
+    bool shared = false; // MAP_SHARED, so forked processes never copy the pages
+
+    bool is_default() const { return huge_pages == HugePageMode::OFF && numa_node < 0 && !shared; }
+};
+
+struct MemoryPlacementStats {
+    uint64_t mapped_bytes = 0;       // currently mapped through the placement path
+    uint64_t hugetlb_bytes = 0;      // of which backed by MAP_HUGETLB
+    uint64_t hugetlb_fallbacks = 0;  // MAP_HUGETLB requests that fell back to transparent huge pages
+    uint64_t numa_bind_failures = 0;
+};
+
+class MemoryPlacementPolicy {
+public:
+    static constexpr size_t HUGE_PAGE_BYTES = size_t{2} << 20;
+
+    // throws std::invalid_argument for unknown names ("off", "transparent", "explicit")
+    static HugePageMode parse_huge_page_mode(const std::string& mode_str);
+    static const char* huge_page_mode_to_string(HugePageMode mode);
+
+    // placement used by allocations on this thread
+    static const MemoryPlacement& current();
+
+    // Allocations below HUGE_PAGE_BYTES, or made under the default placement, go to the
+    // regular heap. Larger ones are mapped directly and placed per current().
+    static void* allocate(size_t bytes, size_t alignment);
+    static void deallocate(void* pointer, size_t bytes, size_t alignment);
+
+    static MemoryPlacementStats stats();
+
+private:
+    friend class PlacementScope;
+    static thread_local MemoryPlacement t_current;
+};
+
+// Applies a placement to allocations made on this thread for the scope's lifetime.
+class PlacementScope {
+public:
+    explicit PlacementScope(const MemoryPlacement& placement);
+    ~PlacementScope();
+
+    PlacementScope(const PlacementScope&) = delete;
+    PlacementScope& operator=(const PlacementScope&) = delete;
+
+private:
+    MemoryPlacement m_previous;
+};
+
+// Stateless allocator for the dataset's arrays. Copies of a container allocate under the
+// placement in effect where the copy is made, which is how per-node replicas are built.
+template <typename T>
+struct PlacementAllocator {
+    using value_type = T;
+
+    PlacementAllocator() = default;
+    template <typename U>
+    PlacementAllocator(const PlacementAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(MemoryPlacementPolicy::allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* pointer, size_t n) {
+        MemoryPlacementPolicy::deallocate(pointer, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PlacementAllocator<U>&) const { return true; }
+};
+
+template <typename T>
+using PlacedVector = std::vector<T, PlacementAllocator<T>>;
@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "dir_index.h"
+
+// Sorted, disjoint address ranges for one address family, keyed by the family's native
+// integer width (uint32_t for IPv4, uint128_t for IPv6). Starts, ends and ids are kept in
+// separate arrays so a binary search only touches the starts.
+template <typename Key>
+class RangeTable {
+public:
+    struct Range {
+        Key first;
+        Key last;
+        RecordId id;
+    };
+
+    // Sorts by start and trims overlapping ranges so that, as with the database query, the
+    // range with the lowest start wins. Ranges with equal starts keep their input order.
+    void build(std::vector<Range>& ranges) {
+        std::stable_sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.first < b.first; });
+
+        m_firsts.clear();
+        m_lasts.clear();
+        m_ids.clear();
+        m_firsts.reserve(ranges.size());
+        m_lasts.reserve(ranges.size());
+        m_ids.reserve(ranges.size());
+
+        for (const auto& range : ranges) {
+            Key first = range.first;
+            if (!m_lasts.empty()) {
+                Key previous_last = m_lasts.back();
+                if (range.last <= previous_last) {
+                    continue; // fully shadowed by a range with a lower start
+                }
+                first = std::max(first, static_cast<Key>(previous_last + 1));
+            }
+            m_firsts.push_back(first);
+            m_lasts.push_back(range.last);
+            m_ids.push_back(range.id);
+        }
+    }
+
+    RecordId find(Key key) const {
+        auto it = std::upper_bound(m_firsts.begin(), m_firsts.end(), key);
+        if (it == m_firsts.begin()) {
+            return NO_RECORD;
+        }
+        size_t i = static_cast<size_t>(it - m_firsts.begin()) - 1;
+        return key <= m_lasts[i] ? m_ids[i] : NO_RECORD;
+    }
+
+    const PlacedVector<Key>& firsts() const { return m_firsts; }
+    const PlacedVector<Key>& lasts() const { return m_lasts; }
+    const PlacedVector<RecordId>& ids() const { return m_ids; }
+
+    size_t size() const { return m_firsts.size(); }
+    size_t memory_bytes() const {
+        return (m_firsts.capacity() + m_lasts.capacity()) * sizeof(Key) + m_ids.capacity() * sizeof(RecordId);
+    }
+
+private:
+    PlacedVector<Key> m_firsts;
+    PlacedVector<Key> m_lasts;
+    PlacedVector<RecordId> m_ids;
+};
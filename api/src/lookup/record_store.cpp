@@ -0,0 +1,87 @@
+#include "record_store.h"
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+int32_t quantize(const std::optional<float>& coordinate, int32_t missing) {
+    if (!coordinate) {
+        return missing;
+    }
+    return static_cast<int32_t>(std::lround(static_cast<double>(*coordinate) * RecordStore::COORDINATE_SCALE));
+}
+
+std::optional<float> dequantize(int32_t value, int32_t missing) {
+    if (value == missing) {
+        return std::nullopt;
+    }
+    return static_cast<float>(value / RecordStore::COORDINATE_SCALE);
+}
+
+} // namespace
+
+void RecordStore::build(const std::vector<LocationRecord>& records) {
+    m_entries.clear();
+    m_chars.clear();
+    m_string_offsets.assign(1, 0);
+
+    std::unordered_map<std::string, uint32_t> dictionary;
+    auto intern = [&](const std::optional<std::string>& value) -> uint32_t {
+        if (!value) {
+            return NO_STRING;
+        }
+        auto it = dictionary.find(*value);
+        if (it != dictionary.end()) {
+            return it->second;
+        }
+        if (m_chars.size() + value->size() > UINT32_MAX) {
+            throw std::length_error("Record string dictionary too large");
+        }
+        m_chars.insert(m_chars.end(), value->begin(), value->end());
+        m_string_offsets.push_back(static_cast<uint32_t>(m_chars.size()));
+        auto index = static_cast<uint32_t>(m_string_offsets.size() - 1);
+        dictionary.emplace(*value, index);
+        return index;
+    };
+
+    m_entries.reserve(records.size());
+    for (const auto& record : records) {
+        Entry entry;
+        entry.country = intern(record.country);
+        entry.city = intern(record.city);
+        entry.region = intern(record.region);
+        entry.postal_code = intern(record.postal_code);
+        entry.timezone = intern(record.timezone);
+        entry.latitude = quantize(record.latitude, NO_COORDINATE);
+        entry.longitude = quantize(record.longitude, NO_COORDINATE);
+        m_entries.push_back(entry);
+    }
+
+    m_chars.shrink_to_fit();
+    m_string_offsets.shrink_to_fit();
+}
+
+LocationRecord RecordStore::get(RecordId id) const {
+    const Entry& entry = m_entries[id];
+    LocationRecord record;
+    record.country = string_at(entry.country);
+    record.city = string_at(entry.city);
+    record.region = string_at(entry.region);
+    record.latitude = dequantize(entry.latitude, NO_COORDINATE);
+    record.longitude = dequantize(entry.longitude, NO_COORDINATE);
+    record.postal_code = string_at(entry.postal_code);
+    record.timezone = string_at(entry.timezone);
+    return record;
+}
+
+std::optional<std::string> RecordStore::string_at(uint32_t index) const {
+    if (index == NO_STRING) {
+        return std::nullopt;
+    }
+    return std::string(m_chars.data() + m_string_offsets[index - 1], m_chars.data() + m_string_offsets[index]);
+}
+
+size_t RecordStore::memory_bytes() const {
+    return m_entries.capacity() * sizeof(Entry) + m_chars.capacity() + m_string_offsets.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../models/location_record.h"
+#include "dir_index.h"
+#include "memory_placement.h"
+
+// Compact table of distinct location records. Every string (country, city, region, postal
+// code, timezone) is stored once in a shared dictionary and records refer to it by index.
+// Coordinates are quantized to 1e-5 degrees, about a metre and close to the precision of
+// the float columns they come from. A record costs 28 bytes plus its share of the dictionary,
+// instead of the ~180 bytes and separate string allocations of a LocationRecord.
+class RecordStore {
+public:
+    static constexpr double COORDINATE_SCALE = 1e5;
+
+    // record ids are positions in `records`
+    void build(const std::vector<LocationRecord>& records);
+
+    LocationRecord get(RecordId id) const;
+
+    size_t size() const { return m_entries.size(); }
+    size_t string_count() const { return m_string_offsets.empty() ? 0 : m_string_offsets.size() - 1; }
+    size_t memory_bytes() const;
+
+private:
+    // dictionary index 0 is reserved for a missing (NULL) value
+    static constexpr uint32_t NO_STRING = 0;
+    static constexpr int32_t NO_COORDINATE = INT32_MIN;
+
+    struct Entry {
+        uint32_t country;
+        uint32_t city;
+        uint32_t region;
+        uint32_t postal_code;
+        uint32_t timezone;
+        int32_t latitude;
+        int32_t longitude;
+    };
+
+    std::optional<std::string> string_at(uint32_t index) const;
+
+    PlacedVector<Entry> m_entries;
+    // string i is m_chars[m_string_offsets[i - 1], m_string_offsets[i])
+    PlacedVector<char> m_chars;
+    PlacedVector<uint32_t> m_string_offsets;
+};
@@ -1,12 +1,182 @@
+#include <algorithm>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <thread>
 #include <crow.h>
 #include "crow/middlewares/cors.h"
 #include "config/service_config.h"
 #include "database/database_pool.h"
+#include "database/dataset_generation.h"
+#include "database/dataset_loader.h"
 #include "handlers/api_handlers.h"
+#include "lookup/dataset_history.h"
+#include "server/binary_server.h"
+#include "server/reuse_port.h"
+#include "server/worker_supervisor.h"
 #include "utils/logger.h"
 
+namespace {
+
+int run_server(const ServiceConfig& config, std::unique_ptr<DatabasePool> db_pool,
+               std::shared_ptr<const LocationDataset> shared_dataset,
+               std::shared_ptr<const DatasetHistory> shared_history, unsigned threads) {
+    auto logger = Logger::Logger::get_logger();
+    crow::App<crow::CORSHandler> app;
+
+    app.get_middleware<crow::CORSHandler>().global()
+        .headers("Content-Type", "Authorization")
+        .methods("GET"_method, "POST"_method, "OPTIONS"_method)
+        .origin("*");
+
+    ApiHandlers handlers(std::move(db_pool), config, std::move(shared_dataset), std::move(shared_history));
+    handlers.register_routes(app);
+
+    // declared after the handlers it calls, so it stops first
+    std::unique_ptr<BinaryServer> binary_server;
+    if (config.m_binary_port > 0 || !config.m_binary_socket.empty()) {
+        BinaryServer::Options options;
+        options.port = config.m_binary_port;
+        options.bind_address = config.m_binary_bind_address;
+        options.unix_path = config.m_binary_socket;
+        options.io_threads = static_cast<size_t>(std::max(1, config.m_binary_io_threads));
+        options.worker_threads = static_cast<size_t>(std::max(1, config.m_binary_workers));
+        binary_server = std::make_unique<BinaryServer>(options, handlers.binary_handler());
+        try {
+            binary_server->start();
+            logger->info("Binary protocol listening on {}", config.m_binary_port > 0
+                ? config.m_binary_bind_address + ":" + std::to_string(binary_server->port())
+                : config.m_binary_socket);
+        } catch (const std::exception& e) {
+            logger->error("{}, binary protocol disabled", e.what());
+            binary_server.reset();
+        }
+    }
+
+    // rollback and counter resets on their own listener, which has no CORS middleware, so no
+    // web page can reach them through a visitor's browser
+    std::unique_ptr<crow::SimpleApp> admin_app;
+    std::future<void> admin_running;
+    if (config.m_admin_port > 0) {
+        admin_app = std::make_unique<crow::SimpleApp>();
+        handlers.register_admin_routes(*admin_app);
+        admin_running = admin_app->bindaddr(config.m_admin_bind_address).port(config.m_admin_port).concurrency(1).run_async();
+        logger->info("Admin endpoints listening on {}:{}", config.m_admin_bind_address, config.m_admin_port);
+    }
+
+    logger->info("Server starting on port {}...", config.m_server_port);
+    auto running = app.port(config.m_server_port).concurrency(threads).run_async();
+    app.wait_for_server_start();
+    // a prefork worker tells the supervisor once it listens and answers lookups, so a worker it
+    // replaces is stopped only then
+    bool stopped = false;
+    while (!handlers.ready() && !stopped) {
+        stopped = running.wait_for(std::chrono::milliseconds(50)) == std::future_status::ready;
+    }
+    if (!stopped) {
+        WorkerSupervisor::notify_ready();
+    }
+    running.get();
+    if (admin_app) {
+        admin_app->stop();
+    }
+    return 0;
+}
+
+// Loads the in-memory dataset into MAP_SHARED memory, so every worker forked afterwards reads
+// the same pages. The dataset is null when in-memory lookups are off or the load fails, in
+// which case each worker loads its own copy.
+DatasetLoader::Result load_shared_dataset(DatabasePool& db_pool, const ServiceConfig& config) {
+    auto logger = Logger::Logger::get_logger();
+    if (config.m_ipv4_index == "off") {
+        return {};
+    }
+    try {
+        Ipv4IndexType ipv4_index = LocationDataset::parse_ipv4_index(config.m_ipv4_index);
+        HugePageMode huge_pages = HugePageMode::OFF;
+        try {
+            huge_pages = MemoryPlacementPolicy::parse_huge_page_mode(config.m_huge_pages);
+        } catch (const std::invalid_argument&) {
+            // reported by the workers
+        }
+        PlacementScope scope(MemoryPlacement{huge_pages, -1, true});
+        return DatasetLoader::load(db_pool, ipv4_index);
+    } catch (const std::exception& e) {
+        logger->error("Failed to load the shared dataset, workers load their own: {}", e.what());
+        return {};
+    }
+}
+
+int run_prefork(const ServiceConfig& config) {
+    auto logger = Logger::Logger::get_logger();
+    size_t worker_count = static_cast<size_t>(config.m_worker_processes);
+
+    // the supervisor's connection only polls the generation and loads the dataset; it has no
+    // polling thread because fork() must happen while the process is single-threaded
+    auto db_pool = std::make_unique<DatabasePool>(config.m_database_url, 1);
+    if (!db_pool->is_pool_healthy()) {
+        logger->error("Failed to initialize database pool. Exiting.");
+        return 1;
+    }
+    DatasetGeneration generation(*db_pool, std::chrono::seconds(0));
+    auto loaded = load_shared_dataset(*db_pool, config);
+    auto dataset = std::move(loaded.dataset);
+    // older generations are kept here too, so every worker answers ?generation= the same way
+    auto history = std::make_shared<const DatasetHistory>(loaded.generation);
+    size_t generations_kept = static_cast<size_t>(std::max(1, config.m_dataset_generations));
+
+    // split the threads and database connections of a single-process deployment over the workers
+    ServiceConfig worker_config = config;
+    worker_config.m_db_pool_size = std::max(2, config.m_db_pool_size / config.m_worker_processes);
+    worker_config.m_async_db_connections = std::max(2, config.m_async_db_connections / config.m_worker_processes);
+    worker_config.m_db_concurrency_limit = std::max(2, config.m_db_concurrency_limit / config.m_worker_processes);
+    worker_config.m_db_concurrency_max = std::max(2, config.m_db_concurrency_max / config.m_worker_processes);
+    unsigned threads = std::max(2u, std::thread::hardware_concurrency() / static_cast<unsigned>(worker_count));
+    if (!config.m_binary_socket.empty()) {
+        // a Unix socket path cannot be shared the way SO_REUSEPORT shares a port
+        logger->warning("BINARY_SOCKET is not supported in prefork mode, use BINARY_PORT");
+        worker_config.m_binary_socket.clear();
+    }
+    if (config.m_admin_port > 0) {
+        // an admin request would reach whichever worker the kernel picks, not the service
+        logger->warning("ADMIN_PORT is not supported in prefork mode, the admin endpoints are disabled");
+        worker_config.m_admin_port = 0;
+    }
+
+    WorkerSupervisor::Tick tick;
+    if (dataset && config.m_generation_poll_seconds > 0) {
+        tick = [&]() {
+            if (!generation.refresh()) {
+                return false;
+            }
+            auto reloaded = load_shared_dataset(*db_pool, config);
+            if (!reloaded.dataset) {
+                return false; // the current workers keep serving the previous generation
+            }
+            history = history->advance(*dataset, reloaded.generation, *reloaded.dataset, generations_kept);
+            dataset = std::move(reloaded.dataset);
+            return true;
+        };
+    }
+
+    ReusePort::enable();
+    WorkerSupervisor supervisor(worker_count, config.m_pin_workers, std::chrono::seconds(config.m_generation_poll_seconds));
+    logger->info("Prefork mode: {} workers with {} threads each on port {}", worker_count, threads, config.m_server_port);
+
+    return supervisor.run([&](size_t worker) {
+        // connected before the worker binds the port; the supervisor keeps the worker this one
+        // replaces until it reports ready from run_server
+        auto worker_pool = std::make_unique<DatabasePool>(worker_config.m_database_url, worker_config.m_db_pool_size);
+        if (!worker_pool->is_pool_healthy()) {
+            Logger::Logger::get_logger()->error("Failed to initialize database pool in worker {}", worker);
+            return 1;
+        }
+        return run_server(worker_config, std::move(worker_pool), dataset, history, threads);
+    }, tick);
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
     try {
 
@@ -28,26 +198,14 @@ int main(int argc, char* argv[]) {
 
         auto config = ServiceConfig::load_from_env();
 
-        logger->info("Initializing database connection pool...");
-        auto db_pool = std::make_unique<DatabasePool>(config.m_database_url, config.m_db_pool_size);
-        
-        if (!db_pool->is_pool_healthy()) {
-            logger->error("Failed to initialize database pool. Exiting.");
-            return 1;
+        if (config.m_worker_processes > 1) {
+            return run_prefork(config);
         }
 
-        crow::App<crow::CORSHandler> app;
-        
-        app.get_middleware<crow::CORSHandler>().global()
-            .headers("Content-Type", "Authorization")
-            .methods("GET"_method, "POST"_method, "OPTIONS"_method)
-            .origin("*");
-
-        ApiHandlers handlers(std::move(db_pool));
-        handlers.register_routes(app);
+        // the pool connects in the background once the handlers start; /readyz reports when it has
+        auto db_pool = std::make_unique<DatabasePool>(config.m_database_url, config.m_db_pool_size, true);
 
-        logger->info("Server starting on port {}...", config.m_server_port);
-        app.port(config.m_server_port).multithreaded().run();
+        return run_server(config, std::move(db_pool), nullptr, nullptr, std::thread::hardware_concurrency());
 
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
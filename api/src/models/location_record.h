@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// One row of ip_locations as served to clients. Coordinates are float because the
+// source columns are REAL.
+struct LocationRecord {
+    std::optional<std::string> country;
+    std::optional<std::string> city;
+    std::optional<std::string> region;
+    std::optional<float> latitude;
+    std::optional<float> longitude;
+    std::optional<std::string> postal_code;
+    std::optional<std::string> timezone;
+
+    bool operator==(const LocationRecord&) const = default;
+};
+
+// The same fields without owning the strings, so a record can be rendered straight out of a
+// cache value or another record without copying them.
+struct LocationRecordView {
+    std::optional<std::string_view> country;
+    std::optional<std::string_view> city;
+    std::optional<std::string_view> region;
+    std::optional<float> latitude;
+    std::optional<float> longitude;
+    std::optional<std::string_view> postal_code;
+    std::optional<std::string_view> timezone;
+
+    LocationRecordView() = default;
+    explicit LocationRecordView(const LocationRecord& record)
+        : country(view(record.country)), city(view(record.city)), region(view(record.region)),
+          latitude(record.latitude), longitude(record.longitude),
+          postal_code(view(record.postal_code)), timezone(view(record.timezone)) {}
+
+    LocationRecord to_record() const {
+        return LocationRecord{own(country), own(city), own(region), latitude, longitude, own(postal_code), own(timezone)};
+    }
+
+private:
+    static std::optional<std::string_view> view(const std::optional<std::string>& value) {
+        return value ? std::optional<std::string_view>(*value) : std::nullopt;
+    }
+    static std::optional<std::string> own(const std::optional<std::string_view>& value) {
+        return value ? std::optional<std::string>(*value) : std::nullopt;
+    }
+};
+
+struct LocationRecordHash {
+    size_t operator()(const LocationRecord& record) const {
+        size_t seed = 0;
+        auto combine = [&seed](size_t value) { seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2); };
+        auto combine_string = [&combine](const std::optional<std::string>& value) {
+            combine(value ? std::hash<std::string>{}(*value) : 0);
+        };
+        auto combine_float = [&combine](const std::optional<float>& value) {
+            combine(value ? std::hash<float>{}(*value) : 1);
+        };
+
+        combine_string(record.country);
+        combine_string(record.city);
+        combine_string(record.region);
+        combine_float(record.latitude);
+        combine_float(record.longitude);
+        combine_string(record.postal_code);
+        combine_string(record.timezone);
+        return seed;
+    }
+};
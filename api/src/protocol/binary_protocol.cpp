@@ -0,0 +1,174 @@
+#include "binary_protocol.h"
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+// string fields in wire order, with their bits in the field mask
+constexpr LocationJson::FieldMask STRING_FIELDS[] = {
+    LocationJson::COUNTRY, LocationJson::CITY, LocationJson::REGION, LocationJson::POSTAL_CODE, LocationJson::TIMEZONE,
+};
+
+void put_u32(std::string& out, uint32_t value) {
+    char bytes[4] = {static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+                     static_cast<char>(value >> 8), static_cast<char>(value)};
+    out.append(bytes, sizeof(bytes));
+}
+
+uint32_t get_u32(std::string_view data, size_t offset) {
+    auto byte = [&](size_t i) { return static_cast<uint32_t>(static_cast<unsigned char>(data[offset + i])); };
+    return (byte(0) << 24) | (byte(1) << 16) | (byte(2) << 8) | byte(3);
+}
+
+void put_float(std::string& out, std::optional<float> value) {
+    put_u32(out, value ? std::bit_cast<uint32_t>(*value) : 0);
+}
+
+// the member of a LocationRecord or LocationRecordView holding a string field
+template <typename Record>
+auto& string_field(Record& record, LocationJson::FieldMask field) {
+    switch (field) {
+        case LocationJson::COUNTRY: return record.country;
+        case LocationJson::CITY: return record.city;
+        case LocationJson::REGION: return record.region;
+        case LocationJson::POSTAL_CODE: return record.postal_code;
+        default: return record.timezone;
+    }
+}
+
+// the length prefix and fixed header of a response, with the length filled in by the caller
+size_t begin_response(std::string& out, uint32_t id, BinaryProtocol::Status status, LocationJson::FieldMask fields) {
+    size_t start = out.size();
+    put_u32(out, 0);
+    put_u32(out, id);
+    out += static_cast<char>(status);
+    out += static_cast<char>(fields);
+    out.append(2, '\0');
+    return start;
+}
+
+void end_response(std::string& out, size_t start) {
+    uint32_t length = static_cast<uint32_t>(out.size() - start - BinaryProtocol::LENGTH_SIZE);
+    for (size_t i = 0; i < 4; ++i) {
+        out[start + i] = static_cast<char>(length >> (24 - 8 * i));
+    }
+}
+
+} // namespace
+
+void BinaryProtocol::append_request(std::string& out, const Request& request) {
+    put_u32(out, static_cast<uint32_t>(REQUEST_SIZE));
+    put_u32(out, request.id);
+    out += static_cast<char>(MessageType::LOOKUP);
+    out += static_cast<char>(request.fields);
+    out.append(2, '\0');
+
+    uint128_t value = request.address.is_v4()
+        ? (static_cast<uint128_t>(0xFFFF) << 32) | request.address.v4()
+        : request.address.v6();
+    for (int shift = 120; shift >= 0; shift -= 8) {
+        out += static_cast<char>(value >> shift);
+    }
+}
+
+void BinaryProtocol::append_response(std::string& out, uint32_t id, Status status) {
+    size_t start = begin_response(out, id, status, 0);
+    out.append(8, '\0');
+    end_response(out, start);
+}
+
+void BinaryProtocol::append_response(std::string& out, uint32_t id, const LocationRecordView& record, FieldMask fields) {
+    FieldMask sent = 0;
+    if ((fields & LocationJson::LATITUDE) && record.latitude) sent |= LocationJson::LATITUDE;
+    if ((fields & LocationJson::LONGITUDE) && record.longitude) sent |= LocationJson::LONGITUDE;
+    for (FieldMask field : STRING_FIELDS) {
+        if ((fields & field) && string_field(record, field)) sent |= field;
+    }
+
+    size_t start = begin_response(out, id, Status::FOUND, sent);
+    put_float(out, (sent & LocationJson::LATITUDE) ? record.latitude : std::nullopt);
+    put_float(out, (sent & LocationJson::LONGITUDE) ? record.longitude : std::nullopt);
+    for (FieldMask field : STRING_FIELDS) {
+        if (sent & field) {
+            std::string_view value = *string_field(record, field);
+            value = value.substr(0, MAX_STRING_LENGTH);
+            out += static_cast<char>(value.size());
+            out += value;
+        }
+    }
+    end_response(out, start);
+}
+
+std::optional<size_t> BinaryProtocol::frame_length(std::string_view buffer) {
+    if (buffer.size() < LENGTH_SIZE) {
+        return std::nullopt;
+    }
+    return get_u32(buffer, 0);
+}
+
+uint32_t BinaryProtocol::frame_id(std::string_view frame) {
+    return frame.size() >= 4 ? get_u32(frame, 0) : 0;
+}
+
+std::optional<BinaryProtocol::Request> BinaryProtocol::parse_request(std::string_view frame) {
+    if (frame.size() != REQUEST_SIZE || static_cast<uint8_t>(frame[4]) != static_cast<uint8_t>(MessageType::LOOKUP)) {
+        return std::nullopt;
+    }
+    Request request;
+    request.id = get_u32(frame, 0);
+    request.fields = static_cast<FieldMask>(static_cast<uint8_t>(frame[5]) & LocationJson::ALL_FIELDS);
+
+    uint128_t value = 0;
+    for (size_t i = 8; i < REQUEST_SIZE; ++i) {
+        value = (value << 8) | static_cast<unsigned char>(frame[i]);
+    }
+    // IPv4 goes over the wire mapped; it is looked up as IPv4, as in ApiHandlers
+    request.address = IpAddress::from_v6(value).unmapped();
+    return request;
+}
+
+std::optional<BinaryProtocol::Response> BinaryProtocol::parse_response(std::string_view frame) {
+    if (frame.size() < RESPONSE_HEADER_SIZE) {
+        return std::nullopt;
+    }
+    Response response;
+    response.id = get_u32(frame, 0);
+    response.status = static_cast<Status>(static_cast<uint8_t>(frame[4]));
+    response.fields = static_cast<FieldMask>(static_cast<uint8_t>(frame[5]) & LocationJson::ALL_FIELDS);
+    if (response.fields & LocationJson::LATITUDE) {
+        response.record.latitude = std::bit_cast<float>(get_u32(frame, 8));
+    }
+    if (response.fields & LocationJson::LONGITUDE) {
+        response.record.longitude = std::bit_cast<float>(get_u32(frame, 12));
+    }
+
+    size_t offset = RESPONSE_HEADER_SIZE;
+    for (FieldMask field : STRING_FIELDS) {
+        if (!(response.fields & field)) {
+            continue;
+        }
+        if (offset >= frame.size()) {
+            return std::nullopt;
+        }
+        size_t length = static_cast<unsigned char>(frame[offset++]);
+        if (frame.size() - offset < length) {
+            return std::nullopt;
+        }
+        string_field(response.record, field) = std::string(frame.substr(offset, length));
+        offset += length;
+    }
+    return response;
+}
+
+const char* BinaryProtocol::status_to_string(Status status) {
+    switch (status) {
+        case Status::FOUND: return "found";
+        case Status::NOT_FOUND: return "not_found";
+        case Status::RESERVED: return "reserved";
+        case Status::BAD_REQUEST: return "bad_request";
+        case Status::RATE_LIMITED: return "rate_limited";
+        case Status::UNAVAILABLE: return "unavailable";
+        case Status::ERROR: return "error";
+    }
+    return "unknown";
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "../handlers/location_json.h"
+#include "../models/location_record.h"
+#include "../utils/ip_address.h"
+
+// Framing of the binary lookup protocol, spoken on BINARY_PORT and BINARY_SOCKET by
+// BinaryServer and BinaryClient. Integers and floats are big-endian.
+//
+// Every frame is preceded by its length as a u32. A lookup request is 24 bytes:
+//   [id u32][type u8 = LOOKUP][fields u8][reserved u16][address, 16 bytes]
+// where IPv4 addresses are sent IPv4-mapped (::ffff:a.b.c.d) and `fields` is a
+// LocationJson::FieldMask of what the caller wants back. The response is
+//   [id u32][status u8][fields u8][reserved u16][latitude f32][longitude f32]
+//   then [length u8 + bytes] for each of country, city, region, postal_code, timezone
+// whose bit is set in the response's `fields`, which are the requested fields the record has.
+// Strings longer than 255 bytes are cut. Responses carry their request's id and may come
+// back in any order, so a caller can keep many requests in flight on one connection.
+class BinaryProtocol {
+public:
+    using FieldMask = LocationJson::FieldMask;
+
+    static constexpr size_t LENGTH_SIZE = 4;
+    static constexpr size_t REQUEST_SIZE = 24;
+    static constexpr size_t RESPONSE_HEADER_SIZE = 16;
+    static constexpr size_t MAX_STRING_LENGTH = 255;
+    static constexpr size_t MAX_RESPONSE_SIZE = RESPONSE_HEADER_SIZE + 5 * (1 + MAX_STRING_LENGTH);
+    // a longer frame is not from a client of this protocol, and the connection is closed
+    static constexpr size_t MAX_FRAME_SIZE = 4096;
+
+    enum class MessageType : uint8_t { LOOKUP = 1 };
+
+    enum class Status : uint8_t {
+        FOUND = 0,
+        NOT_FOUND = 1,
+        RESERVED = 2,     // a special-purpose address, never located
+        BAD_REQUEST = 3,  // the frame is not a lookup request
+        RATE_LIMITED = 4,
+        UNAVAILABLE = 5,  // starting, or over a concurrency limit; retry later
+        ERROR = 6,
+    };
+
+    struct Request {
+        uint32_t id = 0;
+        FieldMask fields = LocationJson::ALL_FIELDS;
+        IpAddress address;
+    };
+
+    struct Response {
+        uint32_t id = 0;
+        Status status = Status::ERROR;
+        FieldMask fields = 0;
+        LocationRecord record;
+    };
+
+    static void append_request(std::string& out, const Request& request);
+    // a response without a record (anything but FOUND)
+    static void append_response(std::string& out, uint32_t id, Status status);
+    static void append_response(std::string& out, uint32_t id, const LocationRecordView& record, FieldMask fields);
+
+    // the length of the frame at the front of `buffer` (after its length prefix), once the
+    // prefix has arrived
+    static std::optional<size_t> frame_length(std::string_view buffer);
+    // the request id of any frame with room for one, 0 otherwise
+    static uint32_t frame_id(std::string_view frame);
+    // nullopt when the frame is not a well-formed lookup request
+    static std::optional<Request> parse_request(std::string_view frame);
+    static std::optional<Response> parse_response(std::string_view frame);
+
+    static const char* status_to_string(Status status);
+};
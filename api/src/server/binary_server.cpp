@@ -0,0 +1,396 @@
+#include "binary_server.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct BinaryServer::Connection {
+    int fd;
+    int epoll_fd;
+    std::string client;
+    std::string in; // read and parsed on the connection's I/O thread only
+
+    // the rest is shared with the workers sending answers
+    std::mutex mutex;
+    std::string out;
+    size_t out_offset = 0;
+    bool writing = false; // EPOLLOUT is watched
+    bool closed = false;
+};
+
+namespace {
+
+std::runtime_error socket_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+int listen_tcp(const std::string& bind_address, int port, int& bound_port) {
+    sockaddr_storage address{};
+    socklen_t length;
+    auto* v4 = reinterpret_cast<sockaddr_in*>(&address);
+    auto* v6 = reinterpret_cast<sockaddr_in6*>(&address);
+    uint16_t wanted = static_cast<uint16_t>(port > 0 ? port : 0);
+    if (inet_pton(AF_INET, bind_address.c_str(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons(wanted);
+        length = sizeof(sockaddr_in);
+    } else if (inet_pton(AF_INET6, bind_address.c_str(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons(wanted);
+        length = sizeof(sockaddr_in6);
+    } else {
+        throw std::runtime_error("Invalid binary protocol bind address: " + bind_address);
+    }
+
+    int fd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw socket_error("Cannot create the binary protocol socket");
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    // bind() goes through ReusePort in the service, so prefork workers share the port
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), length) != 0 || listen(fd, SOMAXCONN) != 0) {
+        auto error = socket_error("Cannot listen on " + bind_address + ":" + std::to_string(wanted));
+        close(fd);
+        throw error;
+    }
+
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    bound_port = ntohs(address.ss_family == AF_INET ? v4->sin_port : v6->sin6_port);
+    return fd;
+}
+
+int listen_unix(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Binary protocol socket path is too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw socket_error("Cannot create the binary protocol socket");
+    }
+    // a socket file left by a previous run would make bind() fail
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        auto error = socket_error("Cannot listen on " + path);
+        close(fd);
+        throw error;
+    }
+    return fd;
+}
+
+std::string peer_address(const sockaddr_storage& address) {
+    char text[INET6_ADDRSTRLEN] = {};
+    if (address.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(&address)->sin_addr, text, sizeof(text));
+    } else if (address.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(&address)->sin6_addr, text, sizeof(text));
+    } else {
+        return "unix";
+    }
+    return text;
+}
+
+} // namespace
+
+BinaryServer::BinaryServer(Options options, Handler handler)
+    : m_options(std::move(options)), m_handler(std::move(handler)) {}
+
+BinaryServer::~BinaryServer() {
+    stop();
+}
+
+void BinaryServer::start() {
+    try {
+        if (m_options.port != 0) {
+            m_tcp_fd = listen_tcp(m_options.bind_address, m_options.port, m_bound_port);
+        }
+        if (!m_options.unix_path.empty()) {
+            m_unix_fd = listen_unix(m_options.unix_path);
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+    m_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    for (size_t i = 0; i < std::max<size_t>(1, m_options.io_threads); ++i) {
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = m_stop_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &event);
+        for (int listen_fd : {m_tcp_fd, m_unix_fd}) {
+            if (listen_fd >= 0) {
+                // one thread is woken per new connection
+                event.events = EPOLLIN | EPOLLEXCLUSIVE;
+                event.data.fd = listen_fd;
+                epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+            }
+        }
+        m_epoll_fds.push_back(epoll_fd);
+    }
+    for (int epoll_fd : m_epoll_fds) {
+        m_io_threads.emplace_back([this, epoll_fd]() { run_io(epoll_fd); });
+    }
+    for (size_t i = 0; i < std::max<size_t>(1, m_options.worker_threads); ++i) {
+        m_workers.emplace_back([this]() { run_worker(); });
+    }
+}
+
+void BinaryServer::stop() {
+    m_stopping = true;
+    if (m_stop_fd >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(m_stop_fd, &one, sizeof(one));
+    }
+    for (auto& thread : m_io_threads) {
+        thread.join();
+    }
+    m_io_threads.clear();
+
+    {
+        // queued lookups would only be answered to closed connections
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        m_queue.clear();
+    }
+    m_queue_cv.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+
+    for (int epoll_fd : m_epoll_fds) {
+        close(epoll_fd);
+    }
+    m_epoll_fds.clear();
+    if (m_unix_fd >= 0) {
+        unlink(m_options.unix_path.c_str());
+    }
+    for (int* fd : {&m_tcp_fd, &m_unix_fd, &m_stop_fd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void BinaryServer::run_io(int epoll_fd) {
+    ConnectionMap connections;
+    epoll_event events[256];
+    while (!m_stopping.load(std::memory_order_relaxed)) {
+        int count = epoll_wait(epoll_fd, events, 256, -1);
+        if (count < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == m_stop_fd) {
+                continue;
+            }
+            if (fd == m_tcp_fd || fd == m_unix_fd) {
+                accept_connections(epoll_fd, fd, connections);
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            auto connection = it->second;
+            bool open = !(events[i].events & EPOLLERR);
+            if (open && (events[i].events & EPOLLOUT)) {
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                flush(*connection);
+            }
+            if (open && (events[i].events & (EPOLLIN | EPOLLHUP))) {
+                open = read_requests(connection);
+            }
+            if (!open) {
+                close_connection(*connection);
+                connections.erase(it);
+            }
+        }
+    }
+    for (auto& [fd, connection] : connections) {
+        close_connection(*connection);
+    }
+}
+
+void BinaryServer::accept_connections(int epoll_fd, int listen_fd, ConnectionMap& connections) {
+    while (true) {
+        sockaddr_storage address{};
+        socklen_t length = sizeof(address);
+        int fd = accept4(listen_fd, reinterpret_cast<sockaddr*>(&address), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return; // EAGAIN once another thread took it or the backlog is empty
+        }
+        if (listen_fd == m_tcp_fd) {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+        connection->epoll_fd = epoll_fd;
+        connection->client = listen_fd == m_tcp_fd ? peer_address(address) : "unix";
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        connections.emplace(fd, std::move(connection));
+        m_accepted.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool BinaryServer::read_requests(const std::shared_ptr<Connection>& connection) {
+    // one buffer per wakeup: the socket is level-triggered, so data left in it brings the loop
+    // back here after the other ready connections had their turn, and a client that keeps its
+    // socket full can neither hold the thread nor grow `in` past a buffer and a partial frame
+    char buffer[16384];
+    bool open = true;
+    ssize_t n;
+    do {
+        n = read(connection->fd, buffer, sizeof(buffer));
+    } while (n < 0 && errno == EINTR);
+    if (n > 0) {
+        connection->in.append(buffer, static_cast<size_t>(n));
+    } else if (n == 0) {
+        // a client that shut down its side still gets the answers that need no I/O
+        open = false;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        return false;
+    }
+
+    // every answer that needs no I/O goes out in one send
+    thread_local std::string answers;
+    answers.clear();
+    std::string_view in = connection->in;
+    size_t offset = 0;
+    while (auto length = BinaryProtocol::frame_length(in.substr(offset))) {
+        if (*length > BinaryProtocol::MAX_FRAME_SIZE) {
+            return false;
+        }
+        if (in.size() - offset < BinaryProtocol::LENGTH_SIZE + *length) {
+            break;
+        }
+        std::string_view frame = in.substr(offset + BinaryProtocol::LENGTH_SIZE, *length);
+        offset += BinaryProtocol::LENGTH_SIZE + *length;
+        m_requests.fetch_add(1, std::memory_order_relaxed);
+
+        auto request = BinaryProtocol::parse_request(frame);
+        if (!request) {
+            BinaryProtocol::append_response(answers, BinaryProtocol::frame_id(frame), BinaryProtocol::Status::BAD_REQUEST);
+            continue;
+        }
+        if (m_handler.prepare(*request, connection->client, answers)) {
+            continue;
+        }
+        if (!enqueue(Job{connection, *request})) {
+            m_rejected.fetch_add(1, std::memory_order_relaxed);
+            BinaryProtocol::append_response(answers, request->id, BinaryProtocol::Status::UNAVAILABLE);
+        }
+    }
+    connection->in.erase(0, offset);
+
+    if (!answers.empty()) {
+        send(*connection, answers);
+    }
+    return open;
+}
+
+bool BinaryServer::enqueue(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        if (m_queue.size() >= m_options.max_queued) {
+            return false;
+        }
+        m_queue.push_back(std::move(job));
+    }
+    m_queue_cv.notify_one();
+    return true;
+}
+
+void BinaryServer::run_worker() {
+    std::string answer;
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_queue_mutex);
+            m_queue_cv.wait(lock, [this]() { return m_stopping.load() || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        answer.clear();
+        m_handler.lookup(job.request, answer);
+        send(*job.connection, answer);
+    }
+}
+
+void BinaryServer::send(Connection& connection, std::string_view data) {
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    if (connection.closed) {
+        return;
+    }
+    connection.out += data;
+    flush(connection);
+    if (connection.out.size() - connection.out_offset > m_options.max_output_bytes) {
+        // the client is not reading its answers; its I/O thread sees the hangup and closes it
+        shutdown(connection.fd, SHUT_RDWR);
+    }
+}
+
+void BinaryServer::flush(Connection& connection) {
+    if (connection.closed) {
+        return;
+    }
+    while (connection.out_offset < connection.out.size()) {
+        ssize_t n = ::send(connection.fd, connection.out.data() + connection.out_offset,
+                           connection.out.size() - connection.out_offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            connection.out_offset += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            break; // EAGAIN, or an error the I/O thread will see
+        }
+    }
+    if (connection.out_offset == connection.out.size()) {
+        connection.out.clear();
+        connection.out_offset = 0;
+    }
+
+    bool writing = !connection.out.empty();
+    if (writing != connection.writing) {
+        epoll_event event{};
+        event.events = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.fd = connection.fd;
+        epoll_ctl(connection.epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.writing = writing;
+    }
+}
+
+void BinaryServer::close_connection(Connection& connection) {
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    if (connection.closed) {
+        return;
+    }
+    // under the mutex, so a worker never sends on a descriptor that has been reused
+    connection.closed = true;
+    epoll_ctl(connection.epoll_fd, EPOLL_CTL_DEL, connection.fd, nullptr);
+    close(connection.fd);
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../protocol/binary_protocol.h"
+
+// A second listener, next to Crow, speaking BinaryProtocol on persistent TCP and Unix socket
+// connections.
+//
+// Each I/O thread runs its own epoll loop over the listening sockets (EPOLLEXCLUSIVE, so one
+// thread takes each connection) and the connections it accepted. It answers every complete
+// request in what it read with `prepare`, the part of a lookup that needs no I/O, and writes
+// the answers back with one send. Requests `prepare` leaves go to a pool of worker threads
+// running `lookup`, which may block on Redis and Postgres; their answers are sent as they
+// finish, out of order, so a slow lookup holds up nothing else on its connection.
+class BinaryServer {
+public:
+    struct Options {
+        int port = 0;                  // 0: no TCP listener, -1: an ephemeral port
+        std::string bind_address = "127.0.0.1";
+        std::string unix_path;         // empty: no Unix socket
+        size_t io_threads = 2;
+        size_t worker_threads = 8;
+        // requests waiting for a worker; more are answered UNAVAILABLE
+        size_t max_queued = 4096;
+        // unsent answers a connection may pile up before it is closed as not reading
+        size_t max_output_bytes = 4 * 1024 * 1024;
+    };
+
+    struct Handler {
+        // answers into `out` and returns true, or returns false to leave the request for
+        // `lookup`. `client` is the peer address, or "unix" for the Unix socket
+        std::function<bool(const BinaryProtocol::Request&, std::string_view client, std::string& out)> prepare;
+        std::function<void(const BinaryProtocol::Request&, std::string& out)> lookup;
+    };
+
+    BinaryServer(Options options, Handler handler);
+    ~BinaryServer();
+
+    BinaryServer(const BinaryServer&) = delete;
+    BinaryServer& operator=(const BinaryServer&) = delete;
+
+    // listens and starts the threads; throws std::runtime_error when a socket cannot be bound
+    void start();
+    // closes the listeners and every connection, and joins the threads
+    void stop();
+
+    // the bound TCP port, once started
+    int port() const { return m_bound_port; }
+
+    uint64_t accepted_count() const { return m_accepted.load(std::memory_order_relaxed); }
+    uint64_t request_count() const { return m_requests.load(std::memory_order_relaxed); }
+    uint64_t rejected_count() const { return m_rejected.load(std::memory_order_relaxed); }
+
+private:
+    struct Connection;
+    using ConnectionMap = std::unordered_map<int, std::shared_ptr<Connection>>;
+    struct Job {
+        std::shared_ptr<Connection> connection;
+        BinaryProtocol::Request request;
+    };
+
+    void run_io(int epoll_fd);
+    void accept_connections(int epoll_fd, int listen_fd, ConnectionMap& connections);
+    // false when the connection has to be closed
+    bool read_requests(const std::shared_ptr<Connection>& connection);
+    void run_worker();
+    // appends to the connection's output and sends what the socket takes
+    void send(Connection& connection, std::string_view data);
+    // sends what the socket takes and watches for writability while output is left over
+    static void flush(Connection& connection);
+    static void close_connection(Connection& connection);
+    // false when the worker queue is full
+    bool enqueue(Job job);
+
+    const Options m_options;
+    const Handler m_handler;
+
+    int m_tcp_fd = -1;
+    int m_unix_fd = -1;
+    int m_stop_fd = -1;
+    int m_bound_port = 0;
+    std::vector<int> m_epoll_fds;
+    std::vector<std::thread> m_io_threads;
+    std::atomic<bool> m_stopping{false};
+
+    std::mutex m_queue_mutex;
+    std::condition_variable m_queue_cv;
+    std::deque<Job> m_queue;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<uint64_t> m_accepted{0};
+    std::atomic<uint64_t> m_requests{0};
+    std::atomic<uint64_t> m_rejected{0};
+};
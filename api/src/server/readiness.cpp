@@ -0,0 +1,67 @@
+#include "readiness.h"
+
+Readiness::Readiness(Clock::time_point start) : m_start(start) {
+    m_states.fill(State::PENDING);
+}
+
+bool Readiness::settle(Component component, State state) {
+    size_t index = static_cast<size_t>(component);
+    if (state == State::PENDING) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_states[index] != State::PENDING) {
+        return false;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_start);
+    m_states[index] = state;
+    m_settled_after[index] = elapsed;
+    if (--m_pending > 0) {
+        return false;
+    }
+    m_time_to_ready = elapsed;
+    m_ready.store(true, std::memory_order_release);
+    return true;
+}
+
+Readiness::State Readiness::state(Component component) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_states[static_cast<size_t>(component)];
+}
+
+std::optional<std::chrono::milliseconds> Readiness::settled_after(Component component) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t index = static_cast<size_t>(component);
+    if (m_states[index] == State::PENDING) {
+        return std::nullopt;
+    }
+    return m_settled_after[index];
+}
+
+std::optional<std::chrono::milliseconds> Readiness::time_to_ready() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending > 0) {
+        return std::nullopt;
+    }
+    return m_time_to_ready;
+}
+
+const char* Readiness::component_to_string(Component component) {
+    switch (component) {
+        case Component::DATABASE: return "database";
+        case Component::CACHE: return "cache";
+        case Component::DATASET: return "dataset";
+    }
+    return "unknown";
+}
+
+const char* Readiness::state_to_string(State state) {
+    switch (state) {
+        case State::PENDING: return "pending";
+        case State::READY: return "ready";
+        case State::BYPASSED: return "bypassed";
+        case State::OFF: return "off";
+    }
+    return "unknown";
+}
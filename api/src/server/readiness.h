@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+
+// Startup progress of what a worker needs before it takes lookups: the database pool's
+// minimum connections, the cache and the in-memory dataset. Each component settles once,
+// as ready, bypassed (the service runs without it, e.g. while Redis is down) or off (not
+// configured). The worker is ready once every component has settled.
+class Readiness {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Component { DATABASE, CACHE, DATASET };
+    static constexpr size_t COMPONENT_COUNT = 3;
+
+    enum class State { PENDING, READY, BYPASSED, OFF };
+
+    explicit Readiness(Clock::time_point start = Clock::now());
+
+    Readiness(const Readiness&) = delete;
+    Readiness& operator=(const Readiness&) = delete;
+
+    // later calls for the same component are ignored; returns true for the call that made
+    // the worker ready
+    bool settle(Component component, State state);
+
+    bool ready() const { return m_ready.load(std::memory_order_acquire); }
+    State state(Component component) const;
+    // time from start until the component settled; nullopt while it is pending
+    std::optional<std::chrono::milliseconds> settled_after(Component component) const;
+    std::optional<std::chrono::milliseconds> time_to_ready() const;
+
+    static const char* component_to_string(Component component);
+    static const char* state_to_string(State state);
+
+private:
+    const Clock::time_point m_start;
+    mutable std::mutex m_mutex;
+    std::array<State, COMPONENT_COUNT> m_states{};
+    std::array<std::chrono::milliseconds, COMPONENT_COUNT> m_settled_after{};
+    size_t m_pending = COMPONENT_COUNT;
+    std::chrono::milliseconds m_time_to_ready{0};
+    std::atomic<bool> m_ready{false};
+};
@@ -0,0 +1,31 @@
+#include "reuse_port.h"
+#include <atomic>
+#include <sys/socket.h>
+
+namespace {
+
+std::atomic<bool> g_reuse_port{false};
+
+} // namespace
+
+void ReusePort::enable() {
+    g_reuse_port.store(true, std::memory_order_relaxed);
+}
+
+bool ReusePort::enabled() {
+    return g_reuse_port.load(std::memory_order_relaxed);
+}
+
+extern "C" int __real_bind(int fd, const struct sockaddr* address, socklen_t length);
+
+extern "C" int __wrap_bind(int fd, const struct sockaddr* address, socklen_t length) {
+    if (ReusePort::enabled() && address && (address->sa_family == AF_INET || address->sa_family == AF_INET6)) {
+        int type = 0;
+        socklen_t type_length = sizeof(type);
+        if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_length) == 0 && type == SOCK_STREAM) {
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+        }
+    }
+    return __real_bind(fd, address, length);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Crow creates and binds its listening socket internally, with no hook to set socket options
+// first. The service executable is linked with -Wl,--wrap=bind so every bind() made from its
+// own objects (Crow and asio are header-only) goes through a wrapper that sets SO_REUSEPORT
+// on TCP sockets once enabled. Only link this file into targets built with that flag.
+namespace ReusePort {
+
+// call before the server starts; later binds of IPv4/IPv6 stream sockets share the port
+void enable();
+bool enabled();
+
+} // namespace ReusePort
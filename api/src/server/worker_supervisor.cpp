@@ -0,0 +1,277 @@
+#include "worker_supervisor.h"
+#include "../utils/logger.h"
+#include "../utils/numa_topology.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t g_stop_requested = 0;
+// in a worker, the write end of its readiness pipe until notify_ready()
+std::atomic<int> g_ready_fd{-1};
+
+void handle_stop_signal(int) {
+    g_stop_requested = 1;
+}
+
+constexpr std::chrono::milliseconds POLL_INTERVAL{50};
+
+} // namespace
+
+WorkerSupervisor::WorkerSupervisor(size_t worker_count, bool pin_workers, std::chrono::milliseconds tick_interval)
+    : m_worker_count(std::max<size_t>(worker_count, 1)), m_tick_interval(tick_interval), m_slots(m_worker_count) {
+    if (pin_workers) {
+        auto cpus = NumaTopology::allowed_cpus();
+        for (size_t i = 0; i < m_worker_count && !cpus.empty(); ++i) {
+            m_worker_cpus.push_back(cpus[i % cpus.size()]);
+        }
+    }
+}
+
+WorkerSupervisor::~WorkerSupervisor() {
+    for (auto& slot : m_slots) {
+        close_ready_fd(slot);
+    }
+}
+
+void WorkerSupervisor::request_stop() {
+    g_stop_requested = 1;
+}
+
+void WorkerSupervisor::notify_ready() {
+    int fd = g_ready_fd.exchange(-1);
+    if (fd >= 0) {
+        char ready = 1;
+        if (write(fd, &ready, 1) != 1) {
+            Logger::Logger::get_logger()->warning("Failed to report the worker ready to the supervisor");
+        }
+        close(fd);
+    }
+}
+
+int WorkerSupervisor::run(const WorkerMain& worker_main, const Tick& tick) {
+    auto logger = Logger::Logger::get_logger();
+    g_stop_requested = 0;
+    struct sigaction action{};
+    action.sa_handler = handle_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+
+    for (size_t i = 0; i < m_worker_count; ++i) {
+        spawn(i, worker_main);
+    }
+    logger->info("Supervisor {} started {} worker(s)", getpid(), m_worker_count);
+
+    auto next_tick = std::chrono::steady_clock::now() + m_tick_interval;
+    while (!g_stop_requested) {
+        reap(worker_main);
+
+        auto now = std::chrono::steady_clock::now();
+        if (tick && now >= next_tick) {
+            next_tick = now + m_tick_interval;
+            if (tick() && !g_stop_requested) {
+                replace_all(worker_main);
+            }
+        }
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+
+    logger->info("Supervisor stopping {} worker(s)", m_worker_count);
+    stop_all();
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    return 0;
+}
+
+bool WorkerSupervisor::spawn(size_t worker, const WorkerMain& worker_main) {
+    auto logger = Logger::Logger::get_logger();
+    std::cout.flush();
+    std::cerr.flush();
+
+    int ready_pipe[2];
+    if (pipe2(ready_pipe, O_CLOEXEC) != 0) {
+        logger->error("Failed to create the readiness pipe of worker {}", worker);
+        m_slots[worker].respawn_at = std::chrono::steady_clock::now() + MIN_UPTIME;
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        logger->error("Failed to fork worker {}", worker);
+        close(ready_pipe[0]);
+        close(ready_pipe[1]);
+        m_slots[worker].respawn_at = std::chrono::steady_clock::now() + MIN_UPTIME;
+        return false;
+    }
+
+    if (pid == 0) {
+        // the server in the worker installs its own handlers
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        close(ready_pipe[0]);
+        for (const auto& slot : m_slots) {
+            if (slot.ready_fd >= 0) {
+                close(slot.ready_fd);
+            }
+        }
+        g_ready_fd = ready_pipe[1];
+        if (worker < m_worker_cpus.size() && !NumaTopology::pin_current_thread_to_cpu(m_worker_cpus[worker])) {
+            logger->warning("Failed to pin worker {} to CPU {}", worker, m_worker_cpus[worker]);
+        }
+
+        int exit_code = 1;
+        try {
+            exit_code = worker_main(worker);
+        } catch (const std::exception& e) {
+            logger->error("Worker {} failed: {}", worker, e.what());
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        // skip destructors of objects inherited from the parent, which still owns them
+        _exit(exit_code);
+    }
+
+    close(ready_pipe[1]);
+    close_ready_fd(m_slots[worker]);
+    m_slots[worker].pid = pid;
+    m_slots[worker].ready_fd = ready_pipe[0];
+    m_slots[worker].started = std::chrono::steady_clock::now();
+    return true;
+}
+
+void WorkerSupervisor::reap(const WorkerMain& worker_main) {
+    auto logger = Logger::Logger::get_logger();
+    auto now = std::chrono::steady_clock::now();
+
+    int status = 0;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        auto slot = std::find_if(m_slots.begin(), m_slots.end(), [pid](const Slot& s) { return s.pid == pid; });
+        if (slot == m_slots.end()) {
+            continue; // a replaced worker finishing late
+        }
+
+        if (WIFSIGNALED(status)) {
+            logger->error("Worker {} (pid {}) killed by signal {}", slot - m_slots.begin(), pid, WTERMSIG(status));
+        } else {
+            logger->error("Worker {} (pid {}) exited with status {}", slot - m_slots.begin(), pid, WEXITSTATUS(status));
+        }
+        slot->pid = -1;
+        close_ready_fd(*slot);
+        // back off when workers die at startup, e.g. the port is taken or the database is down
+        slot->respawn_at = now - slot->started < MIN_UPTIME ? now + MIN_UPTIME : now;
+    }
+
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        if (m_slots[i].pid < 0 && now >= m_slots[i].respawn_at) {
+            ++m_restarts;
+            spawn(i, worker_main);
+        }
+    }
+}
+
+void WorkerSupervisor::replace_all(const WorkerMain& worker_main) {
+    auto logger = Logger::Logger::get_logger();
+    logger->info("Replacing {} worker(s)", m_worker_count);
+
+    // each old worker is stopped only once its replacement listens and is ready, so the port
+    // keeps an acceptor that answers lookups throughout
+    for (size_t i = 0; i < m_slots.size() && !g_stop_requested; ++i) {
+        Slot old = m_slots[i];
+        if (!spawn(i, worker_main)) {
+            logger->error("Keeping worker {} (pid {}), its replacement could not be forked", i, old.pid);
+            continue;
+        }
+        if (old.pid <= 0) {
+            continue;
+        }
+
+        Startup startup = wait_for_ready(m_slots[i].ready_fd, READY_TIMEOUT);
+        if (startup == Startup::EXITED) {
+            waitpid(m_slots[i].pid, nullptr, 0);
+            logger->error("Replacement of worker {} exited before it was ready, keeping pid {}", i, old.pid);
+            close_ready_fd(m_slots[i]);
+            m_slots[i].pid = old.pid;
+            m_slots[i].started = old.started;
+            continue;
+        }
+        if (startup == Startup::TIMED_OUT && !g_stop_requested) {
+            logger->warning("Replacement of worker {} not ready after {} s, stopping pid {} anyway", i,
+                            READY_TIMEOUT.count(), old.pid);
+        }
+        kill(old.pid, SIGTERM);
+        if (!wait_for_exit(old.pid, STOP_GRACE)) {
+            kill(old.pid, SIGKILL);
+            waitpid(old.pid, nullptr, 0);
+        }
+    }
+}
+
+void WorkerSupervisor::stop_all() {
+    for (const auto& slot : m_slots) {
+        if (slot.pid > 0) {
+            kill(slot.pid, SIGTERM);
+        }
+    }
+    for (auto& slot : m_slots) {
+        if (slot.pid > 0 && !wait_for_exit(slot.pid, STOP_GRACE)) {
+            kill(slot.pid, SIGKILL);
+            waitpid(slot.pid, nullptr, 0);
+        }
+        slot.pid = -1;
+        close_ready_fd(slot);
+    }
+}
+
+bool WorkerSupervisor::wait_for_exit(pid_t pid, std::chrono::steady_clock::duration timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        pid_t result = waitpid(pid, nullptr, WNOHANG);
+        if (result == pid || result < 0) {
+            return true;
+        }
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+    return false;
+}
+
+WorkerSupervisor::Startup WorkerSupervisor::wait_for_ready(int ready_fd, std::chrono::steady_clock::duration timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!g_stop_requested) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            break;
+        }
+        pollfd ready{ready_fd, POLLIN, 0};
+        int result = poll(&ready, 1, static_cast<int>(std::min(left, std::chrono::milliseconds(POLL_INTERVAL)).count()));
+        if (result < 0 && errno != EINTR) {
+            break;
+        }
+        if (result > 0) {
+            // a byte once the worker is ready; end of file when it exited without one
+            char byte;
+            ssize_t count = read(ready_fd, &byte, 1);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            return count == 1 ? Startup::READY : Startup::EXITED;
+        }
+    }
+    return Startup::TIMED_OUT;
+}
+
+void WorkerSupervisor::close_ready_fd(Slot& slot) {
+    if (slot.ready_fd >= 0) {
+        close(slot.ready_fd);
+        slot.ready_fd = -1;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <sys/types.h>
+
+// Prefork mode: the parent process only supervises while N forked workers each run their own
+// server on the same port (bound with SO_REUSEPORT), so the kernel spreads connections over
+// independent acceptors instead of funnelling them through one. Data loaded by the parent
+// before forking is inherited by every worker.
+class WorkerSupervisor {
+public:
+    // runs in the forked child; the return value becomes its exit code
+    using WorkerMain = std::function<int(size_t worker)>;
+    // runs in the parent every tick interval; returning true replaces all workers, one at a
+    // time, with freshly forked ones that see the parent's current state. Each old worker is
+    // stopped once its replacement has called notify_ready()
+    using Tick = std::function<bool()>;
+
+    static constexpr std::chrono::seconds STOP_GRACE{10};
+    // how long a replacement worker may take to report ready before the old one is stopped anyway
+    static constexpr std::chrono::seconds READY_TIMEOUT{60};
+    static constexpr std::chrono::seconds MIN_UPTIME{1}; // workers dying sooner are respawned after a delay
+
+    WorkerSupervisor(size_t worker_count, bool pin_workers, std::chrono::milliseconds tick_interval = std::chrono::seconds(1));
+
+    ~WorkerSupervisor();
+
+    WorkerSupervisor(const WorkerSupervisor&) = delete;
+    WorkerSupervisor& operator=(const WorkerSupervisor&) = delete;
+
+    // forks the workers and restarts any that exit until SIGTERM, SIGINT or request_stop(),
+    // then stops them; must be called while the process is single-threaded
+    int run(const WorkerMain& worker_main, const Tick& tick = nullptr);
+
+    // async-signal-safe
+    static void request_stop();
+
+    // Called by a worker once it listens and can answer lookups; replacing a worker waits for
+    // this before stopping the old one. Does nothing outside a supervised worker.
+    static void notify_ready();
+
+    // CPU each worker is pinned to, in worker order; empty when pinning is off
+    const std::vector<int>& worker_cpus() const { return m_worker_cpus; }
+    size_t restarts() const { return m_restarts; }
+
+private:
+    struct Slot {
+        pid_t pid = -1;
+        int ready_fd = -1; // read end of the worker's readiness pipe
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point respawn_at;
+    };
+
+    // false when the fork failed, in which case the slot is left as it was
+    bool spawn(size_t worker, const WorkerMain& worker_main);
+    void reap(const WorkerMain& worker_main);
+    void replace_all(const WorkerMain& worker_main);
+    void stop_all();
+    enum class Startup { READY, EXITED, TIMED_OUT };
+    static Startup wait_for_ready(int ready_fd, std::chrono::steady_clock::duration timeout);
+    static void close_ready_fd(Slot& slot);
+    static bool wait_for_exit(pid_t pid, std::chrono::steady_clock::duration timeout);
+
+    const size_t m_worker_count;
+    const std::chrono::milliseconds m_tick_interval;
+    std::vector<int> m_worker_cpus;
+    std::vector<Slot> m_slots;
+    size_t m_restarts = 0;
+};
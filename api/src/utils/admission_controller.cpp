@@ -0,0 +1,97 @@
+#include "admission_controller.h"
+#include <algorithm>
+
+AdmissionController::Permit::Permit(AdmissionController& controller)
+    : m_controller(&controller), m_start(std::chrono::steady_clock::now()) {}
+
+AdmissionController::Permit::Permit(Permit&& other) noexcept
+    : m_controller(other.m_controller), m_start(other.m_start), m_dropped(other.m_dropped) {
+    other.m_controller = nullptr;
+}
+
+AdmissionController::Permit& AdmissionController::Permit::operator=(Permit&& other) noexcept {
+    if (this != &other) {
+        if (m_controller) {
+            m_controller->on_complete(m_start, m_dropped);
+        }
+        m_controller = other.m_controller;
+        m_start = other.m_start;
+        m_dropped = other.m_dropped;
+        other.m_controller = nullptr;
+    }
+    return *this;
+}
+
+AdmissionController::Permit::~Permit() {
+    if (m_controller) {
+        m_controller->on_complete(m_start, m_dropped);
+    }
+}
+
+AdmissionController::AdmissionController() : AdmissionController(Options()) {}
+
+AdmissionController::AdmissionController(const Options& options)
+    : m_options(options),
+      m_limit(std::clamp(options.initial_limit, std::max(options.min_limit, 1), std::max(options.max_limit, 1))),
+      m_exact_limit(m_limit.load()),
+      m_window_start(std::chrono::steady_clock::now()) {}
+
+std::optional<AdmissionController::Permit> AdmissionController::try_acquire() {
+    if (m_in_flight.fetch_add(1, std::memory_order_acq_rel) >= m_limit.load(std::memory_order_relaxed)) {
+        m_in_flight.fetch_sub(1, std::memory_order_acq_rel);
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    m_admitted.fetch_add(1, std::memory_order_relaxed);
+    return Permit(*this);
+}
+
+std::chrono::microseconds AdmissionController::min_latency() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_min_latency == std::chrono::microseconds::max() ? std::chrono::microseconds(0) : m_min_latency;
+}
+
+void AdmissionController::on_complete(std::chrono::steady_clock::time_point start, bool dropped) {
+    auto now = std::chrono::steady_clock::now();
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - start);
+    // the permit still counts, so this is the concurrency the call ran at
+    int in_flight = m_in_flight.load(std::memory_order_acquire);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (now - m_window_start >= m_options.min_latency_window) {
+            if (m_window_min != std::chrono::microseconds::max()) {
+                m_min_latency = m_window_min;
+            }
+            m_window_min = std::chrono::microseconds::max();
+            m_window_start = now;
+        }
+        if (!dropped) {
+            m_window_min = std::min(m_window_min, latency);
+            m_min_latency = std::min(m_min_latency, latency);
+        }
+
+        // until a call succeeds there is no no-load latency to compare with (and max() times
+        // the tolerance would overflow); only a dropped call gets here then
+        bool queueing = dropped || m_min_latency == std::chrono::microseconds::max();
+        if (!queueing) {
+            auto threshold = std::chrono::duration_cast<std::chrono::microseconds>(m_min_latency * m_options.tolerance)
+                + m_options.latency_slack;
+            queueing = latency > threshold;
+        }
+
+        if (queueing) {
+            // one cut per round trip: completions that queued behind the same backlog count once
+            if (now - m_last_decrease >= latency) {
+                m_exact_limit = std::max<double>(m_options.min_limit, m_exact_limit * m_options.backoff);
+                m_last_decrease = now;
+                m_decreases.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else if (in_flight * 2 >= static_cast<int>(m_exact_limit)) {
+            m_exact_limit = std::min<double>(m_options.max_limit, m_exact_limit + 1.0 / m_exact_limit);
+        }
+        m_limit.store(static_cast<int>(m_exact_limit), std::memory_order_relaxed);
+    }
+
+    m_in_flight.fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+// Adaptive concurrency limit for one stage of a lookup (the Redis read or the Postgres query).
+// A request needs a permit to enter the stage; when the stage already has `limit()` requests in
+// flight it is rejected at once instead of queueing behind them. The limit follows AIMD on
+// observed latency: a completion slower than `tolerance` times the stage's no-load latency
+// (plus a fixed slack) means requests are queueing, and the limit is cut by `backoff` at most
+// once per such completion's latency; otherwise, while the limit is actually in use, it grows
+// by about one per limit's worth of completions. Failed or timed-out calls count as queueing.
+class AdmissionController {
+public:
+    struct Options {
+        int initial_limit = 32;
+        int min_limit = 2;
+        int max_limit = 1024;
+        double tolerance = 2.0;
+        double backoff = 0.9;
+        std::chrono::microseconds latency_slack{1000};
+        // the no-load latency is the minimum over the previous window, so it follows changes
+        std::chrono::milliseconds min_latency_window{10000};
+    };
+
+    // Held for the duration of the stage. Releasing it records the elapsed time as a
+    // successful call unless drop() was called first.
+    class Permit {
+    public:
+        Permit(Permit&& other) noexcept;
+        Permit& operator=(Permit&& other) noexcept;
+        Permit(const Permit&) = delete;
+        ~Permit();
+
+        // the call failed or timed out
+        void drop() { m_dropped = true; }
+
+    private:
+        friend class AdmissionController;
+        explicit Permit(AdmissionController& controller);
+
+        AdmissionController* m_controller;
+        std::chrono::steady_clock::time_point m_start;
+        bool m_dropped = false;
+    };
+
+    AdmissionController();
+    explicit AdmissionController(const Options& options);
+
+    // nullopt when the stage is at its limit
+    std::optional<Permit> try_acquire();
+
+    int limit() const { return m_limit.load(std::memory_order_relaxed); }
+    int in_flight() const { return m_in_flight.load(std::memory_order_relaxed); }
+    std::chrono::microseconds min_latency() const;
+    uint64_t admitted_count() const { return m_admitted.load(std::memory_order_relaxed); }
+    uint64_t rejected_count() const { return m_rejected.load(std::memory_order_relaxed); }
+    uint64_t decrease_count() const { return m_decreases.load(std::memory_order_relaxed); }
+
+private:
+    void on_complete(std::chrono::steady_clock::time_point start, bool dropped);
+
+    const Options m_options;
+    std::atomic<int> m_limit;
+    std::atomic<int> m_in_flight{0};
+
+    mutable std::mutex m_mutex;
+    double m_exact_limit;
+    std::chrono::microseconds m_min_latency = std::chrono::microseconds::max();
+    std::chrono::microseconds m_window_min = std::chrono::microseconds::max();
+    std::chrono::steady_clock::time_point m_window_start;
+    std::chrono::steady_clock::time_point m_last_decrease;
+
+    std::atomic<uint64_t> m_admitted{0};
+    std::atomic<uint64_t> m_rejected{0};
+    std::atomic<uint64_t> m_decreases{0};
+};
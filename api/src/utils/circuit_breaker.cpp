@@ -0,0 +1,75 @@
+#include "circuit_breaker.h"
+
+CircuitBreaker::CircuitBreaker(int failure_threshold, std::chrono::milliseconds open_duration,
+                               std::chrono::microseconds latency_budget)
+    : m_failure_threshold(failure_threshold > 0 ? failure_threshold : 1),
+      m_open_duration(open_duration),
+      m_latency_budget(latency_budget) {}
+
+bool CircuitBreaker::allow_request() {
+    State state = m_state.load(std::memory_order_acquire);
+    if (state == State::CLOSED) {
+        return true;
+    }
+
+    if (state == State::OPEN && now_ns() - m_opened_at_ns.load(std::memory_order_acquire) >= m_open_duration.count()) {
+        // only the caller that wins the transition gets to probe
+        if (m_state.compare_exchange_strong(state, State::HALF_OPEN, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+
+    m_short_circuited.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void CircuitBreaker::record_success(std::chrono::microseconds latency) {
+    if (latency > m_latency_budget) {
+        m_slow_calls.fetch_add(1, std::memory_order_relaxed);
+        record_failure();
+        return;
+    }
+
+    m_consecutive_failures.store(0, std::memory_order_relaxed);
+    State expected = State::HALF_OPEN;
+    m_state.compare_exchange_strong(expected, State::CLOSED, std::memory_order_acq_rel);
+}
+
+void CircuitBreaker::record_failure() {
+    m_failures.fetch_add(1, std::memory_order_relaxed);
+
+    if (m_state.load(std::memory_order_acquire) == State::HALF_OPEN) {
+        open();
+        return;
+    }
+
+    if (m_consecutive_failures.fetch_add(1, std::memory_order_acq_rel) + 1 >= m_failure_threshold) {
+        open();
+    }
+}
+
+void CircuitBreaker::trip() {
+    open();
+}
+
+void CircuitBreaker::open() {
+    m_opened_at_ns.store(now_ns(), std::memory_order_release);
+    m_consecutive_failures.store(0, std::memory_order_relaxed);
+    if (m_state.exchange(State::OPEN, std::memory_order_acq_rel) != State::OPEN) {
+        m_opened.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int64_t CircuitBreaker::now_ns() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* CircuitBreaker::state_to_string(State state) {
+    switch (state) {
+        case State::CLOSED: return "closed";
+        case State::OPEN: return "open";
+        case State::HALF_OPEN: return "half_open";
+        default: return "unknown";
+    }
+}
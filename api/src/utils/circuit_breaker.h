@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Circuit breaker for an optional dependency. After `failure_threshold` consecutive failures
+// (errors, or calls slower than the latency budget) the circuit opens and callers skip the
+// dependency entirely. Once `open_duration` has passed a single caller is let through as a
+// half-open probe; its outcome either closes the circuit or re-opens it.
+class CircuitBreaker {
+public:
+    enum class State { CLOSED, OPEN, HALF_OPEN };
+
+    CircuitBreaker(int failure_threshold = 5,
+                   std::chrono::milliseconds open_duration = std::chrono::milliseconds(5000),
+                   std::chrono::microseconds latency_budget = std::chrono::milliseconds(20));
+
+    // false means the call should be skipped; true must be followed by record_success/record_failure
+    bool allow_request();
+    void record_success(std::chrono::microseconds latency);
+    void record_failure();
+    // opens the circuit immediately, e.g. when the dependency is unreachable at startup
+    void trip();
+
+    State state() const { return m_state.load(std::memory_order_acquire); }
+    static const char* state_to_string(State state);
+
+    std::chrono::microseconds latency_budget() const { return m_latency_budget; }
+    uint64_t short_circuited_count() const { return m_short_circuited.load(std::memory_order_relaxed); }
+    uint64_t failure_count() const { return m_failures.load(std::memory_order_relaxed); }
+    uint64_t slow_call_count() const { return m_slow_calls.load(std::memory_order_relaxed); }
+    uint64_t opened_count() const { return m_opened.load(std::memory_order_relaxed); }
+
+private:
+    void open();
+    int64_t now_ns() const;
+
+    const int m_failure_threshold;
+    const std::chrono::nanoseconds m_open_duration;
+    const std::chrono::microseconds m_latency_budget;
+
+    std::atomic<State> m_state{State::CLOSED};
+    std::atomic<int> m_consecutive_failures{0};
+    std::atomic<int64_t> m_opened_at_ns{0};
+
+    std::atomic<uint64_t> m_short_circuited{0};
+    std::atomic<uint64_t> m_failures{0};
+    std::atomic<uint64_t> m_slow_calls{0};
+    std::atomic<uint64_t> m_opened{0};
+};
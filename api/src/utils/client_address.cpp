@@ -0,0 +1,97 @@
+#include "client_address.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+} // namespace
+
+ClientAddressResolver::ClientAddressResolver(std::vector<IpPrefix> trusted_proxies, int ipv4_prefix, int ipv6_prefix)
+    : m_trusted_proxies(std::move(trusted_proxies)),
+      m_ipv4_prefix(std::clamp(ipv4_prefix, 0, 32)),
+      m_ipv6_prefix(std::clamp(ipv6_prefix, 0, 128)) {}
+
+std::vector<IpPrefix> ClientAddressResolver::parse_prefixes(std::string_view list) {
+    std::vector<IpPrefix> prefixes;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view entry = trim(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        if (entry.empty()) {
+            continue;
+        }
+        auto prefix = IpPrefix::parse(entry);
+        if (!prefix) {
+            throw std::invalid_argument("Invalid trusted proxy: " + std::string(entry));
+        }
+        prefixes.push_back(*prefix);
+    }
+    return prefixes;
+}
+
+std::optional<IpPrefix> ClientAddressResolver::resolve(std::string_view peer, std::string_view forwarded_for,
+                                                       std::string_view real_ip) const {
+    auto client = parse_hop(peer);
+    if (client && is_trusted(*client)) {
+        if (!forwarded_for.empty()) {
+            // proxies append, so the nearest hop is last
+            while (!forwarded_for.empty()) {
+                size_t comma = forwarded_for.rfind(',');
+                std::string_view hop = comma == std::string_view::npos ? forwarded_for : forwarded_for.substr(comma + 1);
+                forwarded_for = comma == std::string_view::npos ? std::string_view() : forwarded_for.substr(0, comma);
+
+                auto address = parse_hop(hop);
+                if (!address) {
+                    break;
+                }
+                client = address;
+                if (!is_trusted(*address)) {
+                    break;
+                }
+            }
+        } else if (auto address = parse_hop(real_ip)) {
+            client = address;
+        }
+    }
+    if (!client) {
+        return std::nullopt;
+    }
+    return IpPrefix(*client, client->is_v4() ? m_ipv4_prefix : m_ipv6_prefix);
+}
+
+bool ClientAddressResolver::is_trusted(const IpAddress& address) const {
+    return std::any_of(m_trusted_proxies.begin(), m_trusted_proxies.end(),
+                       [&](const IpPrefix& prefix) { return prefix.contains(address); });
+}
+
+std::optional<IpAddress> ClientAddressResolver::parse_hop(std::string_view hop) {
+    hop = trim(hop);
+    if (!hop.empty() && hop.front() == '[') {
+        // [2001:db8::1]:443
+        size_t close = hop.find(']');
+        if (close == std::string_view::npos) {
+            return std::nullopt;
+        }
+        hop = hop.substr(1, close - 1);
+    } else if (hop.find(':') != std::string_view::npos && hop.find(':') == hop.rfind(':')) {
+        // 203.0.113.7:51234; an IPv6 address has at least two colons
+        hop = hop.substr(0, hop.find(':'));
+    }
+
+    auto address = IpAddress::parse(hop);
+    if (!address) {
+        return std::nullopt;
+    }
+    // dual-stack sockets report IPv4 peers as ::ffff:a.b.c.d
+    return address->unmapped();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+
+// Works out which client sent a request, as the rate limiter and the heavy hitter counts see it.
+//
+// The peer address of the connection is the client unless it is a trusted proxy. A trusted
+// peer's X-Forwarded-For is read from the right, past trusted hops, and the first address that
+// is not trusted is the client; if every hop is trusted, the leftmost one is. An unparseable
+// hop stops the walk at the proxy that added it. X-Real-IP is used when a trusted peer sends no
+// X-Forwarded-For. Headers from other peers are ignored, since any client can send them.
+//
+// The client's address is then cut to a prefix, /32 and /64 by default, so a host rotating
+// through the addresses of its IPv6 /64 is one client.
+class ClientAddressResolver {
+public:
+    ClientAddressResolver(std::vector<IpPrefix> trusted_proxies, int ipv4_prefix, int ipv6_prefix);
+
+    // comma-separated prefixes or addresses; throws std::invalid_argument naming a bad entry
+    static std::vector<IpPrefix> parse_prefixes(std::string_view list);
+
+    // nullopt when the peer address is unknown or unparseable
+    std::optional<IpPrefix> resolve(std::string_view peer, std::string_view forwarded_for,
+                                    std::string_view real_ip) const;
+
+    bool is_trusted(const IpAddress& address) const;
+
+private:
+    // one address as a header or socket carries it: maybe bracketed, maybe with a port
+    static std::optional<IpAddress> parse_hop(std::string_view hop);
+
+    std::vector<IpPrefix> m_trusted_proxies;
+    int m_ipv4_prefix;
+    int m_ipv6_prefix;
+};
+
+// A client's rate limit key, "203.0.113.0/24" or "unknown", in a fixed buffer.
+class ClientKey {
+public:
+    explicit ClientKey(const std::optional<IpPrefix>& prefix) {
+        m_size = prefix ? prefix->to_chars(m_data) : UNKNOWN.copy(m_data, UNKNOWN.size());
+    }
+
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+
+private:
+    static constexpr std::string_view UNKNOWN = "unknown";
+
+    char m_data[IpPrefix::MAX_TEXT_LENGTH];
+    size_t m_size;
+};
@@ -0,0 +1,156 @@
+#include "heavy_hitters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+HeavyHitters::HeavyHitters(size_t capacity, size_t width)
+    : m_capacity(std::max<size_t>(capacity, 1)),
+      m_width(std::max<size_t>(width, 1)),
+      m_counters(std::make_unique<std::atomic<uint64_t>[]>(DEPTH * m_width)),
+      m_slots(std::make_unique<Slot[]>(m_capacity)) {}
+
+uint64_t HeavyHitters::hash_key(std::string_view key) {
+    uint64_t hash = std::hash<std::string_view>{}(key);
+    return hash ? hash : 1; // 0 marks an empty slot
+}
+
+size_t HeavyHitters::counter_index(uint64_t hash, size_t row) const {
+    // rows use h1 + row * h2 (Kirsch-Mitzenmacher) rather than DEPTH independent hashes
+    uint64_t h1 = hash;
+    uint64_t h2 = (hash >> 32) | (hash << 32) | 1;
+    return row * m_width + static_cast<size_t>((h1 + row * h2) % m_width);
+}
+
+void HeavyHitters::add(std::string_view key) {
+    uint64_t hash = hash_key(key);
+    m_total.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t estimate = std::numeric_limits<uint64_t>::max();
+    for (size_t row = 0; row < DEPTH; ++row) {
+        estimate = std::min(estimate, m_counters[counter_index(hash, row)].fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+    if (estimate > m_threshold.load(std::memory_order_relaxed)) {
+        update_table(hash, key, estimate);
+    }
+}
+
+uint64_t HeavyHitters::estimate(std::string_view key) const {
+    uint64_t hash = hash_key(key);
+    uint64_t estimate = std::numeric_limits<uint64_t>::max();
+    for (size_t row = 0; row < DEPTH; ++row) {
+        estimate = std::min(estimate, m_counters[counter_index(hash, row)].load(std::memory_order_relaxed));
+    }
+    return estimate;
+}
+
+void HeavyHitters::update_table(uint64_t hash, std::string_view key, uint64_t estimate) {
+    size_t min_index = 0;
+    uint64_t min_count = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < m_capacity; ++i) {
+        Slot& slot = m_slots[i];
+        if (slot.hash.load(std::memory_order_relaxed) == hash) {
+            uint64_t count = slot.count.load(std::memory_order_relaxed);
+            while (count < estimate && !slot.count.compare_exchange_weak(count, estimate, std::memory_order_relaxed)) {
+            }
+            return;
+        }
+        uint64_t count = slot.count.load(std::memory_order_relaxed);
+        if (count < min_count) {
+            min_count = count;
+            min_index = i;
+        }
+    }
+    if (estimate <= min_count) {
+        m_threshold.store(min_count, std::memory_order_relaxed);
+        return;
+    }
+
+    // the smallest entry gives way; a writer already holding its slot wins
+    Slot& slot = m_slots[min_index];
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1) || !slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::array<uint64_t, KEY_WORDS> words{};
+    size_t length = std::min(key.size(), KEY_CAPACITY);
+    auto* bytes = reinterpret_cast<unsigned char*>(words.data());
+    bytes[0] = static_cast<unsigned char>(length);
+    std::memcpy(bytes + 1, key.data(), length);
+
+    slot.hash.store(hash, std::memory_order_relaxed);
+    slot.count.store(estimate, std::memory_order_relaxed);
+    for (size_t i = 0; i < KEY_WORDS; ++i) {
+        slot.key[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    // the evicted entry was the smallest, so nothing left in the table is below it
+    m_threshold.store(min_count, std::memory_order_relaxed);
+}
+
+std::vector<HeavyHitters::Entry> HeavyHitters::top(size_t limit) const {
+    std::unordered_map<uint64_t, Entry> entries;
+    for (size_t i = 0; i < m_capacity; ++i) {
+        const Slot& slot = m_slots[i];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        uint64_t hash = slot.hash.load(std::memory_order_relaxed);
+        uint64_t count = slot.count.load(std::memory_order_relaxed);
+        std::array<uint64_t, KEY_WORDS> words;
+        for (size_t w = 0; w < KEY_WORDS; ++w) {
+            words[w] = slot.key[w].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (hash == 0 || slot.sequence.load(std::memory_order_relaxed) != before) {
+            continue;
+        }
+
+        const auto* bytes = reinterpret_cast<const unsigned char*>(words.data());
+        auto [it, inserted] = entries.try_emplace(hash, Entry{std::string(reinterpret_cast<const char*>(bytes + 1), bytes[0]), count});
+        if (!inserted) {
+            it->second.count = std::max(it->second.count, count);
+        }
+    }
+
+    std::vector<Entry> result;
+    result.reserve(entries.size());
+    for (auto& [hash, entry] : entries) {
+        result.push_back(std::move(entry));
+    }
+    std::sort(result.begin(), result.end(), [](const Entry& a, const Entry& b) {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+    });
+    if (result.size() > limit) {
+        result.resize(limit);
+    }
+    return result;
+}
+
+void HeavyHitters::reset() {
+    for (size_t i = 0; i < DEPTH * m_width; ++i) {
+        m_counters[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < m_capacity; ++i) {
+        Slot& slot = m_slots[i];
+        uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) || !slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) {
+            continue;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.hash.store(0, std::memory_order_relaxed);
+        slot.count.store(0, std::memory_order_relaxed);
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+    m_threshold.store(0, std::memory_order_relaxed);
+    m_total.store(0, std::memory_order_relaxed);
+}
+
+uint64_t HeavyHitters::error_bound() const {
+    return static_cast<uint64_t>(std::ceil(std::exp(1.0) * static_cast<double>(total()) / static_cast<double>(m_width)));
+}
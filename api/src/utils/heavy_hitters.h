@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The most frequent keys of a stream (looked-up addresses, clients) in fixed memory.
+//
+// A Count-Min sketch of DEPTH rows by `width` counters estimates how often any key was added:
+// never less than the true count, and more by at most e * total / width with probability
+// 1 - e^-DEPTH. The `capacity` heaviest keys are kept in a table updated the Space-Saving way:
+// a key whose estimate beats the table's smallest entry takes that entry's place.
+//
+// add() never waits. Counters are relaxed atomics. Table entries are written under a
+// per-slot sequence number (a seqlock, as in TraceRing) that the writer claims with a CAS; an
+// update that finds its slot busy leaves the table alone, the sketch is always counted. Two
+// racing inserts of the same key can leave it in two slots; top() merges them.
+class HeavyHitters {
+public:
+    static constexpr size_t DEPTH = 4;
+    // longer keys (e.g. a long X-Forwarded-For chain) are counted in full but shown cut
+    static constexpr size_t KEY_CAPACITY = 63;
+
+    struct Entry {
+        std::string key;
+        uint64_t count;
+    };
+
+    HeavyHitters(size_t capacity, size_t width);
+
+    HeavyHitters(const HeavyHitters&) = delete;
+    HeavyHitters& operator=(const HeavyHitters&) = delete;
+
+    void add(std::string_view key);
+    uint64_t estimate(std::string_view key) const;
+    // heaviest first, at most `limit` entries; entries being written at the time are left out
+    std::vector<Entry> top(size_t limit) const;
+    // starts counting afresh; adds racing with it may be partly kept
+    void reset();
+
+    uint64_t total() const { return m_total.load(std::memory_order_relaxed); }
+    // how far estimate() may exceed the true count, with probability 1 - e^-DEPTH
+    uint64_t error_bound() const;
+    size_t capacity() const { return m_capacity; }
+    size_t width() const { return m_width; }
+
+private:
+    static constexpr size_t KEY_WORDS = (KEY_CAPACITY + 1 + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0}; // odd while being written
+        std::atomic<uint64_t> hash{0};     // 0 while empty
+        std::atomic<uint64_t> count{0};
+        std::array<std::atomic<uint64_t>, KEY_WORDS> key{}; // length byte, then the text
+    };
+
+    static uint64_t hash_key(std::string_view key);
+    size_t counter_index(uint64_t hash, size_t row) const;
+    void update_table(uint64_t hash, std::string_view key, uint64_t estimate);
+
+    const size_t m_capacity;
+    const size_t m_width;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_counters; // DEPTH rows of m_width
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint64_t> m_total{0};
+    // no entry in the table is smaller; keys estimated at or below it skip the table
+    std::atomic<uint64_t> m_threshold{0};
+};
@@ -0,0 +1,145 @@
+#include "ip_address.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <charconv>
+#include <cstring>
+
+namespace {
+constexpr uint128_t V4_MAPPED_PREFIX = static_cast<uint128_t>(0xFFFF) << 32;
+constexpr uint128_t V4_MAPPED_MASK = ~static_cast<uint128_t>(0xFFFFFFFF);
+}
+
+IpAddress IpAddress::from_v4(uint32_t value) {
+    IpAddress address;
+    address.m_family = Family::V4;
+    address.m_value = value;
+    return address;
+}
+
+IpAddress IpAddress::from_v6(uint128_t value) {
+    IpAddress address;
+    address.m_family = Family::V6;
+    address.m_value = value;
+    return address;
+}
+
+std::optional<IpAddress> IpAddress::parse(std::string_view text) {
+    // inet_pton needs a terminated string; nothing valid is longer than INET6_ADDRSTRLEN
+    char buf[INET6_ADDRSTRLEN];
+    if (text.empty() || text.size() >= sizeof(buf)) {
+        return std::nullopt;
+    }
+    std::memcpy(buf, text.data(), text.size());
+    buf[text.size()] = '\0';
+
+    struct in_addr addr;
+    if (inet_pton(AF_INET, buf, &addr) == 1) {
+        return from_v4(ntohl(addr.s_addr));
+    }
+
+    struct in6_addr addr6;
+    if (inet_pton(AF_INET6, buf, &addr6) == 1) {
+        uint128_t value = 0;
+        for (int i = 0; i < 16; ++i) {
+            value = (value << 8) | addr6.s6_addr[i];
+        }
+        return from_v6(value);
+    }
+
+    return std::nullopt;
+}
+
+bool IpAddress::is_v4_mapped() const {
+    return m_family == Family::V6 && (m_value & V4_MAPPED_MASK) == V4_MAPPED_PREFIX;
+}
+
+IpAddress IpAddress::unmapped() const {
+    return is_v4_mapped() ? from_v4(static_cast<uint32_t>(m_value)) : *this;
+}
+
+std::string IpAddress::to_string() const {
+    char buf[MAX_TEXT_LENGTH];
+    return std::string(buf, to_chars(buf));
+}
+
+size_t IpAddress::to_chars(char* out) const {
+    char buf[INET6_ADDRSTRLEN];
+
+    if (m_family == Family::V4) {
+        struct in_addr addr;
+        addr.s_addr = htonl(v4());
+        inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+    } else {
+        struct in6_addr addr6;
+        for (int i = 0; i < 16; ++i) {
+            addr6.s6_addr[i] = static_cast<uint8_t>(m_value >> (8 * (15 - i)));
+        }
+        inet_ntop(AF_INET6, &addr6, buf, sizeof(buf));
+    }
+    size_t length = std::strlen(buf);
+    std::memcpy(out, buf, length);
+    return length;
+}
+
+namespace {
+
+int family_bits(const IpAddress& address) {
+    return address.is_v4() ? 32 : 128;
+}
+
+uint128_t network_mask(const IpAddress& address, int length) {
+    int bits = family_bits(address);
+    if (length == 0) {
+        return 0;
+    }
+    uint128_t all = address.is_v4() ? static_cast<uint128_t>(0xFFFFFFFFu) : ~static_cast<uint128_t>(0);
+    return (all << (bits - length)) & all;
+}
+
+} // namespace
+
+IpPrefix::IpPrefix(const IpAddress& address, int length)
+    : m_length(std::clamp(length, 0, family_bits(address))) {
+    uint128_t mask = network_mask(address, m_length);
+    m_network = address.is_v4() ? IpAddress::from_v4(static_cast<uint32_t>(address.v4() & mask))
+                                : IpAddress::from_v6(address.v6() & mask);
+}
+
+std::optional<IpPrefix> IpPrefix::parse(std::string_view text) {
+    size_t slash = text.find('/');
+    auto address = IpAddress::parse(text.substr(0, slash));
+    if (!address) {
+        return std::nullopt;
+    }
+    if (slash == std::string_view::npos) {
+        return IpPrefix(*address, family_bits(*address));
+    }
+
+    std::string_view length_text = text.substr(slash + 1);
+    int length = 0;
+    auto [end, error] = std::from_chars(length_text.data(), length_text.data() + length_text.size(), length);
+    if (error != std::errc() || end != length_text.data() + length_text.size() || length_text.empty() ||
+        length < 0 || length > family_bits(*address)) {
+        return std::nullopt;
+    }
+    return IpPrefix(*address, length);
+}
+
+bool IpPrefix::contains(const IpAddress& address) const {
+    if (address.family() != m_network.family()) {
+        return false;
+    }
+    uint128_t mask = network_mask(address, m_length);
+    return address.is_v4() ? (address.v4() & mask) == m_network.v4() : (address.v6() & mask) == m_network.v6();
+}
+
+std::string IpPrefix::to_string() const {
+    char buf[MAX_TEXT_LENGTH];
+    return std::string(buf, to_chars(buf));
+}
+
+size_t IpPrefix::to_chars(char* out) const {
+    size_t length = m_network.to_chars(out);
+    out[length++] = '/';
+    return static_cast<size_t>(std::to_chars(out + length, out + MAX_TEXT_LENGTH, m_length).ptr - out);
+}
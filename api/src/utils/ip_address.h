@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using uint128_t = unsigned __int128;
+
+// An IPv4 or IPv6 address in binary form. IPv4 addresses are kept in host byte order in the
+// low 32 bits; IPv6 addresses use the full 128 bits with the first group most significant.
+class IpAddress {
+public:
+    enum class Family { V4, V6 };
+
+    IpAddress() = default;
+
+    static IpAddress from_v4(uint32_t value);
+    static IpAddress from_v6(uint128_t value);
+    static std::optional<IpAddress> parse(std::string_view text);
+
+    Family family() const { return m_family; }
+    bool is_v4() const { return m_family == Family::V4; }
+    bool is_v6() const { return m_family == Family::V6; }
+
+    uint32_t v4() const { return static_cast<uint32_t>(m_value); }
+    uint128_t v6() const { return m_value; }
+
+    // ::ffff:a.b.c.d
+    bool is_v4_mapped() const;
+    // the embedded IPv4 address for IPv4-mapped IPv6 addresses, otherwise the address itself
+    IpAddress unmapped() const;
+
+    // the longest text to_chars() writes: a full IPv4-mapped IPv6 address
+    static constexpr size_t MAX_TEXT_LENGTH = 45;
+
+    std::string to_string() const;
+    // writes the text form to `out`, which has room for MAX_TEXT_LENGTH characters, and
+    // returns its length; nothing is allocated
+    size_t to_chars(char* out) const;
+
+    bool operator==(const IpAddress&) const = default;
+
+private:
+    Family m_family = Family::V4;
+    uint128_t m_value = 0;
+};
+
+// An address block such as 10.0.0.0/8 or 2001:db8::/32. The network address has its host bits
+// cleared, so two addresses in the same block give equal prefixes.
+class IpPrefix {
+public:
+    static constexpr size_t MAX_TEXT_LENGTH = IpAddress::MAX_TEXT_LENGTH + 4; // "/128"
+
+    // keeps the first `length` bits of `address`, clamped to its family's width
+    IpPrefix(const IpAddress& address, int length);
+
+    // "address/length", or a bare address as a block of one
+    static std::optional<IpPrefix> parse(std::string_view text);
+
+    const IpAddress& network() const { return m_network; }
+    int length() const { return m_length; }
+    // false for an address of the other family
+    bool contains(const IpAddress& address) const;
+
+    std::string to_string() const;
+    // as IpAddress::to_chars, with room for MAX_TEXT_LENGTH characters
+    size_t to_chars(char* out) const;
+
+    bool operator==(const IpPrefix&) const = default;
+
+private:
+    IpAddress m_network;
+    int m_length;
+};
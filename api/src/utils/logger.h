@@ -2,6 +2,7 @@
 #include <string>
 #include <memory>
 #include <format>
+#include <string_view>
 
 namespace Logger {
 
@@ -13,28 +14,28 @@ public:
     static std::shared_ptr<Logger> get_logger();
 
     template<typename... Args>
-    void debug(const std::string& fmt_str, Args&&... args) {
+    void debug(std::string_view fmt_str, Args&&... args) {
         if (m_current_level <= Level::DEBUG) {
             log(Level::DEBUG, std::vformat(fmt_str, std::make_format_args(args...)));
         }
     }
 
     template<typename... Args>
-    void info(const std::string& fmt_str, Args&&... args) {
+    void info(std::string_view fmt_str, Args&&... args) {
         if (m_current_level <= Level::INFO) {
             log(Level::INFO, std::vformat(fmt_str, std::make_format_args(args...)));
         }
     }
 
     template<typename... Args>
-    void warning(const std::string& fmt_str, Args&&... args) {
+    void warning(std::string_view fmt_str, Args&&... args) {
         if (m_current_level <= Level::WARNING) {
             log(Level::WARNING, std::vformat(fmt_str, std::make_format_args(args...)));
         }
     }
 
     template<typename... Args>
-    void error(const std::string& fmt_str, Args&&... args) {
+    void error(std::string_view fmt_str, Args&&... args) {
         if (m_current_level <= Level::ERROR) {
             log(Level::ERROR, std::vformat(fmt_str, std::make_format_args(args...)));
         }
@@ -0,0 +1,94 @@
+#include "numa_topology.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+
+std::vector<NumaNode> NumaTopology::detect(const std::string& sysfs_root) {
+    std::vector<NumaNode> nodes;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(sysfs_root, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4
+            || !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+
+        std::ifstream cpulist_file(entry.path() / "cpulist");
+        std::string cpulist;
+        if (!cpulist_file || !std::getline(cpulist_file, cpulist)) {
+            continue;
+        }
+
+        try {
+            NumaNode node{std::stoi(name.substr(4)), parse_cpu_list(cpulist)};
+            if (!node.cpus.empty()) {
+                nodes.push_back(std::move(node));
+            }
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+
+    std::sort(nodes.begin(), nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    return nodes;
+}
+
+std::vector<int> NumaTopology::parse_cpu_list(const std::string& cpu_list) {
+    std::vector<int> cpus;
+    std::stringstream stream(cpu_list);
+    std::string part;
+    while (std::getline(stream, part, ',')) {
+        part.erase(std::remove_if(part.begin(), part.end(), [](char c) { return c == ' ' || c == '\n'; }), part.end());
+        if (part.empty()) {
+            continue;
+        }
+
+        size_t dash = part.find('-');
+        int first = std::stoi(part.substr(0, dash));
+        int last = first;
+        if (dash != std::string::npos) {
+            last = std::stoi(part.substr(dash + 1));
+        }
+        if (first < 0 || last < first) {
+            throw std::invalid_argument("Invalid cpu list: " + cpu_list);
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> NumaTopology::allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+bool NumaTopology::pin_current_thread(const NumaNode& node) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : node.cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool NumaTopology::pin_current_thread_to_cpu(int cpu) {
+    return pin_current_thread(NumaNode{-1, {cpu}});
+}
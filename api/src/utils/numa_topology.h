@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+// NUMA nodes as reported by sysfs, read without libnuma.
+class NumaTopology {
+public:
+    static inline const std::string SYSFS_NODE_ROOT = "/sys/devices/system/node";
+
+    // nodes that have at least one CPU, sorted by id; empty if sysfs has no node information
+    static std::vector<NumaNode> detect(const std::string& sysfs_root = SYSFS_NODE_ROOT);
+
+    // parses the kernel's cpulist format, e.g. "0-3,8-11"; throws std::invalid_argument
+    static std::vector<int> parse_cpu_list(const std::string& cpu_list);
+
+    // CPUs the calling thread may run on, sorted
+    static std::vector<int> allowed_cpus();
+
+    // restricts the calling thread to the node's CPUs
+    static bool pin_current_thread(const NumaNode& node);
+    // restricts the calling thread to a single CPU; threads it starts afterwards inherit this
+    static bool pin_current_thread_to_cpu(int cpu);
+};
@@ -1,13 +1,22 @@
 #include "rate_limiter.h"
 #include <algorithm>
+#include <functional>
 
 const std::chrono::minutes RateLimiter::CLEANUP_INTERVAL{5};
 
-RateLimiter::RateLimiter(int max_requests, int window_seconds) 
-    : m_max_requests(max_requests), m_window(window_seconds), m_last_cleanup(std::chrono::steady_clock::now()) {
+RateLimiter::RateLimiter(int max_requests, int window_seconds, size_t max_clients) 
+    : m_slots(std::max<size_t>(max_clients, 1)),
+      m_max_requests(max_requests),
+      m_window(window_seconds),
+      m_last_cleanup(std::chrono::steady_clock::now()) {
 }
 
-bool RateLimiter::is_allowed(const std::string& client_ip) {
+bool RateLimiter::is_allowed(std::string_view client_key) {
+    if (m_max_requests <= 0) {
+        return false;
+    }
+
+    uint64_t key = hash_key(client_key);
     std::lock_guard<std::mutex> lock(m_mutex);
     auto now = std::chrono::steady_clock::now();
     
@@ -16,34 +25,108 @@ bool RateLimiter::is_allowed(const std::string& client_ip) {
         m_last_cleanup = now;
     }
     
-    auto& client_requests = m_requests[client_ip];
-    
-    while (!client_requests.empty() && now - client_requests.front() > m_window) {
-        client_requests.pop_front();
-    }
+    Slot& slot = find_slot(key, now);
+    auto& window = slot.window;
+    expire(window, now);
+    slot.last_request = now;
     
-    if (client_requests.size() >= static_cast<size_t>(m_max_requests)) {
+    if (window.count == static_cast<size_t>(m_max_requests)) {
         return false;
     }
+    if (window.count == window.times.size()) {
+        grow(window);
+    }
     
-    client_requests.push_back(now);
+    window.times[(window.head + window.count) % window.times.size()] = now;
+    ++window.count;
     return true;
 }
 
+uint64_t RateLimiter::hash_key(std::string_view client_key) {
+    uint64_t key = std::hash<std::string_view>{}(client_key);
+    return key ? key : 1;
+}
+
+RateLimiter::Slot& RateLimiter::find_slot(uint64_t key, std::chrono::steady_clock::time_point now) {
+    size_t home = static_cast<size_t>(key % m_slots.size());
+    size_t probes = std::min(PROBE_LENGTH, m_slots.size());
+    Slot* reusable = nullptr;
+    Slot* quietest = nullptr;
+    for (size_t i = 0; i < probes; ++i) {
+        Slot& slot = m_slots[(home + i) % m_slots.size()];
+        if (slot.key == key) {
+            return slot;
+        }
+        if (reusable) {
+            continue;
+        }
+        if (slot.key == 0) {
+            reusable = &slot;
+            continue;
+        }
+        expire(slot.window, now);
+        if (slot.window.count == 0) {
+            reusable = &slot;
+        } else if (!quietest || slot.last_request < quietest->last_request) {
+            quietest = &slot;
+        }
+    }
+
+    Slot* slot = reusable;
+    if (!slot) {
+        slot = quietest;
+        ++m_evicted;
+    } else if (slot->key == 0) {
+        ++m_client_count;
+    }
+    // the ring's storage is kept for the new client
+    slot->key = key;
+    slot->window.head = 0;
+    slot->window.count = 0;
+    return *slot;
+}
+
+void RateLimiter::grow(ClientWindow& window) const {
+    // doubles up to the limit, oldest entry first, so quiet clients stay small
+    size_t capacity = std::min(std::max<size_t>(8, window.times.size() * 2), static_cast<size_t>(m_max_requests));
+    std::vector<std::chrono::steady_clock::time_point> times(capacity);
+    for (size_t i = 0; i < window.count; ++i) {
+        times[i] = window.times[(window.head + i) % window.times.size()];
+    }
+    window.times = std::move(times);
+    window.head = 0;
+}
+
+void RateLimiter::expire(ClientWindow& window, std::chrono::steady_clock::time_point now) const {
+    while (window.count > 0 && now - window.times[window.head] > m_window) {
+        window.head = (window.head + 1) % window.times.size();
+        --window.count;
+    }
+}
+
 void RateLimiter::cleanup_old_requests() {
     auto now = std::chrono::steady_clock::now();
     
-    for (auto it = m_requests.begin(); it != m_requests.end();) {
-        auto& client_requests = it->second;
-        
-        while (!client_requests.empty() && now - client_requests.front() > m_window) {
-            client_requests.pop_front();
+    for (auto& slot : m_slots) {
+        if (slot.key == 0) {
+            continue;
         }
+        expire(slot.window, now);
         
-        if (client_requests.empty()) {
-            it = m_requests.erase(it);
-        } else {
-            ++it;
+        if (slot.window.count == 0) {
+            // idle clients give their ring back
+            slot = Slot{};
+            --m_client_count;
         }
     }
-}
\ No newline at end of file
+}
+
+size_t RateLimiter::client_count() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_client_count;
+}
+
+uint64_t RateLimiter::evicted_count() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_evicted;
+}
@@ -1,21 +1,55 @@
 #pragma once
 #include <mutex>
-#include <map>
-#include <deque>
 #include <chrono>
-#include <string>
+#include <cstdint>
+#include <string_view>
+#include <vector>
 
 class RateLimiter {
 public:
-    RateLimiter(int max_requests = 100, int window_seconds = 60);
-    bool is_allowed(const std::string& client_ip);
+    static constexpr size_t DEFAULT_MAX_CLIENTS = 100000;
+
+    RateLimiter(int max_requests = 100, int window_seconds = 60, size_t max_clients = DEFAULT_MAX_CLIENTS);
+    bool is_allowed(std::string_view client_key);
     void cleanup_old_requests();
 
+    size_t max_clients() const { return m_slots.size(); }
+    size_t client_count();
+    // clients dropped to make room for new ones while every nearby slot was active
+    uint64_t evicted_count();
+
 private:
+    // A client's request times within the window, oldest at `head`, in a ring that grows up to
+    // max_requests and is then reused, so a known client is checked without allocating.
+    struct ClientWindow {
+        std::vector<std::chrono::steady_clock::time_point> times;
+        size_t head = 0;
+        size_t count = 0;
+    };
+
+    // Clients live in a fixed table of max_clients slots, found by a 64-bit hash of their key
+    // within PROBE_LENGTH slots of its home. A new client takes a free slot there, or the slot
+    // of a client with nothing left in its window, or else evicts the one that has been quiet
+    // longest. Memory and the cost of a check stay bounded however many clients show up.
+    struct Slot {
+        uint64_t key = 0; // 0 while free
+        ClientWindow window;
+        std::chrono::steady_clock::time_point last_request;
+    };
+
+    static constexpr size_t PROBE_LENGTH = 8;
+
+    static uint64_t hash_key(std::string_view client_key);
+    Slot& find_slot(uint64_t key, std::chrono::steady_clock::time_point now);
+    void grow(ClientWindow& window) const;
+    void expire(ClientWindow& window, std::chrono::steady_clock::time_point now) const;
+
     std::mutex m_mutex;
-    std::map<std::string, std::deque<std::chrono::steady_clock::time_point>> m_requests;
+    std::vector<Slot> m_slots;
+    size_t m_client_count = 0;
+    uint64_t m_evicted = 0;
     const int m_max_requests;
     const std::chrono::seconds m_window;
     std::chrono::steady_clock::time_point m_last_cleanup;
     static const std::chrono::minutes CLEANUP_INTERVAL;
-};
\ No newline at end of file
+};
@@ -0,0 +1,82 @@
+#include "request_timing.h"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+RequestTiming::HeaderMode RequestTiming::parse_header_mode(const std::string& mode) {
+    if (mode == "off") return HeaderMode::OFF;
+    if (mode == "request") return HeaderMode::ON_REQUEST;
+    if (mode == "always") return HeaderMode::ALWAYS;
+    throw std::invalid_argument("Unknown server timing mode: " + mode);
+}
+
+RequestTiming RequestTiming::start(bool header_requested, bool sampled) {
+    RequestTiming timing;
+    timing.m_header_requested = header_requested;
+    timing.m_sampled = sampled;
+    if (timing.enabled()) {
+        timing.m_start = std::chrono::steady_clock::now();
+    }
+    return timing;
+}
+
+void RequestTiming::add(Stage stage, std::chrono::nanoseconds duration) {
+    m_ran |= 1u << static_cast<unsigned>(stage);
+    m_durations[static_cast<size_t>(stage)] += duration;
+}
+
+std::chrono::nanoseconds RequestTiming::elapsed() const {
+    if (!enabled()) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::steady_clock::now() - m_start;
+}
+
+void RequestTiming::set_ip(std::string_view ip) {
+    if (!enabled()) {
+        return;
+    }
+    m_ip_length = std::min(ip.size(), m_ip.size());
+    std::copy_n(ip.data(), m_ip_length, m_ip.data());
+}
+
+std::string RequestTiming::server_timing_header() const {
+    std::string header;
+    header.reserve(256);
+    // milliseconds with microsecond precision, without going through floating point formatting
+    auto append = [&](const char* name, std::chrono::nanoseconds duration) {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        char digits[24];
+        if (!header.empty()) header += ", ";
+        header += name;
+        header += ";dur=";
+        header.append(digits, std::to_chars(digits, digits + sizeof(digits), micros / 1000).ptr);
+        header += '.';
+        auto fraction = micros % 1000;
+        header += static_cast<char>('0' + fraction / 100);
+        header += static_cast<char>('0' + fraction / 10 % 10);
+        header += static_cast<char>('0' + fraction % 10);
+    };
+
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        auto stage = static_cast<Stage>(i);
+        if (ran(stage)) {
+            append(stage_to_string(stage), duration(stage));
+        }
+    }
+    append("total", elapsed());
+    return header;
+}
+
+const char* RequestTiming::stage_to_string(Stage stage) {
+    switch (stage) {
+        case Stage::RATE_LIMIT: return "rate_limit";
+        case Stage::VALIDATE: return "validate";
+        case Stage::MEMORY: return "memory";
+        case Stage::CACHE: return "cache";
+        case Stage::POOL_WAIT: return "pool_wait";
+        case Stage::QUERY: return "query";
+        case Stage::SERIALIZE: return "serialize";
+    }
+    return "unknown";
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Steady-clock breakdown of one /ip-location request by stage. A default-constructed timing is
+// disabled: spans then cost a single branch and read no clock, so requests that neither asked
+// for a Server-Timing header nor were sampled for the trace log pay next to nothing.
+class RequestTiming {
+public:
+    enum class Stage : uint8_t {
+        RATE_LIMIT,
+        VALIDATE,   // parsing and the reserved range check
+        MEMORY,     // the in-memory dataset
+        CACHE,      // the Redis read
+        POOL_WAIT,  // waiting for a database connection
+        QUERY,
+        SERIALIZE,  // building the response, including queueing the cache fill
+    };
+    static constexpr size_t STAGE_COUNT = 7;
+
+    // Records the time spent between construction and destruction under one stage.
+    class Span {
+    public:
+        Span(RequestTiming& timing, Stage stage)
+            : m_timing(timing.enabled() ? &timing : nullptr), m_stage(stage) {
+            if (m_timing) m_start = std::chrono::steady_clock::now();
+        }
+        ~Span() {
+            if (m_timing) m_timing->add(m_stage, std::chrono::steady_clock::now() - m_start);
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        RequestTiming* m_timing;
+        Stage m_stage;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // when a response carries the Server-Timing header
+    enum class HeaderMode { OFF, ON_REQUEST, ALWAYS };
+    // throws std::invalid_argument
+    static HeaderMode parse_header_mode(const std::string& mode);
+
+    RequestTiming() = default;
+    // an enabled timing starting now
+    static RequestTiming start(bool header_requested, bool sampled);
+
+    bool enabled() const { return m_header_requested || m_sampled; }
+    bool header_requested() const { return m_header_requested; }
+    bool sampled() const { return m_sampled; }
+
+    Span span(Stage stage) { return Span(*this, stage); }
+    void add(Stage stage, std::chrono::nanoseconds duration);
+
+    bool ran(Stage stage) const { return m_ran & (1u << static_cast<unsigned>(stage)); }
+    std::chrono::nanoseconds duration(Stage stage) const { return m_durations[static_cast<size_t>(stage)]; }
+    std::chrono::nanoseconds elapsed() const;
+
+    // kept only when enabled, for the trace log
+    void set_ip(std::string_view ip);
+    std::string_view ip() const { return std::string_view(m_ip.data(), m_ip_length); }
+
+    // the stages that ran plus the total, in milliseconds: "cache;dur=0.214, ..., total;dur=1.402"
+    std::string server_timing_header() const;
+    static const char* stage_to_string(Stage stage);
+
+private:
+    bool m_header_requested = false;
+    bool m_sampled = false;
+    uint32_t m_ran = 0;
+    std::chrono::steady_clock::time_point m_start;
+    std::array<std::chrono::nanoseconds, STAGE_COUNT> m_durations{};
+    std::array<char, 46> m_ip{}; // INET6_ADDRSTRLEN
+    size_t m_ip_length = 0;
+};
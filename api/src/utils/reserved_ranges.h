@@ -0,0 +1,191 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include "ip_address.h"
+
+// IANA special-purpose address blocks (RFC 6890 registries, plus multicast and the
+// reserved class E space) that have no geographic location. Only blocks that are not
+// globally reachable are listed, and blocks nested inside a larger listed block are
+// omitted. The tables are parsed from CIDR strings and sorted at compile time.
+namespace reserved_ranges_detail {
+
+template <typename Key>
+struct Range {
+    Key first;
+    Key last;
+    const char* name;
+};
+
+struct Entry {
+    std::string_view cidr;
+    const char* name;
+};
+
+constexpr int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    throw std::invalid_argument("invalid hex digit");
+}
+
+constexpr int parse_prefix_length(std::string_view cidr, size_t& slash) {
+    slash = cidr.find('/');
+    if (slash == std::string_view::npos) throw std::invalid_argument("missing prefix length");
+    int length = 0;
+    for (size_t i = slash + 1; i < cidr.size(); ++i) {
+        length = length * 10 + (cidr[i] - '0');
+    }
+    return length;
+}
+
+constexpr Range<uint32_t> parse_v4(const Entry& entry) {
+    size_t slash = 0;
+    int length = parse_prefix_length(entry.cidr, slash);
+
+    uint32_t value = 0;
+    uint32_t octet = 0;
+    for (size_t i = 0; i < slash; ++i) {
+        if (entry.cidr[i] == '.') {
+            value = (value << 8) | octet;
+            octet = 0;
+        } else {
+            octet = octet * 10 + static_cast<uint32_t>(entry.cidr[i] - '0');
+        }
+    }
+    value = (value << 8) | octet;
+
+    uint32_t host_mask = length == 0 ? ~0u : (length == 32 ? 0u : (~0u >> length));
+    return {value & ~host_mask, value | host_mask, entry.name};
+}
+
+constexpr Range<uint128_t> parse_v6(const Entry& entry) {
+    size_t slash = 0;
+    int length = parse_prefix_length(entry.cidr, slash);
+    std::string_view address = entry.cidr.substr(0, slash);
+
+    // groups before and after "::"
+    std::array<uint16_t, 8> head{};
+    std::array<uint16_t, 8> tail{};
+    size_t head_count = 0;
+    size_t tail_count = 0;
+    bool in_tail = false;
+
+    size_t i = 0;
+    while (i < address.size()) {
+        if (address[i] == ':') {
+            if (i + 1 < address.size() && address[i + 1] == ':') {
+                in_tail = true;
+                i += 2;
+            } else {
+                ++i;
+            }
+            continue;
+        }
+        uint16_t group = 0;
+        while (i < address.size() && address[i] != ':') {
+            group = static_cast<uint16_t>((group << 4) | hex_digit(address[i]));
+            ++i;
+        }
+        if (in_tail) {
+            tail[tail_count++] = group;
+        } else {
+            head[head_count++] = group;
+        }
+    }
+
+    std::array<uint16_t, 8> groups{};
+    for (size_t g = 0; g < head_count; ++g) groups[g] = head[g];
+    for (size_t g = 0; g < tail_count; ++g) groups[8 - tail_count + g] = tail[g];
+
+    uint128_t value = 0;
+    for (uint16_t group : groups) {
+        value = (value << 16) | group;
+    }
+
+    uint128_t host_mask = length == 0 ? ~static_cast<uint128_t>(0)
+        : (length == 128 ? 0 : (~static_cast<uint128_t>(0) >> length));
+    return {value & ~host_mask, value | host_mask, entry.name};
+}
+
+template <typename Key, size_t N, typename Parse>
+constexpr std::array<Range<Key>, N> make_table(const std::array<Entry, N>& entries, Parse parse) {
+    std::array<Range<Key>, N> table{};
+    for (size_t i = 0; i < N; ++i) {
+        table[i] = parse(entries[i]);
+    }
+    std::sort(table.begin(), table.end(), [](const Range<Key>& a, const Range<Key>& b) { return a.first < b.first; });
+    for (size_t i = 1; i < N; ++i) {
+        if (table[i].first <= table[i - 1].last) throw std::invalid_argument("overlapping reserved ranges");
+    }
+    return table;
+}
+
+} // namespace reserved_ranges_detail
+
+inline constexpr auto RESERVED_IPV4_RANGES = reserved_ranges_detail::make_table<uint32_t>(
+    std::array<reserved_ranges_detail::Entry, 15>{{
+        {"0.0.0.0/8", "This network"},
+        {"10.0.0.0/8", "Private-Use"},
+        {"100.64.0.0/10", "Shared Address Space"},
+        {"127.0.0.0/8", "Loopback"},
+        {"169.254.0.0/16", "Link Local"},
+        {"172.16.0.0/12", "Private-Use"},
+        {"192.0.0.0/24", "IETF Protocol Assignments"},
+        {"192.0.2.0/24", "Documentation (TEST-NET-1)"},
+        {"192.88.99.0/24", "Deprecated 6to4 Relay Anycast"},
+        {"192.168.0.0/16", "Private-Use"},
+        {"198.18.0.0/15", "Benchmarking"},
+        {"198.51.100.0/24", "Documentation (TEST-NET-2)"},
+        {"203.0.113.0/24", "Documentation (TEST-NET-3)"},
+        {"224.0.0.0/4", "Multicast"},
+        {"240.0.0.0/4", "Reserved"},
+    }},
+    reserved_ranges_detail::parse_v4);
+
+inline constexpr auto RESERVED_IPV6_RANGES = reserved_ranges_detail::make_table<uint128_t>(
+    std::array<reserved_ranges_detail::Entry, 14>{{
+        {"::/128", "Unspecified Address"},
+        {"::1/128", "Loopback Address"},
+        {"64:ff9b:1::/48", "IPv4-IPv6 Translation"},
+        {"100::/64", "Discard-Only Address Block"},
+        {"2001:2::/48", "Benchmarking"},
+        {"2001:10::/28", "Deprecated ORCHID"},
+        {"2001:20::/28", "ORCHIDv2"},
+        {"2001:30::/28", "Drone Remote ID Protocol Entity Tags"},
+        {"2001:db8::/32", "Documentation"},
+        {"3fff::/20", "Documentation"},
+        {"5f00::/16", "Segment Routing (SRv6) SIDs"},
+        {"fc00::/7", "Unique-Local"},
+        {"fe80::/10", "Link-Local Unicast"},
+        {"ff00::/8", "Multicast"},
+    }},
+    reserved_ranges_detail::parse_v6);
+
+static_assert(RESERVED_IPV4_RANGES.front().first == 0 && RESERVED_IPV4_RANGES.front().last == 0x00FFFFFF);
+static_assert(RESERVED_IPV4_RANGES.back().first == 0xF0000000 && RESERVED_IPV4_RANGES.back().last == 0xFFFFFFFF);
+static_assert(RESERVED_IPV6_RANGES.back().first == static_cast<uint128_t>(0xFF00) << 112);
+
+class ReservedRanges {
+public:
+    // name of the reserved block containing the address, or nullptr.
+    // IPv4-mapped IPv6 addresses are checked against the IPv4 table.
+    static const char* find(const IpAddress& address) {
+        IpAddress key = address.unmapped();
+        return key.is_v4() ? find_in(RESERVED_IPV4_RANGES, key.v4()) : find_in(RESERVED_IPV6_RANGES, key.v6());
+    }
+
+private:
+    template <typename Key, size_t N>
+    static const char* find_in(const std::array<reserved_ranges_detail::Range<Key>, N>& table, Key key) {
+        auto it = std::upper_bound(table.begin(), table.end(), key,
+                                   [](Key k, const reserved_ranges_detail::Range<Key>& range) { return k < range.first; });
+        if (it == table.begin()) {
+            return nullptr;
+        }
+        --it;
+        return key <= it->last ? it->name : nullptr;
+    }
+};
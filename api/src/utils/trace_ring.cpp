@@ -0,0 +1,73 @@
+#include "trace_ring.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+TraceRecord TraceRecord::from(const RequestTiming& timing, int status) {
+    TraceRecord record;
+    record.unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record.total_ns = static_cast<uint64_t>(timing.elapsed().count());
+    for (size_t i = 0; i < RequestTiming::STAGE_COUNT; ++i) {
+        auto stage = static_cast<RequestTiming::Stage>(i);
+        record.stage_ns[i] = static_cast<uint64_t>(timing.duration(stage).count());
+        if (timing.ran(stage)) {
+            record.ran_stages |= 1u << i;
+        }
+    }
+    record.status = static_cast<uint16_t>(status);
+    auto ip = timing.ip();
+    std::memcpy(record.ip, ip.data(), std::min(ip.size(), sizeof(record.ip) - 1));
+    return record;
+}
+
+TraceRing::TraceRing(size_t capacity)
+    : m_capacity(std::max<size_t>(capacity, 1)), m_slots(std::make_unique<Slot[]>(m_capacity)) {}
+
+void TraceRing::push(const TraceRecord& record) {
+    std::array<uint64_t, WORDS> words{};
+    std::memcpy(words.data(), &record, sizeof(record));
+
+    uint64_t index = m_next.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = m_slots[index % m_capacity];
+
+    // a writer a full lap behind may still hold the slot; this record is dropped rather than waiting
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1) || !slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+std::vector<TraceRecord> TraceRing::snapshot(size_t limit) const {
+    std::vector<TraceRecord> records;
+    uint64_t next = m_next.load(std::memory_order_acquire);
+    uint64_t available = std::min<uint64_t>({next, m_capacity, limit});
+    records.reserve(available);
+
+    for (uint64_t n = 1; n <= available; ++n) {
+        const Slot& slot = m_slots[(next - n) % m_capacity];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        std::array<uint64_t, WORDS> words;
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before || before == 0) {
+            continue;
+        }
+
+        TraceRecord record;
+        std::memcpy(static_cast<void*>(&record), words.data(), sizeof(record));
+        records.push_back(record);
+    }
+    return records;
+}
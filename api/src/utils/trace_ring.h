@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "request_timing.h"
+
+// One sampled request: when it finished, its status, address and stage breakdown.
+struct TraceRecord {
+    int64_t unix_ms = 0;
+    uint64_t total_ns = 0;
+    std::array<uint64_t, RequestTiming::STAGE_COUNT> stage_ns{};
+    uint32_t ran_stages = 0; // bit per RequestTiming::Stage
+    uint16_t status = 0;
+    char ip[46] = {};
+
+    static TraceRecord from(const RequestTiming& timing, int status);
+};
+static_assert(std::is_trivially_copyable_v<TraceRecord>);
+
+// Fixed-size ring of the most recent trace records. Writers never wait: each claims the next
+// slot with one fetch_add and publishes it under a per-slot sequence number (a seqlock), so a
+// reader copying a slot that is being overwritten sees the sequence move and skips it. A writer
+// that finds its slot still held by one a full lap behind drops its record. Slot contents are
+// stored as relaxed atomic words to keep concurrent reads well-defined.
+class TraceRing {
+public:
+    explicit TraceRing(size_t capacity);
+
+    void push(const TraceRecord& record);
+    // newest first, at most `limit` records; slots being written at the time are left out
+    std::vector<TraceRecord> snapshot(size_t limit) const;
+
+    size_t capacity() const { return m_capacity; }
+    uint64_t recorded_count() const { return m_next.load(std::memory_order_relaxed); }
+    uint64_t dropped_count() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t WORDS = (sizeof(TraceRecord) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0}; // odd while being written
+        std::array<std::atomic<uint64_t>, WORDS> words{};
+    };
+
+    const size_t m_capacity;
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint64_t> m_next{0};
+    std::atomic<uint64_t> m_dropped{0};
+};
@@ -0,0 +1,176 @@
+#include "traffic_capture.h"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+constexpr char MAGIC[8] = {'I', 'P', 'L', 'C', 'A', 'P', '0', '1'};
+constexpr uint128_t V4_MAPPED_PREFIX = static_cast<uint128_t>(0xFFFF) << 32;
+
+void append_le64(std::string& out, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out += static_cast<char>((value >> shift) & 0xFF);
+    }
+}
+
+uint64_t read_le64(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+} // namespace
+
+void TrafficLog::append_header(std::string& out, int64_t start_unix_ns) {
+    out.append(MAGIC, sizeof(MAGIC));
+    append_le64(out, static_cast<uint64_t>(start_unix_ns));
+}
+
+void TrafficLog::append_record(std::string& out, const CapturedRequest& request) {
+    append_le64(out, request.offset_ns);
+    uint128_t value = request.address.is_v4() ? V4_MAPPED_PREFIX | request.address.v4() : request.address.v6();
+    for (int shift = 120; shift >= 0; shift -= 8) {
+        out += static_cast<char>(static_cast<uint8_t>(value >> shift));
+    }
+    out += static_cast<char>(request.fields);
+}
+
+TrafficLog::Contents TrafficLog::read(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open capture file " + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (in.bad()) {
+        throw std::runtime_error("Cannot read capture file " + path);
+    }
+    if (data.size() < HEADER_SIZE || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a capture file");
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    Contents contents;
+    contents.start_unix_ns = static_cast<int64_t>(read_le64(bytes + sizeof(MAGIC)));
+    size_t count = (data.size() - HEADER_SIZE) / RECORD_SIZE;
+    contents.requests.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* p = bytes + HEADER_SIZE + i * RECORD_SIZE;
+        CapturedRequest request;
+        request.offset_ns = read_le64(p);
+        uint128_t value = 0;
+        for (int j = 0; j < 16; ++j) {
+            value = (value << 8) | p[8 + j];
+        }
+        request.address = IpAddress::from_v6(value).unmapped();
+        request.fields = p[24];
+        contents.requests.push_back(request);
+    }
+    return contents;
+}
+
+TrafficCapture::TrafficCapture(const std::string& path, size_t capacity, std::chrono::milliseconds flush_interval)
+    : m_path(path),
+      m_mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+      m_flush_interval(flush_interval),
+      m_start(std::chrono::steady_clock::now()),
+      m_slots(std::make_unique<Slot[]>(m_mask + 1)) {
+    for (size_t i = 0; i <= m_mask; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        throw std::runtime_error("Cannot create capture file " + path + ": " + std::strerror(errno));
+    }
+    std::string header;
+    auto start_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    TrafficLog::append_header(header, start_unix_ns);
+    std::fwrite(header.data(), 1, header.size(), m_file);
+
+    m_writer = std::thread(&TrafficCapture::run, this);
+}
+
+TrafficCapture::~TrafficCapture() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_writer.join();
+    std::fclose(m_file);
+}
+
+void TrafficCapture::record(const IpAddress& address, uint8_t fields) {
+    auto offset = std::chrono::steady_clock::now() - m_start;
+    uint64_t position = m_tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &m_slots[position & m_mask];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (sequence < position) {
+            // the writer has not freed this slot since the last lap: the ring is full
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            position = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+    slot->request.offset_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(offset).count());
+    slot->request.address = address;
+    slot->request.fields = fields;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    m_captured.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool TrafficCapture::drain(std::string& buffer) {
+    buffer.clear();
+    // at most one lap, so writers refilling the ring cannot keep this pass going
+    for (size_t i = 0; i <= m_mask; ++i) {
+        Slot& slot = m_slots[m_head & m_mask];
+        if (slot.sequence.load(std::memory_order_acquire) != m_head + 1) {
+            break;
+        }
+        TrafficLog::append_record(buffer, slot.request);
+        slot.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+        ++m_head;
+    }
+    if (buffer.empty()) {
+        return false;
+    }
+    size_t records = buffer.size() / TrafficLog::RECORD_SIZE;
+    if (std::fwrite(buffer.data(), 1, buffer.size(), m_file) == buffer.size()) {
+        m_written.fetch_add(records, std::memory_order_relaxed);
+    } else {
+        m_failed.fetch_add(records, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void TrafficCapture::run() {
+    std::string buffer;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        lock.unlock();
+        bool wrote = drain(buffer);
+        if (wrote) {
+            std::fflush(m_file);
+        }
+        lock.lock();
+        m_cv.wait_for(lock, m_flush_interval, [this] { return m_stop; });
+    }
+    lock.unlock();
+    drain(buffer);
+    std::fflush(m_file);
+}
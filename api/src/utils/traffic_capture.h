@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ip_address.h"
+
+// One captured lookup: when it arrived, relative to the start of its log, and its key.
+struct CapturedRequest {
+    uint64_t offset_ns = 0;
+    IpAddress address;
+    uint8_t fields = 0; // LocationJson::FieldMask
+};
+
+// The capture file format. A 16-byte header ("IPLCAP01", then the capture's start as
+// nanoseconds since the Unix epoch, little-endian) is followed by 25-byte records: the
+// little-endian offset in nanoseconds, the address as 16 bytes in network order (IPv4
+// mapped into ::ffff:0:0/96) and the field mask.
+class TrafficLog {
+public:
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t RECORD_SIZE = 25;
+
+    static void append_header(std::string& out, int64_t start_unix_ns);
+    static void append_record(std::string& out, const CapturedRequest& request);
+
+    struct Contents {
+        int64_t start_unix_ns = 0;
+        std::vector<CapturedRequest> requests;
+    };
+    // throws std::runtime_error if the file cannot be read or is not a capture; a record cut
+    // short at the end, from a capture that was still running, is left out
+    static Contents read(const std::string& path);
+};
+
+// Samples lookups into a capture file for replay_traffic without slowing them down.
+//
+// record() never blocks and never allocates: it claims a slot in a bounded ring with one CAS
+// and publishes it with a per-slot sequence number (Vyukov's bounded queue, with a single
+// consumer). When the ring is full the record is dropped and counted. A background thread
+// drains the ring into the file in batches.
+class TrafficCapture {
+public:
+    // throws std::runtime_error if the file cannot be created; `capacity` is rounded up to a
+    // power of two
+    TrafficCapture(const std::string& path, size_t capacity,
+                   std::chrono::milliseconds flush_interval = std::chrono::milliseconds(10));
+    // writes out what is left in the ring
+    ~TrafficCapture();
+
+    TrafficCapture(const TrafficCapture&) = delete;
+    TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+    void record(const IpAddress& address, uint8_t fields);
+
+    const std::string& path() const { return m_path; }
+    uint64_t captured_count() const { return m_captured.load(std::memory_order_relaxed); }
+    uint64_t dropped_count() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t written_count() const { return m_written.load(std::memory_order_relaxed); }
+    uint64_t failed_count() const { return m_failed.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        CapturedRequest request;
+    };
+
+    void run();
+    // moves what is published to the file; false when nothing was
+    bool drain(std::string& buffer);
+
+    const std::string m_path;
+    const size_t m_mask;
+    const std::chrono::milliseconds m_flush_interval;
+    const std::chrono::steady_clock::time_point m_start;
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint64_t> m_tail{0};
+    uint64_t m_head = 0; // the writer thread's alone
+    FILE* m_file = nullptr;
+
+    std::atomic<uint64_t> m_captured{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_written{0};
+    std::atomic<uint64_t> m_failed{0};
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    std::thread m_writer;
+};
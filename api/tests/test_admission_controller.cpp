@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "utils/admission_controller.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class AdmissionControllerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        //starts at 4 concurrent calls, between 2 and 8
+        options.initial_limit = 4;
+        options.min_limit = 2;
+        options.max_limit = 8;
+        options.latency_slack = std::chrono::milliseconds(1);
+        controller = std::make_unique<AdmissionController>(options);
+    }
+
+    AdmissionController::Options options;
+    std::unique_ptr<AdmissionController> controller;
+};
+
+TEST_F(AdmissionControllerTest, RejectsCallsOverTheLimit) {
+    std::vector<AdmissionController::Permit> permits;
+    for (int i = 0; i < 4; ++i) {
+        auto permit = controller->try_acquire();
+        ASSERT_TRUE(permit.has_value());
+        permits.push_back(std::move(*permit));
+    }
+    EXPECT_EQ(controller->in_flight(), 4);
+    EXPECT_FALSE(controller->try_acquire().has_value());
+    EXPECT_EQ(controller->rejected_count(), 1u);
+    EXPECT_EQ(controller->in_flight(), 4);
+
+    permits.pop_back();
+    EXPECT_EQ(controller->in_flight(), 3);
+    EXPECT_TRUE(controller->try_acquire().has_value());
+    EXPECT_EQ(controller->admitted_count(), 5u);
+}
+
+TEST_F(AdmissionControllerTest, DroppedCallsCutTheLimit) {
+    auto permit = controller->try_acquire();
+    ASSERT_TRUE(permit.has_value());
+    permit->drop();
+    permit.reset();
+
+    EXPECT_EQ(controller->limit(), 3);
+    EXPECT_EQ(controller->decrease_count(), 1u);
+    // a dropped call does not set the no-load latency
+    EXPECT_EQ(controller->min_latency(), std::chrono::microseconds(0));
+}
+
+TEST_F(AdmissionControllerTest, QueueingDelayCutsTheLimit) {
+    // a fast call sets the no-load latency
+    controller->try_acquire().reset();
+    EXPECT_EQ(controller->limit(), 4);
+
+    auto slow = controller->try_acquire();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    slow.reset();
+
+    EXPECT_EQ(controller->limit(), 3);
+    EXPECT_LT(controller->min_latency(), std::chrono::milliseconds(20));
+}
+
+TEST_F(AdmissionControllerTest, LimitStaysWithinBounds) {
+    for (int i = 0; i < 100; ++i) {
+        auto permit = controller->try_acquire();
+        ASSERT_TRUE(permit.has_value());
+        permit->drop();
+    }
+    EXPECT_EQ(controller->limit(), options.min_limit);
+
+    // fast calls with the limit in use grow it back, up to the maximum
+    for (int i = 0; i < 1000; ++i) {
+        std::vector<AdmissionController::Permit> permits;
+        while (auto permit = controller->try_acquire()) {
+            permits.push_back(std::move(*permit));
+        }
+    }
+    EXPECT_EQ(controller->limit(), options.max_limit);
+}
+
+TEST_F(AdmissionControllerTest, IdleCapacityDoesNotGrowTheLimit) {
+    for (int i = 0; i < 1000; ++i) {
+        controller->try_acquire().reset();
+    }
+    EXPECT_EQ(controller->limit(), 4);
+}
+
+TEST_F(AdmissionControllerTest, ConcurrentCallsNeverExceedTheLimit) {
+    std::atomic<int> peak{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 2000; ++i) {
+                if (auto permit = controller->try_acquire()) {
+                    int current = controller->in_flight();
+                    int seen = peak.load();
+                    while (current > seen && !peak.compare_exchange_weak(seen, current)) {}
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_LE(peak.load(), options.max_limit);
+    EXPECT_EQ(controller->in_flight(), 0);
+    EXPECT_EQ(controller->admitted_count() + controller->rejected_count(), 16000u);
+}
@@ -2,7 +2,10 @@
 #include "config/service_config.h"
 #include "handlers/api_handlers.h"
 #include "utils/logger.h"
+#include <chrono>
 #include <memory>
+#include <string>
+#include <thread>
 #include <crow.h>
 
 class ApiHandlersTest : public ::testing::Test {
@@ -33,6 +36,21 @@ TEST_F(ApiHandlersTest, HealthCheckEndpoint) {
     EXPECT_NE(response.body.find("status"), std::string::npos);
 }
 
+TEST_F(ApiHandlersTest, LivenessDoesNotWaitForStartup) {
+    auto response = handlers->handle_liveness();
+    EXPECT_EQ(response.code, 200);
+    EXPECT_NE(response.body.find("alive"), std::string::npos);
+}
+
+TEST_F(ApiHandlersTest, ReadinessReportsEachComponent) {
+    auto response = handlers->handle_readiness();
+
+    EXPECT_TRUE(response.code == 200 || response.code == 503);
+    EXPECT_NE(response.body.find("database"), std::string::npos);
+    EXPECT_NE(response.body.find("cache"), std::string::npos);
+    EXPECT_NE(response.body.find("dataset"), std::string::npos);
+}
+
 TEST_F(ApiHandlersTest, RootEndpoint) {
     auto response = handlers->handle_root();
     
@@ -71,6 +89,16 @@ TEST_F(ApiHandlersTest, IPLocationWithMissingIP) {
     EXPECT_NE(response.body.find("IP address parameter 'ip' is missing"), std::string::npos);
 }
 
+TEST_F(ApiHandlersTest, IPLocationWithUnknownField) {
+    crow::request req;
+    req.url_params = crow::query_string("?ip=8.8.8.8&fields=country,asn");
+
+    auto response = handlers->handle_ip_location(req);
+
+    EXPECT_EQ(response.code, 400);
+    EXPECT_NE(response.body.find("INVALID_FIELDS"), std::string::npos);
+}
+
 TEST_F(ApiHandlersTest, ErrorResponseFormat) {
     crow::request req;
     req.url_params = crow::query_string("?ip=invalid");
@@ -114,6 +142,121 @@ TEST_F(ApiHandlersTest, RateLimitingFunctionality) {
     EXPECT_TRUE(found_rate_limit || responses.size() > 0);
 }
 
+TEST_F(ApiHandlersTest, ServerTimingHeaderOnRequest) {
+    crow::request req;
+    req.url_params = crow::query_string("?ip=10.0.0.1");
+
+    auto plain = handlers->handle_ip_location(req);
+    EXPECT_TRUE(plain.get_header_value("Server-Timing").empty());
+
+    req.headers.insert({"X-Server-Timing", "1"});
+    auto timed = handlers->handle_ip_location(req);
+    std::string header = timed.get_header_value("Server-Timing");
+    EXPECT_NE(header.find("rate_limit;dur="), std::string::npos);
+    EXPECT_NE(header.find("validate;dur="), std::string::npos);
+    EXPECT_NE(header.find("total;dur="), std::string::npos);
+}
+
+TEST_F(ApiHandlersTest, AsyncLookupCompletesOnTheConnectionContext) {
+    auto config = ServiceConfig::load_from_env();
+    config.m_request_pipeline = "async";
+    config.m_ipv4_index = "off";
+    auto pool = std::make_unique<DatabasePool>(config.m_database_url, config.m_db_pool_size);
+    ApiHandlers async_handlers(std::move(pool), config);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+    while (!async_handlers.ready() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (!async_handlers.ready()) {
+        GTEST_SKIP() << "needs Postgres and Redis";
+    }
+
+    // an address no earlier run has cached, so the lookup misses Redis and queries Postgres
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string ip = "1." + std::to_string((seconds >> 16) & 0xFF) + "." + std::to_string((seconds >> 8) & 0xFF) + "." +
+                     std::to_string(seconds & 0xFF);
+    asio::io_context connection_context;
+    crow::request req;
+    req.io_context = &connection_context;
+    req.url_params = crow::query_string("?ip=" + ip);
+    req.headers.insert({"X-Server-Timing", "1"});
+    crow::response res;
+    async_handlers.handle_ip_location_async(req, res);
+
+    // the lookup finishes on the reactor, but only the connection's context may end the response
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_FALSE(res.is_completed());
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!res.is_completed() && std::chrono::steady_clock::now() < deadline) {
+        connection_context.run_for(std::chrono::milliseconds(10));
+        connection_context.restart();
+    }
+    ASSERT_TRUE(res.is_completed());
+
+    EXPECT_TRUE(res.code == 200 || res.code == 404) << res.body;
+    std::string timing = res.get_header_value("Server-Timing");
+    EXPECT_NE(timing.find("cache;dur="), std::string::npos);
+    EXPECT_NE(timing.find("query;dur="), std::string::npos);
+}
+
+TEST_F(ApiHandlersTest, DebugTracesDisabledByDefault) {
+    crow::request req;
+    auto response = handlers->handle_debug_traces(req);
+    EXPECT_EQ(response.code, 404);
+}
+
+TEST_F(ApiHandlersTest, HeavyHittersCountClientsAndAddresses) {
+    crow::request req;
+    req.remote_ip_address = "198.51.100.23";
+    req.url_params = crow::query_string("?ip=10.1.2.3");
+    for (int i = 0; i < 3; ++i) {
+        handlers->handle_ip_location(req);
+    }
+
+    crow::request debug;
+    auto response = handlers->handle_debug_heavy_hitters(debug);
+    EXPECT_EQ(response.code, 200);
+    EXPECT_NE(response.body.find("198.51.100.23/32"), std::string::npos);
+    EXPECT_NE(response.body.find("10.1.2.3"), std::string::npos);
+
+    // a GET never resets; the admin POST does
+    debug.url_params = crow::query_string("?reset=true");
+    handlers->handle_debug_heavy_hitters(debug);
+    EXPECT_NE(handlers->handle_debug_heavy_hitters(debug).body.find("10.1.2.3"), std::string::npos);
+    crow::request reset;
+    reset.method = crow::HTTPMethod::Post;
+    EXPECT_EQ(handlers->handle_reset_heavy_hitters(reset).code, 403);
+    reset.headers.insert({ApiHandlers::ADMIN_HEADER, "1"});
+    EXPECT_EQ(handlers->handle_reset_heavy_hitters(reset).code, 204);
+    EXPECT_EQ(handlers->handle_debug_heavy_hitters(debug).body.find("10.1.2.3"), std::string::npos);
+}
+
+TEST_F(ApiHandlersTest, AdminActionsNeedTheAdminHeader) {
+    crow::request req;
+    req.method = crow::HTTPMethod::Post;
+    req.url_params = crow::query_string("?serve=latest");
+    EXPECT_EQ(handlers->handle_serve_generation(req).code, 403);
+
+    // past the header check, in-memory lookups are off by default
+    req.headers.insert({ApiHandlers::ADMIN_HEADER, "1"});
+    EXPECT_EQ(handlers->handle_serve_generation(req).code, 404);
+}
+
+TEST_F(ApiHandlersTest, CacheHeadersOnReservedAndErrorResponses) {
+    crow::request reserved;
+    reserved.url_params = crow::query_string("?ip=10.1.2.3");
+    auto response = handlers->handle_ip_location(reserved);
+    EXPECT_EQ(response.code, 404);
+    EXPECT_EQ(response.get_header_value("Cache-Control"), HttpCachePolicy::reserved_cache_control());
+
+    crow::request invalid;
+    invalid.url_params = crow::query_string("?ip=invalid_ip");
+    response = handlers->handle_ip_location(invalid);
+    EXPECT_EQ(response.code, 400);
+    EXPECT_EQ(response.get_header_value("Cache-Control"), "no-store");
+    EXPECT_TRUE(response.get_header_value("ETag").empty());
+}
 
 TEST_F(ApiHandlersTest, RouteRegistration) {
     crow::App<> app;
@@ -121,6 +264,7 @@ TEST_F(ApiHandlersTest, RouteRegistration) {
     // should not throw when registering routes
     EXPECT_NO_THROW({
         handlers->register_routes(app);
+        handlers->register_admin_routes(app);
     });
 }
 
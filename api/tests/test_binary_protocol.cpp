@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "protocol/binary_protocol.h"
+
+namespace {
+
+std::string_view frame_of(const std::string& bytes) {
+    auto length = BinaryProtocol::frame_length(bytes);
+    EXPECT_TRUE(length.has_value());
+    EXPECT_EQ(bytes.size(), BinaryProtocol::LENGTH_SIZE + *length);
+    return std::string_view(bytes).substr(BinaryProtocol::LENGTH_SIZE);
+}
+
+} // namespace
+
+TEST(BinaryProtocolTest, RequestRoundTrip) {
+    std::string bytes;
+    auto address = IpAddress::parse("2001:db8::1");
+    BinaryProtocol::append_request(bytes, BinaryProtocol::Request{7, LocationJson::COUNTRY, *address});
+    EXPECT_EQ(bytes.size(), BinaryProtocol::LENGTH_SIZE + BinaryProtocol::REQUEST_SIZE);
+
+    auto request = BinaryProtocol::parse_request(frame_of(bytes));
+    ASSERT_TRUE(request.has_value());
+    EXPECT_EQ(request->id, 7u);
+    EXPECT_EQ(request->fields, LocationJson::COUNTRY);
+    EXPECT_EQ(request->address, *address);
+}
+
+TEST(BinaryProtocolTest, Ipv4TravelsMapped) {
+    std::string bytes;
+    auto address = IpAddress::parse("203.0.113.9");
+    BinaryProtocol::append_request(bytes, BinaryProtocol::Request{1, LocationJson::ALL_FIELDS, *address});
+
+    //::ffff:203.0.113.9 on the wire
+    EXPECT_EQ(static_cast<unsigned char>(bytes[4 + 8 + 10]), 0xFF);
+    EXPECT_EQ(static_cast<unsigned char>(bytes[4 + 8 + 12]), 203);
+
+    auto request = BinaryProtocol::parse_request(frame_of(bytes));
+    ASSERT_TRUE(request.has_value());
+    EXPECT_TRUE(request->address.is_v4());
+    EXPECT_EQ(request->address, *address);
+}
+
+TEST(BinaryProtocolTest, ResponseCarriesRequestedFieldsOnly) {
+    LocationRecord record;
+    record.country = "CA";
+    record.city = "Stratford";
+    record.latitude = 43.36679f;
+    record.longitude = -80.94972f;
+    record.timezone = "America/Toronto";
+
+    std::string bytes;
+    BinaryProtocol::append_response(bytes, 42, LocationRecordView(record),
+                                    LocationJson::COUNTRY | LocationJson::LATITUDE | LocationJson::REGION);
+    auto response = BinaryProtocol::parse_response(frame_of(bytes));
+    ASSERT_TRUE(response.has_value());
+    EXPECT_EQ(response->id, 42u);
+    EXPECT_EQ(response->status, BinaryProtocol::Status::FOUND);
+    //region was asked for but the record has none
+    EXPECT_EQ(response->fields, LocationJson::COUNTRY | LocationJson::LATITUDE);
+    EXPECT_EQ(response->record.country, "CA");
+    EXPECT_EQ(response->record.latitude, 43.36679f);
+    EXPECT_FALSE(response->record.city.has_value());
+    EXPECT_FALSE(response->record.longitude.has_value());
+
+    bytes.clear();
+    BinaryProtocol::append_response(bytes, 43, LocationRecordView(record), LocationJson::ALL_FIELDS);
+    response = BinaryProtocol::parse_response(frame_of(bytes));
+    ASSERT_TRUE(response.has_value());
+    EXPECT_EQ(response->record, record);
+}
+
+TEST(BinaryProtocolTest, StatusOnlyResponse) {
+    std::string bytes;
+    BinaryProtocol::append_response(bytes, 9, BinaryProtocol::Status::RESERVED);
+    EXPECT_EQ(bytes.size(), BinaryProtocol::LENGTH_SIZE + BinaryProtocol::RESPONSE_HEADER_SIZE);
+
+    auto response = BinaryProtocol::parse_response(frame_of(bytes));
+    ASSERT_TRUE(response.has_value());
+    EXPECT_EQ(response->id, 9u);
+    EXPECT_EQ(response->status, BinaryProtocol::Status::RESERVED);
+    EXPECT_EQ(response->fields, 0);
+}
+
+TEST(BinaryProtocolTest, RejectsMalformedFrames) {
+    std::string bytes;
+    BinaryProtocol::append_request(bytes, BinaryProtocol::Request{5, LocationJson::ALL_FIELDS, IpAddress::from_v4(1)});
+    std::string_view frame = std::string_view(bytes).substr(BinaryProtocol::LENGTH_SIZE);
+
+    EXPECT_FALSE(BinaryProtocol::parse_request(frame.substr(0, 20)).has_value());
+    std::string wrong_type(frame);
+    wrong_type[4] = 9;
+    EXPECT_FALSE(BinaryProtocol::parse_request(wrong_type).has_value());
+    EXPECT_EQ(BinaryProtocol::frame_id(wrong_type), 5u);
+
+    //a string length running past the frame
+    LocationRecord record;
+    record.city = "Stratford";
+    std::string response;
+    BinaryProtocol::append_response(response, 1, LocationRecordView(record), LocationJson::ALL_FIELDS);
+    response.pop_back();
+    EXPECT_FALSE(BinaryProtocol::parse_response(std::string_view(response).substr(BinaryProtocol::LENGTH_SIZE)).has_value());
+
+    EXPECT_FALSE(BinaryProtocol::frame_length("abc").has_value());
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include "client/binary_client.h"
+#include "server/binary_server.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+class BinaryServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_socket_path = "/tmp/binary_server_test_" + std::to_string(getpid()) + ".sock";
+        m_record.country = "CA";
+        m_record.city = "Stratford";
+    }
+
+    // 1.1.1.1 is answered inline, 10/8 is reserved, 2.2.2.2 takes a slow lookup and anything
+    // else is not found by a worker
+    BinaryServer::Handler handler() {
+        return BinaryServer::Handler{
+            [this](const BinaryProtocol::Request& request, std::string_view, std::string& out) {
+                if (request.address == *IpAddress::parse("1.1.1.1")) {
+                    BinaryProtocol::append_response(out, request.id, LocationRecordView(m_record), request.fields);
+                    return true;
+                }
+                if (request.address.is_v4() && (request.address.v4() >> 24) == 10) {
+                    BinaryProtocol::append_response(out, request.id, BinaryProtocol::Status::RESERVED);
+                    return true;
+                }
+                return false;
+            },
+            [](const BinaryProtocol::Request& request, std::string& out) {
+                if (request.address == *IpAddress::parse("2.2.2.2")) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                }
+                BinaryProtocol::append_response(out, request.id, BinaryProtocol::Status::NOT_FOUND);
+            },
+        };
+    }
+
+    std::unique_ptr<BinaryServer> start_server(int port = 0, size_t io_threads = 2) {
+        BinaryServer::Options options;
+        options.port = port;
+        options.unix_path = m_socket_path;
+        options.io_threads = io_threads;
+        options.worker_threads = 2;
+        auto server = std::make_unique<BinaryServer>(options, handler());
+        server->start();
+        return server;
+    }
+
+    std::string m_socket_path;
+    LocationRecord m_record;
+};
+
+TEST_F(BinaryServerTest, LookupOverUnixSocket) {
+    auto server = start_server();
+    auto client = BinaryClient::connect_unix(m_socket_path);
+
+    auto response = client.lookup(*IpAddress::parse("1.1.1.1"), LocationJson::COUNTRY);
+    EXPECT_EQ(response.status, BinaryProtocol::Status::FOUND);
+    EXPECT_EQ(response.record.country, "CA");
+    EXPECT_FALSE(response.record.city.has_value());
+
+    EXPECT_EQ(client.lookup(*IpAddress::parse("10.0.0.1")).status, BinaryProtocol::Status::RESERVED);
+    EXPECT_EQ(client.lookup(*IpAddress::parse("2001:db8::1")).status, BinaryProtocol::Status::NOT_FOUND);
+}
+
+TEST_F(BinaryServerTest, LookupOverTcp) {
+    auto server = start_server(-1);
+    ASSERT_GT(server->port(), 0);
+    auto client = BinaryClient::connect_tcp("127.0.0.1", server->port());
+
+    auto response = client.lookup(*IpAddress::parse("1.1.1.1"));
+    EXPECT_EQ(response.status, BinaryProtocol::Status::FOUND);
+    EXPECT_EQ(response.record, m_record);
+}
+
+TEST_F(BinaryServerTest, PipelinedRequestsAreAllAnswered) {
+    auto server = start_server();
+    auto client = BinaryClient::connect_unix(m_socket_path);
+
+    const char* addresses[] = {"1.1.1.1", "10.1.2.3", "8.8.8.8"};
+    std::map<uint32_t, BinaryProtocol::Status> expected;
+    for (int i = 0; i < 300; ++i) {
+        uint32_t id = client.send(*IpAddress::parse(addresses[i % 3]));
+        expected[id] = i % 3 == 0 ? BinaryProtocol::Status::FOUND
+                     : i % 3 == 1 ? BinaryProtocol::Status::RESERVED
+                                  : BinaryProtocol::Status::NOT_FOUND;
+    }
+    client.flush();
+
+    for (int i = 0; i < 300; ++i) {
+        auto response = client.receive();
+        auto it = expected.find(response.id);
+        ASSERT_NE(it, expected.end());
+        EXPECT_EQ(response.status, it->second);
+        expected.erase(it);
+    }
+    EXPECT_EQ(client.outstanding(), 0u);
+    EXPECT_EQ(server->request_count(), 300u);
+}
+
+TEST_F(BinaryServerTest, SlowLookupDoesNotHoldUpTheConnection) {
+    auto server = start_server();
+    auto client = BinaryClient::connect_unix(m_socket_path);
+
+    uint32_t slow = client.send(*IpAddress::parse("2.2.2.2"));
+    uint32_t fast = client.send(*IpAddress::parse("1.1.1.1"));
+    client.flush();
+
+    EXPECT_EQ(client.receive().id, fast);
+    EXPECT_EQ(client.receive().id, slow);
+}
+
+TEST_F(BinaryServerTest, MalformedFrameGetsBadRequest) {
+    auto server = start_server();
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", m_socket_path.c_str());
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    //length 8: an id and four bytes of nothing in particular
+    const unsigned char frame[] = {0, 0, 0, 8, 0, 0, 0, 77, 9, 9, 9, 9};
+    ASSERT_EQ(write(fd, frame, sizeof(frame)), static_cast<ssize_t>(sizeof(frame)));
+
+    char buffer[64];
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    ASSERT_EQ(n, static_cast<ssize_t>(BinaryProtocol::LENGTH_SIZE + BinaryProtocol::RESPONSE_HEADER_SIZE));
+    auto response = BinaryProtocol::parse_response(std::string_view(buffer + 4, static_cast<size_t>(n) - 4));
+    ASSERT_TRUE(response.has_value());
+    EXPECT_EQ(response->id, 77u);
+    EXPECT_EQ(response->status, BinaryProtocol::Status::BAD_REQUEST);
+    close(fd);
+}
+
+TEST_F(BinaryServerTest, FloodingClientDoesNotStarveOthers) {
+    // one I/O thread, so both connections share an epoll loop
+    auto server = start_server(0, 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", m_socket_path.c_str());
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    // keeps its socket full of inline lookups and throws the answers away
+    std::string requests;
+    for (uint32_t id = 0; id < 1000; ++id) {
+        BinaryProtocol::append_request(requests, BinaryProtocol::Request{id, LocationJson::COUNTRY, *IpAddress::parse("1.1.1.1")});
+    }
+    std::atomic<bool> flooding{true};
+    std::thread writer([&]() {
+        while (flooding && write(fd, requests.data(), requests.size()) > 0) {
+        }
+    });
+    std::thread drainer([&]() {
+        char buffer[65536];
+        while (read(fd, buffer, sizeof(buffer)) > 0) {
+        }
+    });
+
+    auto client = BinaryClient::connect_unix(m_socket_path);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(client.lookup(*IpAddress::parse("10.0.0.1")).status, BinaryProtocol::Status::RESERVED);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+
+    flooding = false;
+    shutdown(fd, SHUT_RDWR);
+    writer.join();
+    drainer.join();
+    close(fd);
+}
+
+TEST_F(BinaryServerTest, StopClosesConnections) {
+    auto server = start_server();
+    auto client = BinaryClient::connect_unix(m_socket_path);
+    EXPECT_EQ(client.lookup(*IpAddress::parse("1.1.1.1")).status, BinaryProtocol::Status::FOUND);
+
+    server->stop();
+    EXPECT_THROW(client.lookup(*IpAddress::parse("1.1.1.1")), std::runtime_error);
+    EXPECT_NE(access(m_socket_path.c_str(), F_OK), 0);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "enrich/bulk_enricher.h"
+#include <sstream>
+#include <stdexcept>
+
+class BulkEnricherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        LocationDataset::Builder builder;
+        LocationRecord toronto;
+        toronto.country = "CA";
+        toronto.city = "Toronto";
+        toronto.region = "Ontario, East";
+        toronto.latitude = 43.65f;
+        toronto.longitude = -79.38f;
+        builder.add_ipv4(IpAddress::parse("1.0.0.0")->v4(), IpAddress::parse("1.0.0.255")->v4(), toronto);
+        LocationRecord paris;
+        paris.country = "FR";
+        paris.city = "Paris";
+        builder.add_ipv4(IpAddress::parse("2.0.0.0")->v4(), IpAddress::parse("2.0.0.255")->v4(), paris);
+        builder.add_ipv6(IpAddress::parse("2001:db8::")->v6(), IpAddress::parse("2001:db8::ffff")->v6(), paris);
+        m_dataset = builder.build(Ipv4IndexType::BINARY_SEARCH);
+    }
+
+    std::string enrich(const std::string& input, BulkEnricher::Options options, BulkEnricher::Stats* stats = nullptr) {
+        std::istringstream in(input);
+        std::ostringstream out;
+        BulkEnricher enricher(m_dataset, options);
+        auto result = enricher.run(in, out);
+        if (stats) {
+            *stats = result;
+        }
+        return out.str();
+    }
+
+    std::shared_ptr<const LocationDataset> m_dataset;
+};
+
+TEST_F(BulkEnricherTest, AppendsColumnsToCsv) {
+    BulkEnricher::Options options;
+    options.column = "client";
+    options.threads = 2;
+    options.batch_lines = 2;
+    BulkEnricher::Stats stats;
+    std::string output = enrich("time,\"client\",path\r\n"
+                                "1,1.0.0.7,/a\n"
+                                "2,\"2.0.0.9\",\"/b,c\"\n"
+                                "3,9.9.9.9,/d\n"
+                                "4,,/e\n"
+                                "5,2001:db8::1,/f\n",
+                                options, &stats);
+    EXPECT_EQ(output,
+              "time,\"client\",path,country,city,region,latitude,longitude,postal_code,timezone\n"
+              "1,1.0.0.7,/a,CA,Toronto,\"Ontario, East\",43.65,-79.38,,\n"
+              "2,\"2.0.0.9\",\"/b,c\",FR,Paris,,,,,\n"
+              "3,9.9.9.9,/d,,,,,,,\n"
+              "4,,/e,,,,,,,\n"
+              "5,2001:db8::1,/f,FR,Paris,,,,,\n");
+    EXPECT_EQ(stats.lines, 5u);
+    EXPECT_EQ(stats.found, 3u);
+    EXPECT_EQ(stats.not_found, 1u);
+    EXPECT_EQ(stats.invalid, 1u);
+}
+
+TEST_F(BulkEnricherTest, ProjectsFieldsAndRejectsUnknownColumn) {
+    BulkEnricher::Options options;
+    options.fields = LocationJson::COUNTRY | LocationJson::LONGITUDE;
+    EXPECT_EQ(enrich("ip\n1.0.0.1\n", options), "ip,country,longitude\n1.0.0.1,CA,-79.38\n");
+
+    options.column = "address";
+    EXPECT_THROW(enrich("ip\n1.0.0.1\n", options), std::invalid_argument);
+    EXPECT_EQ(enrich("", options), "");
+}
+
+TEST_F(BulkEnricherTest, AddsLocationToNdjson) {
+    BulkEnricher::Options options;
+    options.format = BulkEnricher::Format::NDJSON;
+    options.fields = LocationJson::COUNTRY | LocationJson::CITY;
+    BulkEnricher::Stats stats;
+    std::string output = enrich("{\"meta\":{\"ip\":\"2.0.0.1\"},\"tags\":[\"a,}\"],\"ip\":\"1.0.0.1\"}\n"
+                                "{ \"ip\" : \"9.9.9.9\" }\n"
+                                "{}\n"
+                                "{\"ip\":12}\n"
+                                "not json\n",
+                                options, &stats);
+    EXPECT_EQ(output,
+              "{\"meta\":{\"ip\":\"2.0.0.1\"},\"tags\":[\"a,}\"],\"ip\":\"1.0.0.1\","
+              "\"location\":{\"ip\":\"1.0.0.1\",\"country\":\"CA\",\"city\":\"Toronto\"}}\n"
+              "{ \"ip\" : \"9.9.9.9\" ,\"location\":null}\n"
+              "{\"location\":null}\n"
+              "{\"ip\":12,\"location\":null}\n"
+              "not json\n");
+    EXPECT_EQ(stats.found, 1u);
+    EXPECT_EQ(stats.not_found, 1u);
+    EXPECT_EQ(stats.invalid, 3u);
+}
+
+TEST_F(BulkEnricherTest, SortedModeMatchesUnsortedAndKeepsOrder) {
+    std::string input = "ip\n";
+    for (int i = 0; i < 3000; ++i) {
+        input += (i < 1500 ? "1.0.0." : "2.0.0.") + std::to_string(i % 256) + "\n";
+    }
+    // out of order, which sorted mode must still answer right
+    input += "1.0.0.5\n::ffff:2.0.0.1\n0.0.0.1\n";
+
+    BulkEnricher::Options options;
+    options.threads = 3;
+    options.batch_lines = 7;
+    options.max_batches = 2;
+    std::string unsorted = enrich(input, options);
+    options.sorted = true;
+    EXPECT_EQ(enrich(input, options), unsorted);
+    EXPECT_EQ(unsorted.substr(unsorted.rfind("1.0.0.5")), "1.0.0.5,CA,Toronto,\"Ontario, East\",43.65,-79.38,,\n"
+                                                         "::ffff:2.0.0.1,FR,Paris,,,,,\n"
+                                                         "0.0.0.1,,,,,,,\n");
+}
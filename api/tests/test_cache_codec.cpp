@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "cache/cache_codec.h"
+#include "cache/cache_key.h"
+#include <stdexcept>
+
+class CacheCodecTest : public ::testing::Test {
+protected:
+    LocationRecord stratford() {
+        LocationRecord record;
+        record.country = "CA";
+        record.city = "Stratford";
+        record.region = "Ontario";
+        record.latitude = 43.36679f;
+        record.longitude = -80.94972f;
+        record.postal_code = "N5A";
+        record.timezone = "America/Toronto";
+        return record;
+    }
+};
+
+TEST_F(CacheCodecTest, RecordRoundTrip) {
+    auto record = stratford();
+    auto decoded = CacheCodec::decode(CacheCodec::encode_record(record));
+
+    ASSERT_EQ(decoded.kind, CachedValue::Kind::FOUND);
+    EXPECT_EQ(decoded.record, record);
+}
+
+TEST_F(CacheCodecTest, PartialRecordRoundTrip) {
+    LocationRecord record;
+    record.country = "US";
+    record.longitude = -122.5f;
+
+    auto decoded = CacheCodec::decode(CacheCodec::encode_record(record));
+
+    ASSERT_EQ(decoded.kind, CachedValue::Kind::FOUND);
+    EXPECT_EQ(decoded.record, record);
+    EXPECT_FALSE(decoded.record.city.has_value());
+    EXPECT_FALSE(decoded.record.latitude.has_value());
+}
+
+TEST_F(CacheCodecTest, NotFoundRoundTrip) {
+    auto encoded = CacheCodec::encode_not_found();
+
+    EXPECT_EQ(encoded.size(), 3u);
+    EXPECT_EQ(CacheCodec::decode(encoded).kind, CachedValue::Kind::NOT_FOUND);
+}
+
+TEST_F(CacheCodecTest, SmallerThanJson) {
+    std::string json = "{\"timezone\":\"America/Toronto\",\"postal_code\":\"N5A\",\"longitude\":-80.9497199999999992315,"
+                       "\"region\":\"Ontario\",\"latitude\":43.3667900000000017258,\"city\":\"Stratford\","
+                       "\"country\":\"CA\",\"ip\":\"108.160.94.90\"}";
+
+    EXPECT_LT(CacheCodec::encode_record(stratford()).size() * 3, json.size());
+}
+
+TEST_F(CacheCodecTest, LegacyJsonEntries) {
+    EXPECT_EQ(CacheCodec::decode("{\"country\":\"CA\",\"ip\":\"108.160.94.90\"}").kind,
+              CachedValue::Kind::LEGACY_JSON);
+    EXPECT_EQ(CacheCodec::decode("{\"error\":\"IP address location not found\",\"code\":\"IP_NOT_FOUND\"}").kind,
+              CachedValue::Kind::NOT_FOUND);
+}
+
+TEST_F(CacheCodecTest, RejectsCorruptValues) {
+    auto encoded = CacheCodec::encode_record(stratford());
+
+    EXPECT_EQ(CacheCodec::decode("").kind, CachedValue::Kind::INVALID);
+    EXPECT_EQ(CacheCodec::decode(encoded.substr(0, encoded.size() - 1)).kind, CachedValue::Kind::INVALID);
+    EXPECT_EQ(CacheCodec::decode(encoded + "x").kind, CachedValue::Kind::INVALID);
+
+    //unknown version
+    encoded[1] = static_cast<char>(CacheCodec::VERSION + 1);
+    EXPECT_EQ(CacheCodec::decode(encoded).kind, CachedValue::Kind::INVALID);
+}
+
+TEST_F(CacheCodecTest, WidenCoordinateKeepsShortestDigits) {
+    EXPECT_DOUBLE_EQ(CacheCodec::widen_coordinate(43.36679f), 43.36679);
+    EXPECT_EQ(CacheCodec::widen_coordinate(-80.94972f), -80.94972);
+    EXPECT_EQ(CacheCodec::widen_coordinate(0.0f), 0.0);
+}
+
+TEST_F(CacheCodecTest, ParseFormat) {
+    EXPECT_EQ(CacheCodec::parse_format("json"), CacheValueFormat::JSON);
+    EXPECT_EQ(CacheCodec::parse_format("BINARY"), CacheValueFormat::BINARY);
+    EXPECT_THROW(CacheCodec::parse_format("msgpack"), std::invalid_argument);
+}
+
+TEST_F(CacheCodecTest, ViewDecodePointsIntoTheValue) {
+    std::string encoded = CacheCodec::encode_record(stratford());
+    auto decoded = CacheCodec::decode_view(encoded);
+
+    ASSERT_EQ(decoded.kind, CachedValue::Kind::FOUND);
+    ASSERT_TRUE(decoded.record.timezone.has_value());
+    EXPECT_EQ(*decoded.record.timezone, "America/Toronto");
+    EXPECT_GE(decoded.record.timezone->data(), encoded.data());
+    EXPECT_LT(decoded.record.timezone->data(), encoded.data() + encoded.size());
+    EXPECT_EQ(decoded.record.to_record(), stratford());
+}
+
+TEST_F(CacheCodecTest, CacheKeyIncludesGeneration) {
+    CacheKey key(12, "2001:db8::1");
+    EXPECT_EQ(key.view(), "ip_location:12:2001:db8::1");
+
+    CacheKey longest(UINT64_MAX, "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255");
+    EXPECT_EQ(longest.str(), "ip_location:18446744073709551615:ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255");
+}
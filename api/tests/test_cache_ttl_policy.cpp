@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "cache/cache_ttl_policy.h"
+#include <stdexcept>
+
+class CacheTtlPolicyTest : public ::testing::Test {
+protected:
+    // 2025-07-14 00:00:00 UTC
+    std::chrono::system_clock::time_point midnight() {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(1752451200));
+    }
+};
+
+TEST_F(CacheTtlPolicyTest, SecondsUntilNextUpdate) {
+    CacheTtlPolicy policy(2, 0, 0, 0);
+
+    EXPECT_EQ(policy.seconds_until_next_update(midnight()), 2 * 3600);
+    EXPECT_EQ(policy.seconds_until_next_update(midnight() + std::chrono::hours(1) + std::chrono::minutes(30)), 1800);
+
+    //exactly at and after the update rolls over to the next day
+    EXPECT_EQ(policy.seconds_until_next_update(midnight() + std::chrono::hours(2)), 24 * 3600);
+    EXPECT_EQ(policy.seconds_until_next_update(midnight() + std::chrono::hours(3)), 23 * 3600);
+}
+
+TEST_F(CacheTtlPolicyTest, BaseTtlFarFromUpdate) {
+    CacheTtlPolicy policy(2, 0, 0, 0);
+
+    EXPECT_EQ(policy.ttl_seconds(3600, midnight() + std::chrono::hours(12), 0), 3600);
+}
+
+TEST_F(CacheTtlPolicyTest, TtlCappedAtNextUpdate) {
+    CacheTtlPolicy policy(2, 0, 0, 600);
+
+    //30 minutes before the update: remaining time plus the grace period
+    auto now = midnight() + std::chrono::hours(1) + std::chrono::minutes(30);
+    EXPECT_EQ(policy.ttl_seconds(3600, now, 0), 1800 + 600);
+}
+
+TEST_F(CacheTtlPolicyTest, JitterSpreadsExpirations) {
+    CacheTtlPolicy policy(2, 0, 300, 0);
+
+    auto far = midnight() + std::chrono::hours(12);
+    EXPECT_EQ(policy.ttl_seconds(3600, far, 0), 3600);
+    EXPECT_EQ(policy.ttl_seconds(3600, far, 300), 3600 - 360);
+
+    auto near = midnight() + std::chrono::hours(1) + std::chrono::minutes(50);
+    EXPECT_EQ(policy.ttl_seconds(3600, near, 0), 600);
+    EXPECT_EQ(policy.ttl_seconds(3600, near, 120), 720);
+}
+
+TEST_F(CacheTtlPolicyTest, RandomJitterStaysInRange) {
+    CacheTtlPolicy policy(2, 0, 300, 900);
+
+    for (int i = 0; i < 100; ++i) {
+        int ttl = policy.ttl_seconds(300);
+        EXPECT_GE(ttl, 1);
+        EXPECT_LE(ttl, 300 + 300);
+    }
+}
+
+TEST_F(CacheTtlPolicyTest, ParsesSchedule) {
+    auto policy = CacheTtlPolicy::from_schedule("23:45", 0, 0);
+    EXPECT_EQ(policy.seconds_until_next_update(midnight()), 23 * 3600 + 45 * 60);
+
+    EXPECT_THROW(CacheTtlPolicy::from_schedule("2am", 0), std::invalid_argument);
+    EXPECT_THROW(CacheTtlPolicy::from_schedule("24:00", 0), std::invalid_argument);
+    EXPECT_THROW(CacheTtlPolicy::from_schedule("02:xx", 0), std::invalid_argument);
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include "cache/cache_writer.h"
+#include "utils/logger.h"
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+class CacheWriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Logger::Logger::initialize(Logger::Level::ERROR);
+    }
+
+    CacheWriter::FlushFn recording_flush() {
+        return [this](const std::vector<CacheWrite>& batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.push_back(batch);
+        };
+    }
+
+    std::mutex mutex;
+    std::vector<std::vector<CacheWrite>> batches;
+};
+
+TEST_F(CacheWriterTest, FlushesQueuedWrites) {
+    CacheWriter writer(recording_flush());
+
+    EXPECT_TRUE(writer.enqueue("ip_location:8.8.8.8", "{}", 3600));
+    EXPECT_TRUE(writer.enqueue("ip_location:1.1.1.1", "{}", 300));
+    writer.flush();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = 0;
+    for (const auto& batch : batches) {
+        total += batch.size();
+    }
+    EXPECT_EQ(total, 2u);
+    EXPECT_EQ(writer.queued_count(), 2u);
+    EXPECT_EQ(writer.flushed_count(), 2u);
+    EXPECT_EQ(writer.pending(), 0u);
+}
+
+TEST_F(CacheWriterTest, CoalescesDuplicateKeys) {
+    // long interval so both writes are still pending when the second one arrives
+    CacheWriter writer(recording_flush(), 100, 100, std::chrono::milliseconds(10000));
+
+    writer.enqueue("ip_location:8.8.8.8", "old", 300);
+    writer.enqueue("ip_location:8.8.8.8", "new", 3600);
+    writer.flush();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(batches.size(), 1u);
+    ASSERT_EQ(batches[0].size(), 1u);
+    EXPECT_EQ(batches[0][0].value, "new");
+    EXPECT_EQ(batches[0][0].ttl_seconds, 3600);
+    EXPECT_EQ(writer.coalesced_count(), 1u);
+}
+
+TEST_F(CacheWriterTest, DropsWritesWhenQueueIsFull) {
+    CacheWriter writer(recording_flush(), 2, 100, std::chrono::milliseconds(10000));
+
+    EXPECT_TRUE(writer.enqueue("a", "1", 60));
+    EXPECT_TRUE(writer.enqueue("b", "2", 60));
+    EXPECT_FALSE(writer.enqueue("c", "3", 60));
+
+    //coalescing into an existing key still succeeds when full
+    EXPECT_TRUE(writer.enqueue("a", "4", 60));
+
+    EXPECT_EQ(writer.dropped_count(), 1u);
+    writer.flush();
+    EXPECT_EQ(writer.flushed_count(), 2u);
+}
+
+TEST_F(CacheWriterTest, SplitsIntoPipelineBatches) {
+    CacheWriter writer(recording_flush(), 100, 3, std::chrono::milliseconds(10000));
+
+    for (int i = 0; i < 7; ++i) {
+        writer.enqueue("key" + std::to_string(i), "v", 60);
+    }
+    writer.flush();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& batch : batches) {
+        EXPECT_LE(batch.size(), 3u);
+    }
+    EXPECT_EQ(writer.flushed_count(), 7u);
+}
+
+TEST_F(CacheWriterTest, CountsFailedBatches) {
+    CacheWriter writer([](const std::vector<CacheWrite>&) {
+        throw std::runtime_error("connection refused");
+    });
+
+    writer.enqueue("a", "1", 60);
+    writer.flush();
+
+    EXPECT_EQ(writer.failed_count(), 1u);
+    EXPECT_EQ(writer.flushed_count(), 0u);
+}
+
+TEST_F(CacheWriterTest, DrainsOnDestruction) {
+    {
+        CacheWriter writer(recording_flush(), 100, 100, std::chrono::milliseconds(10000));
+        writer.enqueue("a", "1", 60);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(batches.size(), 1u);
+    EXPECT_EQ(batches[0][0].key, "a");
+}
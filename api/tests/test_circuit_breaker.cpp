@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include "utils/circuit_breaker.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class CircuitBreakerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        //opens after 3 failures, stays open for 100ms, 10ms latency budget
+        breaker = std::make_unique<CircuitBreaker>(3, std::chrono::milliseconds(100), std::chrono::milliseconds(10));
+    }
+
+    void fail_times(int n) {
+        for (int i = 0; i < n; ++i) {
+            ASSERT_TRUE(breaker->allow_request());
+            breaker->record_failure();
+        }
+    }
+
+    std::unique_ptr<CircuitBreaker> breaker;
+};
+
+TEST_F(CircuitBreakerTest, StartsClosed) {
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::CLOSED);
+    EXPECT_TRUE(breaker->allow_request());
+}
+
+TEST_F(CircuitBreakerTest, OpensAfterConsecutiveFailures) {
+    fail_times(2);
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::CLOSED);
+
+    fail_times(1);
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::OPEN);
+    EXPECT_FALSE(breaker->allow_request());
+    EXPECT_EQ(breaker->short_circuited_count(), 1u);
+    EXPECT_EQ(breaker->opened_count(), 1u);
+}
+
+TEST_F(CircuitBreakerTest, SuccessResetsFailureCount) {
+    fail_times(2);
+    breaker->record_success(std::chrono::microseconds(100));
+    fail_times(2);
+
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::CLOSED);
+}
+
+TEST_F(CircuitBreakerTest, SlowCallsCountAsFailures) {
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(breaker->allow_request());
+        breaker->record_success(std::chrono::milliseconds(50));
+    }
+
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::OPEN);
+    EXPECT_EQ(breaker->slow_call_count(), 3u);
+}
+
+TEST_F(CircuitBreakerTest, HalfOpenProbeClosesOnSuccess) {
+    fail_times(3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+    //exactly one probe is let through
+    EXPECT_TRUE(breaker->allow_request());
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::HALF_OPEN);
+    EXPECT_FALSE(breaker->allow_request());
+
+    breaker->record_success(std::chrono::microseconds(100));
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::CLOSED);
+    EXPECT_TRUE(breaker->allow_request());
+}
+
+TEST_F(CircuitBreakerTest, HalfOpenProbeReopensOnFailure) {
+    fail_times(3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+    EXPECT_TRUE(breaker->allow_request());
+    breaker->record_failure();
+
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::OPEN);
+    EXPECT_FALSE(breaker->allow_request());
+    EXPECT_EQ(breaker->opened_count(), 2u);
+}
+
+TEST_F(CircuitBreakerTest, TripOpensImmediately) {
+    breaker->trip();
+
+    EXPECT_EQ(breaker->state(), CircuitBreaker::State::OPEN);
+    EXPECT_FALSE(breaker->allow_request());
+    EXPECT_STREQ(CircuitBreaker::state_to_string(breaker->state()), "open");
+}
+
+TEST_F(CircuitBreakerTest, SingleProbeUnderContention) {
+    breaker->trip();
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+    std::atomic<int> allowed{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&]() {
+            if (breaker->allow_request()) {
+                allowed++;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(allowed, 1);
+}
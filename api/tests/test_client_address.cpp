@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "utils/client_address.h"
+
+class ClientAddressTest : public ::testing::Test {
+protected:
+    ClientAddressResolver resolver{ClientAddressResolver::parse_prefixes("10.0.0.0/8, 2001:db8:ffff::/48"), 32, 64};
+
+    std::string resolve(std::string_view peer, std::string_view forwarded_for = "", std::string_view real_ip = "") {
+        return std::string(ClientKey(resolver.resolve(peer, forwarded_for, real_ip)).view());
+    }
+};
+
+TEST_F(ClientAddressTest, UntrustedPeerIsTheClient) {
+    EXPECT_EQ(resolve("203.0.113.7", "198.51.100.1"), "203.0.113.7/32");
+    EXPECT_EQ(resolve("203.0.113.7", "", "198.51.100.1"), "203.0.113.7/32");
+}
+
+TEST_F(ClientAddressTest, TrustedProxiesAreSkippedFromTheRight) {
+    // spoofed first hop, real client, then two of our proxies
+    EXPECT_EQ(resolve("10.0.0.5", "1.2.3.4, 198.51.100.9, 10.1.1.1"), "198.51.100.9/32");
+    EXPECT_EQ(resolve("10.0.0.5", "10.2.2.2, 10.1.1.1"), "10.2.2.2/32");
+    EXPECT_EQ(resolve("10.0.0.5", "", "198.51.100.9"), "198.51.100.9/32");
+    EXPECT_EQ(resolve("10.0.0.5"), "10.0.0.5/32");
+}
+
+TEST_F(ClientAddressTest, UnparseableHopStopsAtTheProxyThatAddedIt) {
+    EXPECT_EQ(resolve("10.0.0.5", "198.51.100.9, garbage, 10.1.1.1"), "10.1.1.1/32");
+}
+
+TEST_F(ClientAddressTest, PortsBracketsAndMappedAddressesAreUnderstood) {
+    EXPECT_EQ(resolve("::ffff:10.0.0.5", "198.51.100.9:51234"), "198.51.100.9/32");
+    EXPECT_EQ(resolve("10.0.0.5", "[2001:db8:1:2::7]:443"), "2001:db8:1:2::/64");
+}
+
+TEST_F(ClientAddressTest, IPv6ClientsAreAggregatedToTheirPrefix) {
+    EXPECT_EQ(resolve("2001:db8:1:2:aaaa::1"), resolve("2001:db8:1:2:bbbb::2"));
+    EXPECT_NE(resolve("2001:db8:1:2::1"), resolve("2001:db8:1:3::1"));
+}
+
+TEST_F(ClientAddressTest, UnknownPeerHasNoAddress) {
+    EXPECT_EQ(resolve("", "198.51.100.9"), "unknown");
+    EXPECT_THROW(ClientAddressResolver::parse_prefixes("10.0.0.0/8,bogus"), std::invalid_argument);
+}
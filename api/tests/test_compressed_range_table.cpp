@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include "lookup/compressed_range_table.h"
+#include "utils/ip_address.h"
+#include <algorithm>
+#include <random>
+#include <set>
+
+namespace {
+
+template <typename Key>
+RangeTable<Key> make_table(std::vector<typename RangeTable<Key>::Range> ranges) {
+    RangeTable<Key> table;
+    table.build(ranges);
+    return table;
+}
+
+const uint128_t TOP = ~static_cast<uint128_t>(0);
+
+uint128_t v6(uint64_t high, uint64_t low = 0) {
+    return (static_cast<uint128_t>(high) << 64) | low;
+}
+
+} // namespace
+
+TEST(CompressedRangeTableTest, EmptyTable) {
+    CompressedRangeTable<uint128_t> compressed;
+    compressed.build(make_table<uint128_t>({}));
+
+    EXPECT_EQ(compressed.size(), 0u);
+    EXPECT_EQ(compressed.find(0), NO_RECORD);
+    EXPECT_EQ(compressed.find(TOP), NO_RECORD);
+}
+
+TEST(CompressedRangeTableTest, FindsRangesAndGaps) {
+    // 2001:db8::/48, 2001:db8:1::/48 adjacent, then a gap and a single address
+    auto table = make_table<uint128_t>({
+        {v6(0x20010db800000000), v6(0x20010db80000ffff, ~0ull), 7},
+        {v6(0x20010db800010000), v6(0x20010db80001ffff, ~0ull), 8},
+        {v6(0x20010db800050000, 1), v6(0x20010db800050000, 1), 9},
+    });
+    CompressedRangeTable<uint128_t> compressed;
+    compressed.build(table);
+
+    EXPECT_EQ(compressed.size(), 3u);
+    EXPECT_EQ(compressed.block_count(), 1u);
+    EXPECT_EQ(compressed.find(v6(0x20010db7ffffffff, ~0ull)), NO_RECORD);
+    EXPECT_EQ(compressed.find(v6(0x20010db800000000)), 7u);
+    EXPECT_EQ(compressed.find(v6(0x20010db80000ffff, ~0ull)), 7u);
+    EXPECT_EQ(compressed.find(v6(0x20010db800010000)), 8u);
+    EXPECT_EQ(compressed.find(v6(0x20010db800020000)), NO_RECORD);
+    EXPECT_EQ(compressed.find(v6(0x20010db800050000)), NO_RECORD);
+    EXPECT_EQ(compressed.find(v6(0x20010db800050000, 1)), 9u);
+    EXPECT_EQ(compressed.find(v6(0x20010db800050000, 2)), NO_RECORD);
+}
+
+TEST(CompressedRangeTableTest, FullAddressSpace) {
+    CompressedRangeTable<uint128_t> compressed;
+    compressed.build(make_table<uint128_t>({{0, TOP, 5}}));
+
+    EXPECT_EQ(compressed.find(0), 5u);
+    EXPECT_EQ(compressed.find(TOP), 5u);
+    EXPECT_EQ(compressed.find(v6(0x2001)), 5u);
+}
+
+TEST(CompressedRangeTableTest, EdgesOfAddressSpace) {
+    CompressedRangeTable<uint32_t> compressed;
+    compressed.build(make_table<uint32_t>({{0, 0, 1}, {0xFFFFFFFF, 0xFFFFFFFF, 2}}));
+
+    EXPECT_EQ(compressed.find(0), 1u);
+    EXPECT_EQ(compressed.find(1), NO_RECORD);
+    EXPECT_EQ(compressed.find(0xFFFFFFFE), NO_RECORD);
+    EXPECT_EQ(compressed.find(0xFFFFFFFF), 2u);
+}
+
+TEST(CompressedRangeTableTest, MatchesUncompressedTable) {
+    std::mt19937_64 rng(42);
+    std::set<uint128_t> boundaries;
+    while (boundaries.size() < 20000) {
+        // mostly prefix-aligned boundaries, some arbitrary ones
+        uint128_t value = (static_cast<uint128_t>(rng()) << 64) | rng();
+        if (rng() % 4 != 0) {
+            value &= ~static_cast<uint128_t>(0) << (64 + rng() % 32);
+        }
+        boundaries.insert(value);
+    }
+
+    std::vector<RangeTable<uint128_t>::Range> ranges;
+    uint128_t previous = 0;
+    RecordId id = 0;
+    for (uint128_t boundary : boundaries) {
+        if (boundary > previous && rng() % 5 != 0) {
+            ranges.push_back({previous, boundary - 1, id % 1000});
+        }
+        ++id;
+        previous = boundary;
+    }
+    auto table = make_table<uint128_t>(ranges);
+    CompressedRangeTable<uint128_t> compressed;
+    compressed.build(table);
+
+    EXPECT_EQ(compressed.size(), table.size());
+    EXPECT_LT(compressed.memory_bytes(), table.memory_bytes());
+
+    for (size_t i = 0; i < table.size(); ++i) {
+        ASSERT_EQ(compressed.find(table.firsts()[i]), table.ids()[i]);
+        ASSERT_EQ(compressed.find(table.lasts()[i]), table.ids()[i]);
+        ASSERT_EQ(compressed.find(table.lasts()[i] + 1), table.find(table.lasts()[i] + 1));
+    }
+    for (int i = 0; i < 100000; ++i) {
+        uint128_t probe = (static_cast<uint128_t>(rng()) << 64) | rng();
+        ASSERT_EQ(compressed.find(probe), table.find(probe));
+    }
+}
+
+TEST(CompressedRangeTableTest, ReaderSeeksByAddressAndOrdinal) {
+    std::mt19937_64 rng(9);
+    std::vector<RangeTable<uint128_t>::Range> ranges;
+    uint128_t address = v6(0x2001);
+    for (RecordId id = 0; id < 5000; ++id) {
+        // gaps of 0 to 2 /64s, sizes of 1 to 8 /64s
+        address += v6(rng() % 3);
+        uint128_t last = address + v6(1 + rng() % 8) - 1;
+        ranges.push_back({address, last, id});
+        address = last + 1;
+    }
+    auto table = make_table<uint128_t>(ranges);
+    CompressedRangeTable<uint128_t> compressed;
+    compressed.build(table);
+
+    CompressedRangeTable<uint128_t>::Reader reader(compressed);
+    RangeTable<uint128_t>::Range range;
+    for (int i = 0; i < 5000; ++i) {
+        uint128_t key = v6(0x2001) + v6(rng() % (table.size() * 7)) + rng() % 4;
+        reader.seek(key);
+        size_t expected = static_cast<size_t>(std::lower_bound(table.lasts().begin(), table.lasts().end(), key) -
+                                              table.lasts().begin());
+        ASSERT_EQ(reader.ordinal(), expected);
+        if (expected < table.size()) {
+            ASSERT_TRUE(reader.next(range));
+            ASSERT_EQ(range.first, table.firsts()[expected]);
+            ASSERT_EQ(range.id, table.ids()[expected]);
+        }
+
+        // forwards within a block and backwards across blocks
+        size_t ordinal = rng() % table.size();
+        reader.seek_ordinal(ordinal);
+        ASSERT_EQ(reader.ordinal(), ordinal);
+        ASSERT_TRUE(reader.next(range));
+        ASSERT_EQ(range.first, table.firsts()[ordinal]);
+        ASSERT_EQ(range.last, table.lasts()[ordinal]);
+    }
+
+    reader.seek(TOP);
+    EXPECT_EQ(reader.ordinal(), table.size());
+    EXPECT_FALSE(reader.next(range));
+    reader.seek(0);
+    EXPECT_EQ(reader.ordinal(), 0u);
+    reader.seek_ordinal(table.size());
+    EXPECT_FALSE(reader.next(range));
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include "lookup/dataset_history.h"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Feed {
+    struct Range {
+        uint128_t first;
+        uint128_t last;
+        bool v4;
+        int location;
+    };
+    std::vector<Range> ranges;
+
+    std::shared_ptr<const LocationDataset> build() const {
+        LocationDataset::Builder builder;
+        for (const auto& range : ranges) {
+            LocationRecord record;
+            record.country = "C" + std::to_string(range.location % 40);
+            record.city = "city" + std::to_string(range.location);
+            if (range.v4) {
+                builder.add_ipv4(static_cast<uint32_t>(range.first), static_cast<uint32_t>(range.last), record);
+            } else {
+                builder.add_ipv6(range.first, range.last, record);
+            }
+        }
+        return builder.build(Ipv4IndexType::DIR_24_8);
+    }
+};
+
+uint128_t ipv6(uint64_t high) {
+    return static_cast<uint128_t>(high) << 64;
+}
+
+// disjoint ranges with gaps, over IPv4 and the start of 2000::/3
+Feed random_feed(std::mt19937& rng) {
+    Feed feed;
+    uint64_t address = 0;
+    for (int i = 0; i < 3000 && address <= 0xFFFFFFFF; ++i) {
+        uint64_t last = std::min<uint64_t>(address + rng() % 2000000, 0xFFFFFFFF);
+        feed.ranges.push_back({address, last, true, static_cast<int>(rng() % 500)});
+        address = last + 1 + rng() % 3;
+    }
+    uint64_t high = 0x2000000000000000;
+    for (int i = 0; i < 2000; ++i) {
+        uint64_t last = high + rng() % 0x100000;
+        feed.ranges.push_back({ipv6(high), ipv6(last) | ~uint64_t{0}, false, static_cast<int>(rng() % 500)});
+        high = last + 1 + rng() % 2;
+    }
+    return feed;
+}
+
+// a feed update: some ranges move, some disappear, some are split
+Feed next_feed(const Feed& feed, std::mt19937& rng, int changes) {
+    Feed next = feed;
+    for (int i = 0; i < changes; ++i) {
+        auto& range = next.ranges[rng() % next.ranges.size()];
+        switch (rng() % 3) {
+            case 0: range.location = static_cast<int>(500 + rng() % 100); break;
+            case 1: range.last = range.first; break;
+            case 2: {
+                if (range.last - range.first < 2) break;
+                uint128_t middle = range.first + (range.last - range.first) / 2;
+                Feed::Range tail{middle + 1, range.last, range.v4, static_cast<int>(rng() % 600)};
+                range.last = middle;
+                next.ranges.push_back(tail);
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+std::string city_of(const std::optional<LocationRecord>& record) {
+    return record ? *record->city : "<none>";
+}
+
+IpAddress random_address(std::mt19937_64& rng) {
+    if (rng() % 2) {
+        return IpAddress::from_v4(static_cast<uint32_t>(rng()));
+    }
+    return IpAddress::from_v6(ipv6(0x2000000000000000 + rng() % 0x40000000) | rng());
+}
+
+} // namespace
+
+TEST(DatasetHistoryTest, OlderGenerationsAnswerAsTheirOwnDatasets) {
+    std::mt19937 rng(7);
+    std::vector<Feed> feeds{random_feed(rng)};
+    for (int i = 0; i < 3; ++i) {
+        feeds.push_back(next_feed(feeds.back(), rng, 200));
+    }
+    std::vector<std::shared_ptr<const LocationDataset>> datasets;
+    for (const auto& feed : feeds) {
+        datasets.push_back(feed.build());
+    }
+
+    auto history = std::make_shared<const DatasetHistory>(1);
+    for (size_t g = 1; g < datasets.size(); ++g) {
+        history = history->advance(*datasets[g - 1], g + 1, *datasets[g], 4);
+    }
+    ASSERT_EQ(history->newest(), 4u);
+    const auto& newest = *datasets.back();
+
+    std::mt19937_64 addresses(11);
+    for (int i = 0; i < 50000; ++i) {
+        IpAddress address = random_address(addresses);
+        for (uint64_t g = 1; g <= 4; ++g) {
+            ASSERT_EQ(city_of(history->find(g, address, newest)), city_of(datasets[g - 1]->find(address)))
+                << "generation " << g << " at " << address.to_string();
+        }
+    }
+    // range bounds, where off-by-one diffs would show
+    for (const auto& feed : feeds) {
+        for (const auto& range : feed.ranges) {
+            for (uint128_t edge : {range.first - 1, range.first, range.last, range.last + 1}) {
+                IpAddress address = range.v4 ? IpAddress::from_v4(static_cast<uint32_t>(edge)) : IpAddress::from_v6(edge);
+                for (uint64_t g = 1; g <= 4; ++g) {
+                    ASSERT_EQ(city_of(history->find(g, address, newest)), city_of(datasets[g - 1]->find(address)));
+                }
+            }
+        }
+    }
+}
+
+TEST(DatasetHistoryTest, DeltasGrowWithTheDiffNotTheDataset) {
+    std::mt19937 rng(3);
+    Feed feed = random_feed(rng);
+    auto older = feed.build();
+    auto newer = next_feed(feed, rng, 10).build();
+
+    auto history = DatasetHistory(1).advance(*older, 2, *newer, 2);
+    auto generations = history->generations();
+    ASSERT_EQ(generations.size(), 2u);
+    EXPECT_EQ(generations[0].generation, 2u);
+    EXPECT_EQ(generations[1].generation, 1u);
+    // each change touches at most a couple of runs
+    EXPECT_GT(generations[1].ipv4_ranges + generations[1].ipv6_ranges, 0u);
+    EXPECT_LE(generations[1].ipv4_ranges + generations[1].ipv6_ranges, 20u);
+    EXPECT_LE(generations[1].records, 10u);
+    EXPECT_LT(history->memory_bytes() * 10,
+              older->ipv4_table().memory_bytes() + older->ipv6_index_memory_bytes() + older->record_memory_bytes());
+
+    // an unchanged feed needs no delta at all
+    auto same = DatasetHistory(1).advance(*older, 2, *feed.build(), 2);
+    EXPECT_EQ(same->generations()[1].ipv4_ranges + same->generations()[1].ipv6_ranges, 0u);
+}
+
+TEST(DatasetHistoryTest, KeepsAtMostKGenerationsButNeverDropsThePinnedOne) {
+    std::mt19937 rng(5);
+    Feed feed = random_feed(rng);
+    std::vector<std::shared_ptr<const LocationDataset>> datasets{feed.build()};
+    for (int i = 0; i < 5; ++i) {
+        feed = next_feed(feed, rng, 20);
+        datasets.push_back(feed.build());
+    }
+
+    auto history = std::make_shared<const DatasetHistory>(1);
+    for (uint64_t g = 2; g <= 4; ++g) {
+        history = history->advance(*datasets[g - 2], g, *datasets[g - 1], 2);
+    }
+    EXPECT_EQ(history->generations().size(), 2u);
+    EXPECT_TRUE(history->contains(4));
+    EXPECT_TRUE(history->contains(3));
+    EXPECT_FALSE(history->contains(2));
+
+    // rolled back to 3: it survives two more feeds
+    history = history->advance(*datasets[3], 5, *datasets[4], 2, 3);
+    history = history->advance(*datasets[4], 6, *datasets[5], 2, 3);
+    EXPECT_EQ(history->generations().size(), 4u);
+    EXPECT_TRUE(history->contains(3));
+    std::mt19937_64 addresses(1);
+    for (int i = 0; i < 20000; ++i) {
+        IpAddress address = random_address(addresses);
+        ASSERT_EQ(city_of(history->find(3, address, *datasets[5])), city_of(datasets[2]->find(address)));
+    }
+
+    // reloading the newest generation keeps what is there; an unrecorded one drops it all
+    EXPECT_EQ(history->advance(*datasets[5], 6, *datasets[5], 2)->generations().size(), 4u);
+    EXPECT_EQ(history->advance(*datasets[5], 0, *datasets[5], 2)->generations().size(), 1u);
+    EXPECT_EQ(DatasetHistory(0).advance(*datasets[0], 1, *datasets[1], 3)->generations().size(), 1u);
+    // K = 1 keeps no older generation
+    EXPECT_EQ(DatasetHistory(1).advance(*datasets[0], 2, *datasets[1], 1)->generations().size(), 1u);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "utils/heavy_hitters.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(HeavyHittersTest, FindsHeavyKeysAmongManyLightOnes) {
+    HeavyHitters sketch(8, 1024);
+    for (int i = 0; i < 20000; ++i) {
+        sketch.add("10.0.0." + std::to_string(i % 5000));
+        if (i % 10 == 0) {
+            sketch.add("203.0.113.7");
+        }
+        if (i % 20 == 0) {
+            sketch.add("2001:db8::1");
+        }
+    }
+
+    auto top = sketch.top(2);
+    ASSERT_EQ(top.size(), 2u);
+    EXPECT_EQ(top[0].key, "203.0.113.7");
+    EXPECT_EQ(top[1].key, "2001:db8::1");
+
+    // never under, and over by no more than the bound
+    EXPECT_GE(top[0].count, 2000u);
+    EXPECT_LE(top[0].count, 2000u + sketch.error_bound());
+    EXPECT_GE(sketch.estimate("2001:db8::1"), 1000u);
+    EXPECT_EQ(sketch.total(), 20000u + 2000u + 1000u);
+}
+
+TEST(HeavyHittersTest, TopIsBoundedByCapacityAndLimit) {
+    HeavyHitters sketch(4, 256);
+    for (int i = 0; i < 100; ++i) {
+        for (int k = 0; k <= i % 10; ++k) {
+            sketch.add("client-" + std::to_string(i % 10));
+        }
+    }
+    EXPECT_LE(sketch.top(100).size(), 4u);
+    EXPECT_EQ(sketch.top(1).size(), 1u);
+    EXPECT_EQ(sketch.top(1)[0].key, "client-9");
+}
+
+TEST(HeavyHittersTest, ConcurrentAddsAreAllCounted) {
+    HeavyHitters sketch(16, 2048);
+    constexpr int THREADS = 4;
+    constexpr int ADDS = 20000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < ADDS; ++i) {
+                sketch.add(i % 2 ? std::string_view("hot") : std::string_view("t" + std::to_string(t) + "-" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(sketch.total(), static_cast<uint64_t>(THREADS * ADDS));
+    EXPECT_GE(sketch.estimate("hot"), static_cast<uint64_t>(THREADS * ADDS / 2));
+    auto top = sketch.top(1);
+    ASSERT_EQ(top.size(), 1u);
+    EXPECT_EQ(top[0].key, "hot");
+}
+
+TEST(HeavyHittersTest, ResetStartsAfresh) {
+    HeavyHitters sketch(4, 64);
+    for (int i = 0; i < 100; ++i) {
+        sketch.add("198.51.100.1");
+    }
+    sketch.reset();
+    EXPECT_EQ(sketch.total(), 0u);
+    EXPECT_EQ(sketch.estimate("198.51.100.1"), 0u);
+    EXPECT_TRUE(sketch.top(4).empty());
+}
+
+TEST(HeavyHittersTest, LongKeysAreCut) {
+    HeavyHitters sketch(4, 64);
+    std::string chain(100, 'x');
+    sketch.add(chain);
+    auto top = sketch.top(1);
+    ASSERT_EQ(top.size(), 1u);
+    EXPECT_EQ(top[0].key, chain.substr(0, HeavyHitters::KEY_CAPACITY));
+}
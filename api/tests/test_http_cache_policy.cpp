@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include "cache/http_cache_policy.h"
+
+TEST(HttpCachePolicyTest, EtagNamesTheGeneration) {
+    EXPECT_EQ(HttpCachePolicy::etag(42), "W/\"42\"");
+    //no generation recorded yet, nothing to validate against
+    EXPECT_EQ(HttpCachePolicy::etag(0), "");
+}
+
+TEST(HttpCachePolicyTest, IfNoneMatchUsesWeakComparison) {
+    EXPECT_TRUE(HttpCachePolicy::matches("W/\"42\"", 42));
+    EXPECT_TRUE(HttpCachePolicy::matches("\"42\"", 42));
+    EXPECT_TRUE(HttpCachePolicy::matches("\"41\", W/\"42\"", 42));
+    EXPECT_TRUE(HttpCachePolicy::matches("*", 42));
+
+    EXPECT_FALSE(HttpCachePolicy::matches("W/\"41\"", 42));
+    EXPECT_FALSE(HttpCachePolicy::matches("W/\"420\"", 42));
+    EXPECT_FALSE(HttpCachePolicy::matches("42", 42));
+    EXPECT_FALSE(HttpCachePolicy::matches("*", 0));
+}
+
+TEST(HttpCachePolicyTest, MaxAgeCappedAtNextUpdate) {
+    HttpCachePolicy policy(3600, 300);
+
+    EXPECT_EQ(policy.cache_control(true, 12 * 3600), "public, max-age=3600");
+    EXPECT_EQ(policy.cache_control(false, 12 * 3600), "public, max-age=300");
+    EXPECT_EQ(policy.cache_control(true, 120), "public, max-age=120");
+    EXPECT_EQ(policy.cache_control(false, 120), "public, max-age=120");
+}
+
+TEST(HttpCachePolicyTest, ZeroMaxAgeDisables) {
+    EXPECT_FALSE(HttpCachePolicy(0, 300).enabled());
+    EXPECT_TRUE(HttpCachePolicy(3600, 0).enabled());
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "utils/ip_address.h"
+
+class IpAddressTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(IpAddressTest, ParsesIPv4) {
+    auto address = IpAddress::parse("192.168.1.1");
+
+    ASSERT_TRUE(address.has_value());
+    EXPECT_TRUE(address->is_v4());
+    EXPECT_EQ(address->v4(), 0xC0A80101u);
+    EXPECT_EQ(address->to_string(), "192.168.1.1");
+}
+
+TEST_F(IpAddressTest, ParsesIPv6) {
+    auto address = IpAddress::parse("2001:db8::1");
+
+    ASSERT_TRUE(address.has_value());
+    EXPECT_TRUE(address->is_v6());
+    EXPECT_EQ(static_cast<uint64_t>(address->v6() >> 64), 0x20010DB800000000ull);
+    EXPECT_EQ(static_cast<uint64_t>(address->v6()), 1u);
+    EXPECT_EQ(address->to_string(), "2001:db8::1");
+}
+
+TEST_F(IpAddressTest, RejectsInvalidInput) {
+    EXPECT_FALSE(IpAddress::parse("").has_value());
+    EXPECT_FALSE(IpAddress::parse("256.1.1.1").has_value());
+    EXPECT_FALSE(IpAddress::parse("gggg::1").has_value());
+    EXPECT_FALSE(IpAddress::parse(" 8.8.8.8").has_value());
+    EXPECT_FALSE(IpAddress::parse(std::string(100, '1')).has_value());
+}
+
+TEST_F(IpAddressTest, UnmapsIPv4MappedAddresses) {
+    auto mapped = IpAddress::parse("::ffff:8.8.8.8");
+
+    ASSERT_TRUE(mapped.has_value());
+    EXPECT_TRUE(mapped->is_v4_mapped());
+    EXPECT_EQ(mapped->unmapped(), IpAddress::from_v4(0x08080808));
+
+    auto native = IpAddress::parse("2001:db8::1");
+    EXPECT_FALSE(native->is_v4_mapped());
+    EXPECT_EQ(native->unmapped(), *native);
+}
+
+TEST_F(IpAddressTest, PrefixesClearHostBits) {
+    auto prefix = IpPrefix::parse("203.0.113.77/24");
+
+    ASSERT_TRUE(prefix.has_value());
+    EXPECT_EQ(prefix->to_string(), "203.0.113.0/24");
+    EXPECT_TRUE(prefix->contains(*IpAddress::parse("203.0.113.200")));
+    EXPECT_FALSE(prefix->contains(*IpAddress::parse("203.0.114.1")));
+    EXPECT_FALSE(prefix->contains(*IpAddress::parse("::ffff:203.0.113.1")));
+
+    IpPrefix v6(*IpAddress::parse("2001:db8:1:2:aaaa:bbbb:cccc:dddd"), 64);
+    EXPECT_EQ(v6.to_string(), "2001:db8:1:2::/64");
+    EXPECT_EQ(v6, IpPrefix(*IpAddress::parse("2001:db8:1:2::99"), 64));
+    EXPECT_EQ(IpPrefix(*IpAddress::parse("10.1.2.3"), 0).to_string(), "0.0.0.0/0");
+}
+
+TEST_F(IpAddressTest, ParsesBareAddressesAsFullPrefixes) {
+    EXPECT_EQ(IpPrefix::parse("10.0.0.1")->to_string(), "10.0.0.1/32");
+    EXPECT_EQ(IpPrefix::parse("::1")->length(), 128);
+    EXPECT_FALSE(IpPrefix::parse("10.0.0.0/33").has_value());
+    EXPECT_FALSE(IpPrefix::parse("10.0.0.0/").has_value());
+    EXPECT_FALSE(IpPrefix::parse("10.0.0.0/8x").has_value());
+    EXPECT_FALSE(IpPrefix::parse("nope/8").has_value());
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include "lookup/csv_dataset_loader.h"
+#include "lookup/location_database.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const std::string HEADER = "start_ip,end_ip,network_ip,city,region,country,latitude,longitude,postal_code,timezone\n";
+
+std::string city_of(const std::optional<LocationRecord>& record) {
+    return record && record->city ? *record->city : "<none>";
+}
+
+class LocationDatabaseTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_path = "/tmp/test_location_database_" + std::to_string(getpid()) + ".csv";
+    }
+
+    void TearDown() override {
+        std::remove(m_path.c_str());
+    }
+
+    // replaced with a rename, as a deployment would, so a reader never sees half a file
+    void write_file(const std::string& rows) {
+        std::string temp = m_path + ".tmp";
+        std::ofstream(temp) << HEADER << rows;
+        std::rename(temp.c_str(), m_path.c_str());
+    }
+
+    std::string m_path;
+};
+
+} // namespace
+
+TEST(CsvDatasetLoaderTest, ReadsTheUpdaterFormat) {
+    std::istringstream in(HEADER
+        + "108.160.94.0,108.160.95.127,108.160.94.0/23,Stratford,Ontario,CA,43.3601,-80.9814,N5A,America/Toronto\n"
+        + "8.8.8.0,8.8.8.255,,\"Mountain View, \"\"HQ\"\"\",,US,,,\"\",\r\n"
+        + "2001:db8::,2001:db8::ffff,2001:db8::/112,Paris,Ile-de-France,FR,48.85,2.35,75001,Europe/Paris\n");
+    auto result = CsvDatasetLoader::load(in, Ipv4IndexType::BINARY_SEARCH);
+    EXPECT_EQ(result.rows, 3u);
+    EXPECT_EQ(result.skipped, 0u);
+
+    auto stratford = result.dataset->find(*IpAddress::parse("108.160.94.90"));
+    ASSERT_TRUE(stratford);
+    EXPECT_EQ(stratford->country, "CA");
+    EXPECT_EQ(stratford->region, "Ontario");
+    EXPECT_FLOAT_EQ(*stratford->latitude, 43.3601f);
+    EXPECT_EQ(stratford->timezone, "America/Toronto");
+
+    auto mountain_view = result.dataset->find(*IpAddress::parse("8.8.8.8"));
+    ASSERT_TRUE(mountain_view);
+    EXPECT_EQ(mountain_view->city, "Mountain View, \"HQ\"");
+    // an unquoted empty field is NULL and a quoted one is an empty string, as in COPY
+    EXPECT_FALSE(mountain_view->region);
+    EXPECT_FALSE(mountain_view->latitude);
+    EXPECT_EQ(mountain_view->postal_code, "");
+    EXPECT_FALSE(mountain_view->timezone);
+
+    EXPECT_EQ(city_of(result.dataset->find(*IpAddress::parse("2001:db8::1"))), "Paris");
+}
+
+TEST(CsvDatasetLoaderTest, SkipsRowsThatDoNotParse) {
+    std::istringstream in(HEADER
+        + "1.0.0.0,1.0.0.255,,A,,AU,-27.4,153.0,,\n"
+        + "not-an-ip,1.0.1.255,,B,,AU,,,,\n"
+        + "1.0.2.0,2001:db8::1,,C,,AU,,,,\n"
+        + "1.0.3.0,1.0.3.255,,D,,AU,north,153.0,,\n"
+        + "1.0.4.0,1.0.4.255,,E,,AU\n"
+        + "\n");
+    auto result = CsvDatasetLoader::load(in, Ipv4IndexType::DIR_24_8);
+    EXPECT_EQ(result.rows, 5u);
+    EXPECT_EQ(result.skipped, 4u);
+    EXPECT_EQ(result.dataset->ipv4_range_count(), 1u);
+
+    EXPECT_THROW(CsvDatasetLoader::load("/nonexistent/dataset.csv", Ipv4IndexType::BINARY_SEARCH), std::runtime_error);
+}
+
+TEST_F(LocationDatabaseTest, LooksUpOneOrMany) {
+    write_file("1.0.0.0,1.0.0.255,,Brisbane,,AU,,,,\n2001:db8::,2001:db8::ffff,,Paris,,FR,,,,\n");
+    auto database = LocationDatabase::open(m_path);
+    EXPECT_EQ(database->generation(), 1u);
+
+    EXPECT_EQ(city_of(database->lookup("1.0.0.1")), "Brisbane");
+    EXPECT_EQ(city_of(database->lookup("::ffff:1.0.0.1")), "Brisbane");
+    EXPECT_FALSE(database->lookup("1.0.1.1"));
+    EXPECT_FALSE(database->lookup("not an address"));
+
+    std::vector<IpAddress> addresses{*IpAddress::parse("2001:db8::5"), *IpAddress::parse("9.9.9.9"),
+                                     *IpAddress::parse("1.0.0.200")};
+    auto records = database->lookup_many(addresses);
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(city_of(records[0]), "Paris");
+    EXPECT_FALSE(records[1]);
+    EXPECT_EQ(city_of(records[2]), "Brisbane");
+}
+
+TEST_F(LocationDatabaseTest, OpenFailsWithoutUsableRows) {
+    EXPECT_THROW(LocationDatabase::open(m_path), std::runtime_error);
+    write_file("");
+    EXPECT_THROW(LocationDatabase::open(m_path), std::runtime_error);
+    write_file("garbage,row,,,,,,,,\n");
+    EXPECT_THROW(LocationDatabase::open(m_path), std::runtime_error);
+}
+
+TEST_F(LocationDatabaseTest, FailedReloadKeepsTheDataset) {
+    write_file("1.0.0.0,1.0.0.255,,Brisbane,,AU,,,,\n");
+    std::string last_error;
+    LocationDatabase::Options options;
+    options.path = m_path;
+    options.on_reload = [&](uint64_t, const std::string& error) { last_error = error; };
+    auto database = LocationDatabase::open(options);
+
+    write_file("");
+    EXPECT_FALSE(database->reload());
+    EXPECT_NE(last_error, "");
+    EXPECT_EQ(database->generation(), 1u);
+    EXPECT_EQ(city_of(database->lookup("1.0.0.1")), "Brisbane");
+
+    write_file("1.0.0.0,1.0.0.255,,Sydney,,AU,,,,\n");
+    EXPECT_TRUE(database->reload());
+    EXPECT_EQ(last_error, "");
+    EXPECT_EQ(database->generation(), 2u);
+    EXPECT_EQ(city_of(database->lookup("1.0.0.1")), "Sydney");
+}
+
+TEST_F(LocationDatabaseTest, ReloadsWhenTheFileChanges) {
+    write_file("1.0.0.0,1.0.0.255,,Brisbane,,AU,,,,\n");
+    std::atomic<int> reloads{0};
+    LocationDatabase::Options options;
+    options.path = m_path;
+    options.reload_interval = std::chrono::milliseconds(10);
+    options.on_reload = [&](uint64_t, const std::string&) { reloads.fetch_add(1); };
+    auto database = LocationDatabase::open(options);
+
+    // an unchanged file is not read again
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(reloads.load(), 0);
+
+    // lookups run throughout the swap
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> misses{0};
+    std::thread reader([&]() {
+        while (!stop.load()) {
+            misses += !database->lookup("1.0.0.1");
+        }
+    });
+
+    write_file("1.0.0.0,1.0.0.255,,Sydney,,AU,,,,\n");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (database->generation() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    stop = true;
+    reader.join();
+
+    EXPECT_EQ(database->generation(), 2u);
+    EXPECT_EQ(city_of(database->lookup("1.0.0.1")), "Sydney");
+    EXPECT_EQ(misses.load(), 0u);
+}
@@ -0,0 +1,331 @@
+#include <gtest/gtest.h>
+#include "lookup/location_dataset.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+class LocationDatasetTest : public ::testing::TestWithParam<Ipv4IndexType> {
+protected:
+    static LocationRecord location(const std::string& country, const std::string& city) {
+        LocationRecord record;
+        record.country = country;
+        record.city = city;
+        return record;
+    }
+
+    static uint32_t ip(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+        return (a << 24) | (b << 16) | (c << 8) | d;
+    }
+
+    static std::string city_of(const LocationDataset& dataset, uint32_t address) {
+        auto record = dataset.find_ipv4(address);
+        return record && record->city ? *record->city : "<none>";
+    }
+
+    // deterministic pseudo-random disjoint ranges with gaps between them
+    static void add_random_ranges(LocationDataset::Builder& builder) {
+        std::mt19937 rng(42);
+        uint64_t address = 0;
+        for (int i = 0; i < 5000; ++i) {
+            address += rng() % 300000;
+            if (address > 0xFFFFFFFF) break;
+            uint64_t last = std::min<uint64_t>(address + rng() % 200000, 0xFFFFFFFF);
+            builder.add_ipv4(static_cast<uint32_t>(address), static_cast<uint32_t>(last),
+                             location("C" + std::to_string(i % 50), "city" + std::to_string(i % 700)));
+            address = last + 1;
+        }
+    }
+};
+
+TEST_P(LocationDatasetTest, FindsContainingRange) {
+    LocationDataset::Builder builder;
+    builder.add_ipv4(ip(8, 8, 8, 0), ip(8, 8, 8, 255), location("US", "Mountain View"));
+    builder.add_ipv4(ip(108, 160, 94, 0), ip(108, 160, 95, 127), location("CA", "Stratford"));
+    auto dataset = builder.build(GetParam());
+
+    EXPECT_EQ(city_of(*dataset, ip(8, 8, 8, 8)), "Mountain View");
+    EXPECT_EQ(city_of(*dataset, ip(108, 160, 94, 90)), "Stratford");
+    EXPECT_EQ(city_of(*dataset, ip(108, 160, 95, 127)), "Stratford");
+    EXPECT_FALSE(dataset->find_ipv4(ip(108, 160, 95, 128)));
+    EXPECT_FALSE(dataset->find_ipv4(ip(8, 8, 7, 255)));
+    EXPECT_FALSE(dataset->find_ipv4(0));
+}
+
+TEST_P(LocationDatasetTest, AddressSpaceBoundaries) {
+    LocationDataset::Builder builder;
+    builder.add_ipv4(0, 0, location("AA", "first"));
+    builder.add_ipv4(0xFFFFFF00, 0xFFFFFFFF, location("ZZ", "last"));
+    auto dataset = builder.build(GetParam());
+
+    EXPECT_EQ(city_of(*dataset, 0), "first");
+    EXPECT_FALSE(dataset->find_ipv4(1));
+    EXPECT_EQ(city_of(*dataset, 0xFFFFFFFF), "last");
+    EXPECT_EQ(city_of(*dataset, 0xFFFFFF00), "last");
+    EXPECT_FALSE(dataset->find_ipv4(0xFFFFFEFF));
+}
+
+TEST_P(LocationDatasetTest, OverlappingRangesPreferLowestStart) {
+    LocationDataset::Builder builder;
+    builder.add_ipv4(ip(10, 0, 0, 0), ip(10, 0, 0, 100), location("US", "outer"));
+    builder.add_ipv4(ip(10, 0, 0, 10), ip(10, 0, 0, 20), location("US", "shadowed"));
+    builder.add_ipv4(ip(10, 0, 0, 50), ip(10, 0, 0, 200), location("US", "trimmed"));
+    auto dataset = builder.build(GetParam());
+
+    EXPECT_EQ(city_of(*dataset, ip(10, 0, 0, 15)), "outer");
+    EXPECT_EQ(city_of(*dataset, ip(10, 0, 0, 100)), "outer");
+    EXPECT_EQ(city_of(*dataset, ip(10, 0, 0, 101)), "trimmed");
+    EXPECT_EQ(city_of(*dataset, ip(10, 0, 0, 200)), "trimmed");
+    EXPECT_EQ(dataset->ipv4_range_count(), 2u);
+}
+
+TEST_P(LocationDatasetTest, MatchesBinarySearchOnRandomRanges) {
+    LocationDataset::Builder reference_builder;
+    add_random_ranges(reference_builder);
+    auto reference = reference_builder.build(Ipv4IndexType::BINARY_SEARCH);
+
+    LocationDataset::Builder builder;
+    add_random_ranges(builder);
+    auto dataset = builder.build(GetParam());
+
+    std::mt19937 rng(7);
+    for (int i = 0; i < 200000; ++i) {
+        uint32_t probe = static_cast<uint32_t>(rng());
+        ASSERT_EQ(dataset->find_ipv4(probe), reference->find_ipv4(probe)) << probe;
+    }
+}
+
+TEST_P(LocationDatasetTest, DeduplicatesRecords) {
+    LocationDataset::Builder builder;
+    builder.add_ipv4(ip(1, 0, 0, 0), ip(1, 0, 0, 255), location("AU", "Sydney"));
+    builder.add_ipv4(ip(1, 0, 2, 0), ip(1, 0, 2, 255), location("AU", "Sydney"));
+    builder.add_ipv4(ip(1, 0, 4, 0), ip(1, 0, 4, 255), location("AU", "Melbourne"));
+    auto dataset = builder.build(GetParam());
+
+    EXPECT_EQ(dataset->ipv4_range_count(), 3u);
+    EXPECT_EQ(dataset->record_count(), 2u);
+    EXPECT_EQ(dataset->find_ipv4(ip(1, 0, 0, 1)), dataset->find_ipv4(ip(1, 0, 2, 1)));
+    EXPECT_NE(dataset->find_ipv4(ip(1, 0, 0, 1)), dataset->find_ipv4(ip(1, 0, 4, 1)));
+}
+
+TEST_P(LocationDatasetTest, KeepsAddressFamiliesSeparate) {
+    LocationDataset::Builder builder;
+    builder.add_ipv4(ip(1, 0, 0, 0), ip(1, 0, 0, 255), location("AU", "Sydney"));
+    builder.add_ipv6(IpAddress::parse("2001:4860::")->v6(), IpAddress::parse("2001:4860:ffff:ffff:ffff:ffff:ffff:ffff")->v6(),
+                     location("US", "Mountain View"));
+    auto dataset = builder.build(GetParam());
+
+    EXPECT_EQ(dataset->ipv4_range_count(), 1u);
+    EXPECT_EQ(dataset->ipv6_range_count(), 1u);
+    EXPECT_EQ(city_of(*dataset, ip(1, 0, 0, 7)), "Sydney");
+    EXPECT_EQ(*dataset->find(*IpAddress::parse("2001:4860:4860::8888"))->city, "Mountain View");
+    EXPECT_FALSE(dataset->find(*IpAddress::parse("2001:4861::1")));
+    // ::100:7 has the same low 32 bits as 1.0.0.7 but is not in the IPv4 table
+    EXPECT_FALSE(dataset->find(*IpAddress::parse("::100:7")));
+}
+
+TEST_P(LocationDatasetTest, RoutesMappedAddressesToIpv4) {
+    LocationDataset::Builder builder;
+    builder.add_ipv4(ip(1, 0, 0, 0), ip(1, 0, 0, 255), location("AU", "Sydney"));
+    // a mapped range in the source data lands in the IPv4 table as well
+    builder.add_ipv6(IpAddress::parse("::ffff:8.8.8.0")->v6(), IpAddress::parse("::ffff:8.8.8.255")->v6(),
+                     location("US", "Mountain View"));
+    auto dataset = builder.build(GetParam());
+
+    EXPECT_EQ(dataset->ipv4_range_count(), 2u);
+    EXPECT_EQ(dataset->ipv6_range_count(), 0u);
+    EXPECT_EQ(*dataset->find(*IpAddress::parse("::ffff:1.0.0.1"))->city, "Sydney");
+    EXPECT_EQ(*dataset->find(*IpAddress::parse("8.8.8.8"))->city, "Mountain View");
+    EXPECT_FALSE(dataset->find(*IpAddress::parse("::ffff:1.0.1.1")));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Ipv4Indexes,
+    LocationDatasetTest,
+    ::testing::Values(Ipv4IndexType::BINARY_SEARCH, Ipv4IndexType::DIR_24_8, Ipv4IndexType::DIR_16_8_8)
+);
+
+TEST_P(LocationDatasetTest, CursorMatchesPointLookups) {
+    LocationDataset::Builder builder;
+    add_random_ranges(builder);
+    builder.add_ipv4(0, 0, location("ZZ", "zero"));
+    builder.add_ipv4(0xFFFFFF00, 0xFFFFFFFF, location("ZZ", "top"));
+    auto dataset = builder.build(GetParam());
+
+    std::mt19937 rng(7);
+    std::vector<uint32_t> addresses{0, 0, 1, 0xFFFFFFFF};
+    for (int i = 0; i < 20000; ++i) {
+        addresses.push_back(static_cast<uint32_t>(rng()));
+    }
+    std::sort(addresses.begin(), addresses.end());
+    // a stretch out of order starts over
+    addresses.insert(addresses.begin() + 10000, addresses.begin() + 100, addresses.begin() + 200);
+
+    LocationDataset::Ipv4Cursor cursor(*dataset);
+    for (uint32_t address : addresses) {
+        ASSERT_EQ(cursor.find(address), dataset->find_ipv4_id(address)) << address;
+    }
+}
+
+TEST(RangeTableTest, Ipv6RangesTrimOverlapsAndHandleTopOfSpace) {
+    const uint128_t top = ~static_cast<uint128_t>(0);
+    std::vector<RangeTable<uint128_t>::Range> ranges = {
+        {top - 10, top, 3},
+        {100, 200, 1},
+        {150, 300, 2},
+    };
+    RangeTable<uint128_t> table;
+    table.build(ranges);
+
+    EXPECT_EQ(table.size(), 3u);
+    EXPECT_EQ(table.find(99), NO_RECORD);
+    EXPECT_EQ(table.find(200), 1u);
+    EXPECT_EQ(table.find(201), 2u);
+    EXPECT_EQ(table.find(301), NO_RECORD);
+    EXPECT_EQ(table.find(top), 3u);
+    EXPECT_EQ(table.memory_bytes(), 3 * (2 * sizeof(uint128_t) + sizeof(RecordId)));
+}
+
+TEST(LocationDatasetIndexNames, ParseIndexType) {
+    EXPECT_EQ(LocationDataset::parse_ipv4_index("dir24"), Ipv4IndexType::DIR_24_8);
+    EXPECT_EQ(LocationDataset::parse_ipv4_index("dir16"), Ipv4IndexType::DIR_16_8_8);
+    EXPECT_EQ(LocationDataset::parse_ipv4_index("binary"), Ipv4IndexType::BINARY_SEARCH);
+    EXPECT_THROW(LocationDataset::parse_ipv4_index("trie"), std::invalid_argument);
+}
+
+TEST(LocationDatasetScanTest, PagesMatchAFilteredWalk) {
+    struct Expected {
+        IpAddress first;
+        IpAddress last;
+        std::string country;
+    };
+    // disjoint ranges, so the tables hold them as added
+    std::mt19937_64 rng(17);
+    std::vector<Expected> all;
+    LocationDataset::Builder builder;
+    uint64_t address = 0;
+    for (int i = 0; i < 4000 && address <= 0xFFFFFFFF; ++i) {
+        uint64_t last = std::min<uint64_t>(address + rng() % 3000000, 0xFFFFFFFF);
+        std::string country = "C" + std::to_string(rng() % 30);
+        LocationRecord record;
+        record.country = country;
+        builder.add_ipv4(static_cast<uint32_t>(address), static_cast<uint32_t>(last), record);
+        all.push_back({IpAddress::from_v4(static_cast<uint32_t>(address)), IpAddress::from_v4(static_cast<uint32_t>(last)),
+                       country});
+        address = last + 1 + rng() % 2;
+    }
+    uint128_t high = uint128_t{0x2001} << 112;
+    for (int i = 0; i < 4000; ++i) {
+        uint128_t last = high + (static_cast<uint128_t>(1 + rng() % 4) << 80) - 1;
+        std::string country = "C" + std::to_string(rng() % 30);
+        LocationRecord record;
+        record.country = country;
+        builder.add_ipv6(high, last, record);
+        all.push_back({IpAddress::from_v6(high), IpAddress::from_v6(last), country});
+        high = last + 1 + (static_cast<uint128_t>(rng() % 2) << 80);
+    }
+    auto dataset = builder.build(Ipv4IndexType::DIR_24_8);
+
+    auto overlaps = [](const Expected& range, const IpPrefix& prefix) {
+        if (range.first.is_v4() && prefix.network().is_v6()) {
+            // IPv4 is ::ffff:0:0/96 to an IPv6 block
+            return prefix.length() <= 96 && prefix.contains(IpAddress::from_v6(uint128_t{0xFFFF} << 32));
+        }
+        if (range.first.family() != prefix.network().family()) {
+            return false;
+        }
+        uint128_t first = range.first.is_v4() ? range.first.v4() : range.first.v6();
+        uint128_t last = range.last.is_v4() ? range.last.v4() : range.last.v6();
+        int bits = prefix.network().is_v4() ? 32 : 128;
+        uint128_t low = prefix.network().is_v4() ? prefix.network().v4() : prefix.network().v6();
+        uint128_t size_mask = prefix.length() == 0 ? (bits == 32 ? 0xFFFFFFFF : ~uint128_t{0})
+                                                   : (uint128_t{1} << (bits - prefix.length())) - 1;
+        return first <= (low | size_mask) && last >= low;
+    };
+
+    std::vector<std::optional<std::string>> prefixes{
+        std::nullopt, "0.0.0.0/0", "10.0.0.0/8", "203.0.113.0/22", "198.51.100.7/32", "::ffff:10.0.0.0/104",
+        "2001::/16", "2001:0:0:4000::/50", "::/0", "::/80", "::ffff:0:0/96", "::/81"};
+    std::vector<std::optional<std::string>> countries{std::nullopt, "C7", "C0", "XX"};
+    for (const auto& prefix_text : prefixes) {
+        for (const auto& country : countries) {
+            if (!prefix_text && !country) {
+                continue;
+            }
+            LocationDataset::RangeQuery query;
+            if (prefix_text) {
+                query.prefix = IpPrefix::parse(*prefix_text);
+                ASSERT_TRUE(query.prefix);
+            }
+            query.country = country;
+
+            // ::ffff:10.0.0.0/104 is 10.0.0.0/8
+            std::optional<IpPrefix> prefix = query.prefix;
+            if (prefix && prefix->network().is_v4_mapped()) {
+                prefix = IpPrefix(prefix->network().unmapped(), prefix->length() - 96);
+            }
+            std::vector<LocationDataset::Range> expected;
+            for (const auto& range : all) {
+                if ((!prefix || overlaps(range, *prefix)) && (!country || range.country == *country)) {
+                    expected.push_back({range.first, range.last, NO_RECORD});
+                }
+            }
+
+            std::vector<LocationDataset::Range> listed;
+            size_t pages = 0;
+            do {
+                size_t limit = 1 + rng() % 700;
+                size_t before = listed.size();
+                query.from = dataset->scan_ranges(query, limit, listed);
+                ASSERT_LE(listed.size() - before, limit);
+                ASSERT_TRUE(!query.from || listed.size() - before == limit);
+                ++pages;
+            } while (query.from && pages < 100);
+
+            ASSERT_EQ(listed.size(), expected.size()) << prefix_text.value_or("-") << " " << country.value_or("-");
+            for (size_t i = 0; i < listed.size(); ++i) {
+                ASSERT_EQ(listed[i].first, expected[i].first);
+                ASSERT_EQ(listed[i].last, expected[i].last);
+                if (country) {
+                    ASSERT_EQ(*dataset->record(listed[i].id).country, *country);
+                }
+            }
+        }
+    }
+}
+
+TEST(LocationDatasetScanTest, Ipv6BlocksCoveringTheMappedBlockListIpv4) {
+    LocationRecord record;
+    record.country = "CA";
+    LocationDataset::Builder builder;
+    builder.add_ipv4(0x0A000000, 0x0AFFFFFF, record);
+    builder.add_ipv6(uint128_t{0x2001} << 112, (uint128_t{0x2002} << 112) - 1, record);
+    auto dataset = builder.build(Ipv4IndexType::BINARY_SEARCH);
+
+    auto count = [&](const char* cidr) {
+        LocationDataset::RangeQuery query;
+        query.prefix = IpPrefix::parse(cidr);
+        std::vector<LocationDataset::Range> ranges;
+        EXPECT_FALSE(dataset->scan_ranges(query, 10, ranges));
+        return ranges;
+    };
+    auto everything = count("::/0");
+    ASSERT_EQ(everything.size(), 2u);
+    EXPECT_TRUE(everything[0].first.is_v4());
+    EXPECT_TRUE(everything[1].first.is_v6());
+    EXPECT_EQ(count("::/80").size(), 1u);
+    EXPECT_TRUE(count("::/80")[0].first.is_v4());
+    EXPECT_EQ(count("::ffff:0:0/96").size(), 1u);
+    EXPECT_TRUE(count("::/81").empty());
+    EXPECT_EQ(count("2000::/3").size(), 1u);
+
+    // a cursor in IPv6 has left IPv4 behind
+    LocationDataset::RangeQuery query;
+    query.prefix = IpPrefix::parse("::/0");
+    std::vector<LocationDataset::Range> first_page;
+    query.from = dataset->scan_ranges(query, 1, first_page);
+    ASSERT_TRUE(query.from && query.from->is_v6());
+    std::vector<LocationDataset::Range> second_page;
+    EXPECT_FALSE(dataset->scan_ranges(query, 1, second_page));
+    ASSERT_EQ(second_page.size(), 1u);
+    EXPECT_TRUE(second_page[0].first.is_v6());
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "handlers/location_json.h"
+
+namespace {
+
+std::pmr::string render(std::string_view ip, const LocationRecord& record) {
+    std::pmr::string out;
+    LocationJson::append_location(out, ip, LocationRecordView(record));
+    return out;
+}
+
+} // namespace
+
+TEST(LocationJsonTest, RendersPresentFieldsInOrder) {
+    LocationRecord record;
+    record.country = "CA";
+    record.city = "Stratford";
+    record.latitude = 43.36679f;
+    record.longitude = -80.94972f;
+    record.timezone = "America/Toronto";
+
+    EXPECT_EQ(render("203.0.113.9", record),
+              "{\"ip\":\"203.0.113.9\",\"country\":\"CA\",\"city\":\"Stratford\",\"latitude\":43.36679,"
+              "\"longitude\":-80.94972,\"timezone\":\"America/Toronto\"}");
+}
+
+TEST(LocationJsonTest, FormatsCoordinatesLikeCrow) {
+    LocationRecord record;
+    record.latitude = 43.0f;
+    record.longitude = 0.5f;
+    EXPECT_EQ(render("1.1.1.1", record), "{\"ip\":\"1.1.1.1\",\"latitude\":43.0,\"longitude\":0.5}");
+}
+
+TEST(LocationJsonTest, EscapesStrings) {
+    LocationRecord record;
+    record.city = "Quote\" back\\slash\ttab\x01";
+    record.region = "Île-de-France";
+    EXPECT_EQ(render("::1", record),
+              "{\"ip\":\"::1\",\"city\":\"Quote\\\" back\\\\slash\\ttab\\u0001\",\"region\":\"Île-de-France\"}");
+}
+
+TEST(LocationJsonTest, ParsesFieldLists) {
+    EXPECT_EQ(LocationJson::parse_fields("country"), LocationJson::COUNTRY);
+    EXPECT_EQ(LocationJson::parse_fields("country,latitude,longitude"),
+              LocationJson::COUNTRY | LocationJson::LATITUDE | LocationJson::LONGITUDE);
+    EXPECT_EQ(LocationJson::parse_fields("ip"), 0);
+    EXPECT_EQ(LocationJson::parse_fields(""), LocationJson::ALL_FIELDS);
+    EXPECT_EQ(LocationJson::parse_fields("city,,city,"), LocationJson::CITY);
+
+    EXPECT_FALSE(LocationJson::parse_fields("country,asn").has_value());
+    EXPECT_FALSE(LocationJson::parse_fields("Country").has_value());
+}
+
+TEST(LocationJsonTest, RendersOnlyRequestedFields) {
+    LocationRecord record;
+    record.country = "CA";
+    record.city = "Stratford";
+    record.latitude = 43.36679f;
+    record.longitude = -80.94972f;
+    record.timezone = "America/Toronto";
+    LocationRecordView view(record);
+
+    std::pmr::string out;
+    LocationJson::append_location(out, "203.0.113.9", view, LocationJson::COUNTRY);
+    EXPECT_EQ(out, "{\"ip\":\"203.0.113.9\",\"country\":\"CA\"}");
+
+    out.clear();
+    LocationJson::append_location(out, "203.0.113.9", view, LocationJson::TIMEZONE | LocationJson::LATITUDE);
+    EXPECT_EQ(out, "{\"ip\":\"203.0.113.9\",\"latitude\":43.36679,\"timezone\":\"America/Toronto\"}");
+
+    out.clear();
+    LocationJson::append_location(out, "203.0.113.9", view, 0);
+    EXPECT_EQ(out, "{\"ip\":\"203.0.113.9\"}");
+
+    //every field requested matches the unprojected body
+    out.clear();
+    LocationJson::append_location(out, "203.0.113.9", view, LocationJson::ALL_FIELDS);
+    EXPECT_EQ(out, render("203.0.113.9", record));
+}
+
+TEST(LocationJsonTest, RendersErrors) {
+    std::pmr::string out;
+    LocationJson::append_error(out, "IP address location not found", "IP_NOT_FOUND", 1752460233);
+    EXPECT_EQ(out, "{\"error\":\"IP address location not found\",\"code\":\"IP_NOT_FOUND\",\"timestamp\":1752460233}");
+}
+
+TEST(LocationJsonTest, RendersRanges) {
+    LocationRecord record;
+    record.country = "CA";
+    record.city = "Stratford";
+    LocationRecordView view(record);
+
+    std::pmr::string out;
+    LocationJson::append_range(out, "203.0.112.0", "203.0.113.255", view);
+    EXPECT_EQ(out, "{\"start_ip\":\"203.0.112.0\",\"end_ip\":\"203.0.113.255\",\"country\":\"CA\",\"city\":\"Stratford\"}");
+
+    out.clear();
+    LocationJson::append_range(out, "2001:db8::", "2001:db8::ffff", view, LocationJson::COUNTRY);
+    EXPECT_EQ(out, "{\"start_ip\":\"2001:db8::\",\"end_ip\":\"2001:db8::ffff\",\"country\":\"CA\"}");
+
+    // a page of /ip-ranges is rendered into the std::string the response sends
+    std::string body;
+    LocationJson::append_range(body, "2001:db8::", "2001:db8::ffff", view, LocationJson::COUNTRY);
+    EXPECT_EQ(std::string_view(body), std::string_view(out));
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "lookup/location_dataset.h"
+#include "lookup/memory_placement.h"
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+
+TEST(MemoryPlacementTest, SmallAndDefaultAllocationsUseTheHeap) {
+    auto before = MemoryPlacementPolicy::stats();
+    {
+        PlacedVector<uint32_t> large(MemoryPlacementPolicy::HUGE_PAGE_BYTES, 7);
+        PlacementScope scope(MemoryPlacement{HugePageMode::TRANSPARENT, -1});
+        PlacedVector<uint32_t> small(1024, 7);
+        EXPECT_EQ(MemoryPlacementPolicy::stats().mapped_bytes, before.mapped_bytes);
+    }
+    EXPECT_EQ(MemoryPlacementPolicy::stats().mapped_bytes, before.mapped_bytes);
+}
+
+TEST(MemoryPlacementTest, LargeAllocationsAreMappedOnHugePageBoundaries) {
+    auto before = MemoryPlacementPolicy::stats();
+    {
+        PlacementScope scope(MemoryPlacement{HugePageMode::TRANSPARENT, -1});
+        PlacedVector<uint32_t> values(MemoryPlacementPolicy::HUGE_PAGE_BYTES, 0);
+        for (size_t i = 0; i < values.size(); i += 4096) {
+            values[i] = static_cast<uint32_t>(i);
+        }
+
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(values.data()) % MemoryPlacementPolicy::HUGE_PAGE_BYTES, 0u);
+        EXPECT_EQ(MemoryPlacementPolicy::stats().mapped_bytes - before.mapped_bytes,
+                  values.size() * sizeof(uint32_t));
+        EXPECT_EQ(values[8192], 8192u);
+    }
+    EXPECT_EQ(MemoryPlacementPolicy::stats().mapped_bytes, before.mapped_bytes);
+}
+
+TEST(MemoryPlacementTest, ExplicitHugePagesFallBackWhenThePoolIsEmpty) {
+    auto before = MemoryPlacementPolicy::stats();
+    PlacementScope scope(MemoryPlacement{HugePageMode::EXPLICIT, -1});
+    PlacedVector<uint8_t> values(MemoryPlacementPolicy::HUGE_PAGE_BYTES * 2, 1);
+
+    // either the reserved pool served it or the fallback was counted
+    auto after = MemoryPlacementPolicy::stats();
+    EXPECT_TRUE(after.hugetlb_bytes > before.hugetlb_bytes || after.hugetlb_fallbacks > before.hugetlb_fallbacks);
+    EXPECT_EQ(values.back(), 1);
+}
+
+TEST(MemoryPlacementTest, SharedPlacementsAreNotCopiedOnFork) {
+    PlacementScope scope(MemoryPlacement{HugePageMode::OFF, -1, true});
+    PlacedVector<uint32_t> values(MemoryPlacementPolicy::HUGE_PAGE_BYTES, 0);
+
+    // a write from the child lands in the parent's pages
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        values[4096] = 42;
+        _exit(0);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_EQ(values[4096], 42u);
+}
+
+TEST(MemoryPlacementTest, ScopesNestAndRestore) {
+    EXPECT_TRUE(MemoryPlacementPolicy::current().is_default());
+    {
+        PlacementScope outer(MemoryPlacement{HugePageMode::TRANSPARENT, 0});
+        {
+            PlacementScope inner(MemoryPlacement{HugePageMode::OFF, -1});
+            EXPECT_TRUE(MemoryPlacementPolicy::current().is_default());
+        }
+        EXPECT_EQ(MemoryPlacementPolicy::current().huge_pages, HugePageMode::TRANSPARENT);
+        EXPECT_EQ(MemoryPlacementPolicy::current().numa_node, 0);
+    }
+    EXPECT_TRUE(MemoryPlacementPolicy::current().is_default());
+}
+
+TEST(MemoryPlacementTest, ReplicaAnswersLikeThePrimary) {
+    LocationDataset::Builder builder;
+    LocationRecord record;
+    record.country = "NL";
+    record.city = "Amsterdam";
+    builder.add_ipv4(0x05000000, 0x05FFFFFF, record);
+    auto primary = builder.build(Ipv4IndexType::DIR_24_8);
+
+    auto before = MemoryPlacementPolicy::stats();
+    auto replica = primary->replicate(MemoryPlacement{HugePageMode::TRANSPARENT, -1});
+
+    // the 64 MB first level of the replica goes through the placement path
+    EXPECT_GE(MemoryPlacementPolicy::stats().mapped_bytes - before.mapped_bytes, size_t{64} << 20);
+    EXPECT_EQ(replica->find_ipv4(0x05010203), primary->find_ipv4(0x05010203));
+    EXPECT_EQ(*replica->find_ipv4(0x05010203)->city, "Amsterdam");
+    EXPECT_FALSE(replica->find_ipv4(0x06000000));
+}
+
+TEST(MemoryPlacementTest, ParseHugePageMode) {
+    EXPECT_EQ(MemoryPlacementPolicy::parse_huge_page_mode("off"), HugePageMode::OFF);
+    EXPECT_EQ(MemoryPlacementPolicy::parse_huge_page_mode("transparent"), HugePageMode::TRANSPARENT);
+    EXPECT_EQ(MemoryPlacementPolicy::parse_huge_page_mode("explicit"), HugePageMode::EXPLICIT);
+    EXPECT_THROW(MemoryPlacementPolicy::parse_huge_page_mode("1g"), std::invalid_argument);
+}
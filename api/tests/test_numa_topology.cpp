@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include "utils/numa_topology.h"
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+class NumaTopologyTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_root = std::filesystem::temp_directory_path() / ("numa_topology_test_" + std::to_string(getpid()));
+        std::filesystem::create_directories(m_root);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_root);
+    }
+
+    void add_node(const std::string& name, const std::string& cpulist) {
+        std::filesystem::create_directories(m_root / name);
+        std::ofstream(m_root / name / "cpulist") << cpulist << "\n";
+    }
+
+    std::filesystem::path m_root;
+};
+
+TEST_F(NumaTopologyTest, ParsesCpuLists) {
+    EXPECT_EQ(NumaTopology::parse_cpu_list("0"), (std::vector<int>{0}));
+    EXPECT_EQ(NumaTopology::parse_cpu_list("0-3,8-9"), (std::vector<int>{0, 1, 2, 3, 8, 9}));
+    EXPECT_EQ(NumaTopology::parse_cpu_list("4,6\n"), (std::vector<int>{4, 6}));
+    EXPECT_TRUE(NumaTopology::parse_cpu_list("").empty());
+    EXPECT_THROW(NumaTopology::parse_cpu_list("3-1"), std::invalid_argument);
+    EXPECT_THROW(NumaTopology::parse_cpu_list("x"), std::invalid_argument);
+}
+
+TEST_F(NumaTopologyTest, DetectsNodesWithCpus) {
+    add_node("node1", "8-15");
+    add_node("node0", "0-7");
+    add_node("node2", ""); // memory-only node
+    std::filesystem::create_directories(m_root / "power");
+
+    auto nodes = NumaTopology::detect(m_root.string());
+
+    ASSERT_EQ(nodes.size(), 2u);
+    EXPECT_EQ(nodes[0].id, 0);
+    EXPECT_EQ(nodes[0].cpus.size(), 8u);
+    EXPECT_EQ(nodes[1].id, 1);
+    EXPECT_EQ(nodes[1].cpus.front(), 8);
+}
+
+TEST_F(NumaTopologyTest, MissingSysfsMeansNoNodes) {
+    EXPECT_TRUE(NumaTopology::detect((m_root / "missing").string()).empty());
+}
+
+TEST_F(NumaTopologyTest, PinsThreadToOneCpu) {
+    auto cpus = NumaTopology::allowed_cpus();
+    ASSERT_FALSE(cpus.empty());
+
+    // on a separate thread so the test runner keeps its own affinity
+    std::vector<int> pinned;
+    std::thread worker([&]() {
+        if (NumaTopology::pin_current_thread_to_cpu(cpus.back())) {
+            pinned = NumaTopology::allowed_cpus();
+        }
+    });
+    worker.join();
+    EXPECT_EQ(pinned, (std::vector<int>{cpus.back()}));
+}
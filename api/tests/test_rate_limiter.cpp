@@ -139,3 +139,24 @@ TEST_F(RateLimiterTest, ThreadSafety) {
     EXPECT_EQ(allowed_count, 3);
     EXPECT_EQ(blocked_count, 47);
 }
+
+TEST_F(RateLimiterTest, TrackedClientsAreCapped) {
+    RateLimiter limiter(3, 60, 16);
+    for (int i = 0; i < 1000; ++i) {
+        limiter.is_allowed("198.51.100." + std::to_string(i));
+    }
+    EXPECT_LE(limiter.client_count(), 16u);
+    EXPECT_GT(limiter.evicted_count(), 0u);
+}
+
+TEST_F(RateLimiterTest, SprayingEvictsQuietClientsFirst) {
+    RateLimiter limiter(3, 60, 8);
+    // every client shares the eight slots; the busy one stays the most recently active
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(limiter.is_allowed("busy"));
+    }
+    for (int i = 0; i < 100; ++i) {
+        limiter.is_allowed("spray-" + std::to_string(i));
+        EXPECT_FALSE(limiter.is_allowed("busy"));
+    }
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "async/reactor.h"
+#include "async/task.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+Task<int> add(int a, int b) {
+    co_return a + b;
+}
+
+Task<int> sum_of_sums() {
+    int first = co_await add(1, 2);
+    int second = co_await add(3, 4);
+    co_return first + second;
+}
+
+Task<int> fails() {
+    throw std::runtime_error("boom");
+    co_return 0;
+}
+
+bool wait_until(const std::atomic<bool>& flag) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!flag.load() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return flag.load();
+}
+
+} // namespace
+
+TEST(ReactorTest, TasksRunInlineUntilTheyAreAwaited) {
+    int result = 0;
+    spawn([](int& out) -> Task<void> { out = co_await sum_of_sums(); }(result));
+    EXPECT_EQ(result, 10);
+}
+
+TEST(ReactorTest, ExceptionsPropagateThroughCoAwait) {
+    std::string error;
+    spawn([](std::string& out) -> Task<void> {
+        try {
+            co_await fails();
+        } catch (const std::runtime_error& e) {
+            out = e.what();
+        }
+    }(error));
+    EXPECT_EQ(error, "boom");
+}
+
+TEST(ReactorTest, ScheduleContinuesOnAReactorThread) {
+    Reactor reactor(2);
+    std::atomic<bool> done{false};
+    std::thread::id resumed_on;
+
+    spawn([](Reactor& r, std::thread::id& id, std::atomic<bool>& flag) -> Task<void> {
+        co_await r.schedule();
+        id = std::this_thread::get_id();
+        flag = true;
+    }(reactor, resumed_on, done));
+
+    ASSERT_TRUE(wait_until(done));
+    EXPECT_NE(resumed_on, std::this_thread::get_id());
+}
+
+TEST(ReactorTest, ResumesWhenSocketBecomesReadable) {
+    Reactor reactor(1);
+    int fds[2];
+    ASSERT_EQ(pipe2(fds, O_NONBLOCK), 0);
+
+    std::atomic<bool> done{false};
+    char received = 0;
+    spawn([](Reactor& r, int fd, char& out, std::atomic<bool>& flag) -> Task<void> {
+        co_await r.readable(fd);
+        [[maybe_unused]] auto n = read(fd, &out, 1);
+        flag = true;
+    }(reactor, fds[0], received, done));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(done.load());
+    ASSERT_EQ(write(fds[1], "x", 1), 1);
+
+    ASSERT_TRUE(wait_until(done));
+    EXPECT_EQ(received, 'x');
+    reactor.forget(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(ReactorTest, HoldsManyWaitersOnFewThreads) {
+    constexpr int WAITERS = 1000;
+    Reactor reactor(2);
+
+    // every waiter suspends on the reactor; none holds a thread while it waits
+    std::atomic<int> finished{0};
+    std::atomic<bool> all_done{false};
+    for (int i = 0; i < WAITERS; ++i) {
+        spawn([](Reactor& r, std::atomic<int>& count, std::atomic<bool>& flag) -> Task<void> {
+            co_await r.schedule();
+            if (count.fetch_add(1) + 1 == WAITERS) {
+                flag = true;
+            }
+        }(reactor, finished, all_done));
+    }
+
+    ASSERT_TRUE(wait_until(all_done));
+    EXPECT_EQ(finished.load(), WAITERS);
+}
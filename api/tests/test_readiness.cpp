@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include "server/readiness.h"
+
+using Component = Readiness::Component;
+using State = Readiness::State;
+
+TEST(ReadinessTest, ReadyOnceEveryComponentHasSettled) {
+    Readiness readiness;
+    EXPECT_FALSE(readiness.ready());
+    EXPECT_FALSE(readiness.time_to_ready().has_value());
+
+    EXPECT_FALSE(readiness.settle(Component::DATASET, State::OFF));
+    EXPECT_FALSE(readiness.settle(Component::CACHE, State::BYPASSED));
+    EXPECT_FALSE(readiness.ready());
+
+    EXPECT_TRUE(readiness.settle(Component::DATABASE, State::READY));
+    EXPECT_TRUE(readiness.ready());
+    EXPECT_TRUE(readiness.time_to_ready().has_value());
+}
+
+TEST(ReadinessTest, ComponentsSettleOnlyOnce) {
+    Readiness readiness;
+    readiness.settle(Component::CACHE, State::BYPASSED);
+    EXPECT_FALSE(readiness.settle(Component::CACHE, State::READY));
+    EXPECT_EQ(readiness.state(Component::CACHE), State::BYPASSED);
+
+    // settling as pending does nothing
+    EXPECT_FALSE(readiness.settle(Component::DATABASE, State::PENDING));
+    EXPECT_EQ(readiness.state(Component::DATABASE), State::PENDING);
+    EXPECT_FALSE(readiness.settled_after(Component::DATABASE).has_value());
+}
+
+TEST(ReadinessTest, TimesAreMeasuredFromStart) {
+    Readiness readiness(Readiness::Clock::now() - std::chrono::seconds(2));
+    readiness.settle(Component::DATABASE, State::READY);
+    readiness.settle(Component::CACHE, State::READY);
+    readiness.settle(Component::DATASET, State::READY);
+
+    ASSERT_TRUE(readiness.settled_after(Component::DATABASE).has_value());
+    EXPECT_GE(readiness.settled_after(Component::DATABASE)->count(), 2000);
+    EXPECT_GE(readiness.time_to_ready()->count(), readiness.settled_after(Component::DATABASE)->count());
+}
+
+TEST(ReadinessTest, NamesComponentsAndStates) {
+    EXPECT_STREQ(Readiness::component_to_string(Component::DATABASE), "database");
+    EXPECT_STREQ(Readiness::component_to_string(Component::DATASET), "dataset");
+    EXPECT_STREQ(Readiness::state_to_string(State::BYPASSED), "bypassed");
+    EXPECT_STREQ(Readiness::state_to_string(State::PENDING), "pending");
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "lookup/record_store.h"
+
+TEST(RecordStoreTest, RoundTripsRecords) {
+    LocationRecord full;
+    full.country = "US";
+    full.city = "Mountain View";
+    full.region = "California";
+    full.latitude = 37.38605f;
+    full.longitude = -122.08385f;
+    full.postal_code = "94035";
+    full.timezone = "America/Los_Angeles";
+
+    LocationRecord sparse;
+    sparse.country = "US";
+    sparse.city = "";
+
+    RecordStore store;
+    store.build({full, sparse, LocationRecord()});
+
+    ASSERT_EQ(store.size(), 3u);
+
+    LocationRecord decoded = store.get(0);
+    EXPECT_EQ(decoded.country, full.country);
+    EXPECT_EQ(decoded.city, full.city);
+    EXPECT_EQ(decoded.region, full.region);
+    EXPECT_EQ(decoded.postal_code, full.postal_code);
+    EXPECT_EQ(decoded.timezone, full.timezone);
+    ASSERT_TRUE(decoded.latitude && decoded.longitude);
+    EXPECT_NEAR(*decoded.latitude, *full.latitude, 1e-5);
+    EXPECT_NEAR(*decoded.longitude, *full.longitude, 1e-5);
+
+    // empty strings and missing values stay distinct
+    EXPECT_EQ(store.get(1).country, "US");
+    EXPECT_EQ(store.get(1).city, "");
+    EXPECT_FALSE(store.get(1).region);
+    EXPECT_FALSE(store.get(1).latitude);
+
+    EXPECT_EQ(store.get(2), LocationRecord());
+}
+
+TEST(RecordStoreTest, SharesStringsAcrossRecordsAndFields) {
+    std::vector<LocationRecord> records;
+    for (int i = 0; i < 100; ++i) {
+        LocationRecord record;
+        record.country = "SG";
+        record.city = "Singapore";
+        record.region = "Singapore";
+        record.postal_code = std::to_string(100000 + i);
+        record.timezone = "Asia/Singapore";
+        records.push_back(record);
+    }
+
+    RecordStore store;
+    store.build(records);
+
+    // SG, Singapore, Asia/Singapore and one postal code per record
+    EXPECT_EQ(store.string_count(), 3u + 100u);
+    EXPECT_EQ(*store.get(42).postal_code, "100042");
+    EXPECT_EQ(*store.get(42).region, "Singapore");
+}
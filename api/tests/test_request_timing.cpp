@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include "utils/request_timing.h"
+#include <stdexcept>
+#include <thread>
+
+TEST(RequestTimingTest, DisabledTimingRecordsNothing) {
+    RequestTiming timing;
+    {
+        auto span = timing.span(RequestTiming::Stage::CACHE);
+    }
+    timing.set_ip("8.8.8.8");
+
+    EXPECT_FALSE(timing.enabled());
+    EXPECT_FALSE(timing.ran(RequestTiming::Stage::CACHE));
+    EXPECT_EQ(timing.elapsed().count(), 0);
+    EXPECT_TRUE(timing.ip().empty());
+}
+
+TEST(RequestTimingTest, SpansAccumulatePerStage) {
+    auto timing = RequestTiming::start(false, true);
+    for (int i = 0; i < 2; ++i) {
+        auto span = timing.span(RequestTiming::Stage::QUERY);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    EXPECT_TRUE(timing.ran(RequestTiming::Stage::QUERY));
+    EXPECT_FALSE(timing.ran(RequestTiming::Stage::CACHE));
+    EXPECT_GE(timing.duration(RequestTiming::Stage::QUERY), std::chrono::milliseconds(4));
+    EXPECT_GE(timing.elapsed(), timing.duration(RequestTiming::Stage::QUERY));
+}
+
+TEST(RequestTimingTest, HeaderListsStagesThatRanAndTheTotal) {
+    auto timing = RequestTiming::start(true, false);
+    timing.add(RequestTiming::Stage::RATE_LIMIT, std::chrono::microseconds(2));
+    timing.add(RequestTiming::Stage::CACHE, std::chrono::microseconds(1500));
+
+    std::string header = timing.server_timing_header();
+    EXPECT_EQ(header.rfind("rate_limit;dur=0.002, cache;dur=1.500, total;dur=", 0), 0u) << header;
+    EXPECT_EQ(header.find("query"), std::string::npos);
+}
+
+TEST(RequestTimingTest, KeepsTheAddressOnlyWhenEnabled) {
+    auto timing = RequestTiming::start(false, true);
+    timing.set_ip("2001:db8::1");
+    EXPECT_EQ(timing.ip(), "2001:db8::1");
+}
+
+TEST(RequestTimingTest, ParsesHeaderModes) {
+    EXPECT_EQ(RequestTiming::parse_header_mode("off"), RequestTiming::HeaderMode::OFF);
+    EXPECT_EQ(RequestTiming::parse_header_mode("request"), RequestTiming::HeaderMode::ON_REQUEST);
+    EXPECT_EQ(RequestTiming::parse_header_mode("always"), RequestTiming::HeaderMode::ALWAYS);
+    EXPECT_THROW(RequestTiming::parse_header_mode("sometimes"), std::invalid_argument);
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "utils/reserved_ranges.h"
+
+class ReservedRangesTest : public ::testing::TestWithParam<std::pair<std::string, bool>> {};
+
+TEST_P(ReservedRangesTest, Classification) {
+    auto [ip, reserved] = GetParam();
+    auto address = IpAddress::parse(ip);
+    ASSERT_TRUE(address.has_value()) << ip;
+
+    EXPECT_EQ(ReservedRanges::find(*address) != nullptr, reserved) << ip;
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    SpecialPurposeBlocks,
+    ReservedRangesTest,
+    ::testing::Values(
+        std::make_pair("10.1.2.3", true),
+        std::make_pair("172.16.0.1", true),
+        std::make_pair("172.31.255.255", true),
+        std::make_pair("172.32.0.0", false),
+        std::make_pair("192.168.1.1", true),
+        std::make_pair("127.0.0.1", true),
+        std::make_pair("169.254.10.10", true),
+        std::make_pair("100.64.0.1", true),
+        std::make_pair("100.128.0.1", false),
+        std::make_pair("224.0.0.251", true),
+        std::make_pair("255.255.255.255", true),
+        std::make_pair("0.0.0.0", true),
+        std::make_pair("192.0.2.10", true),
+        std::make_pair("203.0.113.5", true),
+        std::make_pair("8.8.8.8", false),
+        std::make_pair("108.160.94.90", false),
+        std::make_pair("::1", true),
+        std::make_pair("::", true),
+        std::make_pair("2001:db8::1", true),
+        std::make_pair("fe80::1", true),
+        std::make_pair("fd12:3456::1", true),
+        std::make_pair("ff02::1", true),
+        std::make_pair("2606:4700:4700::1111", false),
+        std::make_pair("::ffff:192.168.1.1", true),
+        std::make_pair("::ffff:8.8.8.8", false)
+    )
+);
+
+TEST(ReservedRangesNames, ReportsBlockName) {
+    EXPECT_STREQ(ReservedRanges::find(*IpAddress::parse("10.0.0.1")), "Private-Use");
+    EXPECT_STREQ(ReservedRanges::find(*IpAddress::parse("100.64.1.1")), "Shared Address Space");
+    EXPECT_STREQ(ReservedRanges::find(*IpAddress::parse("2001:db8::")), "Documentation");
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "utils/trace_ring.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+TraceRecord record_with_status(uint16_t status) {
+    TraceRecord record;
+    record.status = status;
+    record.total_ns = status * 1000u;
+    return record;
+}
+
+} // namespace
+
+TEST(TraceRingTest, EmptyRingHasNoRecords) {
+    TraceRing ring(4);
+    EXPECT_TRUE(ring.snapshot(4).empty());
+}
+
+TEST(TraceRingTest, ReturnsNewestFirstAndKeepsTheLastLap) {
+    TraceRing ring(4);
+    for (uint16_t status = 1; status <= 6; ++status) {
+        ring.push(record_with_status(status));
+    }
+
+    auto records = ring.snapshot(10);
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[0].status, 6);
+    EXPECT_EQ(records[3].status, 3);
+    EXPECT_EQ(records[0].total_ns, 6000u);
+    EXPECT_EQ(ring.recorded_count(), 6u);
+
+    EXPECT_EQ(ring.snapshot(2).size(), 2u);
+}
+
+TEST(TraceRingTest, RecordsTimingBreakdown) {
+    auto timing = RequestTiming::start(false, true);
+    timing.add(RequestTiming::Stage::POOL_WAIT, std::chrono::microseconds(30));
+    timing.set_ip("203.0.113.9");
+
+    auto record = TraceRecord::from(timing, 200);
+    EXPECT_STREQ(record.ip, "203.0.113.9");
+    EXPECT_EQ(record.status, 200);
+    EXPECT_EQ(record.ran_stages, 1u << static_cast<unsigned>(RequestTiming::Stage::POOL_WAIT));
+    EXPECT_EQ(record.stage_ns[static_cast<size_t>(RequestTiming::Stage::POOL_WAIT)], 30000u);
+}
+
+TEST(TraceRingTest, ReadersNeverSeeTornRecords) {
+    TraceRing ring(8);
+    std::atomic<bool> stop{false};
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&, t]() {
+            uint16_t status = static_cast<uint16_t>(100 * (t + 1));
+            while (!stop.load()) {
+                ring.push(record_with_status(status));
+            }
+        });
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        for (const auto& record : ring.snapshot(8)) {
+            ASSERT_EQ(record.total_ns, record.status * 1000u);
+        }
+    }
+    stop = true;
+    for (auto& writer : writers) {
+        writer.join();
+    }
+}
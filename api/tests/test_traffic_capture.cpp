@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "utils/traffic_capture.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / (name + "." + std::to_string(getpid()))).string();
+}
+
+IpAddress address(const char* text) {
+    return *IpAddress::parse(text);
+}
+
+} // namespace
+
+TEST(TrafficCaptureTest, RecordsRoundTripThroughTheFile) {
+    std::string path = temp_path("capture_round_trip");
+    {
+        TrafficCapture capture(path, 16);
+        capture.record(address("203.0.113.7"), 0x7F);
+        capture.record(address("2001:db8::1"), 0x03);
+        capture.record(address("::ffff:198.51.100.1"), 0x01);
+    }
+
+    auto contents = TrafficLog::read(path);
+    ASSERT_EQ(contents.requests.size(), 3u);
+    EXPECT_GT(contents.start_unix_ns, 0);
+    EXPECT_EQ(contents.requests[0].address, address("203.0.113.7"));
+    EXPECT_TRUE(contents.requests[0].address.is_v4());
+    EXPECT_EQ(contents.requests[0].fields, 0x7F);
+    EXPECT_EQ(contents.requests[1].address, address("2001:db8::1"));
+    EXPECT_EQ(contents.requests[1].fields, 0x03);
+    // mapped addresses come back as the IPv4 address they are
+    EXPECT_EQ(contents.requests[2].address, address("198.51.100.1"));
+    EXPECT_LE(contents.requests[0].offset_ns, contents.requests[2].offset_ns);
+    std::filesystem::remove(path);
+}
+
+TEST(TrafficCaptureTest, DropsWhenTheRingIsFull) {
+    std::string path = temp_path("capture_full");
+    {
+        // the writer sleeps for an hour between flushes, so only the destructor drains
+        TrafficCapture capture(path, 4, std::chrono::hours(1));
+        for (int i = 0; i < 10; ++i) {
+            capture.record(address("192.0.2.1"), 0x7F);
+        }
+        EXPECT_EQ(capture.captured_count() + capture.dropped_count(), 10u);
+        EXPECT_GE(capture.dropped_count(), 6u);
+    }
+    EXPECT_LE(TrafficLog::read(path).requests.size(), 4u);
+    std::filesystem::remove(path);
+}
+
+TEST(TrafficCaptureTest, ConcurrentWritersLoseNothingTheyCounted) {
+    std::string path = temp_path("capture_concurrent");
+    uint64_t captured = 0;
+    {
+        TrafficCapture capture(path, 1024, std::chrono::milliseconds(1));
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < 4; ++t) {
+            threads.emplace_back([&capture, t] {
+                for (uint32_t i = 0; i < 5000; ++i) {
+                    capture.record(IpAddress::from_v4((t << 24) | i), static_cast<uint8_t>(t));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        captured = capture.captured_count();
+        EXPECT_EQ(captured + capture.dropped_count(), 20000u);
+    }
+
+    auto contents = TrafficLog::read(path);
+    ASSERT_EQ(contents.requests.size(), captured);
+    // each writer's records keep their order
+    std::vector<uint32_t> last(4, 0);
+    std::vector<bool> seen(4, false);
+    for (const auto& request : contents.requests) {
+        uint32_t thread = request.fields;
+        uint32_t index = request.address.v4() & 0xFFFFFF;
+        ASSERT_LT(thread, 4u);
+        EXPECT_EQ(request.address.v4() >> 24, thread);
+        if (seen[thread]) {
+            EXPECT_GT(index, last[thread]);
+        }
+        seen[thread] = true;
+        last[thread] = index;
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(TrafficCaptureTest, ReadLeavesOutATruncatedRecordAndRejectsOtherFiles) {
+    std::string path = temp_path("capture_truncated");
+    std::string data;
+    TrafficLog::append_header(data, 1700000000000000000);
+    CapturedRequest request;
+    request.offset_ns = 42;
+    request.address = address("192.0.2.9");
+    request.fields = 0x7F;
+    TrafficLog::append_record(data, request);
+    TrafficLog::append_record(data, request);
+    data.resize(data.size() - 5);
+    std::ofstream(path, std::ios::binary) << data;
+
+    auto contents = TrafficLog::read(path);
+    EXPECT_EQ(contents.start_unix_ns, 1700000000000000000);
+    ASSERT_EQ(contents.requests.size(), 1u);
+    EXPECT_EQ(contents.requests[0].offset_ns, 42u);
+    EXPECT_EQ(contents.requests[0].address, address("192.0.2.9"));
+
+    std::ofstream(path, std::ios::binary) << "not a capture at all";
+    EXPECT_THROW(TrafficLog::read(path), std::runtime_error);
+    std::filesystem::remove(path);
+    EXPECT_THROW(TrafficLog::read(path), std::runtime_error);
+}
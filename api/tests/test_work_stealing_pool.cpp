@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include "enrich/work_stealing_pool.h"
+#include <atomic>
+#include <chrono>
+
+TEST(WorkStealingPoolTest, RunsEveryTaskBeforeDestruction) {
+    std::atomic<int> ran{0};
+    {
+        WorkStealingPool pool(4);
+        EXPECT_EQ(pool.thread_count(), 4u);
+        for (int i = 0; i < 1000; ++i) {
+            pool.submit([&ran]() { ran.fetch_add(1); });
+        }
+    }
+    EXPECT_EQ(ran.load(), 1000);
+}
+
+TEST(WorkStealingPoolTest, IdleThreadsStealFromABusyOne) {
+    std::atomic<int> ran{0};
+    WorkStealingPool pool(2);
+    // the first task holds its thread, so the tasks dealt to that thread behind it are stolen
+    std::atomic<bool> release{false};
+    pool.submit([&]() {
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+        ran.fetch_add(1);
+    });
+    for (int i = 0; i < 100; ++i) {
+        pool.submit([&ran]() { ran.fetch_add(1); });
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (ran.load() < 100 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(ran.load(), 100);
+    EXPECT_GT(pool.steal_count(), 0u);
+    release = true;
+}
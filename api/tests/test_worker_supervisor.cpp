@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "server/worker_supervisor.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+int g_events_fd = -1;
+
+// an old worker records that it was stopped
+void report_stopped(int) {
+    if (write(g_events_fd, "t", 1) != 1) {
+        _exit(2);
+    }
+    _exit(0);
+}
+
+} // namespace
+
+class WorkerSupervisorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(pipe(m_pipe), 0);
+        fcntl(m_pipe[0], F_SETFL, O_NONBLOCK);
+    }
+
+    void TearDown() override {
+        close(m_pipe[0]);
+        close(m_pipe[1]);
+    }
+
+    // each started worker reports its index through the pipe
+    WorkerSupervisor::WorkerMain reporting_worker(bool exit_immediately) {
+        return [this, exit_immediately](size_t worker) {
+            char index = static_cast<char>(worker);
+            if (write(m_pipe[1], &index, 1) != 1) {
+                return 2;
+            }
+            WorkerSupervisor::notify_ready();
+            if (!exit_immediately) {
+                pause();
+            }
+            return 1;
+        };
+    }
+
+    // stops the supervisor after the given number of ticks
+    static WorkerSupervisor::Tick stop_after(int ticks, int* count, int replace_on = -1) {
+        return [ticks, count, replace_on]() {
+            if (++*count >= ticks) {
+                WorkerSupervisor::request_stop();
+            }
+            return *count == replace_on;
+        };
+    }
+
+    std::string started_workers() {
+        std::string started;
+        char buffer[64];
+        ssize_t n;
+        while ((n = read(m_pipe[0], buffer, sizeof(buffer))) > 0) {
+            started.append(buffer, static_cast<size_t>(n));
+        }
+        std::sort(started.begin(), started.end());
+        return started;
+    }
+
+    int m_pipe[2];
+};
+
+TEST_F(WorkerSupervisorTest, StartsEveryWorkerAndStopsThem) {
+    WorkerSupervisor supervisor(3, false, std::chrono::milliseconds(10));
+    int ticks = 0;
+    EXPECT_EQ(supervisor.run(reporting_worker(false), stop_after(5, &ticks)), 0);
+
+    EXPECT_EQ(started_workers(), std::string("\0\1\2", 3));
+    EXPECT_EQ(supervisor.restarts(), 0u);
+}
+
+TEST_F(WorkerSupervisorTest, RespawnsWorkersThatExit) {
+    WorkerSupervisor supervisor(1, false, std::chrono::milliseconds(10));
+    // workers that die at startup are respawned after MIN_UPTIME
+    auto start = std::chrono::steady_clock::now();
+    supervisor.run(reporting_worker(true), [&]() {
+        if (std::chrono::steady_clock::now() - start > WorkerSupervisor::MIN_UPTIME + std::chrono::milliseconds(500)) {
+            WorkerSupervisor::request_stop();
+        }
+        return false;
+    });
+
+    EXPECT_GE(supervisor.restarts(), 1u);
+    EXPECT_GE(started_workers().size(), 2u);
+}
+
+TEST_F(WorkerSupervisorTest, TickReplacesWorkers) {
+    WorkerSupervisor supervisor(2, false, std::chrono::milliseconds(10));
+    int ticks = 0;
+    supervisor.run(reporting_worker(false), stop_after(5, &ticks, 2));
+
+    // replacements are not counted as restarts
+    EXPECT_EQ(started_workers(), std::string("\0\0\1\1", 4));
+    EXPECT_EQ(supervisor.restarts(), 0u);
+}
+
+TEST_F(WorkerSupervisorTest, ReplacedWorkersRunUntilTheNewOneIsReady) {
+    WorkerSupervisor supervisor(2, false, std::chrono::milliseconds(10));
+    g_events_fd = m_pipe[1];
+    // forked workers see whether they were started by the replacing tick
+    bool replacing = false;
+    int ticks = 0;
+    auto tick = stop_after(5, &ticks, 2);
+    supervisor.run([&](size_t) {
+        if (!replacing) {
+            signal(SIGTERM, report_stopped);
+            if (write(m_pipe[1], "o", 1) != 1) {
+                return 2;
+            }
+            WorkerSupervisor::notify_ready();
+        } else {
+            // started ('n'), then ready ('r') only after a while, as a worker connecting its pool
+            if (write(m_pipe[1], "n", 1) != 1) {
+                return 2;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (write(m_pipe[1], "r", 1) != 1) {
+                return 2;
+            }
+            WorkerSupervisor::notify_ready();
+        }
+        pause();
+        return 1;
+    }, [&]() {
+        replacing = tick();
+        return replacing;
+    });
+
+    std::string events;
+    char buffer[64];
+    ssize_t n;
+    while ((n = read(m_pipe[0], buffer, sizeof(buffer))) > 0) {
+        events.append(buffer, static_cast<size_t>(n));
+    }
+    EXPECT_EQ(std::count(events.begin(), events.end(), 'o'), 2);
+    events.erase(std::remove(events.begin(), events.end(), 'o'), events.end());
+    // each old worker is stopped only after its replacement is ready, one worker at a time
+    EXPECT_EQ(events, "nrtnrt");
+    EXPECT_EQ(supervisor.restarts(), 0u);
+}
+
+TEST_F(WorkerSupervisorTest, ReplacementThatExitsKeepsTheOldWorker) {
+    WorkerSupervisor supervisor(1, false, std::chrono::milliseconds(10));
+    bool replacing = false;
+    int ticks = 0;
+    auto tick = stop_after(5, &ticks, 2);
+    supervisor.run([&](size_t) {
+        if (replacing) {
+            return 1; // fails before it is ready
+        }
+        if (write(m_pipe[1], "o", 1) != 1) {
+            return 2;
+        }
+        WorkerSupervisor::notify_ready();
+        pause();
+        return 1;
+    }, [&]() {
+        replacing = tick();
+        return replacing;
+    });
+
+    // the old worker kept serving: it was neither stopped early nor respawned
+    EXPECT_EQ(started_workers(), "o");
+    EXPECT_EQ(supervisor.restarts(), 0u);
+}
+
+TEST_F(WorkerSupervisorTest, PinsWorkersToAllowedCpus) {
+    WorkerSupervisor unpinned(2, false);
+    EXPECT_TRUE(unpinned.worker_cpus().empty());
+
+    WorkerSupervisor pinned(3, true);
+    EXPECT_EQ(pinned.worker_cpus().size(), 3u);
+}
@@ -0,0 +1,142 @@
+// Enriches a CSV or NDJSON file with locations from a local dataset file (the CSV the data
+// updater imports), without going through the service. See BulkEnricher.
+//
+//   ip_enrich --dataset FILE [--format csv|ndjson] [--column NAME] [--fields LIST] [--sorted]
+//             [--threads N] [--batch-lines N] [--ipv4-index binary|dir24|dir16] [INPUT [OUTPUT]]
+//
+// INPUT and OUTPUT default to stdin and stdout ("-"). The format defaults to ndjson for .ndjson
+// and .jsonl inputs and to csv otherwise. Progress and the final lines/sec go to stderr.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "enrich/bulk_enricher.h"
+#include "lookup/csv_dataset_loader.h"
+
+namespace {
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: ip_enrich --dataset FILE [--format csv|ndjson] [--column NAME] [--fields LIST] [--sorted]\n"
+                 "                 [--threads N] [--batch-lines N] [--ipv4-index binary|dir24|dir16] [INPUT [OUTPUT]]\n");
+}
+
+bool ends_with(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void print_stats(const char* prefix, const BulkEnricher::Stats& stats) {
+    std::fprintf(stderr, "%s%llu lines in %.1f s (%.0f lines/s): %llu found, %llu not found, %llu without an address\n",
+                 prefix, static_cast<unsigned long long>(stats.lines), stats.seconds, stats.lines_per_second(),
+                 static_cast<unsigned long long>(stats.found), static_cast<unsigned long long>(stats.not_found),
+                 static_cast<unsigned long long>(stats.invalid));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string dataset_path;
+    std::string format_name;
+    std::string fields;
+    std::string ipv4_index = "dir24";
+    BulkEnricher::Options options;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage();
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--dataset") {
+            dataset_path = value();
+        } else if (arg == "--format") {
+            format_name = value();
+        } else if (arg == "--column") {
+            options.column = value();
+        } else if (arg == "--fields") {
+            fields = value();
+        } else if (arg == "--sorted") {
+            options.sorted = true;
+        } else if (arg == "--threads") {
+            options.threads = std::strtoull(value().c_str(), nullptr, 10);
+        } else if (arg == "--batch-lines") {
+            options.batch_lines = std::strtoull(value().c_str(), nullptr, 10);
+        } else if (arg == "--ipv4-index") {
+            ipv4_index = value();
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (dataset_path.empty() || paths.size() > 2) {
+        usage();
+        return 2;
+    }
+    std::string input_path = paths.size() > 0 ? paths[0] : "-";
+    std::string output_path = paths.size() > 1 ? paths[1] : "-";
+
+    if (format_name.empty()) {
+        format_name = ends_with(input_path, ".ndjson") || ends_with(input_path, ".jsonl") ? "ndjson" : "csv";
+    }
+    auto format = BulkEnricher::parse_format(format_name);
+    auto field_mask = LocationJson::parse_fields(fields);
+    if (!format || !field_mask) {
+        std::fprintf(stderr, "ip_enrich: %s\n", !format ? "unknown format" : "unknown field in --fields");
+        return 2;
+    }
+    options.format = *format;
+    options.fields = *field_mask;
+    options.max_batches = options.threads * 4;
+    options.progress_interval = std::chrono::seconds(5);
+    options.on_progress = [](const BulkEnricher::Stats& stats) { print_stats("... ", stats); };
+
+    try {
+        auto loaded = CsvDatasetLoader::load(dataset_path, LocationDataset::parse_ipv4_index(ipv4_index));
+        std::fprintf(stderr, "dataset: %zu IPv4 and %zu IPv6 ranges, %zu skipped rows\n",
+                     loaded.dataset->ipv4_range_count(), loaded.dataset->ipv6_range_count(), loaded.skipped);
+
+        std::ifstream input_file;
+        std::ofstream output_file;
+        std::vector<char> output_buffer(1 << 20);
+        if (input_path != "-") {
+            input_file.open(input_path, std::ios::binary);
+            if (!input_file) {
+                throw std::runtime_error("Cannot open " + input_path);
+            }
+        }
+        if (output_path != "-") {
+            output_file.rdbuf()->pubsetbuf(output_buffer.data(), static_cast<std::streamsize>(output_buffer.size()));
+            output_file.open(output_path, std::ios::binary | std::ios::trunc);
+            if (!output_file) {
+                throw std::runtime_error("Cannot open " + output_path);
+            }
+        }
+        std::ios::sync_with_stdio(false);
+        std::istream& in = input_path != "-" ? static_cast<std::istream&>(input_file) : std::cin;
+        std::ostream& out = output_path != "-" ? static_cast<std::ostream&>(output_file) : std::cout;
+
+        BulkEnricher enricher(loaded.dataset, options);
+        print_stats("", enricher.run(in, out));
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "ip_enrich: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,356 @@
+// Replays lookups captured with CAPTURE_FILE against a running service, to compare builds on
+// the production key distribution and hit ratio rather than synthetic addresses.
+//
+//   replay_traffic [--host H] [--port P] [--connections N] [--speed X | --max] [--limit N] FILE...
+//
+// Requests are sent open loop: each one is due at its captured arrival time divided by
+// `speed`, whether or not earlier ones have been answered, and its latency is counted from
+// when it was due. A stall then shows up in the percentiles instead of quietly delaying the
+// requests behind it (coordinated omission). Due requests wait for a free keep-alive
+// connection; the send lag reports how far the harness itself fell behind. --max sends as
+// fast as the connections allow and counts latency from the actual send.
+//
+// Several files, e.g. one per prefork worker, are merged by arrival time. Every request
+// carries X-Server-Timing: 1, and the stages in the response's Server-Timing header tell
+// whether it was answered from memory, from Redis or from Postgres. The target's
+// RATE_LIMIT_REQUESTS must allow the replayed rate from one client.
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "utils/traffic_capture.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr const char* FIELD_NAMES[] = {"country", "city", "region", "latitude", "longitude", "postal_code", "timezone"};
+constexpr uint8_t ALL_FIELDS = 0x7F;
+
+enum class Source { MEMORY, CACHE, DATABASE, OTHER };
+
+struct Connection {
+    int fd = -1;
+    std::string in;
+    size_t request = 0;
+    Clock::time_point due;
+    Clock::time_point sent;
+};
+
+struct Totals {
+    size_t ok = 0;
+    size_t not_found = 0;
+    size_t rate_limited = 0;
+    size_t other_status = 0;
+    size_t errors = 0;
+    size_t sources[4] = {};
+    std::vector<double> latency_ms;
+    std::vector<double> lag_ms;
+};
+
+int connect_to(const char* host, const char* port) {
+    addrinfo hints{};
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* resolved = nullptr;
+    if (getaddrinfo(host, port, &hints, &resolved) != 0 || !resolved) {
+        return -1;
+    }
+    int fd = socket(resolved->ai_family, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, resolved->ai_addr, resolved->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(resolved);
+    if (fd >= 0) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+std::string request_text(const CapturedRequest& request, const char* host) {
+    std::string text = "GET /ip-location?ip=" + request.address.to_string();
+    if (request.fields != ALL_FIELDS) {
+        text += "&fields=ip";
+        for (size_t i = 0; i < 7; ++i) {
+            if (request.fields & (1 << i)) {
+                text += ',';
+                text += FIELD_NAMES[i];
+            }
+        }
+    }
+    text += " HTTP/1.1\r\nHost: ";
+    text += host;
+    text += "\r\nX-Server-Timing: 1\r\n\r\n";
+    return text;
+}
+
+// length of the first complete response in `in`, or 0; fills in its status and source
+size_t complete_response(const std::string& in, int& status, Source& source) {
+    size_t header_end = in.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return 0;
+    }
+    status = std::atoi(in.c_str() + in.find(' ') + 1);
+
+    std::string headers = in.substr(0, header_end);
+    std::transform(headers.begin(), headers.end(), headers.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t content_length = 0;
+    size_t length_header = headers.find("\r\ncontent-length:");
+    if (length_header != std::string::npos) {
+        content_length = std::strtoull(headers.c_str() + length_header + 17, nullptr, 10);
+    }
+    size_t total = header_end + 4 + content_length;
+    if (in.size() < total) {
+        return 0;
+    }
+
+    source = Source::OTHER;
+    size_t timing_header = headers.find("\r\nserver-timing:");
+    if (timing_header != std::string::npos) {
+        std::string timing = headers.substr(timing_header, headers.find("\r\n", timing_header + 2) - timing_header);
+        // a cache miss runs the cache stage too, so the query stage is looked for first
+        if (timing.find("query;") != std::string::npos) {
+            source = Source::DATABASE;
+        } else if (timing.find("cache;") != std::string::npos) {
+            source = Source::CACHE;
+        } else if (timing.find("memory;") != std::string::npos) {
+            source = Source::MEMORY;
+        }
+    }
+    return total;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+    return sorted[index];
+}
+
+void usage() {
+    std::fprintf(stderr, "usage: replay_traffic [--host H] [--port P] [--connections N] [--speed X | --max] [--limit N] FILE...\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* host = "127.0.0.1";
+    const char* port = "8080";
+    size_t connection_count = 64;
+    double speed = 1.0;
+    bool max_speed = false;
+    size_t limit = 0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--host" && has_value) {
+            host = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            port = argv[++i];
+        } else if (arg == "--connections" && has_value) {
+            connection_count = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--speed" && has_value) {
+            speed = std::atof(argv[++i]);
+        } else if (arg == "--max") {
+            max_speed = true;
+        } else if (arg == "--limit" && has_value) {
+            limit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] != '-') {
+            paths.push_back(arg);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (paths.empty() || speed <= 0) {
+        usage();
+        return 2;
+    }
+
+    // merged by arrival time across files
+    struct Scheduled {
+        int64_t unix_ns;
+        CapturedRequest request;
+    };
+    std::vector<Scheduled> schedule;
+    try {
+        for (const auto& path : paths) {
+            auto contents = TrafficLog::read(path);
+            for (const auto& request : contents.requests) {
+                schedule.push_back({contents.start_unix_ns + static_cast<int64_t>(request.offset_ns), request});
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "replay_traffic: %s\n", e.what());
+        return 1;
+    }
+    std::stable_sort(schedule.begin(), schedule.end(),
+                     [](const Scheduled& a, const Scheduled& b) { return a.unix_ns < b.unix_ns; });
+    if (limit > 0 && schedule.size() > limit) {
+        schedule.resize(limit);
+    }
+    if (schedule.empty()) {
+        std::fprintf(stderr, "replay_traffic: no requests captured\n");
+        return 1;
+    }
+    double captured_seconds = static_cast<double>(schedule.back().unix_ns - schedule.front().unix_ns) / 1e9;
+
+    int epoll_fd = epoll_create1(0);
+    std::vector<Connection> connections(connection_count);
+    std::vector<size_t> idle;
+    auto open_connection = [&](size_t index) {
+        Connection& connection = connections[index];
+        connection.fd = connect_to(host, port);
+        if (connection.fd < 0) {
+            return false;
+        }
+        connection.in.clear();
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = index;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection.fd, &event);
+        idle.push_back(index);
+        return true;
+    };
+    for (size_t i = 0; i < connection_count; ++i) {
+        if (!open_connection(i)) {
+            std::fprintf(stderr, "replay_traffic: cannot connect to %s:%s\n", host, port);
+            return 1;
+        }
+    }
+
+    Totals totals;
+    totals.latency_ms.reserve(schedule.size());
+    totals.lag_ms.reserve(schedule.size());
+    std::deque<size_t> due;
+    size_t next = 0;
+    size_t completed = 0;
+    auto start = Clock::now();
+    auto due_time = [&](size_t i) {
+        if (max_speed) {
+            return start;
+        }
+        auto offset = static_cast<double>(schedule[i].unix_ns - schedule.front().unix_ns) / speed;
+        return start + std::chrono::nanoseconds(static_cast<int64_t>(offset));
+    };
+
+    std::vector<epoll_event> events(connection_count);
+    char buffer[16384];
+    while (completed < schedule.size()) {
+        auto now = Clock::now();
+        while (next < schedule.size() && due_time(next) <= now) {
+            due.push_back(next++);
+        }
+        while (!due.empty() && !idle.empty()) {
+            size_t index = idle.back();
+            idle.pop_back();
+            Connection& connection = connections[index];
+            connection.request = due.front();
+            due.pop_front();
+            connection.due = due_time(connection.request);
+            connection.sent = Clock::now();
+            std::string text = request_text(schedule[connection.request].request, host);
+            if (send(connection.fd, text.data(), text.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(text.size())) {
+                ++totals.errors;
+                ++completed;
+                close(connection.fd);
+                if (!open_connection(index)) {
+                    std::fprintf(stderr, "replay_traffic: lost the connection to %s:%s\n", host, port);
+                    return 1;
+                }
+            }
+        }
+
+        int timeout_ms = -1;
+        if (next < schedule.size() && due.empty()) {
+            // rounded down: the last millisecond before a send is polled through, not slept past
+            auto wait = std::chrono::floor<std::chrono::milliseconds>(due_time(next) - Clock::now()).count();
+            timeout_ms = static_cast<int>(std::max<int64_t>(wait, 0));
+        }
+        int ready = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            std::perror("epoll_wait");
+            return 1;
+        }
+        for (int e = 0; e < ready; ++e) {
+            size_t index = events[e].data.u64;
+            Connection& connection = connections[index];
+            ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                ++totals.errors;
+                ++completed;
+                close(connection.fd);
+                if (!open_connection(index)) {
+                    std::fprintf(stderr, "replay_traffic: lost the connection to %s:%s\n", host, port);
+                    return 1;
+                }
+                continue;
+            }
+            connection.in.append(buffer, static_cast<size_t>(n));
+
+            int status = 0;
+            Source source = Source::OTHER;
+            size_t length = complete_response(connection.in, status, source);
+            if (length == 0) {
+                continue;
+            }
+            auto finished = Clock::now();
+            connection.in.erase(0, length);
+            auto from = max_speed ? connection.sent : connection.due;
+            totals.latency_ms.push_back(std::chrono::duration<double, std::milli>(finished - from).count());
+            totals.lag_ms.push_back(std::chrono::duration<double, std::milli>(connection.sent - connection.due).count());
+            ++totals.sources[static_cast<size_t>(source)];
+            if (status == 200) {
+                ++totals.ok;
+            } else if (status == 404) {
+                ++totals.not_found;
+            } else if (status == 429) {
+                ++totals.rate_limited;
+            } else {
+                ++totals.other_status;
+            }
+            ++completed;
+            idle.push_back(index);
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(totals.latency_ms.begin(), totals.latency_ms.end());
+    std::sort(totals.lag_ms.begin(), totals.lag_ms.end());
+    size_t answered = totals.sources[0] + totals.sources[1] + totals.sources[2];
+    std::printf("replayed %zu requests from %zu file(s), captured over %.1f s, ", schedule.size(), paths.size(),
+                captured_seconds);
+    if (max_speed) {
+        std::printf("at maximum speed\n");
+    } else {
+        std::printf("at %.2fx (target %.0f req/s)\n", speed,
+                    captured_seconds > 0 ? static_cast<double>(schedule.size()) * speed / captured_seconds : 0.0);
+    }
+    std::printf("took %.1f s, %.0f req/s\n", seconds, static_cast<double>(schedule.size()) / seconds);
+    std::printf("status: 200 %zu, 404 %zu, 429 %zu, other %zu; connection errors %zu\n", totals.ok, totals.not_found,
+                totals.rate_limited, totals.other_status, totals.errors);
+    std::printf("answered from memory %zu, cache %zu, database %zu; hit ratio %.1f%%\n", totals.sources[0],
+                totals.sources[1], totals.sources[2],
+                answered > 0 ? 100.0 * static_cast<double>(totals.sources[0] + totals.sources[1]) / static_cast<double>(answered) : 0.0);
+    std::printf("latency ms from %s: p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+                max_speed ? "send" : "due time", percentile(totals.latency_ms, 0.50), percentile(totals.latency_ms, 0.90),
+                percentile(totals.latency_ms, 0.99), percentile(totals.latency_ms, 0.999),
+                totals.latency_ms.empty() ? 0.0 : totals.latency_ms.back());
+    if (!max_speed) {
+        std::printf("send lag ms: p50 %.3f  p99 %.3f  max %.3f (a large lag means too few --connections)\n",
+                    percentile(totals.lag_ms, 0.50), percentile(totals.lag_ms, 0.99),
+                    totals.lag_ms.empty() ? 0.0 : totals.lag_ms.back());
+    }
+    return 0;
+}
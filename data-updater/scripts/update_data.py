@@ -20,6 +20,9 @@ DB_PORT = os.getenv("DB_PORT", "5432")
 
 CSV_URL = "https://docs.google.com/uc?export=download&id=1jSFgZC37plw90CkioEsKvunaeMKUv_rq"
 
+# must match DATA_UPDATE_TIME_UTC on the API so cache TTLs line up with the swap
+UPDATE_TIME_UTC = os.getenv("UPDATE_TIME_UTC", "02:00")
+
 def get_db_connection():
     """Establishes and returns a PostgreSQL database connection."""
     conn_string = f"host={DB_HOST} port={DB_PORT} dbname={DB_NAME} user={DB_USER} password={DB_PASSWORD}"
@@ -111,8 +114,9 @@ def update_ip_data():
             """
             
             cur.copy_expert(copy_sql, csv_file_like_object)
+            row_count = cur.rowcount
             
-            logger.info(f"Copied {cur.rowcount} rows into ip_locations_new.")
+            logger.info(f"Copied {row_count} rows into ip_locations_new.")
 
             logger.info("Creating indexes...")
             cur.execute("CREATE INDEX ON ip_locations_new (start_ip) WHERE start_ip IS NOT NULL;")
@@ -146,9 +150,21 @@ def update_ip_data():
                 cur.execute("DROP TABLE ip_locations_old;")
             else:
                 cur.execute("ALTER TABLE ip_locations_new RENAME TO ip_locations;")
+
+            # the API polls this table and versions its cache keys with the latest generation,
+            # so it is bumped in the same transaction as the swap
+            cur.execute("""
+                CREATE TABLE IF NOT EXISTS dataset_generations (
+                    generation BIGSERIAL PRIMARY KEY,
+                    row_count BIGINT,
+                    created_at TIMESTAMPTZ NOT NULL DEFAULT now()
+                );
+            """)
+            cur.execute("INSERT INTO dataset_generations (row_count) VALUES (%s) RETURNING generation;", (row_count,))
+            generation = cur.fetchone()[0]
             
             conn.commit()
-            logger.info("Atomic table swap complete.")
+            logger.info(f"Atomic table swap complete, dataset generation is now {generation}.")
 
     except requests.exceptions.RequestException as e:
         logger.error(f"Error downloading CSV: {e}")
@@ -175,9 +191,9 @@ class DataUpdateScheduler:
         self.update_in_progress = False
 
     def schedule_updates(self):
-        """Schedule daily updates at 2 AM"""
-        schedule.every().day.at("02:00").do(self.safe_update)
-        logger.info("Scheduled daily updates at 2:00 AM")
+        """Schedule daily updates (2 AM UTC by default)"""
+        schedule.every().day.at(UPDATE_TIME_UTC, "UTC").do(self.safe_update)
+        logger.info(f"Scheduled daily updates at {UPDATE_TIME_UTC} UTC")
         
         while True:
             schedule.run_pending()